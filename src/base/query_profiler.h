@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_QUERY_PROFILER_H_
+#define SRC_BASE_QUERY_PROFILER_H_
+
+#include <chrono>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "bthread/bthread.h"
+
+namespace fedb {
+namespace base {
+
+struct ProfileStage {
+    std::string name;
+    uint64_t time_us;
+    uint64_t row_cnt;
+    // times the stage is entered, e.g. one for every remote call
+    uint64_t cnt;
+};
+
+// time and rows spent by one query in its stages. the profiler is bound to
+// the running bthread, so code deep in the execution records into it without
+// passing it around, and records nothing when no query is profiled. a bthread
+// key rather than thread_local, as a bthread blocked on an rpc may resume on
+// another pthread
+class QueryProfiler {
+ public:
+    QueryProfiler() : stages_(), start_(Clock::now()) {}
+    ~QueryProfiler() {}
+
+    // stages with the same name add up and keep the order they first show up
+    void Add(const std::string& name, uint64_t time_us, uint64_t row_cnt) {
+        for (auto& stage : stages_) {
+            if (stage.name == name) {
+                stage.time_us += time_us;
+                stage.row_cnt += row_cnt;
+                stage.cnt++;
+                return;
+            }
+        }
+        stages_.push_back(ProfileStage{name, time_us, row_cnt, 1});
+    }
+
+    const std::vector<ProfileStage>& GetStages() const { return stages_; }
+
+    uint64_t GetTotalTime() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+    }
+
+    static QueryProfiler* Current() { return static_cast<QueryProfiler*>(bthread_getspecific(GetKey())); }
+
+    // binds a profiler to the bthread for the scope, a null profiler does nothing
+    class Scope {
+     public:
+        explicit Scope(QueryProfiler* profiler) : last_(Current()) { SetCurrent(profiler); }
+        ~Scope() { SetCurrent(last_); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+     private:
+        QueryProfiler* last_;
+    };
+
+    // times the scope into a stage of the current profiler
+    class Stage {
+     public:
+        explicit Stage(const char* name) : profiler_(Current()), name_(name), row_cnt_(0), start_() {
+            if (profiler_ != nullptr) {
+                start_ = Clock::now();
+            }
+        }
+        ~Stage() {
+            if (profiler_ != nullptr) {
+                uint64_t time_us =
+                    std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+                profiler_->Add(name_, time_us, row_cnt_);
+            }
+        }
+        Stage(const Stage&) = delete;
+        Stage& operator=(const Stage&) = delete;
+
+        void SetRowCnt(uint64_t row_cnt) { row_cnt_ = row_cnt; }
+
+     private:
+        QueryProfiler* profiler_;
+        const char* name_;
+        uint64_t row_cnt_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    static bthread_key_t GetKey() {
+        static bthread_key_t key = [] {
+            bthread_key_t new_key;
+            bthread_key_create(&new_key, nullptr);
+            return new_key;
+        }();
+        return key;
+    }
+
+    static void SetCurrent(QueryProfiler* profiler) { bthread_setspecific(GetKey(), profiler); }
+
+    std::vector<ProfileStage> stages_;
+    Clock::time_point start_;
+};
+
+}  // namespace base
+}  // namespace fedb
+
+#endif  // SRC_BASE_QUERY_PROFILER_H_
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/query_profiler.h"
+
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace base {
+
+class QueryProfilerTest : public ::testing::Test {
+ public:
+    QueryProfilerTest() {}
+    ~QueryProfilerTest() {}
+};
+
+TEST_F(QueryProfilerTest, Stage) {
+    QueryProfiler profiler;
+    {
+        QueryProfiler::Scope scope(&profiler);
+        {
+            QueryProfiler::Stage stage("compile");
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        for (int i = 0; i < 3; i++) {
+            QueryProfiler::Stage stage("remote_wait");
+            stage.SetRowCnt(2);
+        }
+    }
+    ASSERT_EQ(nullptr, QueryProfiler::Current());
+    {
+        // not profiled
+        QueryProfiler::Stage stage("run");
+    }
+    const auto& stages = profiler.GetStages();
+    ASSERT_EQ(2u, stages.size());
+    ASSERT_EQ("compile", stages[0].name);
+    ASSERT_GE(stages[0].time_us, 2000u);
+    ASSERT_EQ(1u, stages[0].cnt);
+    ASSERT_EQ("remote_wait", stages[1].name);
+    ASSERT_EQ(3u, stages[1].cnt);
+    ASSERT_EQ(6u, stages[1].row_cnt);
+    ASSERT_GE(profiler.GetTotalTime(), stages[0].time_us);
+}
+
+TEST_F(QueryProfilerTest, NestedScope) {
+    QueryProfiler outer;
+    QueryProfiler inner;
+    QueryProfiler::Scope outer_scope(&outer);
+    {
+        QueryProfiler::Scope inner_scope(&inner);
+        QueryProfiler::Stage stage("run");
+    }
+    ASSERT_EQ(&outer, QueryProfiler::Current());
+    ASSERT_EQ(1u, inner.GetStages().size());
+    ASSERT_EQ(0u, outer.GetStages().size());
+}
+
+}  // namespace base
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_RATE_LIMITER_H_
+#define SRC_BASE_RATE_LIMITER_H_
+
+#include <chrono>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+namespace fedb {
+namespace base {
+
+// token bucket shared by the threads of one transfer. rate is the tokens
+// refilled per second and burst caps the tokens saved while idle. a caller
+// takes its tokens right away and sleeps off the debt outside the lock, so
+// waiters are served in arrival order
+class RateLimiter {
+ public:
+    RateLimiter(uint64_t rate, uint64_t burst)
+        : rate_(rate), burst_(burst), tokens_(static_cast<double>(burst)), last_(Clock::now()), mu_() {}
+    ~RateLimiter() {}
+
+    // the time in microseconds to wait before n tokens may be used. 0 rate means no limit
+    uint64_t Reserve(uint64_t n) {
+        if (rate_ == 0) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        auto now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - last_).count();
+        last_ = now;
+        tokens_ += elapsed * rate_;
+        if (tokens_ > burst_) {
+            tokens_ = static_cast<double>(burst_);
+        }
+        tokens_ -= n;
+        if (tokens_ >= 0) {
+            return 0;
+        }
+        return static_cast<uint64_t>(-tokens_ * 1000000 / rate_);
+    }
+
+    void Acquire(uint64_t n) {
+        uint64_t wait_time = Reserve(n);
+        if (wait_time > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(wait_time));
+        }
+    }
+
+ private:
+    using Clock = std::chrono::steady_clock;
+    uint64_t rate_;
+    uint64_t burst_;
+    double tokens_;
+    Clock::time_point last_;
+    std::mutex mu_;
+};
+
+}  // namespace base
+}  // namespace fedb
+
+#endif  // SRC_BASE_RATE_LIMITER_H_
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/rate_limiter.h"
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace base {
+
+class RateLimiterTest : public ::testing::Test {
+ public:
+    RateLimiterTest() {}
+    ~RateLimiterTest() {}
+};
+
+TEST_F(RateLimiterTest, Unlimited) {
+    RateLimiter limiter(0, 0);
+    ASSERT_EQ(0u, limiter.Reserve(1000000));
+}
+
+TEST_F(RateLimiterTest, Reserve) {
+    RateLimiter limiter(1000, 1000);
+    // the burst is free
+    ASSERT_EQ(0u, limiter.Reserve(1000));
+    // the next 500 tokens take about half a second
+    uint64_t wait_time = limiter.Reserve(500);
+    ASSERT_GT(wait_time, 400000u);
+    ASSERT_LE(wait_time, 500000u);
+    // the debt adds up
+    ASSERT_GT(limiter.Reserve(500), wait_time + 400000u);
+}
+
+TEST_F(RateLimiterTest, Acquire) {
+    RateLimiter limiter(1000000, 10000);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 6; i++) {
+        limiter.Acquire(10000);
+    }
+    auto used = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ASSERT_GE(used.count(), 40);
+}
+
+}  // namespace base
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -340,6 +340,11 @@ class Skiplist {
             return node_->GetValue();
         }
 
+        uint8_t GetHeight() const {
+            assert(Valid());
+            return node_->Height();
+        }
+
         void Seek(const K& k) {
             node_ = list_->FindLessThan(k);
             Next();
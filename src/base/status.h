@@ -196,6 +196,9 @@ enum ReturnCode {
     kSdkEndpointDuplicate = 156,
     kProcedureAlreadyExists = 157,
     kProcedureNotFound = 158,
+    kReplicaOffsetBehind = 159,
+    kIndexNotReady = 160,
+    kServerOverloaded = 161,
     kNameserverIsNotLeader = 300,
     kAutoFailoverIsEnabled = 301,
     kEndpointIsNotExist = 302,
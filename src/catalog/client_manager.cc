@@ -19,6 +19,7 @@
 
 #include <utility>
 
+#include "base/query_profiler.h"
 #include "codec/fe_schema_codec.h"
 #include "codec/sql_rpc_row_codec.h"
 
@@ -52,7 +53,11 @@ const ::hybridse::codec::Row& TabletRowHandler::GetValue() {
         return row_;
     }
     DLOG(INFO) << "TabletRowHandler get value by brpc join";
-    brpc::Join(cntl->call_id());
+    {
+        ::fedb::base::QueryProfiler::Stage stage("remote_wait");
+        stage.SetRowCnt(1);
+        brpc::Join(cntl->call_id());
+    }
     if (cntl->Failed()) {
         status_ = ::hybridse::base::Status(::hybridse::common::kRpcError, "request error. " + cntl->ErrorText());
         return row_;
@@ -112,7 +117,11 @@ void AsyncTableHandler::SyncRpcResponse() {
         LOG(WARNING) << status_.msg;
         return;
     }
-    brpc::Join(cntl->call_id());
+    {
+        ::fedb::base::QueryProfiler::Stage stage("remote_batch_wait");
+        brpc::Join(cntl->call_id());
+        stage.SetRowCnt(response->count());
+    }
     if (cntl->Failed()) {
         status_ = ::hybridse::base::Status(::hybridse::common::kRpcError, "request error. " + cntl->ErrorText());
         LOG(WARNING) << status_.msg;
@@ -355,7 +364,7 @@ std::shared_ptr<hybridse::vm::TableHandler> TabletsAccessor::SubQuery(uint32_t t
 }
 PartitionClientManager::PartitionClientManager(uint32_t pid, const std::shared_ptr<TabletAccessor>& leader,
                                                const std::vector<std::shared_ptr<TabletAccessor>>& followers)
-    : pid_(pid), leader_(leader), followers_(followers), rand_(0xdeadbeef) {}
+    : pid_(pid), leader_(leader), followers_(followers), rand_(0xdeadbeef), read_cnt_(0) {}
 
 std::shared_ptr<TabletAccessor> PartitionClientManager::GetFollower() {
     if (!followers_.empty()) {
@@ -365,6 +374,52 @@ std::shared_ptr<TabletAccessor> PartitionClientManager::GetFollower() {
     return std::shared_ptr<TabletAccessor>();
 }
 
+std::shared_ptr<TabletAccessor> PartitionClientManager::GetLeastLoaded(
+    const std::vector<std::shared_ptr<TabletAccessor>>& tablets) {
+    if (tablets.empty()) {
+        return std::shared_ptr<TabletAccessor>();
+    }
+    // the replicas tied at the least cost take the reads in turn
+    std::vector<std::shared_ptr<TabletAccessor>> candidates;
+    int64_t min_cost = 0;
+    for (const auto& tablet : tablets) {
+        int64_t cost = tablet->GetLoadCost();
+        if (candidates.empty() || cost < min_cost) {
+            candidates.clear();
+            min_cost = cost;
+        }
+        if (cost == min_cost) {
+            candidates.push_back(tablet);
+        }
+    }
+    uint32_t idx = read_cnt_.fetch_add(1, std::memory_order_relaxed) % candidates.size();
+    return candidates[idx];
+}
+
+std::shared_ptr<TabletAccessor> PartitionClientManager::GetReadTablet() {
+    if (followers_.empty()) {
+        return leader_;
+    }
+    std::vector<std::shared_ptr<TabletAccessor>> tablets(followers_);
+    if (leader_) {
+        tablets.push_back(leader_);
+    }
+    return GetLeastLoaded(tablets);
+}
+
+std::shared_ptr<TabletAccessor> PartitionClientManager::GetOtherTablet(const std::shared_ptr<TabletAccessor>& tablet) {
+    std::vector<std::shared_ptr<TabletAccessor>> others;
+    if (leader_ && leader_ != tablet) {
+        others.push_back(leader_);
+    }
+    for (const auto& follower : followers_) {
+        if (follower && follower != tablet) {
+            others.push_back(follower);
+        }
+    }
+    return GetLeastLoaded(others);
+}
+
 TableClientManager::TableClientManager(const TablePartitions& partitions, const ClientManager& client_manager) {
     for (const auto& table_partition : partitions) {
         uint32_t pid = table_partition.pid();
@@ -445,15 +500,23 @@ std::shared_ptr<TabletAccessor> ClientManager::GetTablet() const {
     if (clients_.empty()) {
         return std::shared_ptr<TabletAccessor>();
     }
-    uint32_t seq = rand_.Uniform(clients_.size());
+    // the power of two choices keeps off the busy tablets without a full scan
+    uint32_t seq[2] = {rand_.Uniform(clients_.size()), rand_.Uniform(clients_.size())};
+    std::shared_ptr<TabletAccessor> tablet[2];
     uint32_t cnt = 0;
     for (const auto& kv : clients_) {
-        if (cnt == seq) {
-            return kv.second;
+        if (cnt == seq[0]) {
+            tablet[0] = kv.second;
+        }
+        if (cnt == seq[1]) {
+            tablet[1] = kv.second;
         }
         cnt++;
     }
-    return std::shared_ptr<TabletAccessor>();
+    if (tablet[0] && tablet[1] && tablet[1]->GetLoadCost() < tablet[0]->GetLoadCost()) {
+        return tablet[1];
+    }
+    return tablet[0];
 }
 
 bool ClientManager::UpdateClient(const std::map<std::string, std::string>& endpoint_map) {
@@ -465,7 +528,7 @@ bool ClientManager::UpdateClient(const std::map<std::string, std::string>& endpo
     for (const auto& kv : endpoint_map) {
         auto it = real_endpoint_map_.find(kv.first);
         if (it == real_endpoint_map_.end()) {
-            auto wrapper = std::make_shared<TabletAccessor>(kv.first);
+            auto wrapper = std::make_shared<TabletAccessor>(kv.first, connection_type_);
             if (!wrapper->UpdateClient(kv.second)) {
                 LOG(WARNING) << "add client failed. name " << kv.first << ", endpoint " << kv.second;
                 continue;
@@ -18,6 +18,7 @@
 #ifndef SRC_CATALOG_CLIENT_MANAGER_H_
 #define SRC_CATALOG_CLIENT_MANAGER_H_
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <memory>
@@ -131,17 +132,20 @@ class AsyncTablesHandler : public ::hybridse::vm::MemTableHandler {
 
 class TabletAccessor : public ::hybridse::vm::Tablet {
  public:
-    explicit TabletAccessor(const std::string& name) : name_(name), tablet_client_() {}
+    explicit TabletAccessor(const std::string& name) : name_(name), connection_type_(), tablet_client_() {}
+
+    TabletAccessor(const std::string& name, const std::string& connection_type)
+        : name_(name), connection_type_(connection_type), tablet_client_() {}
 
     TabletAccessor(const std::string& name, const std::shared_ptr<::fedb::client::TabletClient>& client)
-        : name_(name), tablet_client_(client) {}
+        : name_(name), connection_type_(), tablet_client_(client) {}
 
     std::shared_ptr<::fedb::client::TabletClient> GetClient() {
         return std::atomic_load_explicit(&tablet_client_, std::memory_order_relaxed);
     }
 
     bool UpdateClient(const std::string& endpoint) {
-        auto client = std::make_shared<::fedb::client::TabletClient>(name_, endpoint);
+        auto client = std::make_shared<::fedb::client::TabletClient>(name_, endpoint, false, connection_type_);
         if (client->Init() != 0) {
             return false;
         }
@@ -166,8 +170,18 @@ class TabletAccessor : public ::hybridse::vm::Tablet {
                                                            const bool is_debug) override;
     const std::string& GetName() const { return name_; }
 
+    // the expected wait of one more request, see RpcLoad
+    int64_t GetLoadCost() {
+        auto client = GetClient();
+        if (!client) {
+            return INT64_MAX;
+        }
+        return client->GetLoad()->GetCost();
+    }
+
  private:
     std::string name_;
+    std::string connection_type_;
     std::shared_ptr<::fedb::client::TabletClient> tablet_client_;
 };
 class TabletsAccessor : public ::hybridse::vm::Tablet {
@@ -219,11 +233,22 @@ class PartitionClientManager {
 
     std::shared_ptr<TabletAccessor> GetFollower();
 
+    // the least loaded of the leader and all followers, used by follower reads.
+    // replicas as loaded as each other are taken in turn
+    std::shared_ptr<TabletAccessor> GetReadTablet();
+
+    // the least loaded replica other than tablet, used by hedged reads. null if
+    // there is none
+    std::shared_ptr<TabletAccessor> GetOtherTablet(const std::shared_ptr<TabletAccessor>& tablet);
+
  private:
+    std::shared_ptr<TabletAccessor> GetLeastLoaded(const std::vector<std::shared_ptr<TabletAccessor>>& tablets);
+
     uint32_t pid_;
     std::shared_ptr<TabletAccessor> leader_;
     std::vector<std::shared_ptr<TabletAccessor>> followers_;
     ::fedb::base::Random rand_;
+    std::atomic<uint32_t> read_cnt_;
 };
 
 class ClientManager;
@@ -266,6 +291,22 @@ class TableClientManager {
         }
         return std::shared_ptr<TabletAccessor>();
     }
+
+    std::shared_ptr<TabletAccessor> GetReadTablet(uint32_t pid) const {
+        auto partition_manager = GetPartitionClientManager(pid);
+        if (partition_manager) {
+            return partition_manager->GetReadTablet();
+        }
+        return std::shared_ptr<TabletAccessor>();
+    }
+
+    std::shared_ptr<TabletAccessor> GetOtherTablet(uint32_t pid, const std::shared_ptr<TabletAccessor>& tablet) const {
+        auto partition_manager = GetPartitionClientManager(pid);
+        if (partition_manager) {
+            return partition_manager->GetOtherTablet(tablet);
+        }
+        return std::shared_ptr<TabletAccessor>();
+    }
     std::shared_ptr<TabletsAccessor> GetTablet(std::vector<uint32_t> pids) const {
         std::shared_ptr<TabletsAccessor> tablets_accessor = std::shared_ptr<TabletsAccessor>(new TabletsAccessor());
         for (size_t idx = 0; idx < pids.size(); idx++) {
@@ -291,8 +332,12 @@ class TableClientManager {
 
 class ClientManager {
  public:
-    ClientManager() : real_endpoint_map_(), clients_(), mu_(), rand_(0xdeadbeef) {}
+    ClientManager() : connection_type_(), real_endpoint_map_(), clients_(), mu_(), rand_(0xdeadbeef) {}
+    // connection_type of the channels to the tablets, see RpcClient
+    explicit ClientManager(const std::string& connection_type)
+        : connection_type_(connection_type), real_endpoint_map_(), clients_(), mu_(), rand_(0xdeadbeef) {}
     std::shared_ptr<TabletAccessor> GetTablet(const std::string& name) const;
+    // the less loaded of two tablets picked at random
     std::shared_ptr<TabletAccessor> GetTablet() const;
 
     bool UpdateClient(const std::map<std::string, std::string>& real_ep_map);
@@ -300,6 +345,7 @@ class ClientManager {
     bool UpdateClient(const std::map<std::string, std::shared_ptr<::fedb::client::TabletClient>>& tablet_clients);
 
  private:
+    std::string connection_type_;
     std::unordered_map<std::string, std::string> real_endpoint_map_;
     std::unordered_map<std::string, std::shared_ptr<TabletAccessor>> clients_;
     mutable ::fedb::base::SpinMutex mu_;
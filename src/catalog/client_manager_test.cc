@@ -71,6 +71,41 @@ TEST_F(ClientManagerTest, client_manager_test) {
     ASSERT_EQ("name0", table_client_manager.GetPartitionClientManager(0)->GetLeader()->GetClient()->GetEndpoint());
     ASSERT_EQ("endpoint3",
               table_client_manager.GetPartitionClientManager(0)->GetLeader()->GetClient()->GetRealEndpoint());
+
+    // reads are spread over all replicas of a partition
+    std::map<std::string, int> read_cnt;
+    for (int i = 0; i < 30; i++) {
+        read_cnt[table_client_manager.GetReadTablet(1)->GetName()]++;
+    }
+    ASSERT_EQ(3u, read_cnt.size());
+    ASSERT_EQ(10, read_cnt["name0"]);
+    ASSERT_EQ(10, read_cnt["name1"]);
+    ASSERT_EQ(10, read_cnt["name2"]);
+    ASSERT_FALSE(table_client_manager.GetReadTablet(8));
+
+    // hedged reads go to the other replicas
+    auto leader = table_client_manager.GetTablet(2);
+    std::map<std::string, int> hedge_cnt;
+    for (int i = 0; i < 10; i++) {
+        hedge_cnt[table_client_manager.GetOtherTablet(2, leader)->GetName()]++;
+    }
+    ASSERT_EQ(2u, hedge_cnt.size());
+    ASSERT_EQ(5, hedge_cnt["name1"]);
+    ASSERT_EQ(5, hedge_cnt["name2"]);
+    ASSERT_FALSE(table_client_manager.GetOtherTablet(8, leader));
+
+    // reads keep off the replica with requests on the way
+    client1->GetLoad()->Begin();
+    read_cnt.clear();
+    for (int i = 0; i < 30; i++) {
+        read_cnt[table_client_manager.GetReadTablet(1)->GetName()]++;
+    }
+    ASSERT_EQ(0, read_cnt["name1"]);
+    ASSERT_EQ(15, read_cnt["name2"]);
+    ASSERT_EQ(15, read_cnt["name0"]);
+    client1->GetLoad()->End(1000);
+    ASSERT_EQ(0, client1->GetLoad()->GetInflight());
+    ASSERT_EQ(1000, client1->GetLoad()->GetLatency());
 }
 
 }  // namespace catalog
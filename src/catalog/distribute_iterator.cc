@@ -26,6 +26,7 @@ FullTableIterator::FullTableIterator(std::shared_ptr<Tables> tables) :
 void FullTableIterator::SeekToFirst() {
     it_.reset();
     for (const auto& kv : *tables_) {
+        kv.second->RecordRead();
         it_.reset(kv.second->NewTraverseIterator(0));
         it_->SeekToFirst();
         if (it_->Valid()) {
@@ -48,6 +49,7 @@ void FullTableIterator::Next() {
             return;
         }
         for (iter++; iter != tables_->end(); iter++) {
+            iter->second->RecordRead();
             it_.reset(iter->second->NewTraverseIterator(0));
             it_->SeekToFirst();
             if (it_->Valid()) {
@@ -86,6 +88,7 @@ void DistributeWindowIterator::Seek(const std::string& key) {
     }
     auto iter = tables_->find(cur_pid_);
     if (iter != tables_->end()) {
+        iter->second->RecordRead();
         it_.reset(iter->second->NewWindowIterator(index_));
         it_->Seek(key);
         if (it_->Valid()) {
@@ -96,6 +99,7 @@ void DistributeWindowIterator::Seek(const std::string& key) {
         if (kv.first <= cur_pid_) {
             continue;
         }
+        kv.second->RecordRead();
         it_.reset(kv.second->NewWindowIterator(index_));
         it_->SeekToFirst();
         if (it_->Valid()) {
@@ -112,6 +116,7 @@ void DistributeWindowIterator::SeekToFirst() {
         return;
     }
     for (const auto& kv : *tables_) {
+        kv.second->RecordRead();
         it_.reset(kv.second->NewWindowIterator(index_));
         it_->SeekToFirst();
         if (it_->Valid()) {
@@ -129,6 +134,7 @@ void DistributeWindowIterator::Next() {
             return;
         }
         for (iter++; iter != tables_->end(); iter++) {
+            iter->second->RecordRead();
             it_.reset(iter->second->NewWindowIterator(index_));
             it_->SeekToFirst();
             if (it_->Valid()) {
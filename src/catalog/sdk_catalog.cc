@@ -105,6 +105,15 @@ std::shared_ptr<TabletAccessor> SDKTableHandler::GetTablet(uint32_t pid) {
     return table_client_manager_->GetTablet(pid);
 }
 
+std::shared_ptr<TabletAccessor> SDKTableHandler::GetReadTablet(uint32_t pid) {
+    return table_client_manager_->GetReadTablet(pid);
+}
+
+std::shared_ptr<TabletAccessor> SDKTableHandler::GetOtherTablet(uint32_t pid,
+                                                                const std::shared_ptr<TabletAccessor>& tablet) {
+    return table_client_manager_->GetOtherTablet(pid, tablet);
+}
+
 bool SDKTableHandler::GetTablet(std::vector<std::shared_ptr<TabletAccessor>>* tablets) {
     if (tablets == nullptr) {
         return false;
@@ -137,6 +146,19 @@ bool SDKCatalog::Init(const std::vector<::fedb::nameserver::TableInfo>& tables,
     return true;
 }
 
+bool SDKCatalog::Init(const SDKTables& base_tables, const std::vector<::fedb::nameserver::TableInfo>& changed_tables,
+        const std::set<uint32_t>& changed_tids, const Procedures& db_sp_map) {
+    for (const auto& db_kv : base_tables) {
+        for (const auto& table_kv : db_kv.second) {
+            if (changed_tids.find(table_kv.second->GetTid()) != changed_tids.end()) {
+                continue;
+            }
+            tables_[db_kv.first].emplace(table_kv.first, table_kv.second);
+        }
+    }
+    return Init(changed_tables, db_sp_map);
+}
+
 std::shared_ptr<::hybridse::vm::TableHandler> SDKCatalog::GetTable(
     const std::string& db, const std::string& table_name) {
     auto db_it = tables_.find(db);
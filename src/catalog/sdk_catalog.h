@@ -24,6 +24,7 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <set>
 #include "base/spinlock.h"
 #include "catalog/client_manager.h"
 #include "client/tablet_client.h"
@@ -83,6 +84,12 @@ class SDKTableHandler : public ::hybridse::vm::TableHandler {
 
     std::shared_ptr<TabletAccessor> GetTablet(uint32_t pid);
 
+    // any replica of the partition, the caller must bound its staleness
+    std::shared_ptr<TabletAccessor> GetReadTablet(uint32_t pid);
+
+    // another replica of the partition for a hedged read
+    std::shared_ptr<TabletAccessor> GetOtherTablet(uint32_t pid, const std::shared_ptr<TabletAccessor>& tablet);
+
     bool GetTablet(std::vector<std::shared_ptr<TabletAccessor>>* tablets);
 
     inline uint32_t GetTid() const { return meta_.tid(); }
@@ -126,6 +133,13 @@ class SDKCatalog : public ::hybridse::vm::Catalog {
     bool Init(const std::vector<::fedb::nameserver::TableInfo>& tables,
             const Procedures& db_sp_map);
 
+    // keeps the handlers of base_tables except the ones in changed_tids, which
+    // are replaced by changed_tables
+    bool Init(const SDKTables& base_tables, const std::vector<::fedb::nameserver::TableInfo>& changed_tables,
+            const std::set<uint32_t>& changed_tids, const Procedures& db_sp_map);
+
+    const SDKTables& GetTables() const { return tables_; }
+
     std::shared_ptr<::hybridse::type::Database> GetDatabase(const std::string& db) override {
         return std::shared_ptr<::hybridse::type::Database>();
     }
@@ -17,8 +17,13 @@
 
 #include "catalog/sdk_catalog.h"
 
+#include <map>
+#include <set>
+#include <vector>
+
 #include "base/fe_status.h"
 #include "catalog/schema_adapter.h"
+#include "catalog/table_change.h"
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
 #include "proto/fe_common.pb.h"
@@ -121,6 +126,74 @@ TEST_F(SDKCatalogTest, sdk_lastjoin_smoke_test) {
     std::cout << ss.str() << std::endl;
 }
 
+
+::fedb::nameserver::TableInfo MakeTableInfo(const std::string& tname, uint32_t tid, const std::string& leader) {
+    TestArgs* args = PrepareTable(tname, "db1");
+    ::fedb::nameserver::TableInfo table_info = args->meta;
+    delete args;
+    table_info.set_tid(tid);
+    auto partition = table_info.add_table_partition();
+    partition->set_pid(0);
+    auto partition_meta = partition->add_partition_meta();
+    partition_meta->set_endpoint(leader);
+    partition_meta->set_is_leader(true);
+    partition_meta->set_is_alive(true);
+    return table_info;
+}
+
+TEST_F(SDKCatalogTest, sdk_refresh_tables_test) {
+    auto client_manager = std::make_shared<ClientManager>();
+    client_manager->UpdateClient(
+        std::map<std::string, std::string>({{"name0", "127.0.0.1:9530"}, {"name1", "127.0.0.1:9531"}}));
+    Procedures procedures;
+    std::shared_ptr<SDKCatalog> base_catalog(new SDKCatalog(client_manager));
+    ASSERT_TRUE(base_catalog->Init(
+        {MakeTableInfo("t0", 10, "name0"), MakeTableInfo("t1", 1, "name0"), MakeTableInfo("t2", 2, "name0")},
+        procedures));
+    // the change log creates t3, moves the leader of t1, then drops t2 and
+    // creates it again with tid 4
+    ::fedb::nameserver::TableChangeLog change_log;
+    uint64_t version = 1;
+    for (uint32_t tid : {3, 1, 2, 4}) {
+        auto change = change_log.add_change();
+        change->set_version(++version);
+        change->set_tid(tid);
+    }
+    std::set<uint32_t> tids;
+    ASSERT_TRUE(GetChangedTables(change_log, 1, version, &tids));
+    ASSERT_EQ(std::set<uint32_t>({1, 2, 3, 4}), tids);
+    std::vector<::fedb::nameserver::TableInfo> changed_tables = {
+        MakeTableInfo("t3", 3, "name0"), MakeTableInfo("t1", 1, "name1"), MakeTableInfo("t2", 4, "name0")};
+    std::shared_ptr<SDKCatalog> catalog(new SDKCatalog(client_manager));
+    ASSERT_TRUE(catalog->Init(base_catalog->GetTables(), changed_tables, tids, procedures));
+    // the unchanged table keeps its handler
+    auto t0 = catalog->GetTable("db1", "t0");
+    ASSERT_TRUE(t0 != nullptr);
+    ASSERT_EQ(base_catalog->GetTable("db1", "t0"), t0);
+    ASSERT_TRUE(catalog->GetTable("db1", "t3") != nullptr);
+    auto t1 = std::dynamic_pointer_cast<SDKTableHandler>(catalog->GetTable("db1", "t1"));
+    ASSERT_TRUE(t1 != nullptr);
+    ASSERT_TRUE(t1->GetTablet(0) != nullptr);
+    ASSERT_EQ("name1", t1->GetTablet(0)->GetName());
+    auto t2 = std::dynamic_pointer_cast<SDKTableHandler>(catalog->GetTable("db1", "t2"));
+    ASSERT_TRUE(t2 != nullptr);
+    ASSERT_EQ(4u, t2->GetTid());
+    ASSERT_NE(base_catalog->GetTable("db1", "t2"), t2);
+
+    // drop t0
+    auto change = change_log.add_change();
+    change->set_version(++version);
+    change->set_tid(10);
+    tids.clear();
+    ASSERT_TRUE(GetChangedTables(change_log, version - 1, version, &tids));
+    std::shared_ptr<SDKCatalog> new_catalog(new SDKCatalog(client_manager));
+    ASSERT_TRUE(new_catalog->Init(catalog->GetTables(), {}, tids, procedures));
+    ASSERT_TRUE(new_catalog->GetTable("db1", "t0") == nullptr);
+    ASSERT_EQ(catalog->GetTable("db1", "t1"), new_catalog->GetTable("db1", "t1"));
+    ASSERT_EQ(catalog->GetTable("db1", "t2"), new_catalog->GetTable("db1", "t2"));
+    ASSERT_EQ(catalog->GetTable("db1", "t3"), new_catalog->GetTable("db1", "t3"));
+}
+
 }  // namespace catalog
 }  // namespace fedb
 
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catalog/table_change.h"
+
+#include <map>
+
+namespace fedb {
+namespace catalog {
+
+bool GetChangedTables(const ::fedb::nameserver::TableChangeLog& change_log, uint64_t from, uint64_t to,
+                      std::set<uint32_t>* tids) {
+    if (from >= to) {
+        return true;
+    }
+    std::map<uint64_t, const ::fedb::nameserver::TableChange*> changes;
+    for (const auto& change : change_log.change()) {
+        if (change.version() > from && change.version() <= to) {
+            changes[change.version()] = &change;
+        }
+    }
+    if (changes.size() != to - from) {
+        return false;
+    }
+    for (const auto& kv : changes) {
+        if (!kv.second->has_tid()) {
+            return false;
+        }
+        tids->insert(kv.second->tid());
+    }
+    return true;
+}
+
+bool GetChangedTables(const std::string& change_log, uint64_t from, uint64_t to, std::set<uint32_t>* tids) {
+    ::fedb::nameserver::TableChangeLog log;
+    if (!log.ParseFromString(change_log)) {
+        return false;
+    }
+    return GetChangedTables(log, from, to, tids);
+}
+
+}  // namespace catalog
+}  // namespace fedb
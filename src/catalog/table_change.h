@@ -0,0 +1,39 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CATALOG_TABLE_CHANGE_H_
+#define SRC_CATALOG_TABLE_CHANGE_H_
+
+#include <set>
+#include <string>
+
+#include "proto/name_server.pb.h"
+
+namespace fedb {
+namespace catalog {
+
+// collects the tables changed in the notify versions (from, to]. returns false
+// if the log misses one of them or has a change of all tables, then the whole
+// catalog must be reloaded
+bool GetChangedTables(const ::fedb::nameserver::TableChangeLog& change_log, uint64_t from, uint64_t to,
+                      std::set<uint32_t>* tids);
+
+// same with the serialized log read from zookeeper
+bool GetChangedTables(const std::string& change_log, uint64_t from, uint64_t to, std::set<uint32_t>* tids);
+
+}  // namespace catalog
+}  // namespace fedb
+#endif  // SRC_CATALOG_TABLE_CHANGE_H_
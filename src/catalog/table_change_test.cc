@@ -0,0 +1,68 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catalog/table_change.h"
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace catalog {
+
+class TableChangeTest : public ::testing::Test {};
+
+static void AddChange(::fedb::nameserver::TableChangeLog* change_log, uint64_t version, int32_t tid) {
+    auto change = change_log->add_change();
+    change->set_version(version);
+    if (tid >= 0) {
+        change->set_tid(tid);
+    }
+}
+
+TEST_F(TableChangeTest, GetChangedTables) {
+    ::fedb::nameserver::TableChangeLog change_log;
+    AddChange(&change_log, 5, 1);
+    AddChange(&change_log, 6, 2);
+    AddChange(&change_log, 7, 1);
+    AddChange(&change_log, 8, -1);
+    std::set<uint32_t> tids;
+    ASSERT_TRUE(GetChangedTables(change_log, 4, 7, &tids));
+    ASSERT_EQ(std::set<uint32_t>({1, 2}), tids);
+    tids.clear();
+    ASSERT_TRUE(GetChangedTables(change_log, 6, 7, &tids));
+    ASSERT_EQ(std::set<uint32_t>({1}), tids);
+    tids.clear();
+    ASSERT_TRUE(GetChangedTables(change_log, 7, 7, &tids));
+    ASSERT_TRUE(tids.empty());
+    // version 4 is not in the log
+    ASSERT_FALSE(GetChangedTables(change_log, 3, 7, &tids));
+    // version 9 is not in the log yet
+    ASSERT_FALSE(GetChangedTables(change_log, 6, 9, &tids));
+    // all tables changed
+    ASSERT_FALSE(GetChangedTables(change_log, 6, 8, &tids));
+    std::string value;
+    change_log.SerializeToString(&value);
+    tids.clear();
+    ASSERT_TRUE(GetChangedTables(value, 5, 6, &tids));
+    ASSERT_EQ(std::set<uint32_t>({2}), tids);
+}
+
+}  // namespace catalog
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
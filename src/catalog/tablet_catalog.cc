@@ -29,6 +29,7 @@
 #include "glog/logging.h"
 DECLARE_bool(enable_distsql);
 DECLARE_bool(enable_localtablet);
+DECLARE_string(sub_query_connection_type);
 namespace fedb {
 namespace catalog {
 
@@ -251,7 +252,13 @@ std::shared_ptr<::hybridse::vm::Tablet> TabletTableHandler::GetTablet(const std:
 }
 
 TabletCatalog::TabletCatalog()
-    : mu_(), tables_(), db_(), db_sp_map_(), client_manager_(), version_(1), local_tablet_() {}
+    : mu_(),
+      tables_(),
+      db_(),
+      db_sp_map_(),
+      client_manager_(FLAGS_sub_query_connection_type),
+      version_(1),
+      local_tablet_() {}
 
 TabletCatalog::~TabletCatalog() {}
 
@@ -435,6 +442,60 @@ void TabletCatalog::Refresh(const std::vector<::fedb::nameserver::TableInfo>& ta
     LOG(INFO) << "refresh catalog. version " << version;
 }
 
+void TabletCatalog::RefreshTables(const std::vector<::fedb::nameserver::TableInfo>& table_info_vec,
+        const std::set<uint32_t>& tids, uint64_t version) {
+    std::set<uint32_t> cur_tids;
+    for (const auto& table_info : table_info_vec) {
+        const std::string& db_name = table_info.db();
+        const std::string& table_name = table_info.name();
+        if (db_name.empty()) {
+            continue;
+        }
+        std::shared_ptr<TabletTableHandler> handler;
+        {
+            std::lock_guard<::fedb::base::SpinMutex> spin_lock(mu_);
+            auto& db_tables = tables_[db_name];
+            auto it = db_tables.find(table_name);
+            // a table recreated with the same name gets a new handler
+            if (it == db_tables.end() || (static_cast<uint32_t>(it->second->GetTid()) != table_info.tid() &&
+                        !it->second->HasLocalTable())) {
+                handler = std::make_shared<TabletTableHandler>(table_info, local_tablet_);
+                if (!handler->Init(client_manager_)) {
+                    LOG(WARNING) << "tablet handler init failed";
+                    return;
+                }
+                db_tables[table_name] = handler;
+                LOG(INFO) << "add table " << table_name << " db " << db_name;
+            } else {
+                handler = it->second;
+            }
+        }
+        handler->Update(table_info, client_manager_);
+        cur_tids.insert(table_info.tid());
+    }
+
+    std::lock_guard<::fedb::base::SpinMutex> spin_lock(mu_);
+    for (auto db_it = tables_.begin(); db_it != tables_.end();) {
+        for (auto table_it = db_it->second.begin(); table_it != db_it->second.end();) {
+            uint32_t tid = table_it->second->GetTid();
+            if (tids.find(tid) != tids.end() && cur_tids.find(tid) == cur_tids.end() &&
+                    !table_it->second->HasLocalTable()) {
+                LOG(INFO) << "delete table from catalog. db: " << db_it->first << ", table: " << table_it->first;
+                table_it = db_it->second.erase(table_it);
+                continue;
+            }
+            ++table_it;
+        }
+        if (db_it->second.empty()) {
+            db_it = tables_.erase(db_it);
+            continue;
+        }
+        ++db_it;
+    }
+    version_.store(version, std::memory_order_relaxed);
+    LOG(INFO) << "refresh " << tids.size() << " tables of catalog. version " << version;
+}
+
 bool TabletCatalog::UpdateClient(const std::map<std::string, std::string>& real_ep_map) {
     return client_manager_.UpdateClient(real_ep_map);
 }
@@ -20,6 +20,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -265,6 +266,10 @@ class TabletCatalog : public ::hybridse::vm::Catalog {
     void Refresh(const std::vector<::fedb::nameserver::TableInfo> &table_info_vec, uint64_t version,
             const Procedures& db_sp_map);
 
+    // refreshes only the tables in tids. a tid missing in table_info_vec is dropped
+    void RefreshTables(const std::vector<::fedb::nameserver::TableInfo> &table_info_vec,
+            const std::set<uint32_t> &tids, uint64_t version);
+
     bool AddProcedure(const std::string &db, const std::string &sp_name,
             const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info);
 
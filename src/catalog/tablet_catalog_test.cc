@@ -17,10 +17,13 @@
 
 #include "catalog/tablet_catalog.h"
 
+#include <map>
+#include <set>
 #include <vector>
 
 #include "base/fe_status.h"
 #include "catalog/schema_adapter.h"
+#include "catalog/table_change.h"
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
 #include "proto/fe_common.pb.h"
@@ -588,6 +591,96 @@ TEST_F(TabletCatalogTest, get_tablet) {
     delete args;
 }
 
+::fedb::nameserver::TableInfo MakeTableInfo(const std::string &tname, uint32_t tid, const std::string &leader) {
+    ::fedb::nameserver::TableInfo table_info;
+    table_info.set_name(tname);
+    table_info.set_db("db1");
+    table_info.set_tid(tid);
+    table_info.set_format_version(1);
+    RtiDBSchema *schema = table_info.mutable_column_desc_v1();
+    auto col1 = schema->Add();
+    col1->set_name("col1");
+    col1->set_data_type(::fedb::type::kVarchar);
+    auto col2 = schema->Add();
+    col2->set_name("col2");
+    col2->set_data_type(::fedb::type::kBigInt);
+    auto key1 = table_info.mutable_column_key()->Add();
+    key1->set_index_name("index0");
+    key1->add_col_name("col1");
+    key1->add_ts_name("col2");
+    auto partition = table_info.add_table_partition();
+    partition->set_pid(0);
+    auto partition_meta = partition->add_partition_meta();
+    partition_meta->set_endpoint(leader);
+    partition_meta->set_is_leader(true);
+    partition_meta->set_is_alive(true);
+    return table_info;
+}
+
+void ApplyTableChange(TabletCatalog *catalog, const ::fedb::nameserver::TableChangeLog &change_log, uint64_t version,
+                      const std::map<uint32_t, ::fedb::nameserver::TableInfo> &zk_tables) {
+    std::set<uint32_t> tids;
+    ASSERT_TRUE(GetChangedTables(change_log, catalog->GetVersion(), version, &tids));
+    std::vector<::fedb::nameserver::TableInfo> table_info_vec;
+    for (const auto &kv : zk_tables) {
+        if (tids.find(kv.first) != tids.end()) {
+            table_info_vec.push_back(kv.second);
+        }
+    }
+    catalog->RefreshTables(table_info_vec, tids, version);
+}
+
+TEST_F(TabletCatalogTest, refresh_tables_test) {
+    std::shared_ptr<TabletCatalog> catalog(new TabletCatalog());
+    ASSERT_TRUE(catalog->Init());
+    catalog->UpdateClient({{"name0", "127.0.0.1:9530"}, {"name1", "127.0.0.1:9531"}});
+    // the tables in zookeeper by tid
+    std::map<uint32_t, ::fedb::nameserver::TableInfo> zk_tables;
+    zk_tables[1] = MakeTableInfo("t1", 1, "name0");
+    zk_tables[2] = MakeTableInfo("t2", 2, "name0");
+    Procedures procedures;
+    catalog->Refresh({zk_tables[1], zk_tables[2]}, 1, procedures);
+    auto old_t2 = catalog->GetTable("db1", "t2");
+    ASSERT_TRUE(old_t2 != nullptr);
+
+    ::fedb::nameserver::TableChangeLog change_log;
+    auto add_change = [&change_log](uint64_t version, uint32_t tid) {
+        auto change = change_log.add_change();
+        change->set_version(version);
+        change->set_tid(tid);
+    };
+    // create t3, move the leader of t1, drop t2 and create it again
+    zk_tables[3] = MakeTableInfo("t3", 3, "name0");
+    add_change(2, 3);
+    zk_tables[1] = MakeTableInfo("t1", 1, "name1");
+    add_change(3, 1);
+    zk_tables.erase(2);
+    add_change(4, 2);
+    zk_tables[4] = MakeTableInfo("t2", 4, "name0");
+    add_change(5, 4);
+    ApplyTableChange(catalog.get(), change_log, 5, zk_tables);
+    ASSERT_EQ(5u, catalog->GetVersion());
+    ASSERT_TRUE(catalog->GetTable("db1", "t3") != nullptr);
+    auto t1 = catalog->GetTable("db1", "t1");
+    ASSERT_TRUE(t1 != nullptr);
+    auto tablet = std::dynamic_pointer_cast<TabletAccessor>(t1->GetTablet("", "pk1"));
+    ASSERT_TRUE(tablet != nullptr);
+    ASSERT_EQ("name1", tablet->GetName());
+    auto t2 = std::dynamic_pointer_cast<TabletTableHandler>(catalog->GetTable("db1", "t2"));
+    ASSERT_TRUE(t2 != nullptr);
+    ASSERT_EQ(4, t2->GetTid());
+    ASSERT_NE(old_t2, t2);
+
+    // drop t3
+    zk_tables.erase(3);
+    add_change(6, 3);
+    ApplyTableChange(catalog.get(), change_log, 6, zk_tables);
+    ASSERT_EQ(6u, catalog->GetVersion());
+    ASSERT_TRUE(catalog->GetTable("db1", "t3") == nullptr);
+    ASSERT_TRUE(catalog->GetTable("db1", "t1") != nullptr);
+    ASSERT_TRUE(catalog->GetTable("db1", "t2") != nullptr);
+}
+
 }  // namespace catalog
 }  // namespace fedb
 
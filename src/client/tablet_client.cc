@@ -21,6 +21,7 @@
 #include <iostream>
 #include <set>
 #include "base/glog_wapper.h"  // NOLINT
+#include "brpc/callback.h"
 #include "brpc/channel.h"
 #include "codec/codec.h"
 #include "codec/sql_rpc_row_codec.h"
@@ -32,6 +33,7 @@ DECLARE_int32(request_timeout_ms);
 DECLARE_uint32(latest_ttl_max);
 DECLARE_uint32(absolute_ttl_max);
 DECLARE_bool(enable_show_tp);
+DECLARE_bool(enable_columnar_batch_result);
 
 namespace fedb {
 namespace client {
@@ -53,6 +55,16 @@ TabletClient::TabletClient(const std::string& endpoint, const std::string& real_
         }
     }
 
+TabletClient::TabletClient(const std::string& endpoint, const std::string& real_endpoint,
+    bool use_sleep_policy, const std::string& connection_type)
+    : endpoint_(endpoint), real_endpoint_(endpoint), client_(endpoint, use_sleep_policy, connection_type) {
+        if (!real_endpoint.empty()) {
+            real_endpoint_ = real_endpoint;
+            client_ = ::fedb::RpcClient<::fedb::api::TabletServer_Stub>(real_endpoint, use_sleep_policy,
+                                                                          connection_type);
+        }
+    }
+
 TabletClient::~TabletClient() {}
 
 int TabletClient::Init() { return client_.Init(); }
@@ -134,13 +146,14 @@ bool TabletClient::CreateTable(
 bool TabletClient::Query(const std::string& db, const std::string& sql,
                          const std::string& row, brpc::Controller* cntl,
                          fedb::api::QueryResponse* response,
-                         const bool is_debug) {
+                         const bool is_debug, const bool is_profile) {
     if (cntl == NULL || response == NULL) return false;
     ::fedb::api::QueryRequest request;
     request.set_sql(sql);
     request.set_db(db);
     request.set_is_batch(false);
     request.set_is_debug(is_debug);
+    request.set_is_profile(is_profile);
     request.set_row_size(row.size());
     request.set_row_slices(1);
     auto& io_buf = cntl->request_attachment();
@@ -161,13 +174,14 @@ bool TabletClient::Query(const std::string& db, const std::string& sql,
 bool TabletClient::Query(const std::string& db, const std::string& sql,
                          brpc::Controller* cntl,
                          ::fedb::api::QueryResponse* response,
-                         const bool is_debug) {
+                         const bool is_debug, const bool is_profile) {
     if (cntl == NULL || response == NULL) return false;
     ::fedb::api::QueryRequest request;
     request.set_sql(sql);
     request.set_db(db);
     request.set_is_batch(true);
     request.set_is_debug(is_debug);
+    request.set_is_profile(is_profile);
     bool ok = client_.SendRequest(&::fedb::api::TabletServer_Stub::Query, cntl,
                                   &request, response);
 
@@ -213,12 +227,14 @@ bool TabletClient::SQLBatchRequestQuery(const std::string& db, const std::string
                                         std::shared_ptr<::fedb::sdk::SQLRequestRowBatch> row_batch,
                                         brpc::Controller* cntl,
                                         ::fedb::api::SQLBatchRequestQueryResponse* response,
-                                        const bool is_debug) {
+                                        const bool is_debug, const bool is_profile) {
     if (cntl == NULL || response == NULL) return false;
     ::fedb::api::SQLBatchRequestQueryRequest request;
     request.set_sql(sql);
     request.set_db(db);
     request.set_is_debug(is_debug);
+    request.set_is_profile(is_profile);
+    request.set_columnar_result(FLAGS_enable_columnar_batch_result);
 
     const std::set<size_t>& indices_set = row_batch->common_column_indices();
     for (size_t idx : indices_set) {
@@ -336,7 +352,7 @@ bool TabletClient::Put(
 bool TabletClient::Put(
     uint32_t tid, uint32_t pid, uint64_t time, const std::string& value,
     const std::vector<std::pair<std::string, uint32_t>>& dimensions,
-    uint32_t format_version) {
+    uint32_t format_version, uint64_t* log_offset) {
     ::fedb::api::PutRequest request;
     request.set_time(time);
     request.set_value(value);
@@ -353,6 +369,9 @@ bool TabletClient::Put(
         client_.SendRequest(&::fedb::api::TabletServer_Stub::Put, &request,
                             &response, FLAGS_request_timeout_ms, 1);
     if (ok && response.code() == 0) {
+        if (log_offset != nullptr) {
+            *log_offset = response.log_offset();
+        }
         return true;
     }
     LOG(WARNING) << "fail to send write request for " << response.msg() << " and error code " << response.code();
@@ -362,7 +381,7 @@ bool TabletClient::Put(
     uint32_t tid, uint32_t pid,
     const std::vector<std::pair<std::string, uint32_t>>& dimensions,
     const std::vector<uint64_t>& ts_dimensions, const std::string& value,
-    uint32_t format_version) {
+    uint32_t format_version, uint64_t* log_offset) {
     ::fedb::api::PutRequest request;
     request.set_value(value);
     request.set_tid(tid);
@@ -383,6 +402,9 @@ bool TabletClient::Put(
         client_.SendRequest(&::fedb::api::TabletServer_Stub::Put, &request,
                             &response, FLAGS_request_timeout_ms, 1);
     if (ok && response.code() == 0) {
+        if (log_offset != nullptr) {
+            *log_offset = response.log_offset();
+        }
         return true;
     }
     LOG(WARNING) << "put row to table " << tid << " failed with error "
@@ -464,6 +486,21 @@ bool TabletClient::FollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term,
     return false;
 }
 
+bool TabletClient::AsyncFollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term, brpc::Controller* cntl,
+                                      ::fedb::api::AppendEntriesResponse* response) {
+    if (cntl == nullptr || response == nullptr) {
+        return false;
+    }
+    ::fedb::api::AppendEntriesRequest request;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    request.set_term(term);
+    cntl->set_timeout_ms(FLAGS_request_timeout_ms);
+    cntl->set_max_retry(1);
+    return client_.SendRequest(&::fedb::api::TabletServer_Stub::AppendEntries, cntl, &request, response,
+                               brpc::DoNothing());
+}
+
 bool TabletClient::PauseSnapshot(uint32_t tid, uint32_t pid,
                                  std::shared_ptr<TaskInfo> task_info) {
     ::fedb::api::GeneralRequest request;
@@ -1420,6 +1457,41 @@ bool TabletClient::ExtractIndexData(
     return true;
 }
 
+bool TabletClient::BackfillIndexData(
+    uint32_t tid, uint32_t pid, uint32_t partition_num,
+    const ::fedb::common::ColumnKey& column_key, uint32_t idx,
+    const std::map<uint32_t, std::string>& pid_endpoint_map,
+    std::shared_ptr<TaskInfo> task_info) {
+    ::fedb::api::BackfillIndexDataRequest request;
+    ::fedb::api::GeneralResponse response;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    request.set_partition_num(partition_num);
+    request.set_idx(idx);
+    request.mutable_column_key()->CopyFrom(column_key);
+    for (const auto& kv : pid_endpoint_map) {
+        auto pair = request.add_pairs();
+        pair->set_pid(kv.first);
+        pair->set_endpoint(kv.second);
+    }
+    if (task_info) {
+        request.mutable_task_info()->CopyFrom(*task_info);
+    }
+    bool ok =
+        client_.SendRequest(&fedb::api::TabletServer_Stub::BackfillIndexData,
+                            &request, &response, FLAGS_request_timeout_ms, 1);
+    if (!ok || response.code() != 0) {
+        return false;
+    }
+    return true;
+}
+
+bool TabletClient::PutIndexData(const ::fedb::api::PutIndexDataRequest& request,
+                                ::fedb::api::GeneralResponse* response) {
+    return client_.SendRequest(&fedb::api::TabletServer_Stub::PutIndexData,
+                               &request, response, FLAGS_request_timeout_ms, 1);
+}
+
 bool TabletClient::CancelOP(const uint64_t op_id) {
     ::fedb::api::CancelOPRequest request;
     ::fedb::api::GeneralResponse response;
@@ -1492,6 +1564,14 @@ bool TabletClient::AsyncScan(const ::fedb::api::ScanRequest& request,
             callback->GetResponse().get(), callback);
 }
 
+bool TabletClient::AsyncPut(const ::fedb::api::PutRequest& request, brpc::Controller* cntl,
+                            ::fedb::api::PutResponse* response, google::protobuf::Closure* done) {
+    if (cntl == nullptr || response == nullptr || done == nullptr) {
+        return false;
+    }
+    return client_.SendRequest(&::fedb::api::TabletServer_Stub::Put, cntl, &request, response, done);
+}
+
 bool TabletClient::Scan(const ::fedb::api::ScanRequest& request,
         brpc::Controller* cntl,
         ::fedb::api::ScanResponse* response) {
@@ -1501,18 +1581,74 @@ bool TabletClient::Scan(const ::fedb::api::ScanRequest& request,
         LOG(WARNING) << "fail to scan table with tid " << request.tid();
         return false;
     }
+    scan_latency_ << cntl->latency_us();
     return true;
 }
 
+int TabletClient::HedgedScan(const std::shared_ptr<TabletClient>& hedge_client,
+        const ::fedb::api::ScanRequest& request,
+        brpc::Controller* cntl[2],
+        ::fedb::api::ScanResponse* response[2]) {
+    ::fedb::RpcClient<::fedb::api::TabletServer_Stub>* hedge = NULL;
+    if (hedge_client) {
+        hedge = &hedge_client->client_;
+    }
+    int idx = ::fedb::SendHedgedRequest(&client_, hedge, &::fedb::api::TabletServer_Stub::Scan,
+                                        &request, GetScanLatencyP95(), cntl, response);
+    if (idx == 0) {
+        scan_latency_ << cntl[0]->latency_us();
+    } else if (idx == 1) {
+        hedge_client->scan_latency_ << cntl[1]->latency_us();
+    } else {
+        LOG(WARNING) << "fail to scan table with tid " << request.tid();
+    }
+    return idx;
+}
+
+bool TabletClient::BatchGet(const ::fedb::api::BatchGetRequest& request,
+        brpc::Controller* cntl,
+        ::fedb::api::BatchGetResponse* response) {
+    bool ok = client_.SendRequest(&::fedb::api::TabletServer_Stub::BatchGet, cntl,
+                                  &request, response);
+    if (!ok || response->code() != 0) {
+        LOG(WARNING) << "fail to batch get table with tid " << request.tid();
+        return false;
+    }
+    return true;
+}
+
+bool TabletClient::BatchScan(const ::fedb::api::BatchScanRequest& request,
+        brpc::Controller* cntl,
+        ::fedb::api::BatchScanResponse* response) {
+    bool ok = client_.SendRequest(&::fedb::api::TabletServer_Stub::BatchScan, cntl,
+                                  &request, response);
+    if (!ok || response->code() != 0) {
+        LOG(WARNING) << "fail to batch scan table with tid " << request.tid();
+        return false;
+    }
+    return true;
+}
+
+bool TabletClient::AsyncBatchScan(const ::fedb::api::BatchScanRequest& request,
+        fedb::RpcCallback<fedb::api::BatchScanResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    return client_.SendRequest(&::fedb::api::TabletServer_Stub::BatchScan,
+            callback->GetController().get(), &request,
+            callback->GetResponse().get(), callback);
+}
+
 bool TabletClient::CallProcedure(const std::string& db, const std::string& sp_name,
                          const std::string& row, brpc::Controller* cntl,
                          fedb::api::QueryResponse* response,
-                         bool is_debug, uint64_t timeout_ms) {
+                         bool is_debug, uint64_t timeout_ms, bool is_profile) {
     if (cntl == NULL || response == NULL) return false;
     ::fedb::api::QueryRequest request;
     request.set_sp_name(sp_name);
     request.set_db(db);
     request.set_is_debug(is_debug);
+    request.set_is_profile(is_profile);
     request.set_is_batch(false);
     request.set_is_procedure(true);
     request.set_row_size(row.size());
@@ -1556,7 +1692,7 @@ bool TabletClient::CallSQLBatchRequestProcedure(const std::string& db, const std
         std::shared_ptr<::fedb::sdk::SQLRequestRowBatch> row_batch,
         brpc::Controller* cntl,
         fedb::api::SQLBatchRequestQueryResponse* response,
-        bool is_debug, uint64_t timeout_ms) {
+        bool is_debug, uint64_t timeout_ms, bool is_profile) {
     if (cntl == NULL || response == NULL) {
         return false;
     }
@@ -1565,6 +1701,8 @@ bool TabletClient::CallSQLBatchRequestProcedure(const std::string& db, const std
     request.set_is_procedure(true);
     request.set_db(db);
     request.set_is_debug(is_debug);
+    request.set_is_profile(is_profile);
+    request.set_columnar_result(FLAGS_enable_columnar_batch_result);
     cntl->set_timeout_ms(timeout_ms);
 
     auto& io_buf = cntl->request_attachment();
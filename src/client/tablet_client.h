@@ -26,6 +26,7 @@
 
 #include "base/kv_iterator.h"
 #include "brpc/channel.h"
+#include "bvar/bvar.h"
 #include "codec/schema_codec.h"
 #include "proto/tablet.pb.h"
 #include "rpc/rpc_client.h"
@@ -51,6 +52,10 @@ class TabletClient {
 
     TabletClient(const std::string& endpoint, const std::string& real_endpoint, bool use_sleep_policy);
 
+    // connection_type is single, pooled or short, see RpcClient
+    TabletClient(const std::string& endpoint, const std::string& real_endpoint, bool use_sleep_policy,
+                 const std::string& connection_type);
+
     ~TabletClient();
 
     int Init();
@@ -59,6 +64,9 @@ class TabletClient {
 
     const std::string& GetRealEndpoint() const;
 
+    // requests on the way and recent latency, for picking the least loaded replica
+    inline const std::shared_ptr<::fedb::RpcLoad>& GetLoad() const { return client_.GetLoad(); }
+
     bool CreateTable(const std::string& name, uint32_t tid, uint32_t pid,
                      uint64_t abs_ttl, uint64_t lat_ttl, bool leader,
                      const std::vector<std::string>& endpoints,
@@ -82,20 +90,21 @@ class TabletClient {
         const fedb::common::VersionPair& pair, const std::string& schema,
         std::string& msg);  // NOLINT
 
+    // is_profile asks the tablet to return the time spent in each query stage
     bool Query(const std::string& db, const std::string& sql,
                brpc::Controller* cntl, ::fedb::api::QueryResponse* response,
-               const bool is_debug = false);
+               const bool is_debug = false, const bool is_profile = false);
 
     bool Query(const std::string& db, const std::string& sql,
                const std::string& row, brpc::Controller* cntl,
                ::fedb::api::QueryResponse* response,
-               const bool is_debug = false);
+               const bool is_debug = false, const bool is_profile = false);
 
     bool SQLBatchRequestQuery(const std::string& db, const std::string& sql,
                               std::shared_ptr<::fedb::sdk::SQLRequestRowBatch>,
                               brpc::Controller* cntl,
                               ::fedb::api::SQLBatchRequestQueryResponse* response,
-                              const bool is_debug = false);
+                              const bool is_debug = false, const bool is_profile = false);
 
     bool Put(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time,
              const std::string& value, uint32_t format_version = 0);
@@ -110,7 +119,7 @@ class TabletClient {
     bool Put(uint32_t tid, uint32_t pid, uint64_t time,
              const std::string& value,
              const std::vector<std::pair<std::string, uint32_t>>& dimensions,
-             uint32_t format_version);
+             uint32_t format_version, uint64_t* log_offset = nullptr);
 
     bool Put(uint32_t tid, uint32_t pid,
              const std::vector<std::pair<std::string, uint32_t>>& dimensions,
@@ -120,7 +129,8 @@ class TabletClient {
     bool Put(uint32_t tid, uint32_t pid,
              const std::vector<std::pair<std::string, uint32_t>>& dimensions,
              const std::vector<uint64_t>& ts_dimensions,
-             const std::string& value, uint32_t format_version);
+             const std::string& value, uint32_t format_version,
+             uint64_t* log_offset = nullptr);
 
     bool Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time,
              std::string& value, uint64_t& ts, std::string& msg);  // NOLINT
@@ -177,6 +187,32 @@ class TabletClient {
     bool AsyncScan(const ::fedb::api::ScanRequest& request,
                    fedb::RpcCallback<fedb::api::ScanResponse>* callback);
 
+    // done is run once the put returns, cntl and response must outlive it
+    bool AsyncPut(const ::fedb::api::PutRequest& request, brpc::Controller* cntl,
+                  ::fedb::api::PutResponse* response, google::protobuf::Closure* done);
+
+    // scans on this tablet and, if it has not answered within the p95 latency
+    // of the recent scans, on hedge_client too. it returns 0 if this tablet
+    // answers, 1 if hedge_client does and -1 if both fail
+    int HedgedScan(const std::shared_ptr<TabletClient>& hedge_client,
+                   const ::fedb::api::ScanRequest& request,
+                   brpc::Controller* cntl[2],
+                   ::fedb::api::ScanResponse* response[2]);
+
+    // in microseconds, 0 before any scan is done
+    int64_t GetScanLatencyP95() { return scan_latency_.latency_percentile(0.95); }
+
+    bool BatchGet(const ::fedb::api::BatchGetRequest& request,
+                  brpc::Controller* cntl,
+                  ::fedb::api::BatchGetResponse* response);
+
+    bool BatchScan(const ::fedb::api::BatchScanRequest& request,
+                   brpc::Controller* cntl,
+                   ::fedb::api::BatchScanResponse* response);
+
+    bool AsyncBatchScan(const ::fedb::api::BatchScanRequest& request,
+                        fedb::RpcCallback<fedb::api::BatchScanResponse>* callback);
+
     bool GetTableSchema(uint32_t tid, uint32_t pid,
                         ::fedb::api::TableMeta& table_meta);  // NOLINT
 
@@ -263,6 +299,11 @@ class TabletClient {
     bool FollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term,
                        uint64_t& offset);  // NOLINT
 
+    // sends FollowOfNoOne without waiting. join cntl before reading the
+    // offset from response
+    bool AsyncFollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term, brpc::Controller* cntl,
+                            ::fedb::api::AppendEntriesResponse* response);
+
     bool GetTableFollower(uint32_t tid, uint32_t pid,
                           uint64_t& offset,                           // NOLINT
                           std::map<std::string, uint64_t>& info_map,  // NOLINT
@@ -309,6 +350,14 @@ class TabletClient {
                           const ::fedb::common::ColumnKey& column_key,
                           uint32_t idx, std::shared_ptr<TaskInfo> task_info);
 
+    bool BackfillIndexData(uint32_t tid, uint32_t pid, uint32_t partition_num,
+                           const ::fedb::common::ColumnKey& column_key, uint32_t idx,
+                           const std::map<uint32_t, std::string>& pid_endpoint_map,
+                           std::shared_ptr<TaskInfo> task_info);
+
+    bool PutIndexData(const ::fedb::api::PutIndexDataRequest& request,
+                      ::fedb::api::GeneralResponse* response);
+
     bool CancelOP(const uint64_t op_id);
 
     bool UpdateRealEndpointMap(const std::map<std::string, std::string>& map);
@@ -319,13 +368,13 @@ class TabletClient {
     bool CallProcedure(const std::string& db, const std::string& sp_name,
             const std::string& row, brpc::Controller* cntl,
             fedb::api::QueryResponse* response,
-            bool is_debug, uint64_t timeout_ms);
+            bool is_debug, uint64_t timeout_ms, bool is_profile = false);
 
     bool CallSQLBatchRequestProcedure(const std::string& db, const std::string& sp_name,
             std::shared_ptr<::fedb::sdk::SQLRequestRowBatch>,
             brpc::Controller* cntl,
             fedb::api::SQLBatchRequestQueryResponse* response,
-            bool is_debug, uint64_t timeout_ms);
+            bool is_debug, uint64_t timeout_ms, bool is_profile = false);
 
     bool DropProcedure(const std::string& db_name, const std::string& sp_name);
 
@@ -349,6 +398,7 @@ class TabletClient {
     std::string real_endpoint_;
     ::fedb::RpcClient<::fedb::api::TabletServer_Stub> client_;
     std::vector<uint64_t> percentile_;
+    bvar::LatencyRecorder scan_latency_;
 };
 
 }  // namespace client
@@ -70,6 +70,7 @@ DECLARE_int32(thread_pool_size);
 DECLARE_int32(put_concurrency_limit);
 DECLARE_int32(scan_concurrency_limit);
 DECLARE_int32(get_concurrency_limit);
+DECLARE_bool(make_snapshot_on_shutdown);
 DEFINE_string(role, "tablet | nameserver | client | ns_client | sql_client",
               "Set the fedb role for start");
 DEFINE_string(cmd, "", "Set the command");
@@ -285,6 +286,9 @@ void StartTablet() {
     }
     server.set_version(FEDB_VERSION.c_str());
     server.RunUntilAskedToQuit();
+    if (FLAGS_make_snapshot_on_shutdown) {
+        tablet->MakeSnapshotOnShutdown();
+    }
 }
 #endif
 
@@ -3419,6 +3423,7 @@ void HandleNSShowOPStatus(const std::vector<std::string>& parts,
     row.push_back("execute_time");
     row.push_back("end_time");
     row.push_back("cur_task");
+    row.push_back("progress");
     row.push_back("for_replica_cluster");
     ::baidu::common::TPrinter tp(row.size(), FLAGS_max_col_display_length);
     tp.AddRow(row);
@@ -3488,6 +3493,11 @@ void HandleNSShowOPStatus(const std::vector<std::string>& parts,
             row.push_back("-");
         }
         row.push_back(response.op_status(idx).task_type());
+        if (response.op_status(idx).progress().empty()) {
+            row.push_back("-");
+        } else {
+            row.push_back(response.op_status(idx).progress());
+        }
         if (response.op_status(idx).for_replica_cluster() == 1) {
             row.push_back("yes");
         } else {
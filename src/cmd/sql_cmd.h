@@ -32,6 +32,7 @@
 #include "plan/plan_api.h"
 #include "proto/fe_type.pb.h"
 #include "sdk/cluster_sdk.h"
+#include "sdk/result_set_sql.h"
 #include "sdk/sql_cluster_router.h"
 #include "version.h"  // NOLINT
 
@@ -153,6 +154,53 @@ void PrintResultSet(std::ostream &stream, ::hybridse::sdk::ResultSet *result_set
     stream << result_set->Size() << " rows in set" << std::endl;
 }
 
+void PrintQueryProfile(std::ostream &stream, const ::fedb::api::QueryProfile &profile) {
+    ::hybridse::base::TextTable t('-', ' ', ' ');
+    t.add("stage");
+    t.add("time(us)");
+    t.add("rows");
+    t.add("count");
+    t.end_of_row();
+    for (const auto &stage : profile.stage()) {
+        t.add(stage.name());
+        t.add(std::to_string(stage.time_us()));
+        t.add(std::to_string(stage.row_cnt()));
+        t.add(std::to_string(stage.cnt()));
+        t.end_of_row();
+    }
+    stream << t << std::endl;
+    stream << "total " << profile.total_time_us() << "us on " << profile.endpoint() << std::endl;
+}
+
+// profile <query> runs the query and prints the time spent in each stage
+bool HandleProfile(const std::string &sql) {
+    const std::string prefix = "profile ";
+    if (sql.size() <= prefix.size()) {
+        return false;
+    }
+    std::string head = sql.substr(0, prefix.size());
+    std::transform(head.begin(), head.end(), head.begin(), ::tolower);
+    if (head != prefix) {
+        return false;
+    }
+    if (db.empty()) {
+        std::cout << "please use database first" << std::endl;
+        return true;
+    }
+    ::hybridse::sdk::Status status;
+    auto rs = sr->ExecuteSQL(db, sql.substr(prefix.size()), true, &status);
+    if (!rs) {
+        std::cout << "fail to execute query" << std::endl;
+        return true;
+    }
+    PrintResultSet(std::cout, rs.get());
+    auto sql_rs = std::dynamic_pointer_cast<::fedb::sdk::ResultSetSQL>(rs);
+    if (sql_rs) {
+        PrintQueryProfile(std::cout, sql_rs->GetProfile());
+    }
+    return true;
+}
+
 void PrintTableIndex(std::ostream &stream,
                      const ::hybridse::vm::IndexList &index_list) {
     ::hybridse::base::TextTable t('-', ' ', ' ');
@@ -538,6 +586,9 @@ void HandleCreateIndex(const hybridse::node::CreateIndexNode *create_index_node)
 }
 
 void HandleSQL(const std::string &sql) {
+    if (HandleProfile(sql)) {
+        return;
+    }
     hybridse::node::NodeManager node_manager;
     hybridse::base::Status sql_status;
     hybridse::node::NodePointVector parser_trees;
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/sql_rpc_column_codec.h"
+
+#include <string.h>
+
+namespace fedb {
+namespace codec {
+
+int GetRpcColumnValueSize(hybridse::type::Type type) {
+    switch (type) {
+        case hybridse::type::kBool:
+            return 1;
+        case hybridse::type::kInt16:
+            return 2;
+        case hybridse::type::kInt32:
+        case hybridse::type::kFloat:
+        case hybridse::type::kDate:
+            return 4;
+        case hybridse::type::kInt64:
+        case hybridse::type::kDouble:
+        case hybridse::type::kTimestamp:
+            return 8;
+        case hybridse::type::kVarchar:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static int32_t GetRowValue(hybridse::codec::RowView* row_view, uint32_t idx, hybridse::type::Type type, char* ptr) {
+    int32_t ret = -1;
+    switch (type) {
+        case hybridse::type::kBool: {
+            bool val = false;
+            ret = row_view->GetBool(idx, &val);
+            *ptr = val ? 1 : 0;
+            break;
+        }
+        case hybridse::type::kInt16: {
+            int16_t val = 0;
+            ret = row_view->GetInt16(idx, &val);
+            memcpy(ptr, &val, sizeof(val));
+            break;
+        }
+        case hybridse::type::kInt32: {
+            int32_t val = 0;
+            ret = row_view->GetInt32(idx, &val);
+            memcpy(ptr, &val, sizeof(val));
+            break;
+        }
+        case hybridse::type::kDate: {
+            int32_t val = 0;
+            ret = row_view->GetDate(idx, &val);
+            memcpy(ptr, &val, sizeof(val));
+            break;
+        }
+        case hybridse::type::kFloat: {
+            float val = 0;
+            ret = row_view->GetFloat(idx, &val);
+            memcpy(ptr, &val, sizeof(val));
+            break;
+        }
+        case hybridse::type::kInt64: {
+            int64_t val = 0;
+            ret = row_view->GetInt64(idx, &val);
+            memcpy(ptr, &val, sizeof(val));
+            break;
+        }
+        case hybridse::type::kTimestamp: {
+            int64_t val = 0;
+            ret = row_view->GetTimestamp(idx, &val);
+            memcpy(ptr, &val, sizeof(val));
+            break;
+        }
+        case hybridse::type::kDouble: {
+            double val = 0;
+            ret = row_view->GetDouble(idx, &val);
+            memcpy(ptr, &val, sizeof(val));
+            break;
+        }
+        default:
+            break;
+    }
+    return ret;
+}
+
+bool EncodeRpcColumn(const hybridse::codec::Schema& schema, uint32_t idx, const std::vector<const int8_t*>& rows,
+                     butil::IOBuf* buf, size_t* total_size) {
+    if (buf == nullptr || total_size == nullptr || idx >= static_cast<uint32_t>(schema.size())) {
+        return false;
+    }
+    hybridse::type::Type type = schema.Get(idx).type();
+    int value_size = GetRpcColumnValueSize(type);
+    if (value_size < 0) {
+        LOG(WARNING) << "unsupported column type " << hybridse::type::Type_Name(type);
+        return false;
+    }
+    size_t row_cnt = rows.size();
+    std::string bitmap((row_cnt + 7) / 8, '\0');
+    std::string values;
+    std::vector<uint32_t> offsets;
+    if (value_size > 0) {
+        values.resize(row_cnt * value_size, '\0');
+    } else {
+        offsets.reserve(row_cnt + 1);
+        offsets.push_back(0);
+    }
+    hybridse::codec::RowView row_view(schema);
+    for (size_t i = 0; i < row_cnt; i++) {
+        if (rows[i] == nullptr || !row_view.Reset(rows[i])) {
+            LOG(WARNING) << "bad row " << i << " of column " << idx;
+            return false;
+        }
+        int32_t ret = 0;
+        if (row_view.IsNULL(idx)) {
+            bitmap[i >> 3] |= static_cast<char>(1 << (i & 0x07));
+        } else if (value_size > 0) {
+            ret = GetRowValue(&row_view, idx, type, &values[i * value_size]);
+        } else {
+            const char* val = nullptr;
+            uint32_t length = 0;
+            ret = row_view.GetString(idx, &val, &length);
+            if (ret == 0) {
+                values.append(val, length);
+            }
+        }
+        if (ret != 0) {
+            LOG(WARNING) << "get value of row " << i << " column " << idx << " failed";
+            return false;
+        }
+        if (value_size == 0) {
+            offsets.push_back(values.size());
+        }
+    }
+    *total_size = bitmap.size() + offsets.size() * sizeof(uint32_t) + values.size();
+    if (buf->append(bitmap) != 0 ||
+        (!offsets.empty() && buf->append(offsets.data(), offsets.size() * sizeof(uint32_t)) != 0) ||
+        buf->append(values) != 0) {
+        LOG(WARNING) << "append column " << idx << " of size " << *total_size << " failed";
+        return false;
+    }
+    return true;
+}
+
+RpcColumnView::RpcColumnView()
+    : type_(hybridse::type::kVarchar), row_cnt_(0), bitmap_size_(0), data_() {}
+
+bool RpcColumnView::Reset(hybridse::type::Type type, uint32_t row_cnt, const butil::IOBuf& buf) {
+    row_cnt_ = 0;
+    data_.clear();
+    int value_size = GetRpcColumnValueSize(type);
+    if (value_size < 0) {
+        LOG(WARNING) << "unsupported column type " << hybridse::type::Type_Name(type);
+        return false;
+    }
+    size_t bitmap_size = (row_cnt + 7) / 8;
+    size_t expect_size = bitmap_size;
+    if (value_size > 0) {
+        expect_size += static_cast<size_t>(row_cnt) * value_size;
+    } else {
+        expect_size += (static_cast<size_t>(row_cnt) + 1) * sizeof(uint32_t);
+    }
+    if (buf.size() < expect_size || (value_size > 0 && buf.size() != expect_size)) {
+        LOG(WARNING) << "bad column size " << buf.size() << ", expect " << expect_size;
+        return false;
+    }
+    buf.copy_to(&data_);
+    if (value_size == 0) {
+        uint32_t str_size = 0;
+        memcpy(&str_size, data_.data() + bitmap_size + row_cnt * sizeof(uint32_t), sizeof(uint32_t));
+        if (expect_size + str_size != data_.size()) {
+            LOG(WARNING) << "bad string column size " << data_.size() << ", expect " << expect_size + str_size;
+            data_.clear();
+            return false;
+        }
+    }
+    type_ = type;
+    row_cnt_ = row_cnt;
+    bitmap_size_ = bitmap_size;
+    return true;
+}
+
+bool RpcColumnView::IsNULL(uint32_t row) const {
+    if (row >= row_cnt_) {
+        return false;
+    }
+    return *reinterpret_cast<const uint8_t*>(data_.data() + (row >> 3)) & (1 << (row & 0x07));
+}
+
+int32_t RpcColumnView::GetValue(uint32_t row, hybridse::type::Type type, void* val, size_t size) const {
+    if (val == nullptr || row >= row_cnt_ || type != type_) {
+        return -1;
+    }
+    if (IsNULL(row)) {
+        return 1;
+    }
+    memcpy(val, data_.data() + bitmap_size_ + static_cast<size_t>(row) * size, size);
+    return 0;
+}
+
+int32_t RpcColumnView::GetBool(uint32_t row, bool* val) const {
+    if (val == nullptr) {
+        return -1;
+    }
+    int8_t v = 0;
+    int32_t ret = GetValue(row, hybridse::type::kBool, &v, sizeof(v));
+    if (ret == 0) {
+        *val = v == 1;
+    }
+    return ret;
+}
+
+int32_t RpcColumnView::GetInt16(uint32_t row, int16_t* val) const {
+    return GetValue(row, hybridse::type::kInt16, val, sizeof(int16_t));
+}
+
+int32_t RpcColumnView::GetInt32(uint32_t row, int32_t* val) const {
+    return GetValue(row, hybridse::type::kInt32, val, sizeof(int32_t));
+}
+
+int32_t RpcColumnView::GetInt64(uint32_t row, int64_t* val) const {
+    return GetValue(row, hybridse::type::kInt64, val, sizeof(int64_t));
+}
+
+int32_t RpcColumnView::GetFloat(uint32_t row, float* val) const {
+    return GetValue(row, hybridse::type::kFloat, val, sizeof(float));
+}
+
+int32_t RpcColumnView::GetDouble(uint32_t row, double* val) const {
+    return GetValue(row, hybridse::type::kDouble, val, sizeof(double));
+}
+
+int32_t RpcColumnView::GetTimestamp(uint32_t row, int64_t* val) const {
+    return GetValue(row, hybridse::type::kTimestamp, val, sizeof(int64_t));
+}
+
+int32_t RpcColumnView::GetDate(uint32_t row, int32_t* date) const {
+    return GetValue(row, hybridse::type::kDate, date, sizeof(int32_t));
+}
+
+int32_t RpcColumnView::GetDate(uint32_t row, int32_t* year, int32_t* month, int32_t* day) const {
+    if (year == nullptr || month == nullptr || day == nullptr) {
+        return -1;
+    }
+    int32_t date = 0;
+    int32_t ret = GetDate(row, &date);
+    if (ret == 0) {
+        *day = date & 0x0000000FF;
+        date = date >> 8;
+        *month = 1 + (date & 0x0000FF);
+        *year = 1900 + (date >> 8);
+    }
+    return ret;
+}
+
+int32_t RpcColumnView::GetString(uint32_t row, const char** val, uint32_t* length) const {
+    if (val == nullptr || length == nullptr || row >= row_cnt_ || type_ != hybridse::type::kVarchar) {
+        return -1;
+    }
+    if (IsNULL(row)) {
+        return 1;
+    }
+    uint32_t start = 0;
+    uint32_t end = 0;
+    const char* offsets = data_.data() + bitmap_size_;
+    memcpy(&start, offsets + row * sizeof(uint32_t), sizeof(uint32_t));
+    memcpy(&end, offsets + (row + 1) * sizeof(uint32_t), sizeof(uint32_t));
+    size_t str_offset = bitmap_size_ + (static_cast<size_t>(row_cnt_) + 1) * sizeof(uint32_t);
+    if (start > end || str_offset + end > data_.size()) {
+        return -1;
+    }
+    *val = data_.data() + str_offset + start;
+    *length = end - start;
+    return 0;
+}
+
+}  // namespace codec
+}  // namespace fedb
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CODEC_SQL_RPC_COLUMN_CODEC_H_
+#define SRC_CODEC_SQL_RPC_COLUMN_CODEC_H_
+
+#include <string>
+#include <vector>
+
+#include "butil/iobuf.h"
+#include "codec/fe_row_codec.h"
+
+namespace fedb {
+namespace codec {
+
+// the size of a value in a column, 0 for strings and -1 for unsupported types
+int GetRpcColumnValueSize(hybridse::type::Type type);
+
+// append column idx of the rows to buf. the column is a null bitmap of one bit
+// per row followed by an array of fixed size values, or by row_cnt + 1 offsets
+// and the bytes for strings. rows are encoded with schema
+bool EncodeRpcColumn(const hybridse::codec::Schema& schema, uint32_t idx, const std::vector<const int8_t*>& rows,
+                     butil::IOBuf* buf, size_t* total_size);
+
+// reads the values of a column encoded by EncodeRpcColumn by row. the Get
+// functions return 0 for a value, 1 for null and -1 for a bad row or type
+class RpcColumnView {
+ public:
+    RpcColumnView();
+
+    // buf holds exactly the column of row_cnt rows
+    bool Reset(hybridse::type::Type type, uint32_t row_cnt, const butil::IOBuf& buf);
+
+    inline uint32_t GetRowCnt() const { return row_cnt_; }
+
+    bool IsNULL(uint32_t row) const;
+
+    int32_t GetBool(uint32_t row, bool* val) const;
+    int32_t GetInt16(uint32_t row, int16_t* val) const;
+    int32_t GetInt32(uint32_t row, int32_t* val) const;
+    int32_t GetInt64(uint32_t row, int64_t* val) const;
+    int32_t GetFloat(uint32_t row, float* val) const;
+    int32_t GetDouble(uint32_t row, double* val) const;
+    int32_t GetTimestamp(uint32_t row, int64_t* val) const;
+    // the date as encoded in the row
+    int32_t GetDate(uint32_t row, int32_t* date) const;
+    int32_t GetDate(uint32_t row, int32_t* year, int32_t* month, int32_t* day) const;
+    int32_t GetString(uint32_t row, const char** val, uint32_t* length) const;
+
+ private:
+    int32_t GetValue(uint32_t row, hybridse::type::Type type, void* val, size_t size) const;
+
+    hybridse::type::Type type_;
+    uint32_t row_cnt_;
+    size_t bitmap_size_;
+    std::string data_;
+};
+
+}  // namespace codec
+}  // namespace fedb
+#endif  // SRC_CODEC_SQL_RPC_COLUMN_CODEC_H_
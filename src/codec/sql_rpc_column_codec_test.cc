@@ -0,0 +1,146 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/sql_rpc_column_codec.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codec/fe_row_codec.h"
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace codec {
+
+class SqlRpcColumnCodecTest : public ::testing::Test {};
+
+void InitColumnSchema(hybridse::codec::Schema* schema) {
+    hybridse::type::ColumnDef* column;
+    column = schema->Add();
+    column->set_name("col_0");
+    column->set_type(hybridse::type::kInt32);
+    column = schema->Add();
+    column->set_name("col_1");
+    column->set_type(hybridse::type::kVarchar);
+    column = schema->Add();
+    column->set_name("col_2");
+    column->set_type(hybridse::type::kDouble);
+    column = schema->Add();
+    column->set_name("col_3");
+    column->set_type(hybridse::type::kBool);
+}
+
+TEST_F(SqlRpcColumnCodecTest, EncodeDecode) {
+    hybridse::codec::Schema schema;
+    InitColumnSchema(&schema);
+    hybridse::codec::RowBuilder builder(schema);
+    std::vector<std::string> bufs;
+    // every third row has null values
+    for (int i = 0; i < 20; i++) {
+        std::string str = "value" + std::to_string(i);
+        std::string buf(builder.CalTotalLength(str.size()), '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&buf[0]), buf.size());
+        if (i % 3 == 0) {
+            builder.AppendNULL();
+            builder.AppendNULL();
+        } else {
+            builder.AppendInt32(i);
+            builder.AppendString(str.c_str(), str.size());
+        }
+        builder.AppendDouble(i * 1.5);
+        builder.AppendBool(i % 2 == 0);
+        bufs.push_back(std::move(buf));
+    }
+    std::vector<const int8_t*> rows;
+    for (const auto& buf : bufs) {
+        rows.push_back(reinterpret_cast<const int8_t*>(buf.data()));
+    }
+    butil::IOBuf io_buf;
+    std::vector<size_t> sizes;
+    for (int idx = 0; idx < schema.size(); idx++) {
+        size_t size = 0;
+        ASSERT_TRUE(EncodeRpcColumn(schema, idx, rows, &io_buf, &size));
+        sizes.push_back(size);
+    }
+    std::vector<RpcColumnView> columns(schema.size());
+    for (int idx = 0; idx < schema.size(); idx++) {
+        butil::IOBuf column_buf;
+        io_buf.cutn(&column_buf, sizes[idx]);
+        ASSERT_TRUE(columns[idx].Reset(schema.Get(idx).type(), rows.size(), column_buf));
+    }
+    ASSERT_EQ(0u, io_buf.size());
+    for (uint32_t i = 0; i < 20; i++) {
+        int32_t int_val = 0;
+        const char* str = nullptr;
+        uint32_t length = 0;
+        if (i % 3 == 0) {
+            ASSERT_TRUE(columns[0].IsNULL(i));
+            ASSERT_EQ(1, columns[0].GetInt32(i, &int_val));
+            ASSERT_EQ(1, columns[1].GetString(i, &str, &length));
+        } else {
+            ASSERT_FALSE(columns[0].IsNULL(i));
+            ASSERT_EQ(0, columns[0].GetInt32(i, &int_val));
+            ASSERT_EQ(static_cast<int32_t>(i), int_val);
+            ASSERT_EQ(0, columns[1].GetString(i, &str, &length));
+            ASSERT_EQ("value" + std::to_string(i), std::string(str, length));
+        }
+        double double_val = 0;
+        ASSERT_EQ(0, columns[2].GetDouble(i, &double_val));
+        ASSERT_DOUBLE_EQ(i * 1.5, double_val);
+        bool bool_val = false;
+        ASSERT_EQ(0, columns[3].GetBool(i, &bool_val));
+        ASSERT_EQ(i % 2 == 0, bool_val);
+    }
+    // wrong type and row out of range
+    int64_t long_val = 0;
+    ASSERT_EQ(-1, columns[0].GetInt64(0, &long_val));
+    int32_t int_val = 0;
+    ASSERT_EQ(-1, columns[0].GetInt32(20, &int_val));
+}
+
+TEST_F(SqlRpcColumnCodecTest, BadSize) {
+    hybridse::codec::Schema schema;
+    InitColumnSchema(&schema);
+    hybridse::codec::RowBuilder builder(schema);
+    std::string buf(builder.CalTotalLength(5), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&buf[0]), buf.size());
+    builder.AppendInt32(1);
+    builder.AppendString("hello", 5);
+    builder.AppendDouble(1.0);
+    builder.AppendBool(true);
+    std::vector<const int8_t*> rows = {reinterpret_cast<const int8_t*>(buf.data())};
+    for (int idx = 0; idx < 2; idx++) {
+        butil::IOBuf io_buf;
+        size_t size = 0;
+        ASSERT_TRUE(EncodeRpcColumn(schema, idx, rows, &io_buf, &size));
+        ASSERT_EQ(size, io_buf.size());
+        RpcColumnView column;
+        ASSERT_FALSE(column.Reset(schema.Get(idx).type(), 2, io_buf));
+        io_buf.pop_back(1);
+        ASSERT_FALSE(column.Reset(schema.Get(idx).type(), 1, io_buf));
+    }
+}
+
+}  // namespace codec
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
@@ -70,6 +70,19 @@ bool DecodeRpcRow(const butil::IOBuf& buf, size_t offset, size_t size, size_t sl
     return true;
 }
 
+bool CutRpcRow(butil::IOBuf* buf, size_t size, size_t slice_num, hybridse::codec::Row* row) {
+    if (buf == nullptr || row == nullptr) {
+        return false;
+    }
+    if (size > buf->size()) {
+        LOG(WARNING) << "Size " << size << " out of bound, buf size=" << buf->size();
+        return false;
+    }
+    butil::IOBuf row_buf;
+    buf->cutn(&row_buf, size);
+    return DecodeRpcRow(row_buf, 0, size, slice_num, row);
+}
+
 bool EncodeRpcRow(const hybridse::codec::Row& row, butil::IOBuf* buf, size_t* total_size) {
     if (buf == nullptr) {
         return false;
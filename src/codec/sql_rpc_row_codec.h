@@ -34,6 +34,11 @@ namespace codec {
 
 bool DecodeRpcRow(const butil::IOBuf& buf, size_t offset, size_t size, size_t slice_num, hybridse::codec::Row* row);
 
+// decode the row at the front of buf and cut it off. decoding a batch of rows
+// this way is linear in the buffer size, seeking by offset walks the blocks
+// from the head of the buffer for every row
+bool CutRpcRow(butil::IOBuf* buf, size_t size, size_t slice_num, hybridse::codec::Row* row);
+
 bool EncodeRpcRow(const hybridse::codec::Row& row, butil::IOBuf* buf, size_t* total_size);
 
 bool EncodeRpcRow(const int8_t* buf, size_t size, butil::IOBuf* io_buf);
@@ -124,6 +124,35 @@ TEST_F(SqlRpcRowCodecTest, TestMultiSlice) {
     ASSERT_EQ(0, decoded.size(3));
 }
 
+TEST_F(SqlRpcRowCodecTest, TestCutRows) {
+    hybridse::codec::Schema schema;
+    InitSchema(&schema);
+    hybridse::codec::RowBuilder builder(schema);
+    size_t buf_size = builder.CalTotalLength(5);
+    butil::IOBuf iobuf;
+    for (int i = 0; i < 100; i++) {
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(buf_size));
+        builder.SetBuffer(buf, buf_size);
+        builder.AppendInt32(i);
+        builder.AppendFloat(3.14);
+        builder.AppendString("hello", 5);
+        hybridse::codec::Row row(hybridse::codec::RefCountedSlice::CreateManaged(buf, buf_size));
+        size_t total_size;
+        ASSERT_TRUE(EncodeRpcRow(row, &iobuf, &total_size));
+    }
+    hybridse::codec::RowView row_view(schema);
+    for (int i = 0; i < 100; i++) {
+        hybridse::codec::Row decoded;
+        ASSERT_TRUE(CutRpcRow(&iobuf, buf_size, 1, &decoded));
+        row_view.Reset(decoded.buf(0), decoded.size(0));
+        ASSERT_EQ(i, row_view.GetInt32Unsafe(0));
+        ASSERT_EQ("hello", row_view.GetStringUnsafe(2));
+    }
+    ASSERT_EQ(0u, iobuf.size());
+    hybridse::codec::Row decoded;
+    ASSERT_FALSE(CutRpcRow(&iobuf, buf_size, 1, &decoded));
+}
+
 }  // namespace codec
 }  // namespace fedb
 
@@ -45,6 +45,32 @@ DEFINE_uint32(name_server_task_concurrency_for_replica_cluster, 2,
               "config the concurrency of name_server_task for replica cluster");
 DEFINE_uint32(name_server_task_max_concurrency, 8,
               "config the max concurrency of name_server_task");
+DEFINE_bool(enable_name_server_task_steal, true,
+            "run the waiting ops of independent partitions on idle task queues");
+DEFINE_uint32(name_server_task_concurrency_per_tablet, 4,
+              "config the max running ops touching one tablet, 0 means no limit");
+DEFINE_bool(enable_fast_select_leader, false,
+            "elect a leader without the unreachable followers whose offset, reported after the leader "
+            "went offline, it covers");
+DEFINE_uint32(table_change_log_size, 1000,
+              "config the number of table changes kept for the incremental refresh of clients");
+DEFINE_bool(enable_hot_partition_migrate, false,
+            "migrate the followers of hot partitions off overloaded tablets automatically");
+DEFINE_double(hot_tablet_load_ratio, 1.5,
+              "config how many times the average request rate makes a tablet hot");
+DEFINE_uint32(hot_tablet_min_qps, 10000, "config the min request rate of a hot tablet");
+DEFINE_uint32(hot_tablet_put_byte_per_qps, 4096,
+              "config how many written bytes per second count as one request per second in the hot score");
+DEFINE_uint32(name_server_migrate_concurrency, 1,
+              "config the max migrate ops started by the automatic rebalance");
+DEFINE_bool(enable_memory_aware_placement, false,
+            "place the partitions of new tables on the tablets holding the least memory");
+DEFINE_bool(enable_memory_rebalance, false,
+            "migrate followers off the tablets holding much more memory than the average");
+DEFINE_double(memory_rebalance_ratio, 1.2,
+              "config how many times the average memory makes a tablet overloaded");
+DEFINE_uint64(memory_rebalance_min_byte_size, 1024 * 1024 * 1024,
+              "config the min memory of a tablet the rebalance moves replicas from");
 DEFINE_int32(name_server_task_wait_time, 1000, "config the time of task wait");
 DEFINE_uint32(name_server_op_execute_timeout, 2 * 60 * 60 * 1000,
               "config the timeout of nameserver op");
@@ -79,6 +105,18 @@ DEFINE_uint32(preview_limit_max_num, 1000,
               "config the max num of preview limit");
 DEFINE_uint32(preview_default_limit, 100,
               "config the default limit of preview");
+DEFINE_uint32(batch_query_parallelism, 4,
+              "config the max bthreads used by one batch get/scan request");
+DEFINE_uint32(batch_query_parallel_threshold, 32,
+              "config the min key count to run batch get/scan in parallel");
+DEFINE_uint32(sql_plan_cache_shard_num, 16,
+              "config the shard num of compiled sql plan cache on tablet");
+DEFINE_uint32(sql_plan_cache_capacity, 4096,
+              "config the max compiled sql plans cached on tablet");
+DEFINE_uint32(procedure_result_cache_max_mb, 256,
+              "config the max memory in MB of procedure results cached on tablet");
+DEFINE_uint32(procedure_result_cache_slot_num, 4096,
+              "config the key slot num a put invalidates cached procedure results by");
 // binlog configuration
 DEFINE_int32(binlog_single_file_max_size, 1024 * 4,
              "the max size of single binlog file");
@@ -103,6 +141,13 @@ DEFINE_uint32(put_slow_log_threshold, 50000,
               "config the threshold of put slow log");
 DEFINE_uint32(query_slow_log_threshold, 50000,
               "config the threshold of query slow log");
+DEFINE_bool(enable_table_rpc_metric, false, "record the rpc latency of every table partition");
+DEFINE_bool(enable_admission_control, false,
+            "limit the running rpcs of the online, write, batch and admin classes adaptively");
+DEFINE_uint32(admission_max_concurrency, 256, "the running rpcs shared by the rpc classes by their weight");
+DEFINE_string(admission_class_weight, "online:4,write:2,batch:1,admin:1", "the share of each rpc class");
+DEFINE_uint32(admission_queue_size, 64, "the rpcs of a class waiting to run, more are rejected");
+DEFINE_uint32(admission_queue_timeout_ms, 10, "the rpcs waiting to run longer are rejected");
 
 // local db config
 DEFINE_string(db_root_path, "/tmp/", "the root path of db");
@@ -115,6 +160,10 @@ DEFINE_int32(get_concurrency_limit, 8, "the limit of get concurrency");
 DEFINE_int32(request_max_retry, 3, "max retry time when request error");
 DEFINE_int32(request_timeout_ms, 20000, "request timeout");
 DEFINE_int32(request_sleep_time, 1000, "the sleep time when request error");
+DEFINE_bool(enable_columnar_batch_result, false,
+            "ask the tablet to return the result of a batch request column by column");
+DEFINE_string(sub_query_connection_type, "single",
+              "the connection type of the channels for sub queries to the other tablets, single, pooled or short");
 
 DEFINE_uint32(max_traverse_cnt, 50000, "max traverse iter loop cnt");
 
@@ -129,11 +178,17 @@ DEFINE_uint32(stream_block_size, 1 * 1204 * 1024,
               "config the write/read block size in streaming");
 DEFINE_int32(stream_bandwidth_limit, 10 * 1204 * 1024,
              "the limit bandwidth. Byte/Second");
+DEFINE_uint32(send_file_window_size, 8,
+              "config the max blocks in flight when send a file");
+DEFINE_uint32(send_dir_parallelism, 4,
+              "config the max files sent in parallel when send a dir");
 
 // if set 23, the task will execute 23:00 every day
 DEFINE_int32(make_snapshot_time, 23, "config the time to make snapshot");
 DEFINE_int32(make_snapshot_check_interval, 1000 * 60 * 10,
              "config the interval to check making snapshot time");
+DEFINE_bool(make_snapshot_on_shutdown, false,
+            "snapshot every partition when the tablet is stopped so that the next start replays no binlog");
 DEFINE_int32(make_snapshot_threshold_offset, 100000,
              "config the offset to reach the threshold");
 DEFINE_uint32(make_snapshot_max_deleted_keys, 1000000,
@@ -146,6 +201,12 @@ DEFINE_int32(snapshot_pool_size, 1, "the size of tablet thread pool for making s
 
 DEFINE_uint32(load_index_max_wait_time, 120 * 60 * 1000,
               "config the max wait time of load index");
+DEFINE_bool(enable_online_index_backfill, true,
+            "build the data of a new index from memory instead of dump files");
+DEFINE_uint32(index_backfill_thread_num, 4,
+              "config the threads traversing segments when backfill index");
+DEFINE_uint32(index_backfill_batch_size, 500,
+              "config the max entries of one put index data request");
 
 DEFINE_string(recycle_bin_root_path, "/tmp/recycle",
               "specify the root path of recycle bin");
@@ -181,6 +242,7 @@ DEFINE_bool(verify_compression, false, "For debug");
 DEFINE_uint32(load_table_batch, 30, "set laod table batch size");
 DEFINE_uint32(load_table_thread_num, 3, "set load tabale thread pool size");
 DEFINE_uint32(load_table_queue_size, 1000, "set load tabale queue size");
+DEFINE_uint32(load_table_concurrency_per_disk, 2, "the max number of tables loaded at the same time on one disk");
 
 // multiple data center
 DEFINE_uint32(get_replica_status_interval, 10000,
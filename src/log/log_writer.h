@@ -22,6 +22,7 @@
 #define SRC_LOG_LOG_WRITER_H_
 
 #include <stdint.h>
+#include <stdio.h>
 #include <string>
 #include "base/slice.h"
 #include "base/status.h"
@@ -63,6 +64,11 @@ class Writer {
         return header_size_;
     }
 
+    // bytes of the buffers for compressed blocks
+    inline uint32_t GetBufferSize() {
+        return buffer_ == nullptr ? 0 : block_size_ * 2;
+    }
+
     CompressType GetCompressType(const std::string& compress_type);
 
  private:
@@ -111,6 +117,9 @@ struct WriteHandle {
 
     uint64_t GetSize() { return wf_->GetSize(); }
 
+    // bytes buffered by the writer and the stdio stream
+    uint64_t GetBufferSize() { return lw_->GetBufferSize() + BUFSIZ; }
+
     ~WriteHandle() {
         delete lw_;
         delete wf_;
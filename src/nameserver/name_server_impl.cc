@@ -22,6 +22,7 @@
 #include <strings.h>
 
 #include <algorithm>
+#include <iterator>
 #include <set>
 #ifdef DISALLOW_COPY_AND_ASSIGN
 #undef DISALLOW_COPY_AND_ASSIGN
@@ -61,6 +62,20 @@ DECLARE_int32(make_snapshot_check_interval);
 DECLARE_bool(use_name);
 DECLARE_bool(enable_distsql);
 DECLARE_bool(enable_timeseries_table);
+DECLARE_bool(enable_online_index_backfill);
+DECLARE_bool(enable_name_server_task_steal);
+DECLARE_uint32(name_server_task_concurrency_per_tablet);
+DECLARE_bool(enable_fast_select_leader);
+DECLARE_uint32(table_change_log_size);
+DECLARE_bool(enable_hot_partition_migrate);
+DECLARE_double(hot_tablet_load_ratio);
+DECLARE_uint32(hot_tablet_min_qps);
+DECLARE_uint32(hot_tablet_put_byte_per_qps);
+DECLARE_uint32(name_server_migrate_concurrency);
+DECLARE_bool(enable_memory_aware_placement);
+DECLARE_bool(enable_memory_rebalance);
+DECLARE_double(memory_rebalance_ratio);
+DECLARE_uint64(memory_rebalance_min_byte_size);
 
 using ::fedb::base::ReturnCode;
 using ::fedb::api::OPType::kAddIndexOP;
@@ -788,6 +803,11 @@ bool NameServerImpl::Recover() {
                 return false;
             }
         }
+        {
+            // the log of the former leader is dropped, clients reload all tables on the gap
+            std::lock_guard<std::mutex> log_lock(change_log_mu_);
+            table_change_log_.clear();
+        }
         value.clear();
         if (!zk_client_->GetNodeValue(zk_auto_failover_node_, value)) {
             auto_failover_.load(std::memory_order_acquire) ? value = "true" : value = "false";
@@ -1143,20 +1163,13 @@ bool NameServerImpl::RecoverOPTask() {
             op_data->op_info_.task_status() == ::fedb::api::TaskStatus::kCanceled) {
             done_op_list_.push_back(op_data);
         } else {
-            uint32_t idx = 0;
             if (op_data->op_info_.for_replica_cluster() == 1) {
-                idx = op_data->op_info_.vec_idx();
                 PDLOG(INFO,
                       "current task is for replica cluster, op_index [%lu] "
                       "op_type[%s]",
                       op_data->op_info_.op_id(), ::fedb::api::OPType_Name(op_data->op_info_.op_type()).c_str());
-            } else {
-                idx = op_data->op_info_.pid() % task_vec_.size();
-                if (op_data->op_info_.has_vec_idx() && op_data->op_info_.vec_idx() < task_vec_.size()) {
-                    idx = op_data->op_info_.vec_idx();
-                }
             }
-            task_vec_[idx].push_back(op_data);
+            task_vec_[GetRecoverOPQueue(op_data)].push_back(op_data);
         }
         PDLOG(INFO, "recover op[%s] success. op_id[%lu]",
               ::fedb::api::OPType_Name(op_data->op_info_.op_type()).c_str(), op_data->op_info_.op_id());
@@ -1174,6 +1187,17 @@ bool NameServerImpl::RecoverOPTask() {
     }
     return true;
 }
+uint32_t NameServerImpl::GetRecoverOPQueue(const std::shared_ptr<OPData>& op_data) {
+    if (op_data->op_info_.for_replica_cluster() == 1) {
+        return op_data->op_info_.vec_idx();
+    }
+    // ops moved to an idle queue go back to it
+    if (op_data->op_info_.has_vec_idx() && op_data->op_info_.vec_idx() < task_vec_.size()) {
+        return op_data->op_info_.vec_idx();
+    }
+    return op_data->op_info_.pid() % task_vec_.size();
+}
+
 int NameServerImpl::CreateMakeSnapshotOPTask(std::shared_ptr<OPData> op_data) {
     MakeSnapshotNSRequest request;
     if (!request.ParseFromString(op_data->op_info_.data())) {
@@ -1547,6 +1571,7 @@ bool NameServerImpl::Init(const std::string& zk_cluster, const std::string& zk_p
     zk_zone_data_path_ = zk_path + "/cluster";
     zk_auto_failover_node_ = zk_config_path + "/auto_failover";
     zk_table_changed_notify_node_ = zk_table_path + "/notify";
+    zk_table_change_log_node_ = zk_table_path + "/change_log";
     running_.store(false, std::memory_order_release);
     mode_.store(kNORMAL, std::memory_order_release);
     auto_failover_.store(FLAGS_auto_failover, std::memory_order_release);
@@ -1570,6 +1595,12 @@ bool NameServerImpl::Init(const std::string& zk_cluster, const std::string& zk_p
         }
     }
     task_vec_.resize(FLAGS_name_server_task_max_concurrency + FLAGS_name_server_task_concurrency_for_replica_cluster);
+    // several nameservers may share a process, so the bvar names carry the endpoint
+    std::string metric_prefix = "fedb_nameserver_" + endpoint;
+    op_waiting_cnt_.reset(new bvar::Status<uint64_t>(metric_prefix, "op_waiting", 0));
+    op_running_cnt_.reset(new bvar::Status<uint64_t>(metric_prefix, "op_running", 0));
+    op_wait_latency_.reset(new bvar::LatencyRecorder(metric_prefix, "op_wait"));
+    op_run_latency_.reset(new bvar::LatencyRecorder(metric_prefix, "op_run"));
     std::string value;
     std::vector<std::string> endpoints;
     if (!zk_client_->GetNodes(endpoints)) {
@@ -1756,6 +1787,9 @@ int NameServerImpl::UpdateTask(const std::list<std::shared_ptr<OPData>>& op_list
         if (op_data->op_info_.op_id() == response.task(idx).op_id() &&
             task->task_info_->task_type() == response.task(idx).task_type()) {
             has_op_task = true;
+            if (task->sub_task_.empty() && response.task(idx).has_progress()) {
+                task->task_info_->set_progress(response.task(idx).progress());
+            }
             if (response.task(idx).status() != ::fedb::api::kInited) {
                 if (!task->sub_task_.empty()) {
                     for (auto& sub_task : task->sub_task_) {
@@ -2056,6 +2090,7 @@ void NameServerImpl::DeleteTask(const std::vector<uint64_t>& done_task_vec) {
             if (!zk_client_->SetNodeValue(node, value)) {
                 PDLOG(WARNING, "set zk status value failed. node[%s] value[%s]", node.c_str(), value.c_str());
             }
+            RecordOPFinished(op_data);
             done_op_list_.push_back(op_data);
             task_vec_[index].pop_front();
             PDLOG(INFO, "delete op[%lu] in running op", op_id);
@@ -2067,6 +2102,7 @@ void NameServerImpl::DeleteTask(const std::vector<uint64_t>& done_task_vec) {
                     op_data->op_info_.set_task_status(::fedb::api::kDone);
                     op_data->task_list_.clear();
                 }
+                RecordOPFinished(op_data);
                 done_op_list_.push_back(op_data);
                 task_vec_[index].pop_front();
                 PDLOG(INFO, "delete op[%lu] in running op", op_id);
@@ -2096,6 +2132,26 @@ void NameServerImpl::ProcessTask() {
                 }
             }
 
+            std::map<std::string, uint64_t> running_partitions;
+            std::map<std::string, uint32_t> running_endpoints;
+            uint64_t waiting_cnt = 0;
+            for (const auto& op_list : task_vec_) {
+                if (op_list.empty()) {
+                    continue;
+                }
+                waiting_cnt += op_list.size();
+                const std::shared_ptr<OPData>& op_data = op_list.front();
+                if (op_data->op_info_.task_status() == ::fedb::api::kDoing) {
+                    AddRunningOP(op_data, &running_partitions, &running_endpoints);
+                }
+            }
+            // an op waits for the queued ops of its partition added before it,
+            // also for the ones moved to another queue
+            std::map<std::string, uint64_t> first_op;
+            GetFirstOP(&first_op);
+            if (FLAGS_enable_name_server_task_steal) {
+                StealTask(running_partitions, running_endpoints, first_op);
+            }
             for (const auto& op_list : task_vec_) {
                 if (op_list.empty()) {
                     continue;
@@ -2106,6 +2162,9 @@ void NameServerImpl::ProcessTask() {
                     continue;
                 }
                 if (op_data->op_info_.task_status() == ::fedb::api::kInited) {
+                    if (!CanRunOP(op_data, running_partitions, running_endpoints, first_op)) {
+                        continue;
+                    }
                     op_data->op_info_.set_start_time(::baidu::common::timer::now_time());
                     op_data->op_info_.set_task_status(::fedb::api::kDoing);
                     std::string value;
@@ -2117,6 +2176,11 @@ void NameServerImpl::ProcessTask() {
                         op_data->op_info_.set_task_status(::fedb::api::kInited);
                         continue;
                     }
+                    op_data->run_time_ = ::baidu::common::timer::get_micros();
+                    if (op_data->add_time_ > 0 && op_wait_latency_) {
+                        *op_wait_latency_ << (op_data->run_time_ - op_data->add_time_) / 1000;
+                    }
+                    AddRunningOP(op_data, &running_partitions, &running_endpoints);
                 }
                 std::shared_ptr<Task> task = op_data->task_list_.front();
                 if (task->task_info_->status() == ::fedb::api::kFailed) {
@@ -2143,12 +2207,176 @@ void NameServerImpl::ProcessTask() {
                     }
                 }
             }
+            uint64_t running_cnt = 0;
+            for (const auto& op_list : task_vec_) {
+                if (!op_list.empty() && op_list.front()->op_info_.task_status() == ::fedb::api::kDoing) {
+                    running_cnt++;
+                }
+            }
+            if (op_running_cnt_ && op_waiting_cnt_) {
+                op_running_cnt_->set_value(running_cnt);
+                op_waiting_cnt_->set_value(waiting_cnt > running_cnt ? waiting_cnt - running_cnt : 0);
+            }
         }
         UpdateZKTaskStatus();
         DeleteTask();
     }
 }
 
+static bool IsPartitionOP(const std::shared_ptr<OPData>& op_data) {
+    return op_data->op_info_.pid() != INVALID_PID && op_data->op_info_.for_replica_cluster() != 1;
+}
+
+static std::string GetOPPartitionKey(const std::shared_ptr<OPData>& op_data) {
+    return op_data->op_info_.db() + "/" + op_data->op_info_.name() + "/" +
+           std::to_string(op_data->op_info_.pid());
+}
+
+static void GetOPEndpoints(const std::shared_ptr<OPData>& op_data, std::set<std::string>* endpoints) {
+    for (const auto& task : op_data->task_list_) {
+        if (!task->endpoint_.empty()) {
+            endpoints->insert(task->endpoint_);
+        }
+        for (const auto& sub_task : task->sub_task_) {
+            if (!sub_task->endpoint_.empty()) {
+                endpoints->insert(sub_task->endpoint_);
+            }
+        }
+    }
+}
+
+void NameServerImpl::AddRunningOP(const std::shared_ptr<OPData>& op_data,
+                                  std::map<std::string, uint64_t>* running_partitions,
+                                  std::map<std::string, uint32_t>* running_endpoints) {
+    if (!IsPartitionOP(op_data)) {
+        return;
+    }
+    running_partitions->emplace(GetOPPartitionKey(op_data), op_data->op_info_.op_id());
+    std::set<std::string> endpoints;
+    GetOPEndpoints(op_data, &endpoints);
+    for (const auto& endpoint : endpoints) {
+        (*running_endpoints)[endpoint]++;
+    }
+}
+
+void NameServerImpl::GetFirstOP(std::map<std::string, uint64_t>* first_op) {
+    for (const auto& op_list : task_vec_) {
+        for (const auto& op_data : op_list) {
+            if (!IsPartitionOP(op_data)) {
+                continue;
+            }
+            auto result = first_op->emplace(GetOPPartitionKey(op_data), op_data->op_info_.op_id());
+            if (!result.second && result.first->second > op_data->op_info_.op_id()) {
+                result.first->second = op_data->op_info_.op_id();
+            }
+        }
+    }
+}
+
+bool NameServerImpl::CanRunOP(const std::shared_ptr<OPData>& op_data,
+                              const std::map<std::string, uint64_t>& running_partitions,
+                              const std::map<std::string, uint32_t>& running_endpoints,
+                              const std::map<std::string, uint64_t>& first_op) {
+    if (!IsPartitionOP(op_data)) {
+        return true;
+    }
+    // the ops of one partition run one by one, in the order they are added
+    std::string key = GetOPPartitionKey(op_data);
+    auto iter = running_partitions.find(key);
+    if (iter != running_partitions.end() && iter->second != op_data->op_info_.op_id()) {
+        return false;
+    }
+    auto first_iter = first_op.find(key);
+    if (first_iter != first_op.end() && first_iter->second != op_data->op_info_.op_id()) {
+        return false;
+    }
+    if (FLAGS_name_server_task_concurrency_per_tablet > 0) {
+        std::set<std::string> endpoints;
+        GetOPEndpoints(op_data, &endpoints);
+        for (const auto& endpoint : endpoints) {
+            auto it = running_endpoints.find(endpoint);
+            if (it != running_endpoints.end() && it->second >= FLAGS_name_server_task_concurrency_per_tablet) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void NameServerImpl::StealTask(const std::map<std::string, uint64_t>& running_partitions,
+                               const std::map<std::string, uint32_t>& running_endpoints,
+                               const std::map<std::string, uint64_t>& first_op) {
+    uint32_t queue_num = std::min((uint32_t)task_vec_.size(), FLAGS_name_server_task_max_concurrency);
+    bool has_idle = false;
+    for (uint32_t idx = 0; idx < queue_num; idx++) {
+        if (task_vec_[idx].empty()) {
+            has_idle = true;
+            break;
+        }
+    }
+    if (!has_idle) {
+        return;
+    }
+    for (uint32_t idx = 0; idx < queue_num; idx++) {
+        if (!task_vec_[idx].empty()) {
+            continue;
+        }
+        bool moved = false;
+        for (uint32_t cur_idx = 0; cur_idx < queue_num && !moved; cur_idx++) {
+            auto& op_list = task_vec_[cur_idx];
+            if (op_list.size() < 2) {
+                continue;
+            }
+            for (auto iter = std::next(op_list.begin()); iter != op_list.end(); iter++) {
+                std::shared_ptr<OPData> op_data = *iter;
+                if (!IsPartitionOP(op_data) || op_data->task_list_.empty() ||
+                    op_data->op_info_.task_status() != ::fedb::api::kInited ||
+                    op_data->op_info_.parent_id() != INVALID_PARENT_ID ||
+                    !CanRunOP(op_data, running_partitions, running_endpoints, first_op)) {
+                    continue;
+                }
+                // ops added after this one must wait for it
+                bool is_parent = false;
+                for (const auto& cur_op : op_list) {
+                    if (cur_op->op_info_.parent_id() == op_data->op_info_.op_id()) {
+                        is_parent = true;
+                        break;
+                    }
+                }
+                if (is_parent) {
+                    continue;
+                }
+                op_data->op_info_.set_vec_idx(idx);
+                std::string value;
+                op_data->op_info_.SerializeToString(&value);
+                std::string node = zk_op_data_path_ + "/" + std::to_string(op_data->op_info_.op_id());
+                if (!zk_client_->SetNodeValue(node, value)) {
+                    PDLOG(WARNING, "set zk op value failed. node[%s]", node.c_str());
+                    op_data->op_info_.set_vec_idx(cur_idx);
+                    return;
+                }
+                PDLOG(INFO, "move op[%lu] from queue %u to idle queue %u. op_type[%s] name[%s] pid[%u]",
+                      op_data->op_info_.op_id(), cur_idx, idx,
+                      ::fedb::api::OPType_Name(op_data->op_info_.op_type()).c_str(),
+                      op_data->op_info_.name().c_str(), op_data->op_info_.pid());
+                op_list.erase(iter);
+                task_vec_[idx].push_back(op_data);
+                moved = true;
+                break;
+            }
+        }
+        if (!moved) {
+            return;
+        }
+    }
+}
+
+void NameServerImpl::RecordOPFinished(const std::shared_ptr<OPData>& op_data) {
+    if (op_data->run_time_ > 0 && op_run_latency_) {
+        *op_run_latency_ << (::baidu::common::timer::get_micros() - op_data->run_time_) / 1000;
+    }
+}
+
 void NameServerImpl::ConnectZK(RpcController* controller, const ConnectZKRequest* request, GeneralResponse* response,
                                Closure* done) {
     brpc::ClosureGuard done_guard(done);
@@ -2539,6 +2767,34 @@ int NameServerImpl::SetPartitionInfo(TableInfo& table_info) {
             }
         }
     }
+    std::vector<std::vector<std::string>> placement;
+    if (FLAGS_enable_memory_aware_placement) {
+        std::map<std::string, TabletUsage> usage;
+        for (const auto& kv : endpoint_pid_bucked) {
+            usage.emplace(kv.first, TabletUsage());
+        }
+        auto add_usage = [&usage](const std::map<std::string, std::shared_ptr<TableInfo>>& table_info_map) {
+            for (const auto& kv : table_info_map) {
+                for (const auto& partition : kv.second->table_partition()) {
+                    for (const auto& meta : partition.partition_meta()) {
+                        auto it = usage.find(meta.endpoint());
+                        if (it == usage.end() || !meta.is_alive()) {
+                            continue;
+                        }
+                        it->second.byte_size += meta.record_byte_size();
+                        it->second.diskused += meta.diskused();
+                        it->second.partition_num++;
+                    }
+                }
+            }
+        };
+        std::lock_guard<std::mutex> lock(mu_);
+        add_usage(table_info_);
+        for (const auto& kv : db_table_info_) {
+            add_usage(kv.second);
+        }
+        PlacePartitions(usage, partition_num, replica_num, &placement);
+    }
     int index = 0;
     int pos = 0;
     uint64_t min = UINT64_MAX;
@@ -2557,7 +2813,8 @@ int NameServerImpl::SetPartitionInfo(TableInfo& table_info) {
         PartitionMeta* leader_partition_meta = NULL;
         for (uint32_t idx = 0; idx < replica_num; idx++) {
             PartitionMeta* partition_meta = table_partition->add_partition_meta();
-            std::string endpoint = endpoint_vec[pos % endpoint_vec.size()];
+            std::string endpoint =
+                placement.empty() ? endpoint_vec[pos % endpoint_vec.size()] : placement[pid][idx];
             partition_meta->set_endpoint(endpoint);
             partition_meta->set_is_leader(false);
             if (endpoint_leader[endpoint] < min_leader_num) {
@@ -3210,6 +3467,9 @@ void NameServerImpl::ShowOPStatus(RpcController* controller, const ShowOPStatusR
         } else {
             std::shared_ptr<Task> task = kv.second->task_list_.front();
             op_status->set_task_type(::fedb::api::TaskType_Name(task->task_info_->task_type()));
+            if (task->task_info_->has_progress()) {
+                op_status->set_progress(task->task_info_->progress());
+            }
         }
         op_status->set_start_time(kv.second->op_info_.start_time());
         op_status->set_end_time(kv.second->op_info_.end_time());
@@ -3470,7 +3730,7 @@ void NameServerImpl::DropTableInternel(const DropTableRequest& request, GeneralR
                 task_ptr->set_status(::fedb::api::TaskStatus::kDone);
             }
         }
-        NotifyTableChanged();
+        NotifyTableChanged(tid);
     }
 }
 
@@ -3640,7 +3900,7 @@ void NameServerImpl::AddTableField(RpcController* controller, const AddTableFiel
         added_column_desc->CopyFrom(request->column_desc());
         fedb::common::VersionPair* added_version_pair = table_info->add_schema_versions();
         added_version_pair->CopyFrom(new_pair);
-        NotifyTableChanged();
+        NotifyTableChanged(table_info->tid());
     }
     response->set_code(ReturnCode::kOk);
     response->set_msg("ok");
@@ -4013,7 +4273,7 @@ bool NameServerImpl::SetTableInfo(std::shared_ptr<::fedb::nameserver::TableInfo>
         {
             std::lock_guard<std::mutex> lock(mu_);
             db_table_info_[table_info->db()].insert(std::make_pair(table_info->name(), table_info));
-            NotifyTableChanged();
+            NotifyTableChanged(table_info->tid());
         }
     } else {
         if (!zk_client_->CreateNode(zk_table_data_path_ + "/" + table_info->name(), table_value)) {
@@ -4027,7 +4287,7 @@ bool NameServerImpl::SetTableInfo(std::shared_ptr<::fedb::nameserver::TableInfo>
         {
             std::lock_guard<std::mutex> lock(mu_);
             table_info_.insert(std::make_pair(table_info->name(), table_info));
-            NotifyTableChanged();
+            NotifyTableChanged(table_info->tid());
         }
     }
     return true;
@@ -5273,7 +5533,20 @@ int NameServerImpl::AddOPData(const std::shared_ptr<OPData>& op_data, uint32_t c
             idx = op_data->op_info_.pid() % concurrency;
         }
     }
+    uint64_t parent_id = op_data->op_info_.parent_id();
+    if (parent_id != INVALID_PARENT_ID) {
+        // the parent may have been moved to another queue
+        for (uint32_t cur_idx = 0; cur_idx < task_vec_.size(); cur_idx++) {
+            for (const auto& cur_op : task_vec_[cur_idx]) {
+                if (cur_op->op_info_.op_id() == parent_id) {
+                    idx = cur_idx;
+                    break;
+                }
+            }
+        }
+    }
     op_data->op_info_.set_vec_idx(idx);
+    op_data->add_time_ = ::baidu::common::timer::get_micros();
     std::string value;
     op_data->op_info_.SerializeToString(&value);
     std::string node = zk_op_data_path_ + "/" + std::to_string(op_data->op_info_.op_id());
@@ -5282,7 +5555,6 @@ int NameServerImpl::AddOPData(const std::shared_ptr<OPData>& op_data, uint32_t c
               ::fedb::api::OPType_Name(op_data->op_info_.op_type()).c_str());
         return -1;
     }
-    uint64_t parent_id = op_data->op_info_.parent_id();
     if (parent_id != INVALID_PARENT_ID) {
         std::list<std::shared_ptr<OPData>>::iterator iter = task_vec_[idx].begin();
         for (; iter != task_vec_[idx].end(); iter++) {
@@ -5490,8 +5762,11 @@ void NameServerImpl::UpdateTableStatus() {
     }
     std::unordered_map<std::string, ::fedb::api::TableStatus> pos_response;
     pos_response.reserve(16);
+    // the offsets of a tablet are not older than the time its request is sent
+    std::map<std::string, uint64_t> status_time;
     for (const auto& kv : tablet_ptr_map) {
         ::fedb::api::GetTableStatusResponse tablet_status_response;
+        status_time[kv.first] = ::baidu::common::timer::get_micros() / 1000;
         if (!kv.second->client_->GetTableStatus(tablet_status_response)) {
             PDLOG(WARNING, "get table status failed! endpoint[%s]", kv.first.c_str());
             continue;
@@ -5505,9 +5780,27 @@ void NameServerImpl::UpdateTableStatus() {
     if (pos_response.empty()) {
         DEBUGLOG("pos_response is empty");
     } else {
-        UpdateTableStatusFun(table_info_, pos_response);
+        UpdateTableStatusFun(table_info_, pos_response, status_time);
         for (const auto& kv : db_table_info_) {
-            UpdateTableStatusFun(kv.second, pos_response);
+            UpdateTableStatusFun(kv.second, pos_response, status_time);
+        }
+        {
+            // drop the replicas not reported for a while
+            std::lock_guard<std::mutex> lock(mu_);
+            uint64_t expire_time = ::baidu::common::timer::get_micros() / 1000 - 3 * FLAGS_get_table_status_interval;
+            for (auto it = replica_counters_.begin(); it != replica_counters_.end();) {
+                if (it->second.update_time < expire_time) {
+                    it = replica_counters_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        if (FLAGS_enable_hot_partition_migrate) {
+            MigrateHotPartition();
+        }
+        if (FLAGS_enable_memory_rebalance) {
+            RebalanceMemory();
         }
     }
     if (running_.load(std::memory_order_acquire)) {
@@ -5518,8 +5811,10 @@ void NameServerImpl::UpdateTableStatus() {
 
 void NameServerImpl::UpdateTableStatusFun(
     const std::map<std::string, std::shared_ptr<TableInfo>>& table_info_map,
-    const std::unordered_map<std::string, ::fedb::api::TableStatus>& pos_response) {
+    const std::unordered_map<std::string, ::fedb::api::TableStatus>& pos_response,
+    const std::map<std::string, uint64_t>& status_time) {
     std::lock_guard<std::mutex> lock(mu_);
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
     for (const auto& kv : table_info_map) {
         uint32_t tid = kv.second->tid();
         std::string first_index_col;
@@ -5569,6 +5864,13 @@ void NameServerImpl::UpdateTableStatusFun(
                     }
                     partition_meta->set_record_cnt(record_cnt);
                     partition_meta->set_diskused(table_status.diskused());
+                    ReplicaCounter* counter = &replica_counters_[pos_key];
+                    UpdateReplicaCounter(table_status.put_cnt(), table_status.put_byte_size(), table_status.read_cnt(),
+                                         cur_time, counter);
+                    auto time_iter = status_time.find(endpoint);
+                    if (time_iter != status_time.end()) {
+                        counter->offset_time = time_iter->second;
+                    }
                     if (kv.second->table_partition(idx).partition_meta(meta_idx).is_alive() &&
                         kv.second->table_partition(idx).partition_meta(meta_idx).is_leader()) {
                         table_partition->set_record_cnt(record_cnt);
@@ -5584,6 +5886,124 @@ void NameServerImpl::UpdateTableStatusFun(
     }
 }
 
+uint32_t NameServerImpl::GetMigrateOPNum() {
+    uint32_t cnt = 0;
+    for (const auto& op_list : task_vec_) {
+        for (const auto& op_data : op_list) {
+            if (op_data->op_info_.op_type() == ::fedb::api::OPType::kMigrateOP) {
+                cnt++;
+            }
+        }
+    }
+    return cnt;
+}
+
+bool NameServerImpl::MigrateHotReplica(const std::vector<ReplicaLoad>& loads, double load_ratio, double min_load) {
+    std::vector<std::string> endpoints;
+    for (const auto& kv : tablets_) {
+        if (kv.second->state_ == ::fedb::api::TabletState::kTabletHealthy) {
+            endpoints.push_back(kv.first);
+        }
+    }
+    std::string des_endpoint;
+    int idx = SelectHotReplica(loads, endpoints, load_ratio, min_load, &des_endpoint);
+    if (idx < 0) {
+        return false;
+    }
+    const ReplicaLoad& load = loads[idx];
+    PDLOG(INFO, "migrate replica off hot tablet. table[%s] db[%s] pid[%u] load[%.0f] src_endpoint[%s] des_endpoint[%s]",
+          load.name.c_str(), load.db.c_str(), load.pid, load.load, load.endpoint.c_str(), des_endpoint.c_str());
+    if (CreateMigrateOP(load.endpoint, load.name, load.db, load.pid, des_endpoint) < 0) {
+        PDLOG(WARNING, "create migrate op failed. table[%s] pid[%u]", load.name.c_str(), load.pid);
+        return false;
+    }
+    return true;
+}
+
+void NameServerImpl::MigrateHotPartition() {
+    std::lock_guard<std::mutex> lock(mu_);
+    // the rates settle before the next move
+    if (GetMigrateOPNum() >= FLAGS_name_server_migrate_concurrency) {
+        return;
+    }
+    std::vector<ReplicaLoad> loads;
+    auto add_loads = [&](const std::map<std::string, std::shared_ptr<TableInfo>>& table_info_map) {
+        for (const auto& kv : table_info_map) {
+            const auto& table_info = kv.second;
+            for (const auto& partition : table_info->table_partition()) {
+                std::string prefix = std::to_string(table_info->tid()) + "_" + std::to_string(partition.pid()) + "_";
+                // every replica applies the writes of the leader. large rows cost
+                // more than small ones, so the written bytes add to the rate
+                double put_qps = 0;
+                for (const auto& meta : partition.partition_meta()) {
+                    auto it = replica_counters_.find(prefix + meta.endpoint());
+                    if (meta.is_leader() && meta.is_alive() && it != replica_counters_.end()) {
+                        put_qps = it->second.put_qps;
+                        if (FLAGS_hot_tablet_put_byte_per_qps > 0) {
+                            put_qps += it->second.put_byte_rate / FLAGS_hot_tablet_put_byte_per_qps;
+                        }
+                    }
+                }
+                for (const auto& meta : partition.partition_meta()) {
+                    if (!meta.is_alive()) {
+                        continue;
+                    }
+                    ReplicaLoad load;
+                    load.db = table_info->db();
+                    load.name = table_info->name();
+                    load.pid = partition.pid();
+                    load.endpoint = meta.endpoint();
+                    load.is_leader = meta.is_leader();
+                    load.load = put_qps;
+                    auto it = replica_counters_.find(prefix + meta.endpoint());
+                    if (it != replica_counters_.end()) {
+                        load.load += it->second.read_qps;
+                    }
+                    loads.push_back(std::move(load));
+                }
+            }
+        }
+    };
+    add_loads(table_info_);
+    for (const auto& kv : db_table_info_) {
+        add_loads(kv.second);
+    }
+    MigrateHotReplica(loads, FLAGS_hot_tablet_load_ratio, FLAGS_hot_tablet_min_qps);
+}
+
+void NameServerImpl::RebalanceMemory() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (GetMigrateOPNum() >= FLAGS_name_server_migrate_concurrency) {
+        return;
+    }
+    std::vector<ReplicaLoad> loads;
+    auto add_loads = [&](const std::map<std::string, std::shared_ptr<TableInfo>>& table_info_map) {
+        for (const auto& kv : table_info_map) {
+            const auto& table_info = kv.second;
+            for (const auto& partition : table_info->table_partition()) {
+                for (const auto& meta : partition.partition_meta()) {
+                    if (!meta.is_alive()) {
+                        continue;
+                    }
+                    ReplicaLoad load;
+                    load.db = table_info->db();
+                    load.name = table_info->name();
+                    load.pid = partition.pid();
+                    load.endpoint = meta.endpoint();
+                    load.is_leader = meta.is_leader();
+                    load.load = meta.record_byte_size();
+                    loads.push_back(std::move(load));
+                }
+            }
+        }
+    };
+    add_loads(table_info_);
+    for (const auto& kv : db_table_info_) {
+        add_loads(kv.second);
+    }
+    MigrateHotReplica(loads, FLAGS_memory_rebalance_ratio, FLAGS_memory_rebalance_min_byte_size);
+}
+
 int NameServerImpl::CreateDelReplicaOP(const std::string& name, const std::string& db, uint32_t pid,
                                        const std::string& endpoint) {
     std::string value = endpoint;
@@ -7926,11 +8346,18 @@ void NameServerImpl::SelectLeader(const std::string& name, const std::string& db
                                   std::vector<std::string>& follower_endpoint,
                                   std::shared_ptr<::fedb::api::TaskInfo> task_info) {
     uint64_t cur_term = 0;
+    // the offsets reported by the last table status
+    std::map<std::string, uint64_t> cached_offset;
+    // when the cached offsets are requested and when the old leader went offline
+    std::map<std::string, uint64_t> offset_time;
+    std::string old_leader;
+    uint64_t offline_time = 0;
     {
         std::lock_guard<std::mutex> lock(mu_);
+        std::shared_ptr<::fedb::nameserver::TableInfo> table_info;
+        bool has_table = GetTableInfoUnlock(name, db, &table_info);
         if (auto_failover_.load(std::memory_order_acquire)) {
-            std::shared_ptr<::fedb::nameserver::TableInfo> table_info;
-            if (!GetTableInfoUnlock(name, db, &table_info)) {
+            if (!has_table) {
                 task_info->set_status(::fedb::api::TaskStatus::kFailed);
                 PDLOG(WARNING, "not found table[%s] in table_info map. op_id[%lu]", name.c_str(), task_info->op_id());
                 return;
@@ -7953,6 +8380,29 @@ void NameServerImpl::SelectLeader(const std::string& name, const std::string& db
                 break;
             }
         }
+        if (has_table) {
+            for (const auto& part : table_info->table_partition()) {
+                if (part.pid() != pid) {
+                    continue;
+                }
+                for (const auto& meta : part.partition_meta()) {
+                    cached_offset.insert(std::make_pair(meta.endpoint(), meta.offset()));
+                    auto counter_it = replica_counters_.find(std::to_string(tid) + "_" + std::to_string(pid) + "_" +
+                                                             meta.endpoint());
+                    if (counter_it != replica_counters_.end()) {
+                        offset_time.insert(std::make_pair(meta.endpoint(), counter_it->second.offset_time));
+                    }
+                    if (meta.is_leader()) {
+                        old_leader = meta.endpoint();
+                    }
+                }
+                break;
+            }
+            auto it = tablets_.find(old_leader);
+            if (it != tablets_.end() && it->second->state_ != ::fedb::api::TabletState::kTabletHealthy) {
+                offline_time = it->second->ctime_;
+            }
+        }
         if (!zk_client_->SetNodeValue(zk_term_node_, std::to_string(term_ + 2))) {
             PDLOG(WARNING,
                   "update leader id  node failed. table name[%s] pid[%u] "
@@ -7964,29 +8414,50 @@ void NameServerImpl::SelectLeader(const std::string& name, const std::string& db
         cur_term = term_ + 1;
         term_ += 2;
     }
-    // select the max offset endpoint as leader
-    uint64_t max_offset = 0;
-    std::vector<std::string> leader_endpoint_vec;
-    for (const auto& endpoint : follower_endpoint) {
-        std::shared_ptr<TabletInfo> tablet_ptr;
-        {
-            std::lock_guard<std::mutex> lock(mu_);
-            auto it = tablets_.find(endpoint);
+    std::vector<std::shared_ptr<TabletInfo>> tablet_vec(follower_endpoint.size());
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (uint32_t idx = 0; idx < follower_endpoint.size(); idx++) {
+            auto it = tablets_.find(follower_endpoint[idx]);
             if (it == tablets_.end() || it->second->state_ != ::fedb::api::TabletState::kTabletHealthy) {
-                PDLOG(WARNING, "endpoint[%s] is offline. table[%s] pid[%u]  op_id[%lu]", endpoint.c_str(), name.c_str(),
-                      pid, task_info->op_id());
-                task_info->set_status(::fedb::api::TaskStatus::kFailed);
-                return;
+                PDLOG(WARNING, "endpoint[%s] is offline. table[%s] pid[%u]  op_id[%lu]",
+                      follower_endpoint[idx].c_str(), name.c_str(), pid, task_info->op_id());
+                continue;
             }
-            tablet_ptr = it->second;
+            tablet_vec[idx] = it->second;
         }
-        uint64_t offset = 0;
-        if (!tablet_ptr->client_->FollowOfNoOne(tid, pid, cur_term, offset)) {
-            PDLOG(WARNING, "followOfNoOne failed. tid[%u] pid[%u] endpoint[%s] op_id[%lu]", tid, pid, endpoint.c_str(),
-                  task_info->op_id());
-            task_info->set_status(::fedb::api::TaskStatus::kFailed);
-            return;
+    }
+    // stop all followers at the same time, the election waits for the slowest one only
+    std::vector<std::unique_ptr<brpc::Controller>> cntl_vec(follower_endpoint.size());
+    std::vector<::fedb::api::AppendEntriesResponse> response_vec(follower_endpoint.size());
+    for (uint32_t idx = 0; idx < tablet_vec.size(); idx++) {
+        if (!tablet_vec[idx]) {
+            continue;
         }
+        cntl_vec[idx].reset(new brpc::Controller());
+        if (!tablet_vec[idx]->client_->AsyncFollowOfNoOne(tid, pid, cur_term, cntl_vec[idx].get(),
+                                                          &response_vec[idx])) {
+            cntl_vec[idx].reset();
+        }
+    }
+    for (const auto& cntl : cntl_vec) {
+        if (cntl) {
+            brpc::Join(cntl->call_id());
+        }
+    }
+    // select the max offset endpoint as leader
+    uint64_t max_offset = 0;
+    std::vector<std::string> leader_endpoint_vec;
+    std::vector<std::string> failed_endpoint_vec;
+    for (uint32_t idx = 0; idx < follower_endpoint.size(); idx++) {
+        const std::string& endpoint = follower_endpoint[idx];
+        if (!cntl_vec[idx] || cntl_vec[idx]->Failed() || response_vec[idx].code() != 0) {
+            PDLOG(WARNING, "followOfNoOne failed. tid[%u] pid[%u] endpoint[%s] op_id[%lu]", tid, pid,
+                  endpoint.c_str(), task_info->op_id());
+            failed_endpoint_vec.push_back(endpoint);
+            continue;
+        }
+        uint64_t offset = response_vec[idx].log_offset();
         PDLOG(INFO,
               "FollowOfNoOne ok. term[%lu] offset[%lu] name[%s] tid[%u] "
               "pid[%u] endpoint[%s]",
@@ -7999,6 +8470,34 @@ void NameServerImpl::SelectLeader(const std::string& name, const std::string& db
             leader_endpoint_vec.push_back(endpoint);
         }
     }
+    if (!failed_endpoint_vec.empty()) {
+        if (!FLAGS_enable_fast_select_leader || leader_endpoint_vec.empty()) {
+            task_info->set_status(::fedb::api::TaskStatus::kFailed);
+            return;
+        }
+        // a follower that cannot be reached is skipped if the new leader has all the data it reported
+        // after the old leader went offline. an older offset may miss the entries replicated since
+        for (const auto& endpoint : failed_endpoint_vec) {
+            auto iter = cached_offset.find(endpoint);
+            auto time_iter = offset_time.find(endpoint);
+            if (offline_time == 0 || time_iter == offset_time.end() || time_iter->second <= offline_time) {
+                PDLOG(WARNING, "offset of endpoint[%s] is reported before leader[%s] is offline. tid[%u] pid[%u] "
+                      "op_id[%lu]", endpoint.c_str(), old_leader.c_str(), tid, pid, task_info->op_id());
+                task_info->set_status(::fedb::api::TaskStatus::kFailed);
+                return;
+            }
+            if (iter == cached_offset.end() || iter->second > max_offset) {
+                PDLOG(WARNING,
+                      "endpoint[%s] may have more data than offset[%lu]. tid[%u] pid[%u] "
+                      "op_id[%lu]",
+                      endpoint.c_str(), max_offset, tid, pid, task_info->op_id());
+                task_info->set_status(::fedb::api::TaskStatus::kFailed);
+                return;
+            }
+            PDLOG(INFO, "skip endpoint[%s] with offset[%lu]. tid[%u] pid[%u] op_id[%lu]", endpoint.c_str(),
+                  iter->second, tid, pid, task_info->op_id());
+        }
+    }
     std::shared_ptr<OPData> op_data = FindRunningOP(task_info->op_id());
     if (!op_data) {
         PDLOG(WARNING, "cannot find op[%lu] in running op", task_info->op_id());
@@ -8279,7 +8778,44 @@ void NameServerImpl::UpdateLeaderInfo(std::shared_ptr<::fedb::api::TaskInfo> tas
     task_info->set_status(::fedb::api::TaskStatus::kFailed);
 }
 
-void NameServerImpl::NotifyTableChanged() {
+void NameServerImpl::NotifyTableChanged() { NotifyTableChanged(INVALID_TID); }
+
+void NameServerImpl::NotifyTableChanged(uint32_t tid) {
+    std::lock_guard<std::mutex> lock(change_log_mu_);
+    std::string value;
+    uint64_t version = 0;
+    if (zk_client_->GetNodeValue(zk_table_changed_notify_node_, value)) {
+        try {
+            version = std::stoull(value) + 1;
+        } catch (const std::exception& e) {
+            PDLOG(WARNING, "invalid notify value %s", value.c_str());
+        }
+    }
+    if (version > 0) {
+        // a failed increment leaves an entry with the same version
+        while (!table_change_log_.empty() && table_change_log_.back().version() >= version) {
+            table_change_log_.pop_back();
+        }
+        TableChange change;
+        change.set_version(version);
+        if (tid != INVALID_TID) {
+            change.set_tid(tid);
+        }
+        table_change_log_.push_back(change);
+        while (table_change_log_.size() > FLAGS_table_change_log_size) {
+            table_change_log_.pop_front();
+        }
+        TableChangeLog change_log;
+        for (const auto& cur_change : table_change_log_) {
+            change_log.add_change()->CopyFrom(cur_change);
+        }
+        std::string log_value;
+        change_log.SerializeToString(&log_value);
+        if (!zk_client_->SetNodeValue(zk_table_change_log_node_, log_value) &&
+            !zk_client_->CreateNode(zk_table_change_log_node_, log_value)) {
+            PDLOG(WARNING, "set table change log failed. node is %s", zk_table_change_log_node_.c_str());
+        }
+    }
     bool ok = zk_client_->Increment(zk_table_changed_notify_node_);
     if (!ok) {
         PDLOG(WARNING, "increment failed. node is %s", zk_table_changed_notify_node_.c_str());
@@ -9265,7 +9801,7 @@ void NameServerImpl::DeleteIndex(RpcController* controller, const DeleteIndexReq
 
 bool NameServerImpl::UpdateZkTableNode(const std::shared_ptr<::fedb::nameserver::TableInfo>& table_info) {
     if (UpdateZkTableNodeWithoutNotify(table_info.get())) {
-        NotifyTableChanged();
+        NotifyTableChanged(table_info->tid());
         return true;
     }
     return false;
@@ -9582,6 +10118,38 @@ int NameServerImpl::CreateAddIndexOPTask(std::shared_ptr<OPData> op_data) {
         return 0;
     }
     const int part_size = table_info->table_partition_size();
+    if (FLAGS_enable_online_index_backfill && table_info->format_version() == 1) {
+        // build the index from memory of the leader, the binlog of the partition replicates it to followers
+        task = CreateAddIndexToTabletTask(op_index, kAddIndexOP, tid, pid, endpoints, ck);
+        if (!task) {
+            LOG(WARNING) << "create add index task failed. tid[" << tid << "] pid[" << pid << "]";
+            return -1;
+        }
+        op_data->task_list_.push_back(task);
+        task = CreateBackfillIndexDataTask(op_index, kAddIndexOP, tid, pid, leader_endpoint, part_size, ck, ck_idx,
+                                           pid_endpoint_map);
+        if (!task) {
+            LOG(WARNING) << "create backfill index data task failed. tid[" << tid << "] pid[" << pid
+                         << "] endpoint[" << leader_endpoint << "]";
+            return -1;
+        }
+        op_data->task_list_.push_back(task);
+        task = CreateCheckBinlogSyncProgressTask(op_index, kAddIndexOP, name, db, pid, follower_endpoint,
+                                                 FLAGS_check_binlog_sync_progress_delta);
+        if (!task) {
+            LOG(WARNING) << "create CheckBinlogSyncProgressTask failed. name[" << name << "] pid[" << pid << "]";
+            return -1;
+        }
+        op_data->task_list_.push_back(task);
+        boost::function<bool()> fun = boost::bind(&NameServerImpl::AddIndexToTableInfo, this, name, db, ck, ck_idx);
+        task = CreateTableSyncTask(op_index, kAddIndexOP, tid, fun);
+        if (!task) {
+            LOG(WARNING) << "create table sync task failed. name[" << name << "] pid[" << pid << "]";
+            return -1;
+        }
+        op_data->task_list_.push_back(task);
+        return 0;
+    }
     task = CreateDumpIndexDataTask(op_index, kAddIndexOP, tid, pid, leader_endpoint, part_size, ck, ck_idx);
     if (!task) {
         LOG(WARNING) << "create dump index task failed. tid[" << tid << "] pid[" << pid << "] endpoint["
@@ -9726,6 +10294,26 @@ std::shared_ptr<Task> NameServerImpl::CreateSendIndexDataTask(uint64_t op_index,
     return task;
 }
 
+std::shared_ptr<Task> NameServerImpl::CreateBackfillIndexDataTask(
+    uint64_t op_index, ::fedb::api::OPType op_type, uint32_t tid, uint32_t pid, const std::string& endpoint,
+    uint32_t partition_num, const ::fedb::common::ColumnKey& column_key, uint32_t idx,
+    const std::map<uint32_t, std::string>& pid_endpoint_map) {
+    std::shared_ptr<TabletInfo> tablet = GetHealthTabletInfoNoLock(endpoint);
+    if (!tablet) {
+        return std::shared_ptr<Task>();
+    }
+    std::shared_ptr<Task> task = std::make_shared<Task>(endpoint, std::make_shared<::fedb::api::TaskInfo>());
+    task->task_info_->set_op_id(op_index);
+    task->task_info_->set_op_type(op_type);
+    task->task_info_->set_task_type(::fedb::api::TaskType::kBackfillIndexData);
+    task->task_info_->set_status(::fedb::api::TaskStatus::kInited);
+    task->task_info_->set_endpoint(endpoint);
+    boost::function<bool()> fun = boost::bind(&TabletClient::BackfillIndexData, tablet->client_, tid, pid,
+                                              partition_num, column_key, idx, pid_endpoint_map, task->task_info_);
+    task->fun_ = boost::bind(&NameServerImpl::WrapTaskFun, this, fun, task->task_info_);
+    return task;
+}
+
 std::shared_ptr<Task> NameServerImpl::CreateLoadIndexDataTask(uint64_t op_index, ::fedb::api::OPType op_type,
                                                               uint32_t tid, uint32_t pid, const std::string& endpoint,
                                                               uint32_t partition_num) {
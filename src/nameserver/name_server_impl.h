@@ -18,8 +18,11 @@
 #ifndef SRC_NAMESERVER_NAME_SERVER_IMPL_H_
 #define SRC_NAMESERVER_NAME_SERVER_IMPL_H_
 
+#include <bvar/bvar.h>
+
 #include <atomic>
 #include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
@@ -34,6 +37,7 @@
 #include "client/ns_client.h"
 #include "client/tablet_client.h"
 #include "codec/schema_codec.h"
+#include "nameserver/partition_balancer.h"
 #include "proto/name_server.pb.h"
 #include "proto/tablet.pb.h"
 #include "zk/dist_lock.h"
@@ -138,6 +142,9 @@ struct Task {
 struct OPData {
     ::fedb::api::OPInfo op_info_;
     std::list<std::shared_ptr<Task>> task_list_;
+    // time in microseconds, not persisted
+    uint64_t add_time_ = 0;
+    uint64_t run_time_ = 0;
 };
 
 class NameServerImplTest;
@@ -410,6 +417,26 @@ class NameServerImpl : public NameServer {
 
     void ProcessTask();
 
+    // moves waiting ops which depend on no queued op to idle queues
+    void StealTask(const std::map<std::string, uint64_t>& running_partitions,
+                   const std::map<std::string, uint32_t>& running_endpoints,
+                   const std::map<std::string, uint64_t>& first_op);
+
+    void AddRunningOP(const std::shared_ptr<OPData>& op_data, std::map<std::string, uint64_t>* running_partitions,
+                      std::map<std::string, uint32_t>* running_endpoints);
+
+    // the id of the first queued op of every partition. mu_ must be held
+    void GetFirstOP(std::map<std::string, uint64_t>* first_op);
+
+    bool CanRunOP(const std::shared_ptr<OPData>& op_data, const std::map<std::string, uint64_t>& running_partitions,
+                  const std::map<std::string, uint32_t>& running_endpoints,
+                  const std::map<std::string, uint64_t>& first_op);
+
+    void RecordOPFinished(const std::shared_ptr<OPData>& op_data);
+
+    // the task queue a recovered op is put back to
+    uint32_t GetRecoverOPQueue(const std::shared_ptr<OPData>& op_data);
+
     int UpdateZKTaskStatus();
 
     void CheckClusterInfo();
@@ -693,6 +720,12 @@ class NameServerImpl : public NameServer {
                                                   const std::string& endpoint,
                                                   uint32_t partition_num);
 
+    std::shared_ptr<Task> CreateBackfillIndexDataTask(
+        uint64_t op_index, ::fedb::api::OPType op_type, uint32_t tid,
+        uint32_t pid, const std::string& endpoint, uint32_t partition_num,
+        const ::fedb::common::ColumnKey& column_key, uint32_t idx,
+        const std::map<uint32_t, std::string>& pid_endpoint_map);
+
     std::shared_ptr<Task> CreateExtractIndexDataTask(
         uint64_t op_index, ::fedb::api::OPType op_type, uint32_t tid,
         uint32_t pid, const std::vector<std::string>& endpoints,
@@ -820,6 +853,9 @@ class NameServerImpl : public NameServer {
         uint32_t concurrency =
             FLAGS_name_server_task_concurrency_for_replica_cluster);
     void NotifyTableChanged();
+
+    // records the changed table in the change log before bumping the notify version
+    void NotifyTableChanged(uint32_t tid);
     void DeleteDoneOP();
     void UpdateTableStatus();
     int DropTableOnTablet(
@@ -901,7 +937,20 @@ class NameServerImpl : public NameServer {
                        std::shared_ptr<::fedb::nameserver::TableInfo>>&
             table_info_map,
         const std::unordered_map<std::string, ::fedb::api::TableStatus>&
-            pos_response);
+            pos_response,
+        const std::map<std::string, uint64_t>& status_time);
+
+    // the number of migrate ops queued or running. mu_ must be held
+    uint32_t GetMigrateOPNum();
+
+    // migrates the follower chosen by SelectHotReplica. mu_ must be held
+    bool MigrateHotReplica(const std::vector<ReplicaLoad>& loads, double load_ratio, double min_load);
+
+    // migrates a follower off the tablet serving the most requests
+    void MigrateHotPartition();
+
+    // migrates a follower off the tablet holding the most memory
+    void RebalanceMemory();
 
     void UpdateRealEpMapToTablet();
 
@@ -951,6 +1000,7 @@ class NameServerImpl : public NameServer {
     std::string zk_auto_failover_node_;
     std::string zk_auto_recover_table_node_;
     std::string zk_table_changed_notify_node_;
+    std::string zk_table_change_log_node_;
     std::string zk_offline_endpoint_lock_node_;
     std::string zk_zone_data_path_;
     uint32_t table_index_;
@@ -978,6 +1028,15 @@ class NameServerImpl : public NameServer {
     std::map<std::string, std::string> sdk_endpoint_map_;
     std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::string>>> db_sp_table_map_;
     std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::string>>> db_table_sp_map_;
+    // keyed by tid_pid_endpoint like the table status
+    std::map<std::string, ReplicaCounter> replica_counters_;
+    std::mutex change_log_mu_;
+    std::deque<TableChange> table_change_log_;
+    std::unique_ptr<bvar::Status<uint64_t>> op_waiting_cnt_;
+    std::unique_ptr<bvar::Status<uint64_t>> op_running_cnt_;
+    // in milliseconds
+    std::unique_ptr<bvar::LatencyRecorder> op_wait_latency_;
+    std::unique_ptr<bvar::LatencyRecorder> op_run_latency_;
 };
 
 }  // namespace nameserver
@@ -41,7 +41,9 @@ DECLARE_int32(request_timeout_ms);
 DECLARE_int32(zk_keep_alive_check_interval);
 DECLARE_int32(make_snapshot_threshold_offset);
 DECLARE_uint32(name_server_task_max_concurrency);
+DECLARE_uint32(name_server_task_concurrency_per_tablet);
 DECLARE_bool(auto_failover);
+DECLARE_bool(enable_fast_select_leader);
 DECLARE_bool(enable_timeseries_table);
 
 using brpc::Server;
@@ -78,8 +80,86 @@ class NameServerImplTest : public ::testing::Test {
     GetTableInfo(NameServerImpl* nameserver) {
         return nameserver->table_info_;
     }
+    std::mutex& GetMutex(NameServerImpl* nameserver) { return nameserver->mu_; }
+    int AddOPData(NameServerImpl* nameserver, const std::shared_ptr<OPData>& op_data, uint32_t concurrency) {
+        return nameserver->AddOPData(op_data, concurrency);
+    }
+    // same as one round of ProcessTask
+    void StealTask(NameServerImpl* nameserver) {
+        std::map<std::string, uint64_t> running_partitions;
+        std::map<std::string, uint32_t> running_endpoints;
+        std::map<std::string, uint64_t> first_op;
+        GetRunningOP(nameserver, &running_partitions, &running_endpoints);
+        nameserver->GetFirstOP(&first_op);
+        nameserver->StealTask(running_partitions, running_endpoints, first_op);
+    }
+    // same as the check of ProcessTask before an op starts
+    bool CanRunOP(NameServerImpl* nameserver, const std::shared_ptr<OPData>& op_data) {
+        std::map<std::string, uint64_t> running_partitions;
+        std::map<std::string, uint32_t> running_endpoints;
+        std::map<std::string, uint64_t> first_op;
+        GetRunningOP(nameserver, &running_partitions, &running_endpoints);
+        nameserver->GetFirstOP(&first_op);
+        return nameserver->CanRunOP(op_data, running_partitions, running_endpoints, first_op);
+    }
+    void GetRunningOP(NameServerImpl* nameserver, std::map<std::string, uint64_t>* running_partitions,
+                      std::map<std::string, uint32_t>* running_endpoints) {
+        for (const auto& op_list : nameserver->task_vec_) {
+            if (!op_list.empty() && op_list.front()->op_info_.task_status() == ::fedb::api::kDoing) {
+                nameserver->AddRunningOP(op_list.front(), running_partitions, running_endpoints);
+            }
+        }
+    }
+    bool GetOPInfo(NameServerImpl* nameserver, uint64_t op_id, ::fedb::api::OPInfo* op_info) {
+        std::string value;
+        std::string node = nameserver->zk_op_data_path_ + "/" + std::to_string(op_id);
+        return nameserver->zk_client_->GetNodeValue(node, value) && op_info->ParseFromString(value);
+    }
+    uint32_t GetRecoverOPQueue(NameServerImpl* nameserver, const std::shared_ptr<OPData>& op_data) {
+        return nameserver->GetRecoverOPQueue(op_data);
+    }
+    std::map<std::string, std::shared_ptr<TabletInfo>>& GetTablets(NameServerImpl* nameserver) {
+        return nameserver->tablets_;
+    }
+    std::map<std::string, ReplicaCounter>& GetReplicaCounters(NameServerImpl* nameserver) {
+        return nameserver->replica_counters_;
+    }
+    void SelectLeader(NameServerImpl* nameserver, const std::string& name, uint32_t tid, uint32_t pid,
+                      std::vector<std::string>& follower_endpoint,  // NOLINT
+                      std::shared_ptr<::fedb::api::TaskInfo> task_info) {
+        nameserver->SelectLeader(name, "", tid, pid, follower_endpoint, task_info);
+    }
 };
 
+static std::shared_ptr<OPData> NewOPData(uint64_t op_id, uint32_t pid, uint64_t parent_id,
+                                         const std::string& endpoint) {
+    std::shared_ptr<OPData> op_data = std::make_shared<OPData>();
+    op_data->op_info_.set_op_id(op_id);
+    op_data->op_info_.set_op_type(::fedb::api::OPType::kMakeSnapshotOP);
+    op_data->op_info_.set_task_index(0);
+    op_data->op_info_.set_data("");
+    op_data->op_info_.set_task_status(::fedb::api::kInited);
+    op_data->op_info_.set_name("t1");
+    op_data->op_info_.set_db("db1");
+    op_data->op_info_.set_pid(pid);
+    op_data->op_info_.set_parent_id(parent_id);
+    auto task_info = std::make_shared<::fedb::api::TaskInfo>();
+    task_info->set_op_id(op_id);
+    task_info->set_op_type(::fedb::api::OPType::kMakeSnapshotOP);
+    task_info->set_task_type(::fedb::api::TaskType::kMakeSnapshot);
+    task_info->set_status(::fedb::api::kInited);
+    op_data->task_list_.push_back(std::make_shared<Task>(endpoint, task_info));
+    return op_data;
+}
+
+static std::vector<uint64_t> GetOPIds(const std::list<std::shared_ptr<OPData>>& op_list) {
+    std::vector<uint64_t> op_ids;
+    for (const auto& op_data : op_list) {
+        op_ids.push_back(op_data->op_info_.op_id());
+    }
+    return op_ids;
+}
+
 bool StartNS(const std::string& endpoint, brpc::Server* server, brpc::ServerOptions* options) {
     FLAGS_endpoint = endpoint;
     NameServerImpl* nameserver = new NameServerImpl();
@@ -738,6 +818,181 @@ TEST_F(NameServerImplTest, CancelOP) {
     delete nameserver;
 }
 
+TEST_F(NameServerImplTest, StealTask) {
+    FLAGS_zk_cluster = "127.0.0.1:6181";
+    FLAGS_zk_root_path = "/rtidb3" + GenRand();
+    FLAGS_endpoint = "127.0.0.1:9633";
+    NameServerImpl* nameserver = new NameServerImpl();
+    ASSERT_TRUE(nameserver->Init(""));
+    sleep(4);
+    {
+        // hold the lock so that ProcessTask does not run the ops
+        std::lock_guard<std::mutex> lock(GetMutex(nameserver));
+        auto& task_vec = GetTaskVec(nameserver);
+        // all ops are added to queue 0 with the concurrency of 2
+        for (uint64_t op_id = 1; op_id <= 3; op_id++) {
+            ASSERT_EQ(0, AddOPData(nameserver, NewOPData(op_id, (op_id - 1) * 2, INVALID_PARENT_ID, ""), 2));
+        }
+        ASSERT_EQ(3u, task_vec[0].size());
+        task_vec[0].front()->op_info_.set_task_status(::fedb::api::kDoing);
+        StealTask(nameserver);
+        ASSERT_EQ(std::vector<uint64_t>({1}), GetOPIds(task_vec[0]));
+        ASSERT_EQ(std::vector<uint64_t>({2}), GetOPIds(task_vec[1]));
+        ASSERT_EQ(std::vector<uint64_t>({3}), GetOPIds(task_vec[2]));
+        // the new queue is persisted and used again after a restart
+        ::fedb::api::OPInfo op_info;
+        ASSERT_TRUE(GetOPInfo(nameserver, 3, &op_info));
+        ASSERT_EQ(2u, op_info.vec_idx());
+        auto recovered = std::make_shared<OPData>();
+        recovered->op_info_.CopyFrom(op_info);
+        ASSERT_EQ(2u, GetRecoverOPQueue(nameserver, recovered));
+        ASSERT_TRUE(GetOPInfo(nameserver, 1, &op_info));
+        recovered->op_info_.CopyFrom(op_info);
+        ASSERT_EQ(0u, GetRecoverOPQueue(nameserver, recovered));
+        for (auto& op_list : task_vec) {
+            op_list.clear();
+        }
+    }
+    delete nameserver;
+}
+
+TEST_F(NameServerImplTest, StealTaskKeepPartitionOrder) {
+    FLAGS_zk_cluster = "127.0.0.1:6181";
+    FLAGS_zk_root_path = "/rtidb3" + GenRand();
+    FLAGS_endpoint = "127.0.0.1:9633";
+    NameServerImpl* nameserver = new NameServerImpl();
+    ASSERT_TRUE(nameserver->Init(""));
+    sleep(4);
+    {
+        std::lock_guard<std::mutex> lock(GetMutex(nameserver));
+        auto& task_vec = GetTaskVec(nameserver);
+        // op 1 and op 3 on pid 0, op 2 on pid 2, op 4 on pid 4
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(1, 0, INVALID_PARENT_ID, ""), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(2, 2, INVALID_PARENT_ID, ""), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(3, 0, INVALID_PARENT_ID, ""), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(4, 4, INVALID_PARENT_ID, ""), 2));
+        task_vec[0].front()->op_info_.set_task_status(::fedb::api::kDoing);
+        StealTask(nameserver);
+        // op 3 waits for op 1 of the same partition
+        ASSERT_EQ(std::vector<uint64_t>({1, 3}), GetOPIds(task_vec[0]));
+        ASSERT_EQ(std::vector<uint64_t>({2}), GetOPIds(task_vec[1]));
+        ASSERT_EQ(std::vector<uint64_t>({4}), GetOPIds(task_vec[2]));
+        // an op of a partition moved before does not overtake it
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(5, 2, INVALID_PARENT_ID, ""), 2));
+        ASSERT_EQ(std::vector<uint64_t>({1, 3, 5}), GetOPIds(task_vec[0]));
+        StealTask(nameserver);
+        ASSERT_EQ(std::vector<uint64_t>({1, 3, 5}), GetOPIds(task_vec[0]));
+        for (auto& op_list : task_vec) {
+            op_list.clear();
+        }
+    }
+    delete nameserver;
+}
+
+TEST_F(NameServerImplTest, StealTaskChildOP) {
+    FLAGS_zk_cluster = "127.0.0.1:6181";
+    FLAGS_zk_root_path = "/rtidb3" + GenRand();
+    FLAGS_endpoint = "127.0.0.1:9633";
+    NameServerImpl* nameserver = new NameServerImpl();
+    ASSERT_TRUE(nameserver->Init(""));
+    sleep(4);
+    {
+        std::lock_guard<std::mutex> lock(GetMutex(nameserver));
+        auto& task_vec = GetTaskVec(nameserver);
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(1, 0, INVALID_PARENT_ID, ""), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(2, 2, INVALID_PARENT_ID, ""), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(3, 4, INVALID_PARENT_ID, ""), 2));
+        // op 4 is a child of op 2 and goes right after it
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(4, 6, 2, ""), 2));
+        ASSERT_EQ(std::vector<uint64_t>({1, 2, 4, 3}), GetOPIds(task_vec[0]));
+        task_vec[0].front()->op_info_.set_task_status(::fedb::api::kDoing);
+        StealTask(nameserver);
+        // neither the parent nor the child is moved
+        ASSERT_EQ(std::vector<uint64_t>({1, 2, 4}), GetOPIds(task_vec[0]));
+        ASSERT_EQ(std::vector<uint64_t>({3}), GetOPIds(task_vec[1]));
+        // a child of a moved op follows it to the new queue
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(5, 8, 3, ""), 2));
+        ASSERT_EQ(std::vector<uint64_t>({3, 5}), GetOPIds(task_vec[1]));
+        ::fedb::api::OPInfo op_info;
+        ASSERT_TRUE(GetOPInfo(nameserver, 5, &op_info));
+        ASSERT_EQ(1u, op_info.vec_idx());
+        for (auto& op_list : task_vec) {
+            op_list.clear();
+        }
+    }
+    delete nameserver;
+}
+
+TEST_F(NameServerImplTest, StealTaskTabletLimit) {
+    FLAGS_zk_cluster = "127.0.0.1:6181";
+    FLAGS_zk_root_path = "/rtidb3" + GenRand();
+    FLAGS_endpoint = "127.0.0.1:9633";
+    uint32_t old_limit = FLAGS_name_server_task_concurrency_per_tablet;
+    FLAGS_name_server_task_concurrency_per_tablet = 1;
+    NameServerImpl* nameserver = new NameServerImpl();
+    ASSERT_TRUE(nameserver->Init(""));
+    sleep(4);
+    {
+        std::lock_guard<std::mutex> lock(GetMutex(nameserver));
+        auto& task_vec = GetTaskVec(nameserver);
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(1, 0, INVALID_PARENT_ID, "127.0.0.1:9530"), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(2, 2, INVALID_PARENT_ID, "127.0.0.1:9530"), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(3, 4, INVALID_PARENT_ID, "127.0.0.1:9531"), 2));
+        task_vec[0].front()->op_info_.set_task_status(::fedb::api::kDoing);
+        StealTask(nameserver);
+        // the tablet of op 2 runs op 1 already
+        ASSERT_EQ(std::vector<uint64_t>({1, 2}), GetOPIds(task_vec[0]));
+        ASSERT_EQ(std::vector<uint64_t>({3}), GetOPIds(task_vec[1]));
+        for (auto& op_list : task_vec) {
+            op_list.clear();
+        }
+    }
+    delete nameserver;
+    FLAGS_name_server_task_concurrency_per_tablet = old_limit;
+}
+
+TEST_F(NameServerImplTest, StealTaskNotOvertaken) {
+    FLAGS_zk_cluster = "127.0.0.1:6181";
+    FLAGS_zk_root_path = "/rtidb3" + GenRand();
+    FLAGS_endpoint = "127.0.0.1:9633";
+    uint32_t old_limit = FLAGS_name_server_task_concurrency_per_tablet;
+    FLAGS_name_server_task_concurrency_per_tablet = 1;
+    NameServerImpl* nameserver = new NameServerImpl();
+    ASSERT_TRUE(nameserver->Init(""));
+    sleep(4);
+    {
+        std::lock_guard<std::mutex> lock(GetMutex(nameserver));
+        auto& task_vec = GetTaskVec(nameserver);
+        // op 2 and op 3 on pid 2
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(1, 0, INVALID_PARENT_ID, "127.0.0.1:9530"), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(2, 2, INVALID_PARENT_ID, "127.0.0.1:9531"), 2));
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(3, 2, INVALID_PARENT_ID, "127.0.0.1:9532"), 2));
+        task_vec[0].front()->op_info_.set_task_status(::fedb::api::kDoing);
+        StealTask(nameserver);
+        ASSERT_EQ(std::vector<uint64_t>({1, 3}), GetOPIds(task_vec[0]));
+        ASSERT_EQ(std::vector<uint64_t>({2}), GetOPIds(task_vec[1]));
+        // op 4 is moved too and runs on the tablet of op 2 first
+        ASSERT_EQ(0, AddOPData(nameserver, NewOPData(4, 4, INVALID_PARENT_ID, "127.0.0.1:9531"), 2));
+        StealTask(nameserver);
+        ASSERT_EQ(std::vector<uint64_t>({4}), GetOPIds(task_vec[2]));
+        task_vec[2].front()->op_info_.set_task_status(::fedb::api::kDoing);
+        ASSERT_FALSE(CanRunOP(nameserver, task_vec[1].front()));
+        // op 1 is done, op 3 is at the head of its queue but waits for op 2
+        task_vec[0].pop_front();
+        ASSERT_EQ(3u, task_vec[0].front()->op_info_.op_id());
+        ASSERT_FALSE(CanRunOP(nameserver, task_vec[0].front()));
+        // op 4 is done, op 2 runs before op 3
+        task_vec[2].pop_front();
+        ASSERT_TRUE(CanRunOP(nameserver, task_vec[1].front()));
+        ASSERT_FALSE(CanRunOP(nameserver, task_vec[0].front()));
+        for (auto& op_list : task_vec) {
+            op_list.clear();
+        }
+    }
+    delete nameserver;
+    FLAGS_name_server_task_concurrency_per_tablet = old_limit;
+}
+
 bool InitRpc(Server* server, google::protobuf::Service* general_svr) {
     brpc::ServerOptions options;
     if (server->AddService(general_svr, brpc::SERVER_DOESNT_OWN_SERVICE) != 0) {
@@ -1606,6 +1861,110 @@ TEST_F(NameServerImplTest, ShowCatalogVersion) {
     }
 }
 
+TEST_F(NameServerImplTest, SelectLeaderSkipFollower) {
+    FLAGS_zk_cluster = "127.0.0.1:6181";
+    bool old_auto_failover = FLAGS_auto_failover;
+    bool old_fast_select = FLAGS_enable_fast_select_leader;
+    // the leader is marked offline by hand below
+    FLAGS_auto_failover = false;
+    std::shared_ptr<NameServerImpl> ns;
+    std::shared_ptr<TabletImpl> t1, t2, t3;
+    Server ns_svr, t1_svr, t2_svr, t3_svr;
+    string ns_ep, t1_ep, t2_ep, t3_ep;
+    int port = 9637;
+    InitNs(port, {&ns_svr}, {&ns}, {&ns_ep});
+    InitTablet(port, {&t1_svr, &t2_svr, &t3_svr}, {&t1, &t2, &t3}, {&t1_ep, &t2_ep, &t3_ep});
+    sleep(2);
+    ::fedb::RpcClient<::fedb::nameserver::NameServer_Stub> name_server_client(ns_ep, "");
+    name_server_client.Init();
+    std::string name = "test" + GenRand();
+    {
+        CreateTableRequest request;
+        GeneralResponse response;
+        TableInfo* table_info = request.mutable_table_info();
+        table_info->set_name(name);
+        TablePartition* partition = table_info->add_table_partition();
+        partition->set_pid(0);
+        for (const auto& endpoint : {t1_ep, t2_ep, t3_ep}) {
+            PartitionMeta* meta = partition->add_partition_meta();
+            meta->set_endpoint(endpoint);
+            meta->set_is_leader(endpoint == t1_ep);
+        }
+        ::fedb::common::ColumnDesc* desc = table_info->add_column_desc_v1();
+        desc->set_name("col1");
+        desc->set_type("string");
+        desc->set_add_ts_idx(true);
+        ASSERT_TRUE(name_server_client.SendRequest(&::fedb::nameserver::NameServer_Stub::CreateTable, &request,
+                                                   &response, FLAGS_request_timeout_ms, 1));
+        ASSERT_EQ(0, response.code());
+    }
+    sleep(2);
+    // t3 is still registered but cannot be reached
+    t3_svr.Stop(0);
+    t3_svr.Join();
+    sleep(1);
+
+    uint32_t tid = 0;
+    uint64_t offline_time = ::baidu::common::timer::get_micros() / 1000;
+    auto op_data = std::make_shared<OPData>();
+    {
+        std::lock_guard<std::mutex> lock(GetMutex(ns.get()));
+        tid = GetTableInfo(ns.get())[name]->tid();
+        auto& leader = GetTablets(ns.get())[t1_ep];
+        leader->state_ = ::fedb::api::TabletState::kTabletOffline;
+        leader->ctime_ = offline_time;
+        ChangeLeaderData change_leader_data;
+        change_leader_data.set_name(name);
+        change_leader_data.set_tid(tid);
+        change_leader_data.set_pid(0);
+        change_leader_data.add_follower(t2_ep);
+        change_leader_data.add_follower(t3_ep);
+        std::string value;
+        change_leader_data.SerializeToString(&value);
+        op_data->op_info_.set_op_id(1);
+        op_data->op_info_.set_op_type(::fedb::api::OPType::kChangeLeaderOP);
+        op_data->op_info_.set_task_status(::fedb::api::kDoing);
+        op_data->op_info_.set_name(name);
+        op_data->op_info_.set_pid(0);
+        op_data->op_info_.set_data(value);
+        GetTaskVec(ns.get())[0].push_front(op_data);
+    }
+    std::vector<std::string> followers = {t2_ep, t3_ep};
+    auto select_leader = [&](uint64_t offset_time) {
+        {
+            std::lock_guard<std::mutex> lock(GetMutex(ns.get()));
+            auto& counter = GetReplicaCounters(ns.get())[std::to_string(tid) + "_0_" + t3_ep];
+            counter.update_time = ::baidu::common::timer::get_micros() / 1000;
+            counter.offset_time = offset_time;
+        }
+        auto task_info = std::make_shared<::fedb::api::TaskInfo>();
+        task_info->set_op_id(1);
+        task_info->set_op_type(::fedb::api::OPType::kChangeLeaderOP);
+        task_info->set_task_type(::fedb::api::TaskType::kSelectLeader);
+        task_info->set_status(::fedb::api::kDoing);
+        SelectLeader(ns.get(), name, tid, 0, followers, task_info);
+        return task_info->status();
+    };
+    FLAGS_enable_fast_select_leader = true;
+    // t3 reported its offset before the leader went offline and may have got more entries since
+    ASSERT_EQ(::fedb::api::kFailed, select_leader(offline_time - 1000));
+    // t2 covers the offset t3 reported after the leader went offline
+    ASSERT_EQ(::fedb::api::kDone, select_leader(offline_time + 1000));
+    ChangeLeaderData change_leader_data;
+    ASSERT_TRUE(change_leader_data.ParseFromString(op_data->op_info_.data()));
+    ASSERT_EQ(t2_ep, change_leader_data.leader());
+    FLAGS_enable_fast_select_leader = false;
+    ASSERT_EQ(::fedb::api::kFailed, select_leader(offline_time + 1000));
+    {
+        std::lock_guard<std::mutex> lock(GetMutex(ns.get()));
+        for (auto& op_list : GetTaskVec(ns.get())) {
+            op_list.clear();
+        }
+    }
+    FLAGS_enable_fast_select_leader = old_fast_select;
+    FLAGS_auto_failover = old_auto_failover;
+}
+
 }  // namespace nameserver
 }  // namespace fedb
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nameserver/partition_balancer.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+
+namespace fedb {
+namespace nameserver {
+
+void UpdateReplicaCounter(uint64_t put_cnt, uint64_t put_byte_size, uint64_t read_cnt, uint64_t time,
+                          ReplicaCounter* counter) {
+    if (counter->update_time > 0 && time > counter->update_time && put_cnt >= counter->put_cnt &&
+        put_byte_size >= counter->put_byte_size && read_cnt >= counter->read_cnt) {
+        double interval = (time - counter->update_time) / 1000.0;
+        counter->put_qps = (put_cnt - counter->put_cnt) / interval;
+        counter->put_byte_rate = (put_byte_size - counter->put_byte_size) / interval;
+        counter->read_qps = (read_cnt - counter->read_cnt) / interval;
+    }
+    counter->put_cnt = put_cnt;
+    counter->put_byte_size = put_byte_size;
+    counter->read_cnt = read_cnt;
+    counter->update_time = time;
+}
+
+int SelectHotReplica(const std::vector<ReplicaLoad>& loads, const std::vector<std::string>& endpoints,
+                     double load_ratio, double min_load, std::string* des_endpoint) {
+    if (endpoints.size() < 2) {
+        return -1;
+    }
+    std::map<std::string, double> tablet_load;
+    for (const auto& endpoint : endpoints) {
+        tablet_load.emplace(endpoint, 0);
+    }
+    std::map<std::string, std::set<std::string>> partition_endpoints;
+    double total_load = 0;
+    for (const auto& load : loads) {
+        partition_endpoints[load.db + "/" + load.name + "/" + std::to_string(load.pid)].insert(load.endpoint);
+        auto it = tablet_load.find(load.endpoint);
+        if (it != tablet_load.end()) {
+            it->second += load.load;
+            total_load += load.load;
+        }
+    }
+    auto hot_it = std::max_element(tablet_load.begin(), tablet_load.end(),
+                                   [](const std::pair<const std::string, double>& a,
+                                      const std::pair<const std::string, double>& b) { return a.second < b.second; });
+    double avg_load = total_load / tablet_load.size();
+    if (hot_it->second < min_load || hot_it->second < avg_load * load_ratio) {
+        return -1;
+    }
+    std::vector<std::pair<double, std::string>> cold_tablets;
+    for (const auto& kv : tablet_load) {
+        if (kv.first != hot_it->first) {
+            cold_tablets.emplace_back(kv.second, kv.first);
+        }
+    }
+    std::sort(cold_tablets.begin(), cold_tablets.end());
+    std::vector<std::pair<double, int>> candidates;
+    for (uint32_t idx = 0; idx < loads.size(); idx++) {
+        if (loads[idx].endpoint == hot_it->first && !loads[idx].is_leader && loads[idx].load > 0) {
+            candidates.emplace_back(loads[idx].load, idx);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<double, int>>());
+    for (const auto& candidate : candidates) {
+        const ReplicaLoad& load = loads[candidate.second];
+        const auto& held = partition_endpoints[load.db + "/" + load.name + "/" + std::to_string(load.pid)];
+        for (const auto& cold : cold_tablets) {
+            if (held.find(cold.second) != held.end()) {
+                continue;
+            }
+            // moving must not turn the destination into the new hot spot
+            if (cold.first + load.load <= hot_it->second - load.load) {
+                *des_endpoint = cold.second;
+                return candidate.second;
+            }
+            break;
+        }
+    }
+    return -1;
+}
+
+void PlacePartitions(std::map<std::string, TabletUsage> usage, uint32_t partition_num, uint32_t replica_num,
+                     std::vector<std::vector<std::string>>* endpoints) {
+    endpoints->clear();
+    if (usage.empty()) {
+        return;
+    }
+    uint64_t total_byte_size = 0;
+    uint64_t total_partition_num = 0;
+    for (const auto& kv : usage) {
+        total_byte_size += kv.second.byte_size;
+        total_partition_num += kv.second.partition_num;
+    }
+    uint64_t avg_byte_size = total_partition_num > 0 ? total_byte_size / total_partition_num : 0;
+    replica_num = std::min(replica_num, static_cast<uint32_t>(usage.size()));
+    for (uint32_t pid = 0; pid < partition_num; pid++) {
+        std::vector<std::pair<std::tuple<uint64_t, uint32_t, uint64_t>, std::string>> order;
+        for (const auto& kv : usage) {
+            order.emplace_back(std::make_tuple(kv.second.byte_size, kv.second.partition_num, kv.second.diskused),
+                               kv.first);
+        }
+        std::sort(order.begin(), order.end());
+        std::vector<std::string> pid_endpoints;
+        for (uint32_t idx = 0; idx < replica_num; idx++) {
+            TabletUsage& tablet_usage = usage[order[idx].second];
+            tablet_usage.byte_size += avg_byte_size;
+            tablet_usage.partition_num++;
+            pid_endpoints.push_back(order[idx].second);
+        }
+        endpoints->push_back(std::move(pid_endpoints));
+    }
+}
+
+}  // namespace nameserver
+}  // namespace fedb
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_NAMESERVER_PARTITION_BALANCER_H_
+#define SRC_NAMESERVER_PARTITION_BALANCER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fedb {
+namespace nameserver {
+
+// request counters of one replica reported by GetTableStatus and the rates
+// derived from the last two reports
+struct ReplicaCounter {
+    uint64_t put_cnt = 0;
+    uint64_t put_byte_size = 0;
+    uint64_t read_cnt = 0;
+    // in milliseconds
+    uint64_t update_time = 0;
+    double put_qps = 0;
+    // written bytes per second
+    double put_byte_rate = 0;
+    double read_qps = 0;
+    // when the last reported offset was requested, in milliseconds
+    uint64_t offset_time = 0;
+};
+
+// updates the rates with a new report. a counter going back means the
+// partition is reloaded, then the rates are left as they are
+void UpdateReplicaCounter(uint64_t put_cnt, uint64_t put_byte_size, uint64_t read_cnt, uint64_t time,
+                          ReplicaCounter* counter);
+
+struct ReplicaLoad {
+    std::string db;
+    std::string name;
+    uint32_t pid;
+    std::string endpoint;
+    bool is_leader;
+    // the request rate or the bytes of the replica
+    double load;
+};
+
+// picks a follower on the most loaded tablet and the least loaded tablet to
+// migrate it to. the tablet must carry more than min_load and load_ratio times
+// the average, and the destination must stay below the source after the move.
+// returns the index of the replica in loads or -1 if nothing is worth moving
+int SelectHotReplica(const std::vector<ReplicaLoad>& loads, const std::vector<std::string>& endpoints,
+                     double load_ratio, double min_load, std::string* des_endpoint);
+
+// memory and disk held by the replicas on a tablet
+struct TabletUsage {
+    uint64_t byte_size = 0;
+    uint64_t diskused = 0;
+    uint32_t partition_num = 0;
+};
+
+// places replica_num replicas of each new partition on the tablets with the
+// least projected memory, counting every new replica as an average one.
+// endpoints gets the tablets of each pid
+void PlacePartitions(std::map<std::string, TabletUsage> usage, uint32_t partition_num, uint32_t replica_num,
+                     std::vector<std::vector<std::string>>* endpoints);
+
+}  // namespace nameserver
+}  // namespace fedb
+#endif  // SRC_NAMESERVER_PARTITION_BALANCER_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nameserver/partition_balancer.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace nameserver {
+
+class PartitionBalancerTest : public ::testing::Test {
+ public:
+    PartitionBalancerTest() {}
+    ~PartitionBalancerTest() {}
+};
+
+static ReplicaLoad NewLoad(uint32_t pid, const std::string& endpoint, bool is_leader, double qps) {
+    ReplicaLoad load;
+    load.db = "db1";
+    load.name = "t1";
+    load.pid = pid;
+    load.endpoint = endpoint;
+    load.is_leader = is_leader;
+    load.load = qps;
+    return load;
+}
+
+TEST_F(PartitionBalancerTest, UpdateReplicaCounter) {
+    ReplicaCounter counter;
+    UpdateReplicaCounter(100, 1000, 200, 1000, &counter);
+    ASSERT_DOUBLE_EQ(0, counter.put_qps);
+    UpdateReplicaCounter(300, 5000, 600, 3000, &counter);
+    ASSERT_DOUBLE_EQ(100, counter.put_qps);
+    ASSERT_DOUBLE_EQ(2000, counter.put_byte_rate);
+    ASSERT_DOUBLE_EQ(200, counter.read_qps);
+    // reloaded partition
+    UpdateReplicaCounter(10, 100, 10, 5000, &counter);
+    ASSERT_DOUBLE_EQ(100, counter.put_qps);
+    ASSERT_DOUBLE_EQ(2000, counter.put_byte_rate);
+    ASSERT_EQ(10u, counter.put_cnt);
+}
+
+TEST_F(PartitionBalancerTest, SelectHotReplica) {
+    std::vector<std::string> endpoints = {"ep1", "ep2", "ep3"};
+    std::vector<ReplicaLoad> loads;
+    loads.push_back(NewLoad(0, "ep1", true, 1000));
+    loads.push_back(NewLoad(0, "ep2", false, 1000));
+    loads.push_back(NewLoad(1, "ep2", true, 1000));
+    loads.push_back(NewLoad(2, "ep1", true, 500));
+    loads.push_back(NewLoad(2, "ep2", false, 500));
+    std::string des_endpoint;
+    // ep2 is hot, its busiest follower goes to the idle ep3
+    ASSERT_EQ(1, SelectHotReplica(loads, endpoints, 1.5, 1000, &des_endpoint));
+    ASSERT_EQ("ep3", des_endpoint);
+    // under the minimal qps
+    ASSERT_EQ(-1, SelectHotReplica(loads, endpoints, 1.5, 10000, &des_endpoint));
+    // leaders are never moved
+    loads[1].is_leader = true;
+    ASSERT_EQ(4, SelectHotReplica(loads, endpoints, 1.5, 1000, &des_endpoint));
+    ASSERT_EQ("ep3", des_endpoint);
+}
+
+TEST_F(PartitionBalancerTest, NoPingPong) {
+    std::vector<std::string> endpoints = {"ep1", "ep2"};
+    std::vector<ReplicaLoad> loads;
+    loads.push_back(NewLoad(0, "ep1", false, 3000));
+    loads.push_back(NewLoad(1, "ep2", false, 2000));
+    std::string des_endpoint;
+    // moving pid 0 would make ep2 the hot one
+    ASSERT_EQ(-1, SelectHotReplica(loads, endpoints, 1.1, 1000, &des_endpoint));
+    loads[1].load = 100;
+    loads.push_back(NewLoad(2, "ep1", false, 1000));
+    ASSERT_EQ(2, SelectHotReplica(loads, endpoints, 1.1, 1000, &des_endpoint));
+    ASSERT_EQ("ep2", des_endpoint);
+}
+
+TEST_F(PartitionBalancerTest, PlacePartitions) {
+    std::map<std::string, TabletUsage> usage;
+    usage["ep1"].byte_size = 3000;
+    usage["ep1"].partition_num = 3;
+    usage["ep2"].byte_size = 1000;
+    usage["ep2"].partition_num = 3;
+    usage["ep3"].byte_size = 2000;
+    usage["ep3"].partition_num = 2;
+    std::vector<std::vector<std::string>> endpoints;
+    PlacePartitions(usage, 4, 2, &endpoints);
+    ASSERT_EQ(4u, endpoints.size());
+    // the average replica is 750 bytes
+    ASSERT_EQ(std::vector<std::string>({"ep2", "ep3"}), endpoints[0]);
+    ASSERT_EQ(std::vector<std::string>({"ep2", "ep3"}), endpoints[1]);
+    ASSERT_EQ(std::vector<std::string>({"ep2", "ep1"}), endpoints[2]);
+    // no memory reported yet, the partitions are spread evenly
+    std::map<std::string, TabletUsage> empty_usage;
+    empty_usage["ep1"];
+    empty_usage["ep2"];
+    empty_usage["ep3"];
+    PlacePartitions(empty_usage, 3, 2, &endpoints);
+    std::map<std::string, int> cnt;
+    for (const auto& pid_endpoints : endpoints) {
+        ASSERT_EQ(2u, pid_endpoints.size());
+        ASSERT_NE(pid_endpoints[0], pid_endpoints[1]);
+        for (const auto& endpoint : pid_endpoints) {
+            cnt[endpoint]++;
+        }
+    }
+    ASSERT_EQ(2, cnt["ep1"]);
+    ASSERT_EQ(2, cnt["ep2"]);
+    ASSERT_EQ(2, cnt["ep3"]);
+}
+
+}  // namespace nameserver
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
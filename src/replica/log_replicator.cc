@@ -509,6 +509,21 @@ void LogReplicator::GetReplicateInfo(
     }
 }
 
+void LogReplicator::GetMemoryUsage(uint64_t* buffer_byte_size, uint64_t* cache_byte_size) {
+    *buffer_byte_size = 0;
+    *cache_byte_size = 0;
+    {
+        std::lock_guard<std::mutex> lock(wmu_);
+        if (wh_ != NULL) {
+            *buffer_byte_size = wh_->GetBufferSize();
+        }
+    }
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    for (const auto& node : nodes_) {
+        *cache_byte_size += node->GetCacheByteSize();
+    }
+}
+
 bool LogReplicator::DelAllReplicateNode() {
     std::vector<std::shared_ptr<ReplicateNode>> copied_nodes = nodes_;
     {
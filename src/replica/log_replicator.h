@@ -89,6 +89,9 @@ class LogReplicator {
 
     void GetReplicateInfo(std::map<std::string, uint64_t>& info_map); // NOLINT
 
+    // bytes of the binlog write buffers and of the requests kept for the followers
+    void GetMemoryUsage(uint64_t* buffer_byte_size, uint64_t* cache_byte_size);
+
     void MatchLogOffset();
 
     void ReplicateToNode(const std::string& endpoint);
@@ -101,6 +104,8 @@ class LogReplicator {
 
     LogParts* GetLogPart();
 
+    inline const std::string& GetLogPath() const { return log_path_; }
+
     inline uint64_t GetLogOffset() {
         return log_offset_.load(std::memory_order_relaxed);
     }
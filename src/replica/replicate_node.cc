@@ -56,6 +56,7 @@ ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs,
                              const std::string& real_point)
     : log_reader_(logs, log_path, false),
       cache_(),
+      cache_byte_size_(0),
       endpoint_(point),
       last_sync_offset_(0),
       log_matched_(false),
@@ -203,6 +204,7 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
         request = cache_[0];
         if (request.entries_size() <= 0) {
             cache_.clear();
+            cache_byte_size_.store(0, std::memory_order_relaxed);
             PDLOG(WARNING, "empty append entry request from node %s cache",
                   endpoint_.c_str());
             return -1;
@@ -213,6 +215,7 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
             DEBUGLOG("duplicate log index from node %s cache",
                   endpoint_.c_str());
             cache_.clear();
+            cache_byte_size_.store(0, std::memory_order_relaxed);
             return -1;
         }
         PDLOG(INFO, "use cached request to send last index %lu. tid %u pid %u",
@@ -316,10 +319,12 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
             }
             if (request_from_cache) {
                 cache_.clear();
+                cache_byte_size_.store(0, std::memory_order_relaxed);
             }
         } else {
             if (!request_from_cache) {
                 cache_.push_back(request);
+                cache_byte_size_.fetch_add(request.SpaceUsedLong(), std::memory_order_relaxed);
             }
             need_wait = true;
             PDLOG(WARNING, "fail to sync log to node %s. tid %u pid %u",
@@ -65,6 +65,9 @@ class ReplicateNode {
 
     uint64_t GetLastSyncOffset();
 
+    // bytes of the requests kept for resending
+    uint64_t GetCacheByteSize() const { return cache_byte_size_.load(std::memory_order_relaxed); }
+
     int GetLogIndex();
 
     void Stop();
@@ -79,6 +82,7 @@ class ReplicateNode {
  private:
     LogReader log_reader_;
     std::vector<::fedb::api::AppendEntriesRequest> cache_;
+    std::atomic<uint64_t> cache_byte_size_;
     std::string endpoint_;
     uint64_t last_sync_offset_;
     bool log_matched_;
@@ -35,7 +35,12 @@
 #include <brpc/channel.h>
 #include <brpc/controller.h>
 #include <brpc/retry_policy.h>
+#include <bthread/bthread.h>
+#include <bthread/countdown_event.h>
+#include <butil/time.h>
 #include <gflags/gflags.h>
+#include <algorithm>
+#include <atomic>
 #include <utility>
 #include <memory>
 
@@ -57,10 +62,14 @@ class SleepRetryPolicy : public brpc::RetryPolicy {
             return false;
         }
         if (EHOSTDOWN == error_code) {
-            PDLOG(WARNING, "error_code is EHOSTDOWN, sleep [%lu] ms",
-                  FLAGS_request_sleep_time);
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(FLAGS_request_sleep_time));
+            // the retry runs in a bthread, so only that bthread sleeps and the
+            // worker pthread goes on with the others
+            int64_t sleep_ms = FLAGS_request_sleep_time;
+            if (controller->timeout_ms() > 0 && controller->timeout_ms() < sleep_ms) {
+                sleep_ms = controller->timeout_ms();
+            }
+            PDLOG(WARNING, "error_code is EHOSTDOWN, sleep [%ld] ms", sleep_ms);
+            bthread_usleep(sleep_ms * 1000);
             return true;
         }
         return (brpc::EFAILEDSOCKET == error_code || brpc::EEOF == error_code ||
@@ -75,21 +84,88 @@ class SleepRetryPolicy : public brpc::RetryPolicy {
 
 static SleepRetryPolicy sleep_retry_policy;
 
+// the requests on the way to an endpoint and its recent latency, the input of
+// load aware routing
+class RpcLoad {
+ public:
+    RpcLoad() : inflight_(0), latency_us_(0) {}
+
+    inline void Begin() { inflight_.fetch_add(1, std::memory_order_relaxed); }
+
+    // latency_us 0 leaves the latency as is, e.g. for a failed request
+    void End(int64_t latency_us) {
+        inflight_.fetch_sub(1, std::memory_order_relaxed);
+        if (latency_us <= 0) {
+            return;
+        }
+        // moving average with 1/8 weight for the new sample. a concurrent
+        // update may lose a sample, which is fine for routing
+        int64_t latency = latency_us_.load(std::memory_order_relaxed);
+        latency = latency == 0 ? latency_us : latency + (latency_us - latency) / 8;
+        latency_us_.store(latency, std::memory_order_relaxed);
+    }
+
+    inline int64_t GetInflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+    inline int64_t GetLatency() const { return latency_us_.load(std::memory_order_relaxed); }
+
+    // the expected wait of one more request, the lower the better
+    inline int64_t GetCost() const { return (GetInflight() + 1) * std::max<int64_t>(GetLatency(), 1); }
+
+ private:
+    std::atomic<int64_t> inflight_;
+    std::atomic<int64_t> latency_us_;
+};
+
+// ends the request in RpcLoad before running the done of the caller
+class RpcLoadClosure : public google::protobuf::Closure {
+ public:
+    RpcLoadClosure(const std::shared_ptr<RpcLoad>& load, brpc::Controller* cntl, google::protobuf::Closure* done)
+        : load_(load), cntl_(cntl), done_(done) {}
+
+    void Run() override {
+        load_->End(cntl_->Failed() ? 0 : cntl_->latency_us());
+        google::protobuf::Closure* done = done_;
+        delete this;
+        done->Run();
+    }
+
+ private:
+    std::shared_ptr<RpcLoad> load_;
+    brpc::Controller* cntl_;
+    google::protobuf::Closure* done_;
+};
+
 template <class T>
 class RpcClient {
  public:
     explicit RpcClient(const std::string& endpoint)
         : endpoint_(endpoint),
           use_sleep_policy_(false),
+          connection_type_(),
           log_id_(0),
           stub_(NULL),
-          channel_(NULL) {}
+          channel_(NULL),
+          load_(std::make_shared<RpcLoad>()) {}
     RpcClient(const std::string& endpoint, bool use_sleep_policy)
         : endpoint_(endpoint),
           use_sleep_policy_(use_sleep_policy),
+          connection_type_(),
+          log_id_(0),
+          stub_(NULL),
+          channel_(NULL),
+          load_(std::make_shared<RpcLoad>()) {}
+    // connection_type is single, pooled or short as in brpc. pooled keeps a
+    // connection for each request on the way, so a slow response does not
+    // hold up the others. empty means the default of brpc, single
+    RpcClient(const std::string& endpoint, bool use_sleep_policy, const std::string& connection_type)
+        : endpoint_(endpoint),
+          use_sleep_policy_(use_sleep_policy),
+          connection_type_(connection_type),
           log_id_(0),
           stub_(NULL),
-          channel_(NULL) {}
+          channel_(NULL),
+          load_(std::make_shared<RpcLoad>()) {}
     ~RpcClient() {
         delete channel_;
         delete stub_;
@@ -101,6 +177,9 @@ class RpcClient {
         if (use_sleep_policy_) {
             options.retry_policy = &sleep_retry_policy;
         }
+        if (!connection_type_.empty()) {
+            options.connection_type = connection_type_.c_str();
+        }
         if (channel_->Init(endpoint_.c_str(), "", &options) != 0) {
             return -1;
         }
@@ -108,6 +187,8 @@ class RpcClient {
         return 0;
     }
 
+    inline const std::shared_ptr<RpcLoad>& GetLoad() const { return load_; }
+
     template <class Request, class Response, class Callback>
     bool SendRequest(void (T::*func)(google::protobuf::RpcController*,
                                      const Request*, Response*, Callback*),
@@ -118,7 +199,7 @@ class RpcClient {
                   "stub is null. client must be init before send request");
             return false;
         }
-        (stub_->*func)(cntl, request, response, callback);
+        Call(func, cntl, request, response, callback);
         return true;
     }
 
@@ -132,7 +213,7 @@ class RpcClient {
                   "stub is null. client must be init before send request");
             return false;
         }
-        (stub_->*func)(cntl, request, response, NULL);
+        Call(func, cntl, request, response, static_cast<google::protobuf::Closure*>(NULL));
         if (!cntl->Failed()) {
             return true;
         }
@@ -157,7 +238,7 @@ class RpcClient {
                   "stub is null. client must be init before send request");
             return false;
         }
-        (stub_->*func)(&cntl, request, response, NULL);
+        Call(func, &cntl, request, response, static_cast<google::protobuf::Closure*>(NULL));
         if (!cntl.Failed()) {
             return true;
         }
@@ -184,7 +265,7 @@ class RpcClient {
                   "stub is null. client must be init before send request");
             return false;
         }
-        (stub_->*func)(&cntl, request, response, NULL);
+        Call(func, &cntl, request, response, static_cast<google::protobuf::Closure*>(NULL));
         if (cntl.Failed()) {
             PDLOG(WARNING, "request error. %s", cntl.ErrorText().c_str());
             return false;
@@ -203,18 +284,102 @@ class RpcClient {
                   "stub is null. client must be init before send request");
             return false;
         }
-        (stub_->*func)(cntl, request, response, callback);
+        Call(func, cntl, request, response, callback);
         return true;
     }
 
+ private:
+    // calls the stub and counts the request in load_ until it returns
+    template <class Request, class Response>
+    void Call(void (T::*func)(google::protobuf::RpcController*, const Request*, Response*,
+                              google::protobuf::Closure*),
+              brpc::Controller* cntl, const Request* request, Response* response,
+              google::protobuf::Closure* callback) {
+        load_->Begin();
+        if (callback == NULL) {
+            (stub_->*func)(cntl, request, response, NULL);
+            load_->End(cntl->Failed() ? 0 : cntl->latency_us());
+            return;
+        }
+        (stub_->*func)(cntl, request, response, new RpcLoadClosure(load_, cntl, callback));
+    }
+
  private:
     std::string endpoint_;
     bool use_sleep_policy_;
+    std::string connection_type_;
     uint64_t log_id_;
     T* stub_;
     brpc::Channel* channel_;
+    std::shared_ptr<RpcLoad> load_;
+};
+
+// the done of one leg of a hedged request
+class HedgeClosure : public google::protobuf::Closure {
+ public:
+    explicit HedgeClosure(bthread::CountdownEvent* event) : event_(event), is_done_(false) {}
+
+    void Run() override {
+        is_done_.store(true, std::memory_order_release);
+        event_->signal();
+    }
+
+    inline bool IsDone() const { return is_done_.load(std::memory_order_acquire); }
+
+ private:
+    bthread::CountdownEvent* event_;
+    std::atomic<bool> is_done_;
 };
 
+// sends request by primary and, if it has not answered in hedge_us or has
+// failed, by hedge too. the first leg answering with code 0 wins and the other
+// one is canceled. it returns the index of the winner in cntl and response, -1
+// if both fail. the hedge leg gets what is left of the timeout of the primary
+template <class T, class Request, class Response>
+int SendHedgedRequest(RpcClient<T>* primary, RpcClient<T>* hedge,
+                      void (T::*func)(google::protobuf::RpcController*, const Request*, Response*,
+                                      google::protobuf::Closure*),
+                      const Request* request, int64_t hedge_us, brpc::Controller* cntl[2],
+                      Response* response[2]) {
+    auto succeed = [&cntl, &response](int idx) { return !cntl[idx]->Failed() && response[idx]->code() == 0; };
+    bthread::CountdownEvent event(1);
+    HedgeClosure primary_done(&event);
+    HedgeClosure hedge_done(&event);
+    int64_t start_time = butil::gettimeofday_us();
+    if (!primary->SendRequest(func, cntl[0], request, response[0], &primary_done)) {
+        return -1;
+    }
+    bool hedged = false;
+    if (hedge != NULL && hedge_us > 0) {
+        if (event.timed_wait(butil::microseconds_from_now(hedge_us)) != 0 || !succeed(0)) {
+            if (cntl[0]->timeout_ms() > 0) {
+                int64_t left_ms = cntl[0]->timeout_ms() - (butil::gettimeofday_us() - start_time) / 1000;
+                cntl[1]->set_timeout_ms(std::max<int64_t>(left_ms, 1));
+            }
+            hedged = hedge->SendRequest(func, cntl[1], request, response[1], &hedge_done);
+        }
+    }
+    if (!hedged) {
+        brpc::Join(cntl[0]->call_id());
+        return succeed(0) ? 0 : -1;
+    }
+    event.wait();
+    int first = primary_done.IsDone() ? 0 : 1;
+    int second = 1 - first;
+    bool first_succeed = succeed(first);
+    if (first_succeed) {
+        brpc::StartCancel(cntl[second]->call_id());
+    }
+    // the closures and the event live on this stack, so both legs must have
+    // run their done before returning, even the one that signaled first
+    brpc::Join(cntl[0]->call_id());
+    brpc::Join(cntl[1]->call_id());
+    if (first_succeed) {
+        return first;
+    }
+    return succeed(second) ? second : -1;
+}
+
 template<class Response>
 class RpcCallback : public google::protobuf::Closure {
  public:
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_ASYNC_INSERTER_H_
+#define SRC_SDK_ASYNC_INSERTER_H_
+
+#include <memory>
+
+#include "sdk/base.h"
+#include "sdk/sql_insert_row.h"
+
+namespace fedb {
+namespace sdk {
+
+struct AsyncInserterOptions {
+    // rows buffered or on the way, Insert blocks once it is reached
+    uint32_t max_buffered_rows = 10000;
+    // the rows of one partition sent together
+    uint32_t flush_rows = 100;
+    // the longest time a row is buffered before it is sent
+    uint32_t flush_interval_ms = 10;
+    // how long Insert waits for buffer space and Flush for the rows on the way
+    uint32_t timeout_ms = 10000;
+};
+
+class InsertFuture {
+ public:
+    InsertFuture() {}
+    virtual ~InsertFuture() {}
+
+    // waits until the row is written to all its partitions
+    virtual bool Get(hybridse::sdk::Status* status) = 0;
+    virtual bool IsDone() const = 0;
+};
+
+// buffers rows by partition and writes them with concurrent rpcs. it is
+// thread safe, rows of different tables can be mixed
+class AsyncInserter {
+ public:
+    AsyncInserter() {}
+    virtual ~AsyncInserter() {}
+
+    // the row must be complete. it returns null if the row is invalid or no
+    // buffer space is freed within timeout_ms
+    virtual std::shared_ptr<InsertFuture> Insert(std::shared_ptr<SQLInsertRow> row,
+                                                 hybridse::sdk::Status* status) = 0;
+
+    // sends the buffered rows and waits until no row is buffered or on the
+    // way. the result of each row is in its future
+    virtual bool Flush(hybridse::sdk::Status* status) = 0;
+};
+
+}  // namespace sdk
+}  // namespace fedb
+
+#endif  // SRC_SDK_ASYNC_INSERTER_H_
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/async_inserter_impl.h"
+
+#include <chrono>  // NOLINT
+
+#include "boost/bind.hpp"
+#include "brpc/controller.h"
+#include "client/tablet_client.h"
+#include "common/timer.h"
+#include "glog/logging.h"
+
+namespace fedb {
+namespace sdk {
+
+bool InsertFutureImpl::Get(hybridse::sdk::Status* status) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return pending_ == 0; });
+    if (status != nullptr && !ok_) {
+        status->code = 1;
+        status->msg = msg_;
+    }
+    return ok_;
+}
+
+bool InsertFutureImpl::IsDone() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return pending_ == 0;
+}
+
+void InsertFutureImpl::Done(bool ok, const std::string& msg) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!ok && ok_) {
+        ok_ = false;
+        msg_ = msg;
+    }
+    if (pending_ > 0 && --pending_ == 0) {
+        cv_.notify_all();
+    }
+}
+
+class PutClosure : public google::protobuf::Closure {
+ public:
+    PutClosure(AsyncInserterImpl* inserter, const std::shared_ptr<::fedb::api::PutRequest>& request,
+               const std::shared_ptr<InsertFutureImpl>& future)
+        : inserter_(inserter), request_(request), future_(future), cntl_(), response_() {}
+    ~PutClosure() {}
+
+    void Run() override {
+        bool ok = !cntl_.Failed() && response_.code() == 0;
+        std::string msg = cntl_.Failed() ? cntl_.ErrorText() : response_.msg();
+        inserter_->OnPutDone(request_->tid(), request_->pid(), ok, response_.log_offset(), msg, future_);
+        delete this;
+    }
+
+    brpc::Controller* GetController() { return &cntl_; }
+    ::fedb::api::PutResponse* GetResponse() { return &response_; }
+
+ private:
+    AsyncInserterImpl* inserter_;
+    std::shared_ptr<::fedb::api::PutRequest> request_;
+    std::shared_ptr<InsertFutureImpl> future_;
+    brpc::Controller cntl_;
+    ::fedb::api::PutResponse response_;
+};
+
+AsyncInserterImpl::AsyncInserterImpl(ClusterSDK* cluster_sdk, const AsyncInserterOptions& options)
+    : cluster_sdk_(cluster_sdk),
+      options_(options),
+      mu_(),
+      cv_(),
+      buffers_(),
+      pending_cnt_(0),
+      running_(true),
+      pool_(1) {
+    if (options_.flush_rows == 0) {
+        options_.flush_rows = 1;
+    }
+    if (options_.flush_interval_ms > 0) {
+        pool_.DelayTask(options_.flush_interval_ms, boost::bind(&AsyncInserterImpl::FlushTimer, this));
+    }
+}
+
+AsyncInserterImpl::~AsyncInserterImpl() {
+    running_.store(false, std::memory_order_relaxed);
+    pool_.Stop(false);
+    std::vector<SendTask> tasks;
+    TakeAllBuffers(&tasks);
+    for (auto& task : tasks) {
+        Send(&task);
+    }
+    // the closures refer to this, the rpc timeout bounds the wait
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return pending_cnt_ == 0; });
+}
+
+std::shared_ptr<InsertFuture> AsyncInserterImpl::Insert(std::shared_ptr<SQLInsertRow> row,
+                                                        hybridse::sdk::Status* status) {
+    if (status == nullptr) {
+        return std::shared_ptr<InsertFuture>();
+    }
+    if (!row || !row->IsComplete()) {
+        status->code = 1;
+        status->msg = "insert value isn't complete";
+        LOG(WARNING) << status->msg;
+        return std::shared_ptr<InsertFuture>();
+    }
+    const auto& table_info = row->GetTableInfo();
+    const auto& dimensions = row->GetDimensions();
+    if (!table_info || dimensions.empty()) {
+        status->code = 1;
+        status->msg = "fail to get the partitions of the row";
+        LOG(WARNING) << status->msg;
+        return std::shared_ptr<InsertFuture>();
+    }
+    const auto& ts_dimensions = row->GetTs();
+    uint64_t cur_ts = 0;
+    if (ts_dimensions.empty()) {
+        cur_ts = ::baidu::common::timer::get_micros() / 1000;
+    }
+    uint32_t cnt = dimensions.size();
+    auto future = std::make_shared<InsertFutureImpl>(cnt);
+    std::vector<SendTask> tasks;
+    {
+        std::unique_lock<std::mutex> lock(mu_);
+        // a row larger than the whole buffer still goes once the buffer is empty
+        if (!cv_.wait_for(lock, std::chrono::milliseconds(options_.timeout_ms), [this, cnt] {
+                return pending_cnt_ == 0 || pending_cnt_ + cnt <= options_.max_buffered_rows;
+            })) {
+            status->code = 1;
+            status->msg = "the insert buffer is full";
+            LOG(WARNING) << status->msg;
+            return std::shared_ptr<InsertFuture>();
+        }
+        pending_cnt_ += cnt;
+        for (const auto& kv : dimensions) {
+            uint32_t pid = kv.first;
+            auto request = std::make_shared<::fedb::api::PutRequest>();
+            request->set_tid(table_info->tid());
+            request->set_pid(pid);
+            request->set_value(row->GetRow());
+            request->set_format_version(1);
+            for (const auto& dim : kv.second) {
+                ::fedb::api::Dimension* d = request->add_dimensions();
+                d->set_key(dim.first);
+                d->set_idx(dim.second);
+            }
+            if (ts_dimensions.empty()) {
+                request->set_time(cur_ts);
+            } else {
+                for (size_t i = 0; i < ts_dimensions.size(); i++) {
+                    ::fedb::api::TSDimension* d = request->add_ts_dimensions();
+                    d->set_ts(ts_dimensions[i]);
+                    d->set_idx(i);
+                }
+            }
+            auto& buffer = buffers_[std::make_pair(table_info->tid(), pid)];
+            if (buffer.puts.empty()) {
+                buffer.db = table_info->db();
+                buffer.name = table_info->name();
+            }
+            buffer.puts.push_back({request, future});
+            if (buffer.puts.size() >= options_.flush_rows) {
+                TakeBuffer(&buffer, pid, &tasks);
+            }
+        }
+    }
+    for (auto& task : tasks) {
+        Send(&task);
+    }
+    return future;
+}
+
+bool AsyncInserterImpl::Flush(hybridse::sdk::Status* status) {
+    if (status == nullptr) {
+        return false;
+    }
+    std::vector<SendTask> tasks;
+    TakeAllBuffers(&tasks);
+    for (auto& task : tasks) {
+        Send(&task);
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    if (!cv_.wait_for(lock, std::chrono::milliseconds(options_.timeout_ms),
+                      [this] { return pending_cnt_ == 0; })) {
+        status->code = 1;
+        status->msg = "flush timeout, " + std::to_string(pending_cnt_) + " puts are not done";
+        LOG(WARNING) << status->msg;
+        return false;
+    }
+    return true;
+}
+
+void AsyncInserterImpl::TakeBuffer(PartitionBuffer* buffer, uint32_t pid, std::vector<SendTask>* tasks) {
+    SendTask task;
+    task.db = buffer->db;
+    task.name = buffer->name;
+    task.pid = pid;
+    task.puts.swap(buffer->puts);
+    tasks->push_back(std::move(task));
+}
+
+void AsyncInserterImpl::TakeAllBuffers(std::vector<SendTask>* tasks) {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto& kv : buffers_) {
+        if (!kv.second.puts.empty()) {
+            TakeBuffer(&kv.second, kv.first.second, tasks);
+        }
+    }
+}
+
+void AsyncInserterImpl::Send(SendTask* task) {
+    std::shared_ptr<::fedb::client::TabletClient> client;
+    auto tablet = cluster_sdk_->GetTablet(task->db, task->name, task->pid);
+    if (tablet) {
+        client = tablet->GetClient();
+    }
+    for (auto& put : task->puts) {
+        if (!client) {
+            OnPutDone(put.request->tid(), task->pid, false, 0,
+                      "fail to get tablet client. pid " + std::to_string(task->pid), put.future);
+            continue;
+        }
+        PutClosure* done = new PutClosure(this, put.request, put.future);
+        done->GetController()->set_timeout_ms(options_.timeout_ms);
+        if (!client->AsyncPut(*put.request, done->GetController(), done->GetResponse(), done)) {
+            delete done;
+            OnPutDone(put.request->tid(), task->pid, false, 0,
+                      "fail to make a put request to table. tid " + std::to_string(put.request->tid()), put.future);
+        }
+    }
+}
+
+void AsyncInserterImpl::OnPutDone(uint32_t tid, uint32_t pid, bool ok, uint64_t log_offset, const std::string& msg,
+                                  const std::shared_ptr<InsertFutureImpl>& future) {
+    if (ok) {
+        cluster_sdk_->UpdateWriteOffset(tid, pid, log_offset);
+    } else {
+        LOG(WARNING) << "put row to table " << tid << " pid " << pid << " failed with error " << msg;
+    }
+    future->Done(ok, msg);
+    std::lock_guard<std::mutex> lock(mu_);
+    pending_cnt_--;
+    cv_.notify_all();
+}
+
+void AsyncInserterImpl::FlushTimer() {
+    if (!running_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::vector<SendTask> tasks;
+    TakeAllBuffers(&tasks);
+    for (auto& task : tasks) {
+        Send(&task);
+    }
+    pool_.DelayTask(options_.flush_interval_ms, boost::bind(&AsyncInserterImpl::FlushTimer, this));
+}
+
+}  // namespace sdk
+}  // namespace fedb
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_ASYNC_INSERTER_IMPL_H_
+#define SRC_SDK_ASYNC_INSERTER_IMPL_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/thread_pool.h"
+#include "proto/tablet.pb.h"
+#include "sdk/async_inserter.h"
+#include "sdk/cluster_sdk.h"
+
+namespace fedb {
+namespace sdk {
+
+class InsertFutureImpl : public InsertFuture {
+ public:
+    explicit InsertFutureImpl(uint32_t pending) : mu_(), cv_(), pending_(pending), ok_(true), msg_() {}
+    ~InsertFutureImpl() {}
+
+    bool Get(hybridse::sdk::Status* status) override;
+    bool IsDone() const override;
+
+    // called once for each partition of the row
+    void Done(bool ok, const std::string& msg);
+
+ private:
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    uint32_t pending_;
+    bool ok_;
+    std::string msg_;
+};
+
+class AsyncInserterImpl : public AsyncInserter {
+ public:
+    AsyncInserterImpl(ClusterSDK* cluster_sdk, const AsyncInserterOptions& options);
+    ~AsyncInserterImpl();
+
+    std::shared_ptr<InsertFuture> Insert(std::shared_ptr<SQLInsertRow> row, hybridse::sdk::Status* status) override;
+
+    bool Flush(hybridse::sdk::Status* status) override;
+
+ private:
+    struct PendingPut {
+        std::shared_ptr<::fedb::api::PutRequest> request;
+        std::shared_ptr<InsertFutureImpl> future;
+    };
+
+    struct PartitionBuffer {
+        std::string db;
+        std::string name;
+        std::vector<PendingPut> puts;
+    };
+
+    // the puts of one (tid, pid) taken out of the buffer to be sent
+    struct SendTask {
+        std::string db;
+        std::string name;
+        uint32_t pid;
+        std::vector<PendingPut> puts;
+    };
+
+    void TakeBuffer(PartitionBuffer* buffer, uint32_t pid, std::vector<SendTask>* tasks);
+    void Send(SendTask* task);
+    void OnPutDone(uint32_t tid, uint32_t pid, bool ok, uint64_t log_offset, const std::string& msg,
+                   const std::shared_ptr<InsertFutureImpl>& future);
+    void TakeAllBuffers(std::vector<SendTask>* tasks);
+    // sends the buffers every flush_interval_ms
+    void FlushTimer();
+
+    friend class PutClosure;
+
+ private:
+    ClusterSDK* cluster_sdk_;
+    AsyncInserterOptions options_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::map<std::pair<uint32_t, uint32_t>, PartitionBuffer> buffers_;
+    // puts buffered or on the way
+    uint32_t pending_cnt_;
+    std::atomic<bool> running_;
+    ::baidu::common::ThreadPool pool_;
+};
+
+}  // namespace sdk
+}  // namespace fedb
+
+#endif  // SRC_SDK_ASYNC_INSERTER_IMPL_H_
@@ -17,6 +17,7 @@
 
 #include "sdk/batch_request_result_set_sql.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -39,7 +40,9 @@ SQLBatchRequestResultSet::SQLBatchRequestResultSet(
       common_row_view_(),
       non_common_row_view_(),
       external_schema_(),
-      cntl_(cntl) {}
+      cntl_(cntl),
+      columnar_(false),
+      columns_() {}
 
 SQLBatchRequestResultSet::~SQLBatchRequestResultSet() {}
 
@@ -64,6 +67,9 @@ bool SQLBatchRequestResultSet::Init() {
     ::hybridse::codec::Schema schema;
     ::hybridse::codec::SchemaCodec::Decode(response_->schema(), &schema);
     external_schema_.SetSchema(schema);
+    if (response_->columnar()) {
+        return InitColumns(schema);
+    }
 
     if (byte_size_ <= 0) return true;
 
@@ -96,6 +102,40 @@ bool SQLBatchRequestResultSet::Init() {
         cntl_->response_attachment().append_to(&common_buf_, row_size, 0);
         common_row_view_->Reset(common_buf_);
     }
+    if (byte_size_ > position_) {
+        cntl_->response_attachment().append_to(&non_common_buf_, byte_size_ - position_, position_);
+    }
+    return true;
+}
+
+bool SQLBatchRequestResultSet::InitColumns(const ::hybridse::codec::Schema& schema) {
+    if (response_->column_sizes_size() != schema.size()) {
+        LOG(WARNING) << "column size count " << response_->column_sizes_size() << " mismatch with schema size "
+                     << schema.size();
+        return false;
+    }
+    for (int i = 0; i < response_->common_column_indices().size(); ++i) {
+        common_column_indices_.insert(response_->common_column_indices().Get(i));
+    }
+    column_remap_.resize(schema.size());
+    columns_.resize(schema.size());
+    // the columns are cut off the front of a shallow copy of the attachment
+    butil::IOBuf buf = cntl_->response_attachment();
+    uint32_t row_cnt = response_->count();
+    for (int i = 0; i < schema.size(); ++i) {
+        size_t column_size = response_->column_sizes(i);
+        butil::IOBuf column_buf;
+        if (buf.cutn(&column_buf, column_size) != column_size) {
+            LOG(WARNING) << "column " << i << " of size " << column_size << " out of bound";
+            return false;
+        }
+        uint32_t column_row_cnt = IsCommonColumnIdx(i) ? std::min(row_cnt, 1u) : row_cnt;
+        if (!columns_[i].Reset(schema.Get(i).type(), column_row_cnt, column_buf)) {
+            LOG(WARNING) << "decode column " << i << " failed";
+            return false;
+        }
+    }
+    columnar_ = true;
     return true;
 }
 
@@ -104,6 +144,9 @@ bool SQLBatchRequestResultSet::IsNULL(int index) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].IsNULL(GetColumnRow(index));
+    }
     size_t mapped_index = column_remap_[index];
     if (IsCommonColumnIdx(index)) {
         return common_row_view_->IsNULL(mapped_index);
@@ -114,6 +157,9 @@ bool SQLBatchRequestResultSet::IsNULL(int index) {
 
 bool SQLBatchRequestResultSet::Next() {
     index_++;
+    if (columnar_) {
+        return index_ < static_cast<int32_t>(response_->count());
+    }
     if (index_ < static_cast<int32_t>(response_->count()) &&
         position_ < byte_size_) {
         if (non_common_schema_.empty()) {
@@ -121,13 +167,13 @@ bool SQLBatchRequestResultSet::Next() {
         }
         // get row size
         uint32_t row_size = 0;
-        cntl_->response_attachment().copy_to(&row_size, 4, position_ + 2);
+        non_common_buf_.copy_to(&row_size, 4, 2);
         DLOG(INFO) << "row size " << row_size << " position " << position_
                    << " byte size " << byte_size_;
-        butil::IOBuf tmp;
-        cntl_->response_attachment().append_to(&tmp, row_size, position_);
+        row_buf_.clear();
+        non_common_buf_.cutn(&row_buf_, row_size);
         position_ += row_size;
-        bool ok = non_common_row_view_->Reset(tmp);
+        bool ok = non_common_row_view_->Reset(row_buf_);
         if (!ok) {
             LOG(WARNING) << "reset row buf failed";
             return false;
@@ -139,7 +185,14 @@ bool SQLBatchRequestResultSet::Next() {
 
 bool SQLBatchRequestResultSet::Reset() {
     index_ = -1;
+    if (columnar_) {
+        return true;
+    }
     position_ = common_buf_size_;
+    non_common_buf_.clear();
+    if (byte_size_ > position_) {
+        cntl_->response_attachment().append_to(&non_common_buf_, byte_size_ - position_, position_);
+    }
     return true;
 }
 
@@ -164,6 +217,15 @@ bool SQLBatchRequestResultSet::GetString(uint32_t index, std::string* str) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        const char* data = nullptr;
+        uint32_t length = 0;
+        if (columns_[index].GetString(GetColumnRow(index), &data, &length) != 0) {
+            return false;
+        }
+        str->assign(data, length);
+        return true;
+    }
     size_t mapped_index = column_remap_[index];
     butil::IOBuf tmp;
     int32_t ret = -1;
@@ -190,6 +252,9 @@ bool SQLBatchRequestResultSet::GetBool(uint32_t index, bool* val) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetBool(GetColumnRow(index), val) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -207,6 +272,13 @@ bool SQLBatchRequestResultSet::GetInt16(uint32_t index, int16_t* result) {
         LOG(WARNING) << "input ptr is null pointer";
         return false;
     }
+    if (!IsValidColumnIdx(index)) {
+        LOG(WARNING) << "column idx out of bound " << index;
+        return false;
+    }
+    if (columnar_) {
+        return columns_[index].GetInt16(GetColumnRow(index), result) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -226,6 +298,9 @@ bool SQLBatchRequestResultSet::GetInt32(uint32_t index, int32_t* result) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetInt32(GetColumnRow(index), result) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -245,6 +320,9 @@ bool SQLBatchRequestResultSet::GetInt64(uint32_t index, int64_t* result) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetInt64(GetColumnRow(index), result) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -264,6 +342,9 @@ bool SQLBatchRequestResultSet::GetFloat(uint32_t index, float* result) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetFloat(GetColumnRow(index), result) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -283,6 +364,9 @@ bool SQLBatchRequestResultSet::GetDouble(uint32_t index, double* result) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetDouble(GetColumnRow(index), result) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -302,6 +386,9 @@ bool SQLBatchRequestResultSet::GetDate(uint32_t index, int32_t* date) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetDate(GetColumnRow(index), date) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -322,6 +409,9 @@ bool SQLBatchRequestResultSet::GetDate(uint32_t index, int32_t* year, int32_t* m
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetDate(GetColumnRow(index), year, month, day) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -341,6 +431,9 @@ bool SQLBatchRequestResultSet::GetTime(uint32_t index, int64_t* mills) {
         LOG(WARNING) << "column idx out of bound " << index;
         return false;
     }
+    if (columnar_) {
+        return columns_[index].GetTimestamp(GetColumnRow(index), mills) == 0;
+    }
     size_t mapped_index = column_remap_[index];
     int32_t ret;
     if (IsCommonColumnIdx(index)) {
@@ -25,6 +25,7 @@
 
 #include "brpc/controller.h"
 #include "butil/iobuf.h"
+#include "codec/sql_rpc_column_codec.h"
 #include "sdk/codec_sdk.h"
 #include "proto/tablet.pb.h"
 #include "sdk/base_impl.h"
@@ -75,6 +76,8 @@ class SQLBatchRequestResultSet : public ::hybridse::sdk::ResultSet {
 
     inline int32_t Size() { return response_->count(); }
 
+    inline const ::fedb::api::QueryProfile& GetProfile() const { return response_->profile(); }
+
  private:
     inline uint32_t GetRecordSize() { return response_->count(); }
 
@@ -82,6 +85,9 @@ class SQLBatchRequestResultSet : public ::hybridse::sdk::ResultSet {
     bool IsCommonColumnIdx(size_t index) const;
     bool IsValidColumnIdx(size_t index) const;
     size_t GetCommonColumnNum() const;
+    bool InitColumns(const ::hybridse::codec::Schema& schema);
+    // a common column holds the value of the first row only
+    inline uint32_t GetColumnRow(size_t index) const { return IsCommonColumnIdx(index) ? 0 : index_; }
 
     std::shared_ptr<::fedb::api::SQLBatchRequestQueryResponse> response_;
     int32_t index_;
@@ -100,7 +106,14 @@ class SQLBatchRequestResultSet : public ::hybridse::sdk::ResultSet {
 
     size_t common_buf_size_ = 0;
     butil::IOBuf common_buf_;
+    // rows not visited yet, Next cuts one row off its front
+    butil::IOBuf non_common_buf_;
+    butil::IOBuf row_buf_;
     std::shared_ptr<brpc::Controller> cntl_;
+
+    // the result is read column by column, see SQLBatchRequestQueryResponse
+    bool columnar_;
+    std::vector<::fedb::codec::RpcColumnView> columns_;
 };
 
 
@@ -31,6 +31,7 @@
 #include "base/hash.h"
 #include "base/strings.h"
 #include "boost/bind.hpp"
+#include "catalog/table_change.h"
 #include "glog/logging.h"
 
 namespace fedb {
@@ -42,16 +43,19 @@ ClusterSDK::ClusterSDK(const ClusterOptions& options)
       nodes_root_path_(options.zk_path + "/nodes"),
       table_root_path_(options.zk_path + "/table/db_table_data"),
       notify_path_(options.zk_path + "/table/notify"),
+      change_log_path_(options.zk_path + "/table/change_log"),
       zk_client_(NULL),
       mu_(),
-      client_manager_(std::make_shared<::fedb::catalog::ClientManager>()),
+      client_manager_(std::make_shared<::fedb::catalog::ClientManager>(options.connection_type)),
       table_to_tablets_(),
       catalog_(new ::fedb::catalog::SDKCatalog(client_manager_)),
       pool_(1),
       session_id_(0),
       rand_(0xdeadbeef),
       sp_root_path_(options.zk_path + "/store_procedure/db_sp_data"),
-      engine_(NULL) {}
+      engine_(NULL),
+      offset_mu_(),
+      write_offsets_() {}
 
 ClusterSDK::~ClusterSDK() {
     pool_.Stop(false);
@@ -96,7 +100,111 @@ bool ClusterSDK::Init() {
     return true;
 }
 
-bool ClusterSDK::Refresh() { return InitCatalog(); }
+bool ClusterSDK::Refresh() {
+    uint64_t version = 0;
+    if (GetNotifyVersion(&version) && RefreshChangedTables(version)) {
+        return true;
+    }
+    return InitCatalog();
+}
+
+bool ClusterSDK::GetNotifyVersion(uint64_t* version) {
+    std::string value;
+    if (!zk_client_->GetNodeValue(notify_path_, value)) {
+        LOG(WARNING) << "fail to get node value. node is " << notify_path_;
+        return false;
+    }
+    try {
+        *version = std::stoull(value);
+    } catch (const std::exception& e) {
+        LOG(WARNING) << "value is not integer. node is " << notify_path_;
+        return false;
+    }
+    return true;
+}
+
+bool ClusterSDK::RefreshChangedTables(uint64_t version) {
+    uint64_t cur_version = cluster_version_.load(std::memory_order_relaxed);
+    if (cur_version == 0 || version < cur_version) {
+        return false;
+    } else if (version == cur_version) {
+        return true;
+    }
+    std::string value;
+    if (!zk_client_->GetNodeValue(change_log_path_, value)) {
+        return false;
+    }
+    std::set<uint32_t> tids;
+    if (!::fedb::catalog::GetChangedTables(value, cur_version, version, &tids)) {
+        DLOG(INFO) << "reload all tables. version " << cur_version << " -> " << version;
+        return false;
+    }
+    std::vector<std::shared_ptr<::fedb::nameserver::TableInfo>> changed_tables;
+    for (uint32_t tid : tids) {
+        std::string node = table_root_path_ + "/" + std::to_string(tid);
+        if (zk_client_->IsExistNode(node) != 0) {
+            // the table is dropped
+            continue;
+        }
+        if (!zk_client_->GetNodeValue(node, value)) {
+            LOG(WARNING) << "fail to get table data. node: " << node;
+            return false;
+        }
+        auto table_info = std::make_shared<::fedb::nameserver::TableInfo>();
+        if (!table_info->ParseFromString(value)) {
+            LOG(WARNING) << "fail to parse table proto. node: " << node;
+            return false;
+        }
+        if (table_info->format_version() != 1) {
+            continue;
+        }
+        changed_tables.push_back(table_info);
+    }
+    std::shared_ptr<::fedb::catalog::SDKCatalog> old_catalog;
+    std::map<std::string, std::map<std::string, std::shared_ptr<::fedb::nameserver::TableInfo>>> mapping;
+    {
+        std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+        old_catalog = catalog_;
+        mapping = table_to_tablets_;
+    }
+    for (auto db_it = mapping.begin(); db_it != mapping.end();) {
+        for (auto it = db_it->second.begin(); it != db_it->second.end();) {
+            if (tids.find(it->second->tid()) != tids.end()) {
+                it = db_it->second.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (db_it->second.empty()) {
+            db_it = mapping.erase(db_it);
+        } else {
+            ++db_it;
+        }
+    }
+    std::vector<::fedb::nameserver::TableInfo> tables;
+    for (const auto& table_info : changed_tables) {
+        tables.push_back(*table_info);
+        mapping[table_info->db()][table_info->name()] = table_info;
+    }
+    auto new_catalog = std::make_shared<::fedb::catalog::SDKCatalog>(client_manager_);
+    if (!new_catalog->Init(old_catalog->GetTables(), tables, tids, old_catalog->GetProcedures())) {
+        LOG(WARNING) << "fail to init catalog";
+        return false;
+    }
+    {
+        std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+        if (catalog_ != old_catalog) {
+            // refreshed by someone else
+            return true;
+        }
+        table_to_tablets_ = mapping;
+        catalog_ = new_catalog;
+    }
+    engine_->UpdateCatalog(new_catalog);
+    cluster_version_.store(version, std::memory_order_relaxed);
+    DLOG(INFO) << "refresh " << tids.size() << " tables. version " << version;
+    return true;
+}
 
 void ClusterSDK::WatchNotify() {
     LOG(INFO) << "start to watch table notify";
@@ -243,6 +351,9 @@ bool ClusterSDK::InitTabletClient() {
 }
 
 bool ClusterSDK::InitCatalog() {
+    // the version is read first so that the changes made during the reload are applied again
+    uint64_t version = 0;
+    GetNotifyVersion(&version);
     std::vector<std::string> table_datas;
     if (zk_client_->IsExistNode(table_root_path_) == 0) {
         bool ok = zk_client_->GetChildren(table_root_path_, table_datas);
@@ -266,7 +377,11 @@ bool ClusterSDK::InitCatalog() {
     }
     bool ok = InitTabletClient();
     if (!ok) return false;
-    return RefreshCatalog(table_datas, sp_datas);
+    if (!RefreshCatalog(table_datas, sp_datas)) {
+        return false;
+    }
+    cluster_version_.store(version, std::memory_order_relaxed);
+    return true;
 }
 
 uint32_t ClusterSDK::GetTableId(const std::string& db, const std::string& tname) {
@@ -328,6 +443,27 @@ bool ClusterSDK::GetRealEndpoint(const std::string& endpoint, std::string* real_
     return true;
 }
 
+void ClusterSDK::UpdateWriteOffset(uint32_t tid, uint32_t pid, uint64_t offset) {
+    std::lock_guard<::fedb::base::SpinMutex> lock(offset_mu_);
+    uint64_t& cur_offset = write_offsets_[tid][pid];
+    if (offset > cur_offset) {
+        cur_offset = offset;
+    }
+}
+
+uint64_t ClusterSDK::GetWriteOffset(uint32_t tid, uint32_t pid) {
+    std::lock_guard<::fedb::base::SpinMutex> lock(offset_mu_);
+    auto it = write_offsets_.find(tid);
+    if (it == write_offsets_.end()) {
+        return 0;
+    }
+    auto iit = it->second.find(pid);
+    if (iit == it->second.end()) {
+        return 0;
+    }
+    return iit->second;
+}
+
 std::shared_ptr<::fedb::catalog::TabletAccessor> ClusterSDK::GetTablet() { return GetCatalog()->GetTablet(); }
 
 std::shared_ptr<::fedb::catalog::TabletAccessor> ClusterSDK::GetTablet(const std::string& db,
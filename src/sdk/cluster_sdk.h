@@ -41,6 +41,7 @@ struct ClusterOptions {
     std::string zk_cluster;
     std::string zk_path;
     int32_t session_timeout = 2000;
+    std::string connection_type;
 };
 
 class ClusterSDK {
@@ -98,8 +99,17 @@ class ClusterSDK {
         return engine_;
     }
 
+    // the latest log offset this client wrote to a partition, follower reads
+    // wait for it so that a client always reads its own writes
+    void UpdateWriteOffset(uint32_t tid, uint32_t pid, uint64_t offset);
+    uint64_t GetWriteOffset(uint32_t tid, uint32_t pid);
+
  private:
     bool InitCatalog();
+    bool GetNotifyVersion(uint64_t* version);
+    // applies the tables changed up to version from the change log. returns
+    // false if the whole catalog must be reloaded
+    bool RefreshChangedTables(uint64_t version);
     bool RefreshCatalog(const std::vector<std::string>& table_datas,
             const std::vector<std::string>& sp_datas);
     bool InitTabletClient();
@@ -113,6 +123,7 @@ class ClusterSDK {
     std::string nodes_root_path_;
     std::string table_root_path_;
     std::string notify_path_;
+    std::string change_log_path_;
     ::fedb::zk::ZkClient* zk_client_;
     ::fedb::base::SpinMutex mu_;
     std::shared_ptr<::fedb::catalog::ClientManager> client_manager_;
@@ -127,6 +138,8 @@ class ClusterSDK {
     ::fedb::base::Random rand_;
     std::string sp_root_path_;
     ::hybridse::vm::Engine* engine_;
+    ::fedb::base::SpinMutex offset_mu_;
+    std::map<uint32_t, std::map<uint32_t, uint64_t>> write_offsets_;
 };
 
 }  // namespace sdk
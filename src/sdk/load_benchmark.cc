@@ -0,0 +1,136 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// closed loop load on the whole tablet rpc path. without --load_zk_cluster it
+// starts a mini cluster in process, e.g. for a regression check in ci
+//   load_benchmark --load_mix=put:50,get:40,window:10 --load_concurrency=16
+//       --load_output=load.json --load_min_qps=5000 --load_max_p99_us=20000
+// the report is json and the exit code is 1 if a threshold is not met
+
+#include <gflags/gflags.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "sdk/load_generator.h"
+#include "sdk/mini_cluster.h"
+#include "sdk/sql_router.h"
+
+DEFINE_string(load_zk_cluster, "", "the zk cluster to connect, a mini cluster is started if empty");
+DEFINE_string(load_zk_path, "", "the zk root path of the cluster to connect");
+DEFINE_int32(load_mini_cluster_zk_port, 6181, "the port of the zk used by the mini cluster");
+DEFINE_int32(load_mini_cluster_tablet_num, 2, "the tablet num of the mini cluster");
+DEFINE_string(load_db, "load_db", "the db of the load table");
+DEFINE_string(load_table, "load_t", "the load table, it is created by the tool and should not exist");
+DEFINE_uint32(load_concurrency, 8, "the number of bthreads sending requests");
+DEFINE_uint64(load_duration_ms, 10000, "the run time");
+DEFINE_uint64(load_qps, 0, "the target qps of all bthreads, 0 means no limit");
+DEFINE_uint64(load_key_num, 10000, "the key cardinality");
+DEFINE_double(load_zipf_theta, 0.99, "the skew of the keys in [0, 1), 0 means uniform");
+DEFINE_uint32(load_value_size, 128, "the size of the string value of a row");
+DEFINE_string(load_mix, "put:50,get:40,window:10", "the weight of each op, the ops are put, get and window");
+DEFINE_uint32(load_window_size, 10, "the rows preceding the current one in the window query");
+DEFINE_uint32(load_preload_rows_per_key, 1, "the rows loaded for each key before the run");
+DEFINE_string(load_output, "", "the file the json report is written to, stdout if empty");
+DEFINE_double(load_min_qps, 0, "fail if the qps is lower, 0 disables the check");
+DEFINE_uint64(load_max_p99_us, 0, "fail if the p99 latency of any op is higher, 0 disables the check");
+DEFINE_double(load_max_error_ratio, 0.001, "fail if the ratio of failed requests is higher");
+
+int main(int argc, char** argv) {
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    ::fedb::sdk::LoadOptions options;
+    options.db = FLAGS_load_db;
+    options.table = FLAGS_load_table;
+    options.concurrency = FLAGS_load_concurrency;
+    options.duration_ms = FLAGS_load_duration_ms;
+    options.target_qps = FLAGS_load_qps;
+    options.key_num = FLAGS_load_key_num;
+    options.zipf_theta = FLAGS_load_zipf_theta;
+    options.value_size = FLAGS_load_value_size;
+    options.window_size = FLAGS_load_window_size;
+    options.preload_rows_per_key = FLAGS_load_preload_rows_per_key;
+    if (!::fedb::sdk::ParseLoadMix(FLAGS_load_mix, &options)) {
+        std::cerr << "invalid load mix " << FLAGS_load_mix << std::endl;
+        return 1;
+    }
+    if (!::fedb::sdk::ZipfianGenerator::IsValidTheta(options.zipf_theta)) {
+        std::cerr << "invalid zipf theta " << options.zipf_theta << std::endl;
+        return 1;
+    }
+    std::unique_ptr<::fedb::sdk::MiniCluster> mc;
+    ::fedb::sdk::SQLRouterOptions sql_opt;
+    if (FLAGS_load_zk_cluster.empty()) {
+        mc.reset(new ::fedb::sdk::MiniCluster(FLAGS_load_mini_cluster_zk_port));
+        if (!mc->SetUp(FLAGS_load_mini_cluster_tablet_num)) {
+            std::cerr << "fail to start mini cluster" << std::endl;
+            return 1;
+        }
+        sql_opt.zk_cluster = mc->GetZkCluster();
+        sql_opt.zk_path = mc->GetZkPath();
+    } else {
+        sql_opt.zk_cluster = FLAGS_load_zk_cluster;
+        sql_opt.zk_path = FLAGS_load_zk_path;
+    }
+    int ret = 0;
+    {
+        auto router = ::fedb::sdk::NewClusterSQLRouter(sql_opt);
+        if (!router) {
+            std::cerr << "fail to init sql cluster router" << std::endl;
+            ret = 1;
+        } else {
+            ::fedb::sdk::LoadGenerator generator(router, options);
+            std::string msg;
+            if (!generator.Prepare(&msg)) {
+                std::cerr << msg << std::endl;
+                ret = 1;
+            } else {
+                ::fedb::sdk::LoadReport report;
+                generator.Run(&report);
+                std::string json = report.ToJson();
+                if (FLAGS_load_output.empty()) {
+                    std::cout << json << std::endl;
+                } else {
+                    std::ofstream out(FLAGS_load_output);
+                    out << json << std::endl;
+                }
+                uint64_t total = report.GetCount() + report.GetErrorCount();
+                if (total == 0 || report.GetErrorCount() > total * FLAGS_load_max_error_ratio) {
+                    std::cerr << "error ratio is too high: " << report.GetErrorCount() << "/" << total
+                              << std::endl;
+                    ret = 1;
+                }
+                if (FLAGS_load_min_qps > 0 && report.GetQps() < FLAGS_load_min_qps) {
+                    std::cerr << "qps " << report.GetQps() << " is lower than " << FLAGS_load_min_qps << std::endl;
+                    ret = 1;
+                }
+                for (int type = 0; type < ::fedb::sdk::kLoadOpTypeNum; type++) {
+                    uint64_t p99 = report.stats[type].GetPercentile(99);
+                    if (FLAGS_load_max_p99_us > 0 && p99 > FLAGS_load_max_p99_us) {
+                        std::cerr << "p99 of " << ::fedb::sdk::GetLoadOpName(static_cast<::fedb::sdk::LoadOpType>(type))
+                                  << " is " << p99 << "us" << std::endl;
+                        ret = 1;
+                    }
+                }
+            }
+        }
+    }
+    if (mc) {
+        mc->Close();
+    }
+    return ret;
+}
@@ -0,0 +1,407 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/load_generator.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <sstream>
+#include <thread>  // NOLINT
+
+#include "base/glog_wapper.h"
+#include "bthread/bthread.h"
+#include "common/timer.h"
+
+namespace fedb {
+namespace sdk {
+
+ZipfianGenerator::ZipfianGenerator(uint64_t n, double theta)
+    : n_(std::max(n, static_cast<uint64_t>(1))), theta_(theta), alpha_(0), zetan_(0), eta_(0) {
+    if (!IsValidTheta(theta_)) {
+        PDLOG(WARNING, "invalid zipfian theta %f, use uniform", theta_);
+        theta_ = 0;
+    }
+    if (theta_ == 0) {
+        return;
+    }
+    double zeta2 = 0;
+    for (uint64_t i = 1; i <= n_; i++) {
+        zetan_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+        if (i == 2) {
+            zeta2 = zetan_;
+        }
+    }
+    alpha_ = 1.0 / (1.0 - theta_);
+    // eta is 0 / 0 for n 2. with n <= 2 the first two branches of Next take
+    // every u, so it is not used
+    if (n_ > 2) {
+        eta_ = (1 - std::pow(2.0 / n_, 1 - theta_)) / (1 - zeta2 / zetan_);
+    }
+}
+
+uint64_t ZipfianGenerator::Next(std::mt19937_64* engine) const {
+    std::uniform_real_distribution<double> dis(0, 1);
+    double u = dis(*engine);
+    if (theta_ == 0) {
+        return std::min(static_cast<uint64_t>(u * n_), n_ - 1);
+    }
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+        return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+        return std::min(static_cast<uint64_t>(1), n_ - 1);
+    }
+    uint64_t rank = static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return std::min(rank, n_ - 1);
+}
+
+const char* GetLoadOpName(LoadOpType type) {
+    switch (type) {
+        case kLoadPut:
+            return "put";
+        case kLoadGet:
+            return "get";
+        case kLoadWindow:
+            return "window";
+        default:
+            return "unknown";
+    }
+}
+
+bool ParseLoadMix(const std::string& mix, LoadOptions* options) {
+    uint32_t weights[kLoadOpTypeNum] = {0};
+    uint32_t total = 0;
+    std::stringstream ss(mix);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t pos = item.find(':');
+        if (pos == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, pos);
+        int type = 0;
+        for (; type < kLoadOpTypeNum; type++) {
+            if (name == GetLoadOpName(static_cast<LoadOpType>(type))) {
+                break;
+            }
+        }
+        if (type == kLoadOpTypeNum) {
+            return false;
+        }
+        try {
+            weights[type] = std::stoul(item.substr(pos + 1));
+        } catch (const std::exception& e) {
+            return false;
+        }
+        total += weights[type];
+    }
+    if (total == 0) {
+        return false;
+    }
+    std::copy(weights, weights + kLoadOpTypeNum, options->mix);
+    return true;
+}
+
+// each power of two from 128 on is split into kLatencySubBucketCnt buckets
+static const uint32_t kLatencySubBucketBits = 6;
+static const uint32_t kLatencySubBucketCnt = 1 << kLatencySubBucketBits;
+static const uint32_t kLatencyBucketCnt = (64 - kLatencySubBucketBits) * kLatencySubBucketCnt;
+
+LatencyStats::LatencyStats() : buckets_(kLatencyBucketCnt, 0), cnt_(0), sum_(0), max_(0), error_cnt_(0) {}
+
+uint32_t LatencyStats::GetBucket(uint64_t latency) {
+    if (latency < 2 * kLatencySubBucketCnt) {
+        return latency;
+    }
+    uint32_t exp = 63 - __builtin_clzll(latency);
+    uint32_t shift = exp - kLatencySubBucketBits;
+    return shift * kLatencySubBucketCnt + (latency >> shift);
+}
+
+uint64_t LatencyStats::GetBucketMax(uint32_t bucket) {
+    if (bucket < 2 * kLatencySubBucketCnt) {
+        return bucket;
+    }
+    uint32_t shift = bucket / kLatencySubBucketCnt - 1;
+    uint64_t sub = bucket % kLatencySubBucketCnt + kLatencySubBucketCnt;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyStats::Add(uint64_t latency) {
+    buckets_[GetBucket(latency)]++;
+    cnt_++;
+    sum_ += latency;
+    max_ = std::max(max_, latency);
+}
+
+void LatencyStats::Merge(const LatencyStats& other) {
+    for (uint32_t i = 0; i < kLatencyBucketCnt; i++) {
+        buckets_[i] += other.buckets_[i];
+    }
+    cnt_ += other.cnt_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+    error_cnt_ += other.error_cnt_;
+}
+
+double LatencyStats::GetMean() const {
+    if (cnt_ == 0) {
+        return 0;
+    }
+    return static_cast<double>(sum_) / cnt_;
+}
+
+uint64_t LatencyStats::GetPercentile(double p) const {
+    if (cnt_ == 0) {
+        return 0;
+    }
+    // nearest rank, the upper bound of its bucket
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100 * cnt_));
+    rank = std::min(std::max(rank, static_cast<uint64_t>(1)), cnt_);
+    uint64_t cur = 0;
+    for (uint32_t i = 0; i < kLatencyBucketCnt; i++) {
+        cur += buckets_[i];
+        if (cur >= rank) {
+            return std::min(GetBucketMax(i), max_);
+        }
+    }
+    return max_;
+}
+
+uint64_t LoadReport::GetCount() const {
+    uint64_t cnt = 0;
+    for (const auto& stat : stats) {
+        cnt += stat.GetCount();
+    }
+    return cnt;
+}
+
+uint64_t LoadReport::GetErrorCount() const {
+    uint64_t cnt = 0;
+    for (const auto& stat : stats) {
+        cnt += stat.GetErrorCount();
+    }
+    return cnt;
+}
+
+double LoadReport::GetQps() const {
+    if (elapsed_us == 0) {
+        return 0;
+    }
+    return GetCount() * 1000000.0 / elapsed_us;
+}
+
+std::string LoadReport::ToJson() {
+    std::stringstream ss;
+    ss << "{\"concurrency\":" << options.concurrency << ",\"target_qps\":" << options.target_qps
+       << ",\"key_num\":" << options.key_num << ",\"zipf_theta\":" << options.zipf_theta
+       << ",\"value_size\":" << options.value_size << ",\"elapsed_us\":" << elapsed_us
+       << ",\"count\":" << GetCount() << ",\"errors\":" << GetErrorCount() << ",\"qps\":" << GetQps()
+       << ",\"ops\":{";
+    bool first = true;
+    for (int type = 0; type < kLoadOpTypeNum; type++) {
+        if (options.mix[type] == 0) {
+            continue;
+        }
+        const LatencyStats& stat = stats[type];
+        if (!first) {
+            ss << ",";
+        }
+        first = false;
+        double qps = elapsed_us == 0 ? 0 : stat.GetCount() * 1000000.0 / elapsed_us;
+        ss << "\"" << GetLoadOpName(static_cast<LoadOpType>(type)) << "\":{\"count\":" << stat.GetCount()
+           << ",\"errors\":" << stat.GetErrorCount() << ",\"qps\":" << qps << ",\"mean_us\":" << stat.GetMean()
+           << ",\"p50_us\":" << stat.GetPercentile(50) << ",\"p90_us\":" << stat.GetPercentile(90)
+           << ",\"p99_us\":" << stat.GetPercentile(99) << ",\"p999_us\":" << stat.GetPercentile(99.9)
+           << ",\"max_us\":" << stat.GetMax() << "}";
+    }
+    ss << "}}";
+    return ss.str();
+}
+
+struct LoadWorkerArgs {
+    LoadGenerator* generator;
+    uint32_t idx;
+};
+
+LoadGenerator::LoadGenerator(std::shared_ptr<SQLRouter> router, const LoadOptions& options)
+    : router_(router),
+      options_(options),
+      zipf_(options.key_num, options.zipf_theta),
+      limiter_(options.target_qps, std::max(options.concurrency, static_cast<uint32_t>(1))),
+      value_(options.value_size, 'v'),
+      insert_sql_("insert into " + options.table + " values(?, ?, ?, ?);"),
+      window_sql_("select c1, sum(c3) over w as w_sum, count(c4) over w as w_cnt from " + options.table +
+                  " window w as (partition by c1 order by c2 rows between " +
+                  std::to_string(options.window_size) + " preceding and current row);"),
+      running_(false),
+      worker_stats_() {}
+
+bool LoadGenerator::Prepare(std::string* msg) {
+    if (!ZipfianGenerator::IsValidTheta(options_.zipf_theta)) {
+        *msg = "zipf theta must be in [0, 1)";
+        return false;
+    }
+    ::hybridse::sdk::Status status;
+    std::vector<std::string> dbs;
+    if (!router_->ShowDB(&dbs, &status)) {
+        *msg = "fail to show db: " + status.msg;
+        return false;
+    }
+    if (std::find(dbs.begin(), dbs.end(), options_.db) == dbs.end() && !router_->CreateDB(options_.db, &status)) {
+        *msg = "fail to create db: " + status.msg;
+        return false;
+    }
+    std::string ddl = "create table " + options_.table +
+                      " (c1 string, c2 bigint, c3 bigint, c4 string, index(key=c1, ts=c2));";
+    if (!router_->ExecuteDDL(options_.db, ddl, &status)) {
+        *msg = "fail to create table: " + status.msg;
+        return false;
+    }
+    router_->RefreshCatalog();
+    int64_t ts = ::baidu::common::timer::get_micros() / 1000;
+    for (uint32_t i = 0; i < options_.preload_rows_per_key; i++) {
+        for (uint64_t rank = 0; rank < options_.key_num; rank++) {
+            if (!Put(GetKey(rank), ts - options_.preload_rows_per_key + i)) {
+                *msg = "fail to load rows";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool LoadGenerator::Put(const std::string& key, int64_t ts) {
+    ::hybridse::sdk::Status status;
+    auto row = router_->GetInsertRow(options_.db, insert_sql_, &status);
+    if (!row || !row->Init(key.size() + value_.size()) || !row->AppendString(key) || !row->AppendInt64(ts) ||
+        !row->AppendInt64(ts) || !row->AppendString(value_) || !row->Build()) {
+        return false;
+    }
+    return router_->ExecuteInsert(options_.db, insert_sql_, row, &status);
+}
+
+bool LoadGenerator::Get(const std::string& key) {
+    ::hybridse::sdk::Status status;
+    ScanOption so;
+    so.limit = 1;
+    auto rs = router_->GetTableReader()->Scan(options_.db, options_.table, key,
+                                              ::baidu::common::timer::get_micros() / 1000, 0, so, &status);
+    return rs && status.code == 0;
+}
+
+bool LoadGenerator::Window(const std::string& key, int64_t ts) {
+    ::hybridse::sdk::Status status;
+    auto row = router_->GetRequestRow(options_.db, window_sql_, &status);
+    if (!row || !row->Init(key.size() + value_.size()) || !row->AppendString(key) || !row->AppendInt64(ts) ||
+        !row->AppendInt64(ts) || !row->AppendString(value_) || !row->Build()) {
+        return false;
+    }
+    auto rs = router_->ExecuteSQL(options_.db, window_sql_, row, &status);
+    return rs && status.code == 0;
+}
+
+void* LoadGenerator::RunWorker(void* args) {
+    LoadWorkerArgs* worker_args = reinterpret_cast<LoadWorkerArgs*>(args);
+    LoadGenerator* generator = worker_args->generator;
+    uint32_t idx = worker_args->idx;
+    generator->Work(idx, &generator->worker_stats_[idx * kLoadOpTypeNum]);
+    return NULL;
+}
+
+void LoadGenerator::Work(uint32_t idx, LatencyStats* stats) {
+    std::mt19937_64 engine(::baidu::common::timer::get_micros() + idx);
+    uint32_t total_weight = 0;
+    for (uint32_t weight : options_.mix) {
+        total_weight += weight;
+    }
+    std::uniform_int_distribution<uint32_t> op_dis(0, total_weight - 1);
+    while (running_.load(std::memory_order_relaxed)) {
+        uint64_t wait_time = limiter_.Reserve(1);
+        if (wait_time > 0) {
+            bthread_usleep(wait_time);
+            if (!running_.load(std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        uint32_t weight = op_dis(engine);
+        int type = 0;
+        while (weight >= options_.mix[type]) {
+            weight -= options_.mix[type];
+            type++;
+        }
+        std::string key = GetKey(zipf_.Next(&engine));
+        int64_t ts = ::baidu::common::timer::get_micros() / 1000;
+        uint64_t start = ::baidu::common::timer::get_micros();
+        bool ok = false;
+        switch (type) {
+            case kLoadPut:
+                ok = Put(key, ts);
+                break;
+            case kLoadGet:
+                ok = Get(key);
+                break;
+            default:
+                ok = Window(key, ts);
+                break;
+        }
+        if (ok) {
+            stats[type].Add(::baidu::common::timer::get_micros() - start);
+        } else {
+            stats[type].AddError();
+        }
+    }
+}
+
+void LoadGenerator::Run(LoadReport* report) {
+    uint32_t concurrency = std::max(options_.concurrency, static_cast<uint32_t>(1));
+    worker_stats_.assign(concurrency * kLoadOpTypeNum, LatencyStats());
+    std::vector<LoadWorkerArgs> args(concurrency);
+    std::vector<bthread_t> bthreads(concurrency);
+    uint64_t start = ::baidu::common::timer::get_micros();
+    running_.store(true, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < concurrency; i++) {
+        args[i].generator = this;
+        args[i].idx = i;
+        if (bthread_start_background(&bthreads[i], NULL, RunWorker, &args[i]) != 0) {
+            PDLOG(WARNING, "fail to start load worker %u", i);
+            running_.store(false, std::memory_order_relaxed);
+            concurrency = i;
+            break;
+        }
+    }
+    if (running_.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(options_.duration_ms));
+        running_.store(false, std::memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < concurrency; i++) {
+        bthread_join(bthreads[i], NULL);
+    }
+    report->options = options_;
+    report->elapsed_us = ::baidu::common::timer::get_micros() - start;
+    for (int type = 0; type < kLoadOpTypeNum; type++) {
+        report->stats[type] = LatencyStats();
+    }
+    for (uint32_t i = 0; i < worker_stats_.size(); i++) {
+        report->stats[i % kLoadOpTypeNum].Merge(worker_stats_[i]);
+    }
+    worker_stats_.clear();
+}
+
+}  // namespace sdk
+}  // namespace fedb
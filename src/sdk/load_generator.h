@@ -0,0 +1,159 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_LOAD_GENERATOR_H_
+#define SRC_SDK_LOAD_GENERATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/rate_limiter.h"
+#include "sdk/sql_router.h"
+
+namespace fedb {
+namespace sdk {
+
+// integers in [0, n) following a zipfian distribution as in YCSB, 0 is the
+// hottest. theta is in [0, 1) and 0 makes it uniform, an invalid theta falls
+// back to uniform too
+class ZipfianGenerator {
+ public:
+    ZipfianGenerator(uint64_t n, double theta);
+
+    static bool IsValidTheta(double theta) { return theta >= 0 && theta < 1; }
+
+    uint64_t Next(std::mt19937_64* engine) const;
+
+ private:
+    uint64_t n_;
+    double theta_;
+    double alpha_;
+    double zetan_;
+    double eta_;
+};
+
+enum LoadOpType {
+    kLoadPut = 0,
+    kLoadGet = 1,
+    kLoadWindow = 2,
+    kLoadOpTypeNum = 3,
+};
+
+const char* GetLoadOpName(LoadOpType type);
+
+struct LoadOptions {
+    std::string db = "load_db";
+    std::string table = "load_t";
+    uint32_t concurrency = 8;
+    uint64_t duration_ms = 10000;
+    // total requests per second of all bthreads, 0 means no limit
+    uint64_t target_qps = 0;
+    uint64_t key_num = 10000;
+    double zipf_theta = 0.99;
+    uint32_t value_size = 128;
+    // weight of each op type
+    uint32_t mix[kLoadOpTypeNum] = {50, 40, 10};
+    // rows preceding the current one in the window query
+    uint32_t window_size = 10;
+    uint32_t preload_rows_per_key = 1;
+};
+
+// parses the op mix like put:50,get:40,window:10. missing ops get 0
+bool ParseLoadMix(const std::string& mix, LoadOptions* options);
+
+// latencies in microseconds of one op type. they are counted in a log linear
+// histogram of fixed size, exact below 128us and within 1/64 above, so a long
+// run does not keep every sample
+class LatencyStats {
+ public:
+    LatencyStats();
+
+    void Add(uint64_t latency);
+    void AddError() { error_cnt_++; }
+    void Merge(const LatencyStats& other);
+
+    uint64_t GetCount() const { return cnt_; }
+    uint64_t GetErrorCount() const { return error_cnt_; }
+    double GetMean() const;
+    // p is in [0, 100]
+    uint64_t GetPercentile(double p) const;
+    uint64_t GetMax() const { return max_; }
+
+ private:
+    static uint32_t GetBucket(uint64_t latency);
+    static uint64_t GetBucketMax(uint32_t bucket);
+
+    std::vector<uint64_t> buckets_;
+    uint64_t cnt_;
+    uint64_t sum_;
+    uint64_t max_;
+    uint64_t error_cnt_;
+};
+
+struct LoadReport {
+    LoadOptions options;
+    uint64_t elapsed_us = 0;
+    LatencyStats stats[kLoadOpTypeNum];
+
+    uint64_t GetCount() const;
+    uint64_t GetErrorCount() const;
+    double GetQps() const;
+    std::string ToJson();
+};
+
+// closed loop load on one table through the sql router. each bthread sends
+// its next request once the former returns, and the target qps caps the
+// rate of all of them. the table is
+//   (c1 string, c2 bigint, c3 bigint, c4 string, index(key=c1, ts=c2))
+class LoadGenerator {
+ public:
+    LoadGenerator(std::shared_ptr<SQLRouter> router, const LoadOptions& options);
+    ~LoadGenerator() {}
+
+    // creates the db and the table and loads rows for every key
+    bool Prepare(std::string* msg);
+
+    void Run(LoadReport* report);
+
+ private:
+    static void* RunWorker(void* args);
+    void Work(uint32_t idx, LatencyStats* stats);
+
+    std::string GetKey(uint64_t rank) const { return "key" + std::to_string(rank); }
+    bool Put(const std::string& key, int64_t ts);
+    bool Get(const std::string& key);
+    bool Window(const std::string& key, int64_t ts);
+
+ private:
+    std::shared_ptr<SQLRouter> router_;
+    LoadOptions options_;
+    ZipfianGenerator zipf_;
+    ::fedb::base::RateLimiter limiter_;
+    std::string value_;
+    std::string insert_sql_;
+    std::string window_sql_;
+    std::atomic<bool> running_;
+    // kLoadOpTypeNum stats for each bthread
+    std::vector<LatencyStats> worker_stats_;
+};
+
+}  // namespace sdk
+}  // namespace fedb
+
+#endif  // SRC_SDK_LOAD_GENERATOR_H_
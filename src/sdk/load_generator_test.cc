@@ -0,0 +1,150 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/load_generator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace sdk {
+
+class LoadGeneratorTest : public ::testing::Test {
+ public:
+    LoadGeneratorTest() {}
+    ~LoadGeneratorTest() {}
+};
+
+TEST_F(LoadGeneratorTest, Zipfian) {
+    std::mt19937_64 engine(1);
+    ZipfianGenerator zipf(1000, 0.99);
+    std::vector<uint64_t> cnt(1000, 0);
+    for (int i = 0; i < 100000; i++) {
+        uint64_t rank = zipf.Next(&engine);
+        ASSERT_LT(rank, 1000u);
+        cnt[rank]++;
+    }
+    // the hottest key takes more than a tenth of the requests
+    ASSERT_GT(cnt[0], 10000u);
+    ASSERT_GT(cnt[0], cnt[1]);
+    ASSERT_GT(cnt[1], cnt[100]);
+}
+
+TEST_F(LoadGeneratorTest, Uniform) {
+    std::mt19937_64 engine(1);
+    ZipfianGenerator zipf(10, 0);
+    std::vector<uint64_t> cnt(10, 0);
+    for (int i = 0; i < 100000; i++) {
+        cnt[zipf.Next(&engine)]++;
+    }
+    for (uint64_t c : cnt) {
+        ASSERT_GT(c, 9000u);
+        ASSERT_LT(c, 11000u);
+    }
+}
+
+TEST_F(LoadGeneratorTest, ZipfianFewKeys) {
+    std::mt19937_64 engine(1);
+    for (uint64_t n : {0, 1, 2, 3}) {
+        ZipfianGenerator zipf(n, 0.99);
+        uint64_t key_num = std::max(n, static_cast<uint64_t>(1));
+        std::vector<uint64_t> cnt(key_num, 0);
+        for (int i = 0; i < 10000; i++) {
+            uint64_t rank = zipf.Next(&engine);
+            ASSERT_LT(rank, key_num);
+            cnt[rank]++;
+        }
+        for (uint64_t c : cnt) {
+            ASSERT_GT(c, 0u);
+        }
+    }
+    ASSERT_TRUE(ZipfianGenerator::IsValidTheta(0));
+    ASSERT_TRUE(ZipfianGenerator::IsValidTheta(0.99));
+    ASSERT_FALSE(ZipfianGenerator::IsValidTheta(1));
+    ASSERT_FALSE(ZipfianGenerator::IsValidTheta(-0.5));
+    // an invalid theta is uniform
+    ZipfianGenerator zipf(10, 1.5);
+    std::vector<uint64_t> cnt(10, 0);
+    for (int i = 0; i < 100000; i++) {
+        cnt[zipf.Next(&engine)]++;
+    }
+    for (uint64_t c : cnt) {
+        ASSERT_GT(c, 9000u);
+        ASSERT_LT(c, 11000u);
+    }
+}
+
+TEST_F(LoadGeneratorTest, ParseLoadMix) {
+    LoadOptions options;
+    ASSERT_TRUE(ParseLoadMix("put:1,window:3", &options));
+    ASSERT_EQ(1u, options.mix[kLoadPut]);
+    ASSERT_EQ(0u, options.mix[kLoadGet]);
+    ASSERT_EQ(3u, options.mix[kLoadWindow]);
+    ASSERT_FALSE(ParseLoadMix("scan:1", &options));
+    ASSERT_FALSE(ParseLoadMix("put:x", &options));
+    ASSERT_FALSE(ParseLoadMix("put:0", &options));
+    ASSERT_EQ(3u, options.mix[kLoadWindow]);
+}
+
+TEST_F(LoadGeneratorTest, LatencyStats) {
+    LatencyStats stats;
+    ASSERT_EQ(0u, stats.GetPercentile(99));
+    LatencyStats other;
+    for (uint64_t i = 1; i <= 100; i++) {
+        if (i % 2 == 0) {
+            stats.Add(i);
+        } else {
+            other.Add(i);
+        }
+    }
+    other.AddError();
+    stats.Merge(other);
+    ASSERT_EQ(100u, stats.GetCount());
+    ASSERT_EQ(1u, stats.GetErrorCount());
+    ASSERT_EQ(50u, stats.GetPercentile(50));
+    ASSERT_EQ(99u, stats.GetPercentile(99));
+    ASSERT_EQ(100u, stats.GetMax());
+    ASSERT_DOUBLE_EQ(50.5, stats.GetMean());
+}
+
+TEST_F(LoadGeneratorTest, LatencyStatsLarge) {
+    LatencyStats stats;
+    for (uint64_t i = 1; i <= 1000000; i++) {
+        stats.Add(i * 10);
+    }
+    ASSERT_EQ(1000000u, stats.GetCount());
+    ASSERT_EQ(10000000u, stats.GetMax());
+    ASSERT_EQ(10000000u, stats.GetPercentile(100));
+    ASSERT_DOUBLE_EQ(5000005.0, stats.GetMean());
+    // within 1/64 of the exact values
+    uint64_t p50 = stats.GetPercentile(50);
+    ASSERT_GE(p50, 5000000u);
+    ASSERT_LE(p50, 5000000u + 5000000u / 64);
+    uint64_t p99 = stats.GetPercentile(99);
+    ASSERT_GE(p99, 9900000u);
+    ASSERT_LE(p99, 9900000u + 9900000u / 64);
+    ASSERT_EQ(10u, stats.GetPercentile(0.0001));
+}
+
+}  // namespace sdk
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/procedure_batcher.h"
+
+#include <algorithm>
+
+#include "base/status.h"
+#include "bthread/bthread.h"
+#include "glog/logging.h"
+#include "sdk/batch_request_result_set_sql.h"
+
+namespace fedb {
+namespace sdk {
+
+// the row idx of a batch, cut out of the batch response
+class ProcedureBatchFuture : public QueryFuture {
+ public:
+    ProcedureBatchFuture(const std::shared_ptr<ProcedureBatch>& batch, uint32_t idx) : batch_(batch), idx_(idx) {}
+    ~ProcedureBatchFuture() {}
+
+    std::shared_ptr<hybridse::sdk::ResultSet> GetResultSet(hybridse::sdk::Status* status) override;
+
+    bool IsDone() const override {
+        if (!batch_->is_sent.load(std::memory_order_acquire)) {
+            return false;
+        }
+        return !batch_->ok || batch_->callback->IsDone();
+    }
+
+ private:
+    std::shared_ptr<ProcedureBatch> batch_;
+    uint32_t idx_;
+};
+
+std::shared_ptr<hybridse::sdk::ResultSet> ProcedureBatchFuture::GetResultSet(hybridse::sdk::Status* status) {
+    if (!status) {
+        return nullptr;
+    }
+    batch_->sent.wait();
+    if (!batch_->ok) {
+        status->code = hybridse::common::kRpcError;
+        status->msg = "request error, fail to send the batch request";
+        return nullptr;
+    }
+    const auto& cntl = batch_->callback->GetController();
+    const auto& response = batch_->callback->GetResponse();
+    brpc::Join(cntl->call_id());
+    if (cntl->Failed()) {
+        status->code = hybridse::common::kRpcError;
+        status->msg = "request error, " + cntl->ErrorText();
+        return nullptr;
+    }
+    if (response->code() != ::fedb::base::kOk) {
+        status->code = response->code();
+        status->msg = "request error, " + response->msg();
+        return nullptr;
+    }
+    int common_cnt = response->common_slices() > 0 ? 1 : 0;
+    if (idx_ >= response->count() || common_cnt + idx_ >= static_cast<uint32_t>(response->row_sizes_size())) {
+        status->code = -1;
+        status->msg = "request error, the batch response has " + std::to_string(response->count()) + " rows";
+        return nullptr;
+    }
+    // the row is the common part, if any, followed by its own non common part
+    auto row_response = std::make_shared<::fedb::api::SQLBatchRequestQueryResponse>();
+    row_response->set_code(response->code());
+    row_response->set_count(1);
+    row_response->set_schema(response->schema());
+    *row_response->mutable_common_column_indices() = response->common_column_indices();
+    row_response->set_common_slices(response->common_slices());
+    row_response->set_non_common_slices(response->non_common_slices());
+    auto row_cntl = std::make_shared<brpc::Controller>();
+    const butil::IOBuf& buf = cntl->response_attachment();
+    size_t offset = 0;
+    if (common_cnt > 0) {
+        uint32_t common_size = response->row_sizes(0);
+        buf.append_to(&row_cntl->response_attachment(), common_size, 0);
+        row_response->add_row_sizes(common_size);
+        offset = common_size;
+    }
+    for (uint32_t i = 0; i < idx_; i++) {
+        offset += response->row_sizes(common_cnt + i);
+    }
+    uint32_t row_size = response->row_sizes(common_cnt + idx_);
+    buf.append_to(&row_cntl->response_attachment(), row_size, offset);
+    row_response->add_row_sizes(row_size);
+    auto rs = std::make_shared<SQLBatchRequestResultSet>(row_response, row_cntl);
+    if (!rs->Init()) {
+        status->code = -1;
+        status->msg = "request error, resuletSetSQL init failed";
+        return nullptr;
+    }
+    return rs;
+}
+
+struct FlushArgs {
+    std::shared_ptr<ProcedureBatcher> batcher;
+    std::string key;
+    std::shared_ptr<ProcedureBatch> batch;
+    uint32_t window_us;
+};
+
+ProcedureBatcher::ProcedureBatcher(uint32_t window_us, uint32_t max_rows, bool is_debug)
+    : window_us_(window_us), max_rows_(std::max(max_rows, 1u)), is_debug_(is_debug), mu_(), batches_() {}
+
+std::shared_ptr<QueryFuture> ProcedureBatcher::Call(const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info,
+                                                    const std::shared_ptr<::fedb::client::TabletClient>& tablet,
+                                                    int64_t timeout_ms, const std::shared_ptr<SQLRequestRow>& row,
+                                                    hybridse::sdk::Status* status) {
+    if (status == nullptr || !sp_info || !tablet) {
+        return std::shared_ptr<QueryFuture>();
+    }
+    if (!row || !row->OK()) {
+        status->code = -1;
+        status->msg = "make sure the request row is built before execute sql";
+        LOG(WARNING) << status->msg;
+        return std::shared_ptr<QueryFuture>();
+    }
+    const auto& input_schema = sp_info->GetInputSchema();
+    auto indices = std::make_shared<ColumnIndicesSet>(row->GetSchema());
+    for (int i = 0; i < input_schema.GetColumnCnt(); i++) {
+        if (input_schema.IsConstant(i)) {
+            indices->AddCommonColumnIdx(i);
+        }
+    }
+    std::string key = sp_info->GetDbName() + "\n" + sp_info->GetSpName();
+    if (!indices->Empty()) {
+        SQLRequestRowBatch probe(row->GetSchema(), indices);
+        if (!probe.AddRow(row)) {
+            status->code = -1;
+            status->msg = "fail to get the constant columns of the request row";
+            LOG(WARNING) << status->msg;
+            return std::shared_ptr<QueryFuture>();
+        }
+        key.append("\n").append(*probe.GetCommonSlice());
+    }
+    std::shared_ptr<ProcedureBatch> batch;
+    uint32_t idx = 0;
+    bool is_first = false;
+    bool is_full = false;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto& pending = batches_[key];
+        if (!pending) {
+            pending = std::make_shared<ProcedureBatch>();
+            pending->db = sp_info->GetDbName();
+            pending->sp_name = sp_info->GetSpName();
+            pending->tablet = tablet;
+            pending->row_batch = std::make_shared<SQLRequestRowBatch>(row->GetSchema(), indices);
+            is_first = true;
+        }
+        batch = pending;
+        if (!batch->row_batch->AddRow(row)) {
+            if (is_first) {
+                batches_.erase(key);
+            }
+            status->code = -1;
+            status->msg = "fail to add the request row to the batch";
+            LOG(WARNING) << status->msg;
+            return std::shared_ptr<QueryFuture>();
+        }
+        idx = batch->row_batch->Size() - 1;
+        batch->timeout_ms = std::max(batch->timeout_ms, timeout_ms);
+        if (static_cast<uint32_t>(batch->row_batch->Size()) >= max_rows_) {
+            batches_.erase(key);
+            is_full = true;
+        }
+    }
+    if (is_full) {
+        Send(batch);
+    } else if (is_first) {
+        FlushArgs* args = new FlushArgs{shared_from_this(), key, batch, window_us_};
+        bthread_t tid;
+        if (bthread_start_background(&tid, NULL, FlushAfterWindow, args) != 0) {
+            delete args;
+            Flush(key, batch);
+        }
+    }
+    return std::make_shared<ProcedureBatchFuture>(batch, idx);
+}
+
+void* ProcedureBatcher::FlushAfterWindow(void* ptr) {
+    std::unique_ptr<FlushArgs> args(static_cast<FlushArgs*>(ptr));
+    bthread_usleep(args->window_us);
+    args->batcher->Flush(args->key, args->batch);
+    return NULL;
+}
+
+void ProcedureBatcher::Flush(const std::string& key, const std::shared_ptr<ProcedureBatch>& batch) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto iter = batches_.find(key);
+        if (iter == batches_.end() || iter->second != batch) {
+            // it was sent once it got full
+            return;
+        }
+        batches_.erase(iter);
+    }
+    Send(batch);
+}
+
+void ProcedureBatcher::Send(const std::shared_ptr<ProcedureBatch>& batch) {
+    auto cntl = std::make_shared<brpc::Controller>();
+    auto response = std::make_shared<fedb::api::SQLBatchRequestQueryResponse>();
+    batch->callback = new fedb::RpcCallback<fedb::api::SQLBatchRequestQueryResponse>(response, cntl);
+    // one reference for the batch and one released when the rpc returns
+    batch->callback->Ref();
+    batch->ok = batch->tablet->CallSQLBatchRequestProcedure(batch->db, batch->sp_name, batch->row_batch, is_debug_,
+                                                            batch->timeout_ms, batch->callback);
+    if (!batch->ok) {
+        LOG(WARNING) << "fail to send the batch request of procedure " << batch->sp_name;
+        batch->callback->UnRef();
+    }
+    DLOG(INFO) << "send " << batch->row_batch->Size() << " rows of procedure " << batch->sp_name;
+    batch->is_sent.store(true, std::memory_order_release);
+    batch->sent.signal();
+}
+
+}  // namespace sdk
+}  // namespace fedb
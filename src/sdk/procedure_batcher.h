@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_PROCEDURE_BATCHER_H_
+#define SRC_SDK_PROCEDURE_BATCHER_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "bthread/countdown_event.h"
+#include "client/tablet_client.h"
+#include "rpc/rpc_client.h"
+#include "sdk/base.h"
+#include "sdk/sql_request_row.h"
+#include "sdk/sql_router.h"
+
+namespace fedb {
+namespace sdk {
+
+// request rows of one procedure sent as one batch request
+struct ProcedureBatch {
+    ProcedureBatch() : sent(1), is_sent(false), ok(false), timeout_ms(0), callback(nullptr) {}
+    ~ProcedureBatch() {
+        if (callback != nullptr) {
+            callback->UnRef();
+        }
+    }
+
+    // signaled once the batch is sent or fails to be sent
+    bthread::CountdownEvent sent;
+    std::atomic<bool> is_sent;
+    bool ok;
+    std::string db;
+    std::string sp_name;
+    std::shared_ptr<::fedb::client::TabletClient> tablet;
+    int64_t timeout_ms;
+    std::shared_ptr<SQLRequestRowBatch> row_batch;
+    fedb::RpcCallback<fedb::api::SQLBatchRequestQueryResponse>* callback;
+};
+
+// coalesces concurrent request mode calls of the same procedure into one
+// SQLBatchRequestQuery. a batch is sent window_us after its first row or
+// once it has max_rows rows, and each caller gets its own row of the result.
+// rows are only batched together if their constant columns are equal
+class ProcedureBatcher : public std::enable_shared_from_this<ProcedureBatcher> {
+ public:
+    ProcedureBatcher(uint32_t window_us, uint32_t max_rows, bool is_debug);
+    ~ProcedureBatcher() {}
+
+    std::shared_ptr<QueryFuture> Call(const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info,
+                                      const std::shared_ptr<::fedb::client::TabletClient>& tablet,
+                                      int64_t timeout_ms, const std::shared_ptr<SQLRequestRow>& row,
+                                      hybridse::sdk::Status* status);
+
+ private:
+    static void* FlushAfterWindow(void* args);
+    // sends batch if it is still the pending one of key
+    void Flush(const std::string& key, const std::shared_ptr<ProcedureBatch>& batch);
+    void Send(const std::shared_ptr<ProcedureBatch>& batch);
+
+ private:
+    uint32_t window_us_;
+    uint32_t max_rows_;
+    bool is_debug_;
+    std::mutex mu_;
+    std::map<std::string, std::shared_ptr<ProcedureBatch>> batches_;
+};
+
+}  // namespace sdk
+}  // namespace fedb
+
+#endif  // SRC_SDK_PROCEDURE_BATCHER_H_
@@ -25,12 +25,18 @@ namespace sdk {
 ResultSetBase::ResultSetBase(const std::shared_ptr<brpc::Controller>& cntl, uint32_t count, uint32_t buf_size,
                              std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view,
                              const ::hybridse::vm::Schema& schema)
+    : ResultSetBase(cntl, count, 0, buf_size, std::move(row_view), schema) {}
+
+ResultSetBase::ResultSetBase(const std::shared_ptr<brpc::Controller>& cntl, uint32_t count, uint32_t buf_offset,
+                             uint32_t buf_size, std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view,
+                             const ::hybridse::vm::Schema& schema)
     : cntl_(cntl),
       count_(count),
+      buf_offset_(buf_offset),
       buf_size_(buf_size),
       row_view_(std::move(row_view)),
       schema_(),
-      position_(0),
+      position_(buf_offset),
       index_(-1) {
     schema_.SetSchema(schema);
 }
@@ -39,13 +45,13 @@ ResultSetBase::~ResultSetBase() {}
 
 bool ResultSetBase::Reset() {
     index_ = -1;
-    position_ = 0;
+    position_ = buf_offset_;
     return true;
 }
 
 bool ResultSetBase::Next() {
     index_++;
-    if (index_ < static_cast<int32_t>(count_) && position_ < buf_size_) {
+    if (index_ < static_cast<int32_t>(count_) && position_ < buf_offset_ + buf_size_) {
         // get row size
         uint32_t row_size = 0;
         cntl_->response_attachment().copy_to(reinterpret_cast<void*>(&row_size), 4, position_ + 2);
@@ -32,6 +32,12 @@ class ResultSetBase {
  public:
     ResultSetBase(const std::shared_ptr<brpc::Controller>& cntl, uint32_t count, uint32_t buf_size,
                   std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view, const ::hybridse::vm::Schema& schema);
+
+    // rows start at buf_offset of response attachment, used by batch scan
+    // which stores rows of many keys in one attachment
+    ResultSetBase(const std::shared_ptr<brpc::Controller>& cntl, uint32_t count, uint32_t buf_offset,
+                  uint32_t buf_size, std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view,
+                  const ::hybridse::vm::Schema& schema);
     ~ResultSetBase();
 
     bool Reset();
@@ -69,6 +75,7 @@ class ResultSetBase {
  private:
     std::shared_ptr<brpc::Controller> cntl_;
     uint32_t count_;
+    uint32_t buf_offset_;
     uint32_t buf_size_;
     std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view_;
     ::hybridse::sdk::SchemaImpl schema_;
@@ -32,14 +32,24 @@ namespace sdk {
 
 ResultSetSQL::ResultSetSQL(const ::hybridse::vm::Schema& schema, uint32_t record_cnt, uint32_t buf_size,
                            const std::shared_ptr<brpc::Controller>& cntl)
-    : schema_(schema), record_cnt_(record_cnt), buf_size_(buf_size), cntl_(cntl), result_set_base_(nullptr) {}
+    : ResultSetSQL(schema, record_cnt, 0, buf_size, cntl) {}
+
+ResultSetSQL::ResultSetSQL(const ::hybridse::vm::Schema& schema, uint32_t record_cnt, uint32_t buf_offset,
+                           uint32_t buf_size, const std::shared_ptr<brpc::Controller>& cntl)
+    : schema_(schema),
+      record_cnt_(record_cnt),
+      buf_offset_(buf_offset),
+      buf_size_(buf_size),
+      cntl_(cntl),
+      result_set_base_(nullptr),
+      profile_() {}
 
 ResultSetSQL::~ResultSetSQL() { delete result_set_base_; }
 
 bool ResultSetSQL::Init() {
     std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view(new ::hybridse::sdk::RowIOBufView(schema_));
     DLOG(INFO) << "init result set sql with record cnt " << record_cnt_ << " buf size " << buf_size_;
-    result_set_base_ = new ResultSetBase(cntl_, record_cnt_, buf_size_, std::move(row_view), schema_);
+    result_set_base_ = new ResultSetBase(cntl_, record_cnt_, buf_offset_, buf_size_, std::move(row_view), schema_);
     return true;
 }
 
@@ -64,6 +74,9 @@ std::shared_ptr<::hybridse::sdk::ResultSet> ResultSetSQL::MakeResultSet(
         status->msg = "request error, resuletSetSQL init failed";
         return std::shared_ptr<ResultSet>();
     }
+    if (response->has_profile()) {
+        rs->profile_.CopyFrom(response->profile());
+    }
     return rs;
 }
 
@@ -105,5 +118,42 @@ std::shared_ptr<::hybridse::sdk::ResultSet> ResultSetSQL::MakeResultSet(
     }
 }
 
+std::shared_ptr<::hybridse::sdk::ResultSet> ResultSetSQL::MakeResultSet(
+    const std::shared_ptr<::fedb::api::BatchScanResponse>& response, int key_idx,
+    const ::google::protobuf::RepeatedField<uint32_t>& projection, const std::shared_ptr<brpc::Controller>& cntl,
+    std::shared_ptr<::hybridse::vm::TableHandler> table_handler, ::hybridse::sdk::Status* status) {
+    if (!status || !response || !cntl) {
+        return std::shared_ptr<ResultSet>();
+    }
+    if (key_idx < 0 || key_idx >= response->buf_offsets_size() || key_idx >= response->counts_size()) {
+        status->code = -1;
+        status->msg = "key index out of range";
+        return std::shared_ptr<ResultSet>();
+    }
+    auto sdk_table_handler = dynamic_cast<::fedb::catalog::SDKTableHandler*>(table_handler.get());
+    ::hybridse::vm::Schema schema = *(sdk_table_handler->GetSchema());
+    if (projection.size() > 0) {
+        schema.Clear();
+        if (!::fedb::catalog::SchemaAdapter::SubSchema(sdk_table_handler->GetSchema(), projection, &schema)) {
+            status->code = -1;
+            status->msg = "fail to get sub schema";
+            return std::shared_ptr<ResultSet>();
+        }
+    }
+    uint32_t buf_offset = response->buf_offsets(key_idx);
+    uint32_t buf_end = response->buf_size();
+    if (key_idx + 1 < response->buf_offsets_size()) {
+        buf_end = response->buf_offsets(key_idx + 1);
+    }
+    std::shared_ptr<::fedb::sdk::ResultSetSQL> rs = std::make_shared<fedb::sdk::ResultSetSQL>(
+        schema, response->counts(key_idx), buf_offset, buf_end - buf_offset, cntl);
+    if (!rs->Init()) {
+        status->code = -1;
+        status->msg = "request error, resuletSetSQL init failed";
+        return std::shared_ptr<ResultSet>();
+    }
+    return rs;
+}
+
 }  // namespace sdk
 }  // namespace fedb
@@ -37,6 +37,9 @@ class ResultSetSQL : public ::hybridse::sdk::ResultSet {
     ResultSetSQL(const ::hybridse::vm::Schema& schema, uint32_t record_cnt, uint32_t buf_size,
                  const std::shared_ptr<brpc::Controller>& cntl);
 
+    ResultSetSQL(const ::hybridse::vm::Schema& schema, uint32_t record_cnt, uint32_t buf_offset, uint32_t buf_size,
+                 const std::shared_ptr<brpc::Controller>& cntl);
+
     ~ResultSetSQL();
 
     static std::shared_ptr<::hybridse::sdk::ResultSet> MakeResultSet(
@@ -48,6 +51,12 @@ class ResultSetSQL : public ::hybridse::sdk::ResultSet {
         const ::google::protobuf::RepeatedField<uint32_t>& projection, const std::shared_ptr<brpc::Controller>& cntl,
         std::shared_ptr<::hybridse::vm::TableHandler> table_handler, ::hybridse::sdk::Status* status);
 
+    // make the result set of the key_idx-th key from a batch scan response
+    static std::shared_ptr<::hybridse::sdk::ResultSet> MakeResultSet(
+        const std::shared_ptr<::fedb::api::BatchScanResponse>& response, int key_idx,
+        const ::google::protobuf::RepeatedField<uint32_t>& projection, const std::shared_ptr<brpc::Controller>& cntl,
+        std::shared_ptr<::hybridse::vm::TableHandler> table_handler, ::hybridse::sdk::Status* status);
+
     bool Init();
 
     bool Reset() { return result_set_base_->Reset(); }
@@ -84,12 +93,17 @@ class ResultSetSQL : public ::hybridse::sdk::ResultSet {
 
     int32_t Size() { return result_set_base_->Size(); }
 
+    // stages of the query, empty unless it is profiled
+    const ::fedb::api::QueryProfile& GetProfile() const { return profile_; }
+
  private:
     ::hybridse::vm::Schema schema_;
     uint32_t record_cnt_;
+    uint32_t buf_offset_;
     uint32_t buf_size_;
     std::shared_ptr<brpc::Controller> cntl_;
     ResultSetBase* result_set_base_;
+    ::fedb::api::QueryProfile profile_;
 };
 
 }  // namespace sdk
@@ -20,16 +20,19 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "brpc/channel.h"
 #include "glog/logging.h"
 #include "plan/plan_api.h"
 #include "proto/tablet.pb.h"
+#include "sdk/async_inserter_impl.h"
 #include "sdk/base.h"
 #include "sdk/base_impl.h"
 #include "sdk/result_set_sql.h"
 #include "sdk/batch_request_result_set_sql.h"
 #include "common/timer.h"
+#include "boost/algorithm/string.hpp"
 #include "boost/none.hpp"
 #include "rpc/rpc_client.h"
 
@@ -38,6 +41,58 @@ DECLARE_int32(request_timeout_ms);
 namespace fedb {
 namespace sdk {
 using hybridse::plan::PlanAPI;
+
+// create procedure takes a trailing OPTIONS (result_cache_bucket_ms = 1000)
+// after END. the sql parser does not know the clause, so it is cut off the
+// script before parsing
+static bool CutProcedureOptions(std::string* sql, uint32_t* result_cache_bucket_ms, std::string* msg) {
+    std::string lower = boost::algorithm::to_lower_copy(*sql);
+    std::vector<std::string> words;
+    boost::algorithm::split(words, boost::algorithm::trim_copy(lower), boost::algorithm::is_space(),
+                            boost::algorithm::token_compress_on);
+    if (words.size() < 2 || words[0] != "create" || words[1] != "procedure") {
+        return true;
+    }
+    size_t pos = lower.rfind("options");
+    if (pos == std::string::npos) {
+        return true;
+    }
+    // the clause only counts right after the END of the procedure body
+    auto space_or_semicolon = boost::algorithm::is_space() || boost::algorithm::is_any_of(";");
+    std::string head = boost::algorithm::trim_right_copy_if(lower.substr(0, pos), space_or_semicolon);
+    if (!boost::algorithm::ends_with(head, "end") ||
+        (head.size() > 3 && !space_or_semicolon(head[head.size() - 4]))) {
+        return true;
+    }
+    std::string tail = boost::algorithm::trim_copy_if(lower.substr(pos + 7), space_or_semicolon);
+    if (tail.size() < 2 || tail.front() != '(' || tail.back() != ')') {
+        *msg = "invalid procedure options";
+        return false;
+    }
+    std::vector<std::string> options;
+    boost::algorithm::split(options, tail.substr(1, tail.size() - 2), boost::algorithm::is_any_of(","));
+    for (const auto& option : options) {
+        std::vector<std::string> kv;
+        boost::algorithm::split(kv, option, boost::algorithm::is_any_of("="));
+        if (kv.size() != 2) {
+            *msg = "invalid procedure option " + option;
+            return false;
+        }
+        std::string key = boost::algorithm::trim_copy(kv[0]);
+        std::string value = boost::algorithm::trim_copy(kv[1]);
+        if (key != "result_cache_bucket_ms") {
+            *msg = "unknown procedure option " + key;
+            return false;
+        }
+        if (value.empty() || value.size() > 9 || !boost::algorithm::all(value, boost::algorithm::is_digit())) {
+            *msg = "invalid value of procedure option " + key;
+            return false;
+        }
+        *result_cache_bucket_ms = std::stoul(value);
+    }
+    *sql = boost::algorithm::trim_right_copy(sql->substr(0, pos));
+    return true;
+}
 class ExplainInfoImpl : public ExplainInfo {
  public:
     ExplainInfoImpl(const ::hybridse::sdk::SchemaImpl& input_schema,
@@ -179,14 +234,16 @@ SQLClusterRouter::SQLClusterRouter(const SQLRouterOptions& options)
       cluster_sdk_(NULL),
       input_lru_cache_(),
       mu_(),
-      rand_(::baidu::common::timer::now_time()) {}
+      rand_(::baidu::common::timer::now_time()),
+      procedure_batcher_() {}
 
 SQLClusterRouter::SQLClusterRouter(ClusterSDK* sdk)
     : options_(),
       cluster_sdk_(sdk),
       input_lru_cache_(),
       mu_(),
-      rand_(::baidu::common::timer::now_time()) {}
+      rand_(::baidu::common::timer::now_time()),
+      procedure_batcher_() {}
 
 SQLClusterRouter::~SQLClusterRouter() {
     delete cluster_sdk_;
@@ -198,6 +255,7 @@ bool SQLClusterRouter::Init() {
         coptions.zk_cluster = options_.zk_cluster;
         coptions.zk_path = options_.zk_path;
         coptions.session_timeout = options_.session_timeout;
+        coptions.connection_type = options_.connection_type;
         cluster_sdk_ = new ClusterSDK(coptions);
         bool ok = cluster_sdk_->Init();
         if (!ok) {
@@ -205,6 +263,10 @@ bool SQLClusterRouter::Init() {
             return false;
         }
     }
+    if (options_.procedure_batch_window_us > 0) {
+        procedure_batcher_ = std::make_shared<ProcedureBatcher>(
+            options_.procedure_batch_window_us, options_.procedure_batch_max_rows, options_.enable_debug);
+    }
     return true;
 }
 
@@ -586,9 +648,17 @@ bool SQLClusterRouter::ExecuteDDL(const std::string& db, const std::string& sql,
     // parse sql to judge whether is create procedure case
     hybridse::node::NodeManager node_manager;
     DLOG(INFO) << "start to execute script from dbms:\n" << sql;
+    std::string script = sql;
+    uint32_t result_cache_bucket_ms = 0;
+    if (!CutProcedureOptions(&script, &result_cache_bucket_ms, &err)) {
+        status->code = -1;
+        status->msg = err;
+        LOG(WARNING) << status->msg;
+        return false;
+    }
     hybridse::base::Status sql_status;
     hybridse::node::NodePointVector parser_trees;
-    PlanAPI::CreateSyntaxTreeFromScript(sql, parser_trees, &node_manager, sql_status);
+    PlanAPI::CreateSyntaxTreeFromScript(script, parser_trees, &node_manager, sql_status);
     if (parser_trees.empty() || sql_status.code != 0) {
         status->code = -1;
         status->msg = sql_status.msg;
@@ -597,7 +667,7 @@ bool SQLClusterRouter::ExecuteDDL(const std::string& db, const std::string& sql,
     }
     hybridse::node::SqlNode* node = parser_trees[0];
     if (node->GetType() == hybridse::node::kCreateSpStmt) {
-        ok = HandleSQLCreateProcedure(parser_trees, db, sql,
+        ok = HandleSQLCreateProcedure(parser_trees, db, script, result_cache_bucket_ms,
                 ns_ptr, &node_manager, &err);
     } else {
         ok = ns_ptr->ExecuteSQL(db, sql, err);
@@ -728,6 +798,11 @@ std::shared_ptr<TableReader> SQLClusterRouter::GetTableReader() {
     return reader;
 }
 
+std::shared_ptr<AsyncInserter> SQLClusterRouter::NewAsyncInserter(const AsyncInserterOptions& options) {
+    std::shared_ptr<AsyncInserterImpl> inserter(new AsyncInserterImpl(cluster_sdk_, options));
+    return inserter;
+}
+
 std::shared_ptr<fedb::client::TabletClient> SQLClusterRouter::GetTablet(
         const std::string& db, const std::string& sp_name, hybridse::sdk::Status* status) {
     if (status == nullptr) return nullptr;
@@ -803,7 +878,7 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQL(
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
     }
     if (!client->Query(db, sql, row->GetRow(), cntl.get(), response.get(),
-                             options_.enable_debug)) {
+                             options_.enable_debug, options_.enable_profile)) {
         status->msg = "request server error, msg: " + response->msg();
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
     }
@@ -820,6 +895,12 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQL(
 std::shared_ptr<::hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQL(
     const std::string& db, const std::string& sql,
     ::hybridse::sdk::Status* status) {
+    return ExecuteSQL(db, sql, options_.enable_profile, status);
+}
+
+std::shared_ptr<::hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQL(
+    const std::string& db, const std::string& sql, bool is_profile,
+    ::hybridse::sdk::Status* status) {
     auto cntl = std::make_shared<::brpc::Controller>();
     cntl->set_timeout_ms(options_.request_timeout);
     auto response = std::make_shared<::fedb::api::QueryResponse>();
@@ -830,7 +911,7 @@ std::shared_ptr<::hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQL(
     }
     DLOG(INFO) << " send query to tablet " << client->GetEndpoint();
     if (!client->Query(db, sql, cntl.get(), response.get(),
-                           options_.enable_debug)) {
+                           options_.enable_debug, is_profile)) {
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
     }
     auto rs = ResultSetSQL::MakeResultSet(response, cntl, status);
@@ -855,7 +936,7 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQLBatchReque
     }
     if (!client->SQLBatchRequestQuery(db, sql, row_batch, cntl.get(),
                                             response.get(),
-                                            options_.enable_debug)) {
+                                            options_.enable_debug, options_.enable_profile)) {
         status->code = -1;
         status->msg = "request server error " + response->msg();
         return nullptr;
@@ -937,16 +1018,18 @@ bool SQLClusterRouter::PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>&
                     DLOG(INFO) << "put data to endpoint " << client->GetEndpoint()
                                << " with dimensions size " << kv.second.size();
                     bool ret = false;
+                    uint64_t log_offset = 0;
                     if (ts_dimensions.empty()) {
-                        ret = client->Put(tid, pid, cur_ts, row->GetRow(), kv.second, 1);
+                        ret = client->Put(tid, pid, cur_ts, row->GetRow(), kv.second, 1, &log_offset);
                     } else {
-                        ret = client->Put(tid, pid, kv.second, row->GetTs(), row->GetRow(), 1);
+                        ret = client->Put(tid, pid, kv.second, row->GetTs(), row->GetRow(), 1, &log_offset);
                     }
                     if (!ret) {
                         status->msg = "fail to make a put request to table. tid " + std::to_string(tid);
                         LOG(WARNING) << status->msg;
                         return false;
                     }
+                    cluster_sdk_->UpdateWriteOffset(tid, pid, log_offset);
                     continue;
                 }
             }
@@ -1074,6 +1157,13 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::CallProcedure(
         LOG(WARNING) << "make sure the request row is built before execute sql";
         return nullptr;
     }
+    if (procedure_batcher_) {
+        auto future = CallProcedureInBatch(db, sp_name, options_.request_timeout, row, status);
+        if (!future) {
+            return nullptr;
+        }
+        return future->GetResultSet(status);
+    }
     auto tablet = GetTablet(db, sp_name, status);
     if (!tablet) {
         return nullptr;
@@ -1082,7 +1172,7 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::CallProcedure(
     auto cntl = std::make_shared<::brpc::Controller>();
     auto response = std::make_shared<::fedb::api::QueryResponse>();
     bool ok = tablet->CallProcedure(db, sp_name, row->GetRow(), cntl.get(), response.get(),
-                             options_.enable_debug, options_.request_timeout);
+                             options_.enable_debug, options_.request_timeout, options_.enable_profile);
     if (!ok) {
         status->code = -1;
         status->msg = "request server error" + response->msg();
@@ -1114,7 +1204,7 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::CallSQLBatchRequestP
     auto response = std::make_shared<::fedb::api::SQLBatchRequestQueryResponse>();
     bool ok = tablet->CallSQLBatchRequestProcedure(
             db, sp_name, row_batch, cntl.get(), response.get(),
-            options_.enable_debug, options_.request_timeout);
+            options_.enable_debug, options_.request_timeout, options_.enable_profile);
     if (!ok) {
         status->code = -1;
         status->msg = "request server error, msg: " + response->msg();
@@ -1151,7 +1241,7 @@ std::shared_ptr<hybridse::sdk::ProcedureInfo> SQLClusterRouter::ShowProcedure(
 }
 
 bool SQLClusterRouter::HandleSQLCreateProcedure(const hybridse::node::NodePointVector& parser_trees,
-        const std::string& db, const std::string& sql,
+        const std::string& db, const std::string& sql, uint32_t result_cache_bucket_ms,
         std::shared_ptr<::fedb::client::NsClient> ns_ptr,
         hybridse::node::NodeManager* node_manager, std::string* msg) {
     if (node_manager == nullptr || msg == nullptr) {
@@ -1183,6 +1273,7 @@ bool SQLClusterRouter::HandleSQLCreateProcedure(const hybridse::node::NodePointV
             sp_info.set_db_name(db);
             sp_info.set_sp_name(create_sp->GetSpName());
             sp_info.set_sql(sql);
+            sp_info.set_result_cache_bucket_ms(result_cache_bucket_ms);
             RtidbSchema* schema = sp_info.mutable_input_schema();
             for (auto input : create_sp->GetInputParameterList()) {
                 if (input == nullptr) {
@@ -1330,6 +1421,9 @@ std::shared_ptr<fedb::sdk::QueryFuture> SQLClusterRouter::CallProcedure(
         LOG(WARNING) << "make sure the request row is built before execute sql";
         return std::shared_ptr<fedb::sdk::QueryFuture>();
     }
+    if (procedure_batcher_) {
+        return CallProcedureInBatch(db, sp_name, timeout_ms, row, status);
+    }
     auto tablet = GetTablet(db, sp_name, status);
     if (!tablet) {
         return std::shared_ptr<fedb::sdk::QueryFuture>();
@@ -1354,6 +1448,27 @@ std::shared_ptr<fedb::sdk::QueryFuture> SQLClusterRouter::CallProcedure(
     return future;
 }
 
+std::shared_ptr<fedb::sdk::QueryFuture> SQLClusterRouter::CallProcedureInBatch(
+    const std::string& db, const std::string& sp_name, int64_t timeout_ms,
+    std::shared_ptr<SQLRequestRow> row, hybridse::sdk::Status* status) {
+    std::shared_ptr<hybridse::sdk::ProcedureInfo> sp_info =
+        cluster_sdk_->GetProcedureInfo(db, sp_name, &status->msg);
+    if (!sp_info) {
+        status->code = -1;
+        status->msg = "procedure not found, msg: " + status->msg;
+        LOG(WARNING) << status->msg;
+        return std::shared_ptr<fedb::sdk::QueryFuture>();
+    }
+    auto tablet = cluster_sdk_->GetTablet(db, sp_info->GetMainTable());
+    if (!tablet || !tablet->GetClient()) {
+        status->code = -1;
+        status->msg = "fail to get tablet, table " + sp_info->GetMainTable();
+        LOG(WARNING) << status->msg;
+        return std::shared_ptr<fedb::sdk::QueryFuture>();
+    }
+    return procedure_batcher_->Call(sp_info, tablet->GetClient(), timeout_ms, row, status);
+}
+
 std::shared_ptr<fedb::sdk::QueryFuture> SQLClusterRouter::CallSQLBatchRequestProcedure(
         const std::string& db, const std::string& sp_name, int64_t timeout_ms,
         std::shared_ptr<SQLRequestRowBatch> row_batch, hybridse::sdk::Status* status) {
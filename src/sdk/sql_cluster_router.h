@@ -30,6 +30,7 @@
 #include "catalog/schema_adapter.h"
 #include "client/tablet_client.h"
 #include "sdk/cluster_sdk.h"
+#include "sdk/procedure_batcher.h"
 #include "sdk/sql_router.h"
 #include "boost/compute/detail/lru_cache.hpp"
 #include "sdk/table_reader_impl.h"
@@ -108,6 +109,9 @@ class SQLClusterRouter : public SQLRouter {
                        hybridse::sdk::Status* status) override;
 
     std::shared_ptr<TableReader> GetTableReader();
+
+    std::shared_ptr<AsyncInserter> NewAsyncInserter(const AsyncInserterOptions& options) override;
+
     std::shared_ptr<ExplainInfo> Explain(const std::string& db,
                                          const std::string& sql,
                                          ::hybridse::sdk::Status* status) override;
@@ -136,6 +140,10 @@ class SQLClusterRouter : public SQLRouter {
         const std::string& db, const std::string& sql,
         ::hybridse::sdk::Status* status) override;
 
+    std::shared_ptr<hybridse::sdk::ResultSet> ExecuteSQL(
+        const std::string& db, const std::string& sql, bool is_profile,
+        ::hybridse::sdk::Status* status);
+
     std::shared_ptr<hybridse::sdk::ResultSet> ExecuteSQLBatchRequest(
         const std::string& db, const std::string& sql,
         std::shared_ptr<SQLRequestRowBatch> row_batch,
@@ -203,7 +211,7 @@ class SQLClusterRouter : public SQLRouter {
         ::hybridse::node::ExprListNode* row, uint32_t* str_length);
 
     bool HandleSQLCreateProcedure(const hybridse::node::NodePointVector& parser_trees,
-            const std::string& db, const std::string& sql,
+            const std::string& db, const std::string& sql, uint32_t result_cache_bucket_ms,
             std::shared_ptr<::fedb::client::NsClient> ns_ptr,
             hybridse::node::NodeManager* node_manager, std::string* msg);
 
@@ -212,6 +220,10 @@ class SQLClusterRouter : public SQLRouter {
     std::shared_ptr<fedb::client::TabletClient> GetTablet(
             const std::string& db, const std::string& sp_name, hybridse::sdk::Status* status);
 
+    std::shared_ptr<fedb::sdk::QueryFuture> CallProcedureInBatch(
+            const std::string& db, const std::string& sp_name, int64_t timeout_ms,
+            std::shared_ptr<SQLRequestRow> row, hybridse::sdk::Status* status);
+
  private:
     SQLRouterOptions options_;
     ClusterSDK* cluster_sdk_;
@@ -219,6 +231,7 @@ class SQLClusterRouter : public SQLRouter {
         input_lru_cache_;
     ::fedb::base::SpinMutex mu_;
     ::fedb::base::Random rand_;
+    std::shared_ptr<ProcedureBatcher> procedure_batcher_;
 };
 
 }  // namespace sdk
@@ -105,6 +105,53 @@ TEST_F(SQLClusterTest, cluster_insert) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(SQLClusterTest, cluster_async_insert) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    std::string name = "test" + GenRand();
+    std::string db = "db" + GenRand();
+    ::hybridse::sdk::Status status;
+    ASSERT_TRUE(router->CreateDB(db, &status));
+    std::string ddl = "create table " + name +
+                      "("
+                      "col1 string, col2 bigint,"
+                      "index(key=col1, ts=col2)) partitionnum=8;";
+    ASSERT_TRUE(router->ExecuteDDL(db, ddl, &status));
+    ASSERT_TRUE(router->RefreshCatalog());
+    AsyncInserterOptions options;
+    options.max_buffered_rows = 20;
+    options.flush_rows = 4;
+    auto inserter = router->NewAsyncInserter(options);
+    ASSERT_TRUE(inserter != nullptr);
+    std::string insert = "insert into " + name + " values(?, ?);";
+    std::vector<std::shared_ptr<InsertFuture>> futures;
+    for (int i = 0; i < 100; i++) {
+        auto row = router->GetInsertRow(db, insert, &status);
+        ASSERT_TRUE(row != nullptr);
+        std::string key = "hello" + std::to_string(i);
+        ASSERT_TRUE(row->Init(key.size()));
+        ASSERT_TRUE(row->AppendString(key));
+        ASSERT_TRUE(row->AppendInt64(1590 + i));
+        auto future = inserter->Insert(row, &status);
+        ASSERT_TRUE(future != nullptr) << status.msg;
+        futures.push_back(future);
+    }
+    ASSERT_TRUE(inserter->Flush(&status));
+    for (const auto& future : futures) {
+        ASSERT_TRUE(future->IsDone());
+        ASSERT_TRUE(future->Get(&status));
+    }
+    auto rs = router->ExecuteSQL(db, "select * from " + name + ";", &status);
+    ASSERT_TRUE(rs != nullptr);
+    ASSERT_EQ(100, rs->Size());
+    inserter.reset();
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop table " + name + ";", &status));
+    ASSERT_TRUE(router->DropDB(db, &status));
+}
+
 TEST_F(SQLSDKQueryTest, GetTabletClient) {
     std::string ddl =
         "create table t1(col0 string,\n"
@@ -84,6 +84,7 @@ class SQLInsertRow {
     const std::map<uint32_t, std::vector<std::pair<std::string, uint32_t>>>& GetDimensions();
     inline const std::vector<uint64_t>& GetTs() { return ts_; }
     inline const std::string& GetRow() { return val_; }
+    inline const std::shared_ptr<::fedb::nameserver::TableInfo>& GetTableInfo() const { return table_info_; }
     inline const std::shared_ptr<hybridse::sdk::Schema> GetSchema() {
         return schema_;
     }
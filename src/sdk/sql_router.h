@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 
+#include "sdk/async_inserter.h"
 #include "sdk/base.h"
 #include "sdk/result_set.h"
 #include "sdk/sql_insert_row.h"
@@ -35,9 +36,19 @@ struct SQLRouterOptions {
     std::string zk_cluster;
     std::string zk_path;
     bool enable_debug = false;
+    // return the time spent in each query stage with the result
+    bool enable_profile = false;
     uint32_t session_timeout = 2000;
     uint32_t max_sql_cache_size = 10;
     uint32_t request_timeout = 60000;
+    // the connections to each tablet, single, pooled or short. pooled avoids
+    // one slow response holding up the others under heavy fan out
+    std::string connection_type = "single";
+    // concurrent request mode CallProcedure calls of one procedure within
+    // this window are sent as one batch request, 0 disables it
+    uint32_t procedure_batch_window_us = 0;
+    // a batch is sent at once when it has this many rows
+    uint32_t procedure_batch_max_rows = 64;
 };
 
 class ExplainInfo {
@@ -89,6 +100,8 @@ class SQLRouter {
 
     virtual std::shared_ptr<fedb::sdk::TableReader> GetTableReader() = 0;
 
+    virtual std::shared_ptr<fedb::sdk::AsyncInserter> NewAsyncInserter(const AsyncInserterOptions& options) = 0;
+
     virtual std::shared_ptr<ExplainInfo> Explain(
         const std::string& db, const std::string& sql,
         ::hybridse::sdk::Status* status) = 0;
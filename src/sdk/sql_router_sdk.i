@@ -38,6 +38,8 @@
 %shared_ptr(hybridse::sdk::ProcedureInfo);
 %shared_ptr(fedb::sdk::QueryFuture);
 %shared_ptr(fedb::sdk::TableReader);
+%shared_ptr(fedb::sdk::AsyncInserter);
+%shared_ptr(fedb::sdk::InsertFuture);
 %template(VectorUint32) std::vector<uint32_t>;
 %template(VectorString) std::vector<std::string>;
 
@@ -48,6 +50,7 @@
 #include "sdk/sql_request_row.h"
 #include "sdk/sql_insert_row.h"
 #include "sdk/table_reader.h"
+#include "sdk/async_inserter.h"
 
 using hybridse::sdk::Schema;
 using hybridse::sdk::ResultSet;
@@ -62,6 +65,9 @@ using fedb::sdk::ExplainInfo;
 using hybridse::sdk::ProcedureInfo;
 using fedb::sdk::QueryFuture;
 using fedb::sdk::TableReader;
+using fedb::sdk::AsyncInserter;
+using fedb::sdk::AsyncInserterOptions;
+using fedb::sdk::InsertFuture;
 %}
 
 %include "sdk/sql_router.h"
@@ -70,3 +76,4 @@ using fedb::sdk::TableReader;
 %include "sdk/sql_request_row.h"
 %include "sdk/sql_insert_row.h"
 %include "sdk/table_reader.h"
+%include "sdk/async_inserter.h"
@@ -479,6 +479,107 @@ TEST_F(SQLSDKQueryTest, request_procedure_test) {
     ASSERT_TRUE(router->ExecuteDDL(db, "drop table trans;", &status));
 }
 
+TEST_F(SQLSDKQueryTest, request_procedure_batch_test) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    sql_opt.procedure_batch_window_us = 1000;
+    sql_opt.procedure_batch_max_rows = 4;
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    std::string db = GenRand("db");
+    hybridse::sdk::Status status;
+    ASSERT_TRUE(router->CreateDB(db, &status));
+    std::string ddl = "create table trans(c1 string, c3 int, c4 bigint, c7 timestamp, index(key=c1, ts=c7));";
+    ASSERT_TRUE(router->ExecuteDDL(db, ddl, &status));
+    ASSERT_TRUE(router->RefreshCatalog());
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into trans values(\"bb\",24,34,1590738994000);", &status));
+    std::string sp_name = "sp_batch";
+    std::string sql =
+        "SELECT c1, c3, sum(c4) OVER w1 as w1_c4_sum FROM trans WINDOW w1 AS"
+        " (PARTITION BY trans.c1 ORDER BY trans.c7 ROWS BETWEEN 2 PRECEDING AND CURRENT ROW);";
+    std::string sp_ddl = "create procedure " + sp_name + " (const c1 string, c3 int, c4 bigint, c7 timestamp)" +
+                         " begin " + sql + " end;";
+    ASSERT_TRUE(router->ExecuteDDL(db, sp_ddl, &status));
+    ASSERT_TRUE(router->RefreshCatalog());
+    // rows with different constant columns go in different batches
+    std::vector<std::shared_ptr<QueryFuture>> futures;
+    for (int i = 0; i < 10; i++) {
+        auto request_row = router->GetRequestRowByProcedure(db, sp_name, &status);
+        ASSERT_TRUE(request_row);
+        request_row->Init(2);
+        ASSERT_TRUE(request_row->AppendString(i % 2 == 0 ? "bb" : "cc"));
+        ASSERT_TRUE(request_row->AppendInt32(i));
+        ASSERT_TRUE(request_row->AppendInt64(i));
+        ASSERT_TRUE(request_row->AppendTimestamp(1590738994000));
+        ASSERT_TRUE(request_row->Build());
+        auto future = router->CallProcedure(db, sp_name, 1000, request_row, &status);
+        ASSERT_TRUE(future) << status.msg;
+        futures.push_back(future);
+    }
+    for (int i = 0; i < 10; i++) {
+        auto rs = futures[i]->GetResultSet(&status);
+        ASSERT_TRUE(rs) << status.msg;
+        ASSERT_TRUE(futures[i]->IsDone());
+        ASSERT_EQ(1, rs->Size());
+        ASSERT_TRUE(rs->Next());
+        ASSERT_EQ(i % 2 == 0 ? "bb" : "cc", rs->GetStringUnsafe(0));
+        ASSERT_EQ(i, rs->GetInt32Unsafe(1));
+        ASSERT_EQ(i % 2 == 0 ? 34 + i : i, rs->GetInt64Unsafe(2));
+        ASSERT_FALSE(rs->Next());
+    }
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop procedure " + sp_name + ";", &status));
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop table trans;", &status));
+    ASSERT_TRUE(router->DropDB(db, &status));
+}
+
+TEST_F(SQLSDKQueryTest, request_procedure_result_cache_test) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    std::string db = GenRand("db");
+    hybridse::sdk::Status status;
+    ASSERT_TRUE(router->CreateDB(db, &status));
+    std::string ddl = "create table trans(c1 string, c3 int, c4 bigint, c7 timestamp, index(key=c1, ts=c7));";
+    ASSERT_TRUE(router->ExecuteDDL(db, ddl, &status));
+    ASSERT_TRUE(router->RefreshCatalog());
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into trans values(\"bb\",24,34,1590738994000);", &status));
+    std::string sp_name = "sp_cache";
+    std::string sql =
+        "SELECT c1, c3, sum(c4) OVER w1 as w1_c4_sum FROM trans WINDOW w1 AS"
+        " (PARTITION BY trans.c1 ORDER BY trans.c7 ROWS BETWEEN 2 PRECEDING AND CURRENT ROW);";
+    std::string sp_ddl = "create procedure " + sp_name + " (c1 string, c3 int, c4 bigint, c7 timestamp)" +
+                         " begin " + sql + " end;";
+    ASSERT_FALSE(router->ExecuteDDL(db, sp_ddl + " options (unknown_option = 1);", &status));
+    ASSERT_TRUE(router->ExecuteDDL(db, sp_ddl + " options (result_cache_bucket_ms = 60000);", &status))
+        << status.msg;
+    ASSERT_TRUE(router->RefreshCatalog());
+    auto call = [&](int64_t expect) {
+        auto request_row = router->GetRequestRowByProcedure(db, sp_name, &status);
+        ASSERT_TRUE(request_row);
+        request_row->Init(2);
+        ASSERT_TRUE(request_row->AppendString("bb"));
+        ASSERT_TRUE(request_row->AppendInt32(1));
+        ASSERT_TRUE(request_row->AppendInt64(1));
+        ASSERT_TRUE(request_row->AppendTimestamp(1590738995000));
+        ASSERT_TRUE(request_row->Build());
+        auto rs = router->CallProcedure(db, sp_name, request_row, &status);
+        ASSERT_TRUE(rs) << status.msg;
+        ASSERT_TRUE(rs->Next());
+        ASSERT_EQ(expect, rs->GetInt64Unsafe(2));
+    };
+    call(35);
+    call(35);
+    // a put on the key drops the cached result
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into trans values(\"bb\",24,10,1590738994500);", &status));
+    call(45);
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop procedure " + sp_name + ";", &status));
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop table trans;", &status));
+    ASSERT_TRUE(router->DropDB(db, &status));
+}
+
 TEST_F(SQLSDKTest, table_reader_scan) {
     SQLRouterOptions sql_opt;
     sql_opt.zk_cluster = mc_->GetZkCluster();
@@ -33,6 +33,17 @@ struct ScanOption {
     uint32_t limit = 0;
     uint32_t at_least = 0;
     std::vector<std::string> projection;
+    // read from any replica which has applied the writes of this client
+    bool read_follower = false;
+    // the staleness bound of follower reads besides the writes of this client
+    uint64_t min_log_offset = 0;
+    // send the scan to a second replica too if the first one has not answered
+    // within its recent p95 latency. the second one may be a follower, so the
+    // staleness is bounded as with read_follower
+    bool hedge = false;
+    // the deadline of the whole scan including the fallback to the leader,
+    // 0 means the default timeout of the channel
+    int64_t timeout_ms = 0;
 };
 
 class ScanFuture {
@@ -58,6 +69,14 @@ class TableReader {
                                                               const std::string& key, int64_t st, int64_t et,
                                                               const ScanOption& so, int64_t timeout_ms,
                                                               hybridse::sdk::Status* status) = 0;
+
+    // scan many keys of one index, the result sets are in the same order as keys.
+    // a key not found has a null result set. a key that fails otherwise has a
+    // null result set too and its code goes to status, kReacheTheScanMaxBytesSize
+    // means the keys did not fit the byte budget of a tablet and can be scanned again
+    virtual std::vector<std::shared_ptr<hybridse::sdk::ResultSet>> BatchScan(
+        const std::string& db, const std::string& table, const std::vector<std::string>& keys, int64_t st,
+        int64_t et, const ScanOption& so, int64_t timeout_ms, hybridse::sdk::Status* status) = 0;
 };
 
 }  // namespace sdk
@@ -17,12 +17,16 @@
 
 #include "sdk/table_reader_impl.h"
 
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "base/hash.h"
 #include "brpc/channel.h"
 #include "client/tablet_client.h"
+#include "common/timer.h"
 #include "proto/tablet.pb.h"
 #include "sdk/result_set_sql.h"
 
@@ -88,6 +92,20 @@ class ScanFutureImpl : public ScanFuture {
 
 TableReaderImpl::TableReaderImpl(ClusterSDK* cluster_sdk) : cluster_sdk_(cluster_sdk) {}
 
+std::shared_ptr<::fedb::catalog::TabletAccessor> TableReaderImpl::GetReadTablet(
+    ::fedb::catalog::SDKTableHandler* table_handler, uint32_t pid, const ScanOption& so, uint64_t* min_log_offset) {
+    *min_log_offset = 0;
+    if (!so.read_follower && !so.hedge) {
+        return table_handler->GetTablet(pid);
+    }
+    // the leader ignores the offset, so a hedged read can carry it to any replica
+    *min_log_offset = std::max(so.min_log_offset, cluster_sdk_->GetWriteOffset(table_handler->GetTid(), pid));
+    if (!so.read_follower) {
+        return table_handler->GetTablet(pid);
+    }
+    return table_handler->GetReadTablet(pid);
+}
+
 std::shared_ptr<fedb::sdk::ScanFuture> TableReaderImpl::AsyncScan(const std::string& db, const std::string& table,
                                                                    const std::string& key, int64_t st, int64_t et,
                                                                    const ScanOption& so, int64_t timeout_ms,
@@ -152,6 +170,7 @@ std::shared_ptr<fedb::sdk::ScanFuture> TableReaderImpl::AsyncScan(const std::str
 std::shared_ptr<hybridse::sdk::ResultSet> TableReaderImpl::Scan(const std::string& db, const std::string& table,
                                                              const std::string& key, int64_t st, int64_t et,
                                                              const ScanOption& so, ::hybridse::sdk::Status* status) {
+    uint64_t start_time = ::baidu::common::timer::get_micros();
     auto table_handler = cluster_sdk_->GetCatalog()->GetTable(db, table);
     if (!table_handler) {
         LOG(WARNING) << "fail to get table " << table << "desc from catalog";
@@ -164,7 +183,8 @@ std::shared_ptr<hybridse::sdk::ResultSet> TableReaderImpl::Scan(const std::strin
     if (pid_num > 0) {
         pid = ::fedb::base::hash64(key) % pid_num;
     }
-    auto accessor = sdk_table_handler->GetTablet(pid);
+    uint64_t min_log_offset = 0;
+    auto accessor = GetReadTablet(sdk_table_handler, pid, so, &min_log_offset);
     if (!accessor) {
         LOG(WARNING) << "fail to get tablet for db " << db << " table " << table;
         return std::shared_ptr<hybridse::sdk::ResultSet>();
@@ -177,6 +197,7 @@ std::shared_ptr<hybridse::sdk::ResultSet> TableReaderImpl::Scan(const std::strin
     request.set_st(st);
     request.set_et(et);
     request.set_use_attachment(true);
+    request.set_min_log_offset(min_log_offset);
     for (size_t i = 0; i < so.projection.size(); i++) {
         const std::string& col = so.projection.at(i);
         int32_t col_idx = sdk_table_handler->GetColumnIndex(col);
@@ -200,7 +221,46 @@ std::shared_ptr<hybridse::sdk::ResultSet> TableReaderImpl::Scan(const std::strin
     }
     auto response = std::make_shared<::fedb::api::ScanResponse>();
     auto cntl = std::make_shared<::brpc::Controller>();
-    client->Scan(request, cntl.get(), response.get());
+    if (so.timeout_ms > 0) {
+        cntl->set_timeout_ms(so.timeout_ms);
+    }
+    std::shared_ptr<::fedb::catalog::TabletAccessor> hedge;
+    if (so.hedge) {
+        hedge = sdk_table_handler->GetOtherTablet(pid, accessor);
+    }
+    if (hedge && hedge->GetClient()) {
+        auto hedge_response = std::make_shared<::fedb::api::ScanResponse>();
+        auto hedge_cntl = std::make_shared<::brpc::Controller>();
+        brpc::Controller* cntls[2] = {cntl.get(), hedge_cntl.get()};
+        ::fedb::api::ScanResponse* responses[2] = {response.get(), hedge_response.get()};
+        if (client->HedgedScan(hedge->GetClient(), request, cntls, responses) == 1) {
+            accessor = hedge;
+            cntl = hedge_cntl;
+            response = hedge_response;
+        }
+    } else {
+        client->Scan(request, cntl.get(), response.get());
+    }
+    auto leader = sdk_table_handler->GetTablet(pid);
+    if ((so.read_follower || so.hedge) && leader && leader != accessor &&
+        (cntl->Failed() || response->code() == ::fedb::base::kReplicaOffsetBehind)) {
+        // the follower has not caught up, fall back to the leader in the time left
+        int64_t left_ms = so.timeout_ms - static_cast<int64_t>(::baidu::common::timer::get_micros() - start_time) / 1000;
+        if (so.timeout_ms <= 0 || left_ms > 0) {
+            response->Clear();
+            cntl->Reset();
+            if (so.timeout_ms > 0) {
+                cntl->set_timeout_ms(left_ms);
+            }
+            request.clear_min_log_offset();
+            leader->GetClient()->Scan(request, cntl.get(), response.get());
+        }
+    }
+    if (cntl->Failed()) {
+        status->code = hybridse::common::kRpcError;
+        status->msg = "request error, " + cntl->ErrorText();
+        return std::shared_ptr<hybridse::sdk::ResultSet>();
+    }
     if (response->code() != 0) {
         status->code = response->code();
         status->msg = response->msg();
@@ -210,5 +270,141 @@ std::shared_ptr<hybridse::sdk::ResultSet> TableReaderImpl::Scan(const std::strin
     return rs;
 }
 
+std::vector<std::shared_ptr<hybridse::sdk::ResultSet>> TableReaderImpl::BatchScan(
+    const std::string& db, const std::string& table, const std::vector<std::string>& keys, int64_t st, int64_t et,
+    const ScanOption& so, int64_t timeout_ms, ::hybridse::sdk::Status* status) {
+    std::vector<std::shared_ptr<hybridse::sdk::ResultSet>> result_sets(keys.size());
+    if (status == nullptr) {
+        return result_sets;
+    }
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    auto table_handler = cluster_sdk_->GetCatalog()->GetTable(db, table);
+    if (!table_handler) {
+        LOG(WARNING) << "fail to get table " << table << "desc from catalog";
+        status->code = -1;
+        status->msg = "fail to get table " + table;
+        return result_sets;
+    }
+    auto sdk_table_handler = dynamic_cast<::fedb::catalog::SDKTableHandler*>(table_handler.get());
+    uint32_t pid_num = sdk_table_handler->GetPartitionNum();
+    // split keys by partition, pid -> position of key in keys
+    std::map<uint32_t, std::vector<uint32_t>> pid_keys;
+    for (uint32_t idx = 0; idx < keys.size(); idx++) {
+        uint32_t pid = 0;
+        if (pid_num > 0) {
+            pid = ::fedb::base::hash64(keys[idx]) % pid_num;
+        }
+        pid_keys[pid].push_back(idx);
+    }
+    ::fedb::api::BatchScanRequest request;
+    request.set_tid(sdk_table_handler->GetTid());
+    request.set_st(st);
+    request.set_et(et);
+    for (size_t i = 0; i < so.projection.size(); i++) {
+        const std::string& col = so.projection.at(i);
+        int32_t col_idx = sdk_table_handler->GetColumnIndex(col);
+        if (col_idx < 0) {
+            LOG(WARNING) << "fail to get col " << col << " from table " << table;
+            status->code = -1;
+            status->msg = "fail to get col " + col;
+            return result_sets;
+        }
+        request.add_projection(static_cast<uint32_t>(col_idx));
+    }
+    if (so.limit > 0) {
+        request.set_limit(so.limit);
+    }
+    if (!so.ts_name.empty()) {
+        request.set_ts_name(so.ts_name);
+    }
+    if (!so.idx_name.empty()) {
+        request.set_idx_name(so.idx_name);
+    }
+    if (so.at_least > 0) {
+        request.set_atleast(so.at_least);
+    }
+    // fan out all partitions before waiting for any of them
+    std::vector<std::pair<uint32_t, fedb::RpcCallback<fedb::api::BatchScanResponse>*>> callbacks;
+    std::map<uint32_t, bool> read_follower;
+    for (const auto& kv : pid_keys) {
+        uint64_t min_log_offset = 0;
+        auto accessor = GetReadTablet(sdk_table_handler, kv.first, so, &min_log_offset);
+        if (!accessor || !accessor->GetClient()) {
+            LOG(WARNING) << "fail to get tablet for db " << db << " table " << table << " pid " << kv.first;
+            status->code = -1;
+            status->msg = "fail to get tablet of pid " + std::to_string(kv.first);
+            break;
+        }
+        request.set_pid(kv.first);
+        request.set_min_log_offset(min_log_offset);
+        read_follower[kv.first] = accessor != sdk_table_handler->GetTablet(kv.first);
+        request.clear_keys();
+        for (uint32_t idx : kv.second) {
+            request.add_keys(keys[idx]);
+        }
+        auto response = std::make_shared<fedb::api::BatchScanResponse>();
+        auto cntl = std::make_shared<brpc::Controller>();
+        cntl->set_timeout_ms(timeout_ms);
+        auto callback = new fedb::RpcCallback<fedb::api::BatchScanResponse>(response, cntl);
+        callback->Ref();
+        if (!accessor->GetClient()->AsyncBatchScan(request, callback)) {
+            callback->UnRef();
+            callback->UnRef();
+            status->code = hybridse::common::kRpcError;
+            status->msg = "fail to send batch scan request";
+            break;
+        }
+        callbacks.emplace_back(kv.first, callback);
+    }
+    for (const auto& pid_callback : callbacks) {
+        auto callback = pid_callback.second;
+        brpc::Join(callback->GetController()->call_id());
+        std::shared_ptr<fedb::api::BatchScanResponse> response = callback->GetResponse();
+        std::shared_ptr<brpc::Controller> cntl = callback->GetController();
+        auto leader = sdk_table_handler->GetTablet(pid_callback.first);
+        int64_t left_ms = timeout_ms - static_cast<int64_t>(::baidu::common::timer::get_micros() - start_time) / 1000;
+        if (read_follower[pid_callback.first] && leader && leader->GetClient() && (timeout_ms <= 0 || left_ms > 0) &&
+            (cntl->Failed() || response->code() == ::fedb::base::kReplicaOffsetBehind)) {
+            // the follower has not caught up, fall back to the leader in the time left
+            request.set_pid(pid_callback.first);
+            request.clear_min_log_offset();
+            request.clear_keys();
+            for (uint32_t idx : pid_keys[pid_callback.first]) {
+                request.add_keys(keys[idx]);
+            }
+            response = std::make_shared<fedb::api::BatchScanResponse>();
+            cntl = std::make_shared<brpc::Controller>();
+            if (timeout_ms > 0) {
+                cntl->set_timeout_ms(left_ms);
+            }
+            leader->GetClient()->BatchScan(request, cntl.get(), response.get());
+        }
+        if (cntl->Failed()) {
+            status->code = hybridse::common::kRpcError;
+            status->msg = "request error, " + cntl->ErrorText();
+        } else if (response->code() != ::fedb::base::kOk) {
+            status->code = response->code();
+            status->msg = "request error, " + response->msg();
+        } else {
+            const auto& key_pos = pid_keys[pid_callback.first];
+            for (uint32_t i = 0; i < key_pos.size() && static_cast<int>(i) < response->key_codes_size(); i++) {
+                int32_t key_code = response->key_codes(i);
+                if (key_code == ::fedb::base::kKeyNotFound) {
+                    continue;
+                }
+                if (key_code != ::fedb::base::kOk) {
+                    status->code = key_code;
+                    status->msg = "fail to scan key " + keys[key_pos[i]] + " with code " + std::to_string(key_code);
+                    continue;
+                }
+                result_sets[key_pos[i]] = ResultSetSQL::MakeResultSet(response, i, request.projection(), cntl,
+                                                                      table_handler, status);
+            }
+        }
+        callback->UnRef();
+    }
+    return result_sets;
+}
+
 }  // namespace sdk
 }  // namespace fedb
@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "sdk/cluster_sdk.h"
 #include "sdk/table_reader.h"
@@ -42,6 +43,18 @@ class TableReaderImpl : public TableReader {
                                                       const ScanOption& so, int64_t timeout_ms,
                                                       ::hybridse::sdk::Status* status);
 
+    std::vector<std::shared_ptr<hybridse::sdk::ResultSet>> BatchScan(const std::string& db, const std::string& table,
+                                                                     const std::vector<std::string>& keys,
+                                                                     int64_t st, int64_t et, const ScanOption& so,
+                                                                     int64_t timeout_ms,
+                                                                     ::hybridse::sdk::Status* status);
+
+ private:
+    // pick the replica to read pid from and the log offset it must reach
+    std::shared_ptr<::fedb::catalog::TabletAccessor> GetReadTablet(::fedb::catalog::SDKTableHandler* table_handler,
+                                                                   uint32_t pid, const ScanOption& so,
+                                                                   uint64_t* min_log_offset);
+
  private:
     ClusterSDK* cluster_sdk_;
 };
@@ -0,0 +1,272 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/index_backfill.h"
+
+#include <snappy.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "base/glog_wapper.h"
+#include "base/hash.h"
+#include "codec/row_codec.h"
+#include "storage/ticket.h"
+
+namespace fedb {
+namespace storage {
+
+IndexBackfill::IndexBackfill(std::shared_ptr<MemTable> table, const ::fedb::common::ColumnKey& column_key,
+                             uint32_t idx, uint32_t partition_num)
+    : table_(table),
+      column_key_(column_key),
+      idx_(idx),
+      pid_(table->GetPid()),
+      partition_num_(partition_num),
+      index_cols_(),
+      new_cols_(),
+      ts_cols_(),
+      scan_index_(),
+      max_col_(0) {}
+
+bool IndexBackfill::Init() {
+    ::fedb::api::TableMeta table_meta(table_->GetTableMeta());
+    if (table_meta.format_version() != 1) {
+        PDLOG(WARNING, "format version %u is not supported. tid %u pid %u", table_meta.format_version(),
+              table_->GetId(), pid_);
+        return false;
+    }
+    std::map<std::string, uint32_t> col_map;
+    for (const auto& col : table_meta.column_desc()) {
+        col_map.emplace(col.name(), col_map.size());
+    }
+    for (const auto& col : table_meta.added_column_desc()) {
+        col_map.emplace(col.name(), col_map.size());
+    }
+    auto get_cols = [&](const ::fedb::common::ColumnKey& ck, std::vector<uint32_t>* cols) {
+        for (const auto& name : ck.col_name()) {
+            auto it = col_map.find(name);
+            if (it == col_map.end()) {
+                PDLOG(WARNING, "fail to find column %s. tid %u pid %u", name.c_str(), table_->GetId(), pid_);
+                return false;
+            }
+            cols->push_back(it->second);
+            max_col_ = std::max(max_col_, it->second);
+        }
+        return !cols->empty();
+    };
+    for (int i = 0; i < table_meta.column_key_size(); i++) {
+        const auto& ck = table_meta.column_key(i);
+        if (ck.flag() || static_cast<uint32_t>(i) == idx_) {
+            continue;
+        }
+        KeyColumns key_cols;
+        key_cols.idx = i;
+        if (!get_cols(ck, &key_cols.cols)) {
+            return false;
+        }
+        index_cols_.push_back(key_cols);
+        auto index_def = table_->GetIndex(i);
+        if (index_def && index_def->IsReady()) {
+            scan_index_.push_back(i);
+        }
+    }
+    if (index_cols_.empty() || !get_cols(column_key_, &new_cols_)) {
+        PDLOG(WARNING, "invalid index %s. tid %u pid %u", column_key_.index_name().c_str(), table_->GetId(), pid_);
+        return false;
+    }
+    const auto& ts_mapping = table_->GetTSMapping();
+    for (const auto& ts_name : column_key_.ts_name()) {
+        auto ts_it = ts_mapping.find(ts_name);
+        auto col_it = col_map.find(ts_name);
+        if (ts_it == ts_mapping.end() || col_it == col_map.end()) {
+            PDLOG(WARNING, "fail to find ts column %s. tid %u pid %u", ts_name.c_str(), table_->GetId(), pid_);
+            return false;
+        }
+        ts_cols_.emplace_back(ts_it->second, col_it->second);
+        max_col_ = std::max(max_col_, col_it->second);
+    }
+    return true;
+}
+
+bool IndexBackfill::BuildKey(const std::vector<std::string>& row, const std::vector<uint32_t>& cols,
+                             std::string* key) {
+    key->clear();
+    for (uint32_t col : cols) {
+        if (col >= row.size()) {
+            return false;
+        }
+        if (!key->empty()) {
+            key->append("|");
+        }
+        key->append(row[col]);
+    }
+    return !key->empty();
+}
+
+bool IndexBackfill::DecodeRow(const ::fedb::base::Slice& value, std::vector<std::string>* row) {
+    std::string buff;
+    ::fedb::base::Slice data(value);
+    if (table_->GetCompressType() == ::fedb::api::kSnappy) {
+        if (!snappy::Uncompress(value.data(), value.size(), &buff)) {
+            return false;
+        }
+        data.reset(buff.data(), buff.size());
+    }
+    const int8_t* raw = reinterpret_cast<const int8_t*>(data.data());
+    uint8_t version = ::fedb::codec::RowView::GetSchemaVersion(raw);
+    std::shared_ptr<Schema> schema = table_->GetVersionSchema(version);
+    if (schema == nullptr) {
+        DLOG(WARNING) << "fail get version " << unsigned(version) << " schema";
+        return false;
+    }
+    return ::fedb::codec::RowCodec::DecodeRow(*schema, raw, data.size(), true, 0, max_col_ + 1, *row);
+}
+
+int IndexBackfill::Pack(int32_t scan_idx, uint64_t ts, const ::fedb::base::Slice& value,
+                        ::fedb::api::LogEntry* entry) {
+    std::vector<std::string> row;
+    if (!DecodeRow(value, &row)) {
+        return -1;
+    }
+    std::string key;
+    std::set<uint32_t> pid_set;
+    int32_t first_pid = -1;
+    for (const auto& index : index_cols_) {
+        if (!BuildKey(row, index.cols, &key)) {
+            continue;
+        }
+        uint32_t pid = ::fedb::base::hash64(key) % partition_num_;
+        if (pid == pid_ && scan_idx >= 0 && index.idx < static_cast<uint32_t>(scan_idx)) {
+            // the row is packed when traversing the former index
+            return -1;
+        }
+        if (first_pid < 0) {
+            first_pid = pid;
+        }
+        pid_set.insert(pid);
+    }
+    if (!BuildKey(row, new_cols_, &key)) {
+        return -1;
+    }
+    uint32_t index_pid = ::fedb::base::hash64(key) % partition_num_;
+    if (index_pid != pid_ &&
+        (first_pid != static_cast<int32_t>(pid_) || pid_set.find(index_pid) != pid_set.end())) {
+        return -1;
+    }
+    entry->Clear();
+    entry->set_value(value.data(), value.size());
+    entry->set_ts(ts);
+    ::fedb::api::Dimension* dim = entry->add_dimensions();
+    dim->set_key(key);
+    dim->set_idx(idx_);
+    for (const auto& kv : ts_cols_) {
+        const std::string& val = row[kv.second];
+        char* end = NULL;
+        uint64_t ts_val = strtoull(val.c_str(), &end, 10);
+        if (val.empty() || *end != '\0') {
+            continue;
+        }
+        ::fedb::api::TSDimension* ts_dim = entry->add_ts_dimensions();
+        ts_dim->set_idx(kv.first);
+        ts_dim->set_ts(ts_val);
+    }
+    if (!ts_cols_.empty() && entry->ts_dimensions_size() == 0) {
+        return -1;
+    }
+    return index_pid;
+}
+
+int IndexBackfill::PackRow(uint32_t scan_idx, uint64_t ts, const ::fedb::base::Slice& value,
+                           ::fedb::api::LogEntry* entry) {
+    return Pack(scan_idx, ts, value, entry);
+}
+
+int IndexBackfill::PackEntry(::fedb::api::LogEntry* entry) {
+    if (entry->has_method_type() && entry->method_type() == ::fedb::api::MethodType::kDelete) {
+        // a delete only unlinks the key from its own index, the rows stay in the
+        // others. a delete on the new index may have run before the scan put the
+        // rows of the key, so it is applied again in binlog order
+        if (entry->dimensions_size() == 0 || entry->dimensions(0).idx() != idx_ ||
+            ::fedb::base::hash64(entry->dimensions(0).key()) % partition_num_ != pid_) {
+            return -1;
+        }
+        return pid_;
+    }
+    bool only_new_index = entry->dimensions_size() > 0;
+    for (const auto& dim : entry->dimensions()) {
+        if (dim.idx() != idx_) {
+            only_new_index = false;
+            break;
+        }
+    }
+    if (only_new_index) {
+        // written by the backfill itself
+        return -1;
+    }
+    std::string value;
+    value.swap(*(entry->mutable_value()));
+    return Pack(-1, entry->ts(), ::fedb::base::Slice(value), entry);
+}
+
+bool IndexBackfill::Exist(std::shared_ptr<Table> table, const ::fedb::api::LogEntry& entry) {
+    const ::fedb::api::Dimension& dim = entry.dimensions(0);
+    uint64_t ts = entry.ts();
+    Ticket ticket;
+    TableIterator* it = NULL;
+    if (entry.ts_dimensions_size() > 0) {
+        ts = entry.ts_dimensions(0).ts();
+        it = table->NewIterator(dim.idx(), entry.ts_dimensions(0).idx(), dim.key(), ticket);
+    } else {
+        it = table->NewIterator(dim.idx(), dim.key(), ticket);
+    }
+    if (it == NULL) {
+        return false;
+    }
+    bool exist = false;
+    ::fedb::base::Slice value(entry.value());
+    it->Seek(ts);
+    while (it->Valid() && it->GetKey() == ts) {
+        if (it->GetValue().compare(value) == 0) {
+            exist = true;
+            break;
+        }
+        it->Next();
+    }
+    delete it;
+    return exist;
+}
+
+int IndexBackfill::PutEntry(std::shared_ptr<Table> table, const ::fedb::api::LogEntry& entry, bool check_exist) {
+    if (entry.dimensions_size() == 0) {
+        return -1;
+    }
+    if (entry.has_method_type() && entry.method_type() == ::fedb::api::MethodType::kDelete) {
+        // nothing to log again when the key is gone already
+        return table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx()) ? 0 : 1;
+    }
+    if (check_exist && Exist(table, entry)) {
+        return 1;
+    }
+    if (!table->Put(entry)) {
+        return -1;
+    }
+    return 0;
+}
+
+}  // namespace storage
+}  // namespace fedb
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/slice.h"
+#include "proto/common.pb.h"
+#include "proto/tablet.pb.h"
+#include "storage/mem_table.h"
+
+namespace fedb {
+namespace storage {
+
+// packs the rows of one partition into entries of a new index while the
+// table keeps serving. a row lives on every partition that owns one of its
+// index keys, so each row is packed exactly once: by the partition the new key
+// maps to if that partition holds the row, otherwise by the partition owning
+// the first index key of the row. methods are thread safe after Init
+class IndexBackfill {
+ public:
+    IndexBackfill(std::shared_ptr<MemTable> table, const ::fedb::common::ColumnKey& column_key, uint32_t idx,
+                  uint32_t partition_num);
+    ~IndexBackfill() = default;
+
+    bool Init();
+
+    // existing indexes to traverse
+    const std::vector<uint32_t>& GetScanIndex() const { return scan_index_; }
+
+    // packs a row found under index scan_idx and returns the pid the entry
+    // goes to, or -1 if the row is skipped
+    int PackRow(uint32_t scan_idx, uint64_t ts, const ::fedb::base::Slice& value, ::fedb::api::LogEntry* entry);
+
+    // same for a binlog entry of this partition. a delete on the new index is
+    // kept as is and goes to this partition
+    int PackEntry(::fedb::api::LogEntry* entry);
+
+    // puts an entry packed by the backfill, or applies a packed delete. returns 1
+    // if check_exist is set and the entry is in the index already or the deleted
+    // key is gone, 0 on success and -1 on failure
+    static int PutEntry(std::shared_ptr<Table> table, const ::fedb::api::LogEntry& entry, bool check_exist);
+
+ private:
+    struct KeyColumns {
+        uint32_t idx;
+        std::vector<uint32_t> cols;
+    };
+
+    int Pack(int32_t scan_idx, uint64_t ts, const ::fedb::base::Slice& value, ::fedb::api::LogEntry* entry);
+    bool DecodeRow(const ::fedb::base::Slice& value, std::vector<std::string>* row);
+    static bool Exist(std::shared_ptr<Table> table, const ::fedb::api::LogEntry& entry);
+    static bool BuildKey(const std::vector<std::string>& row, const std::vector<uint32_t>& cols,
+                         std::string* key);
+
+ private:
+    std::shared_ptr<MemTable> table_;
+    ::fedb::common::ColumnKey column_key_;
+    uint32_t idx_;
+    uint32_t pid_;
+    uint32_t partition_num_;
+    std::vector<KeyColumns> index_cols_;
+    std::vector<uint32_t> new_cols_;
+    // ts idx and column position of the ts columns of the new index
+    std::vector<std::pair<uint32_t, uint32_t>> ts_cols_;
+    std::vector<uint32_t> scan_index_;
+    uint32_t max_col_;
+};
+
+}  // namespace storage
+}  // namespace fedb
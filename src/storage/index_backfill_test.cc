@@ -0,0 +1,201 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/index_backfill.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/hash.h"
+#include "codec/row_codec.h"
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace storage {
+
+class IndexBackfillTest : public ::testing::Test {
+ public:
+    IndexBackfillTest() {}
+    ~IndexBackfillTest() {}
+};
+
+static std::shared_ptr<MemTable> CreateTable(uint32_t pid) {
+    ::fedb::api::TableMeta table_meta;
+    table_meta.set_name("t1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(pid);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_format_version(1);
+    const std::vector<std::string> cols = {"card", "mcc", "addr"};
+    for (const auto& name : cols) {
+        ::fedb::common::ColumnDesc* desc = table_meta.add_column_desc();
+        desc->set_name(name);
+        desc->set_data_type(::fedb::type::kString);
+    }
+    ::fedb::common::ColumnKey* ck = table_meta.add_column_key();
+    ck->set_index_name("card");
+    ck->add_col_name("card");
+    ck = table_meta.add_column_key();
+    ck->set_index_name("mcc");
+    ck->add_col_name("mcc");
+    auto table = std::make_shared<MemTable>(table_meta);
+    table->Init();
+    return table;
+}
+
+static ::fedb::common::ColumnKey NewIndex() {
+    ::fedb::common::ColumnKey ck;
+    ck.set_index_name("addr");
+    ck.add_col_name("addr");
+    return ck;
+}
+
+static std::string EncodeRow(const std::shared_ptr<MemTable>& table, const std::string& card,
+                             const std::string& mcc, const std::string& addr) {
+    std::string row;
+    ::fedb::codec::RowCodec::EncodeRow({card, mcc, addr}, table->GetTableMeta().column_desc(), 1, row);
+    return row;
+}
+
+static uint32_t GetPid(const std::string& key, uint32_t partition_num) {
+    return ::fedb::base::hash64(key) % partition_num;
+}
+
+TEST_F(IndexBackfillTest, PackRowOnePartition) {
+    auto table = CreateTable(0);
+    ASSERT_TRUE(table->AddIndex(NewIndex()));
+    IndexBackfill backfill(table, NewIndex(), 2, 1);
+    ASSERT_TRUE(backfill.Init());
+    ASSERT_EQ(2u, backfill.GetScanIndex().size());
+    std::string row = EncodeRow(table, "card0", "mcc0", "addr0");
+    ::fedb::api::LogEntry entry;
+    ASSERT_EQ(0, backfill.PackRow(0, 1000, ::fedb::base::Slice(row), &entry));
+    ASSERT_EQ(1000u, entry.ts());
+    ASSERT_EQ(row, entry.value());
+    ASSERT_EQ(1, entry.dimensions_size());
+    ASSERT_EQ("addr0", entry.dimensions(0).key());
+    ASSERT_EQ(2u, entry.dimensions(0).idx());
+    // packed when traversing index card already
+    ASSERT_EQ(-1, backfill.PackRow(1, 1000, ::fedb::base::Slice(row), &entry));
+}
+
+TEST_F(IndexBackfillTest, PackRowRoute) {
+    const uint32_t partition_num = 8;
+    std::string card, mcc, addr;
+    for (int i = 0; i < 1000; i++) {
+        card = "card" + std::to_string(i);
+        mcc = "mcc" + std::to_string(i);
+        addr = "addr" + std::to_string(i);
+        uint32_t addr_pid = GetPid(addr, partition_num);
+        if (addr_pid != GetPid(card, partition_num) && addr_pid != GetPid(mcc, partition_num) &&
+            GetPid(card, partition_num) != GetPid(mcc, partition_num)) {
+            break;
+        }
+    }
+    // the partition of the first key sends the row to the partition of the new key
+    auto table = CreateTable(GetPid(card, partition_num));
+    ASSERT_TRUE(table->AddIndex(NewIndex()));
+    IndexBackfill backfill(table, NewIndex(), 2, partition_num);
+    ASSERT_TRUE(backfill.Init());
+    std::string row = EncodeRow(table, card, mcc, addr);
+    ::fedb::api::LogEntry entry;
+    ASSERT_EQ(static_cast<int>(GetPid(addr, partition_num)),
+              backfill.PackRow(0, 1000, ::fedb::base::Slice(row), &entry));
+    ASSERT_EQ(addr, entry.dimensions(0).key());
+    // the partition of the other key skips it
+    auto other = CreateTable(GetPid(mcc, partition_num));
+    ASSERT_TRUE(other->AddIndex(NewIndex()));
+    IndexBackfill other_backfill(other, NewIndex(), 2, partition_num);
+    ASSERT_TRUE(other_backfill.Init());
+    ASSERT_EQ(-1, other_backfill.PackRow(1, 1000, ::fedb::base::Slice(row), &entry));
+}
+
+TEST_F(IndexBackfillTest, PackEntry) {
+    auto table = CreateTable(0);
+    ASSERT_TRUE(table->AddIndex(NewIndex()));
+    IndexBackfill backfill(table, NewIndex(), 2, 1);
+    ASSERT_TRUE(backfill.Init());
+    std::string row = EncodeRow(table, "card0", "mcc0", "addr0");
+    ::fedb::api::LogEntry entry;
+    entry.set_ts(1000);
+    entry.set_value(row);
+    ::fedb::api::Dimension* dim = entry.add_dimensions();
+    dim->set_key("card0");
+    dim->set_idx(0);
+    ASSERT_EQ(0, backfill.PackEntry(&entry));
+    ASSERT_EQ(1, entry.dimensions_size());
+    ASSERT_EQ(2u, entry.dimensions(0).idx());
+    // the entry written by the backfill itself
+    ASSERT_EQ(-1, backfill.PackEntry(&entry));
+    entry.Clear();
+    entry.set_method_type(::fedb::api::MethodType::kDelete);
+    dim = entry.add_dimensions();
+    dim->set_key("card0");
+    dim->set_idx(0);
+    ASSERT_EQ(-1, backfill.PackEntry(&entry));
+    // a delete on the new index is applied again
+    dim->set_key("addr0");
+    dim->set_idx(2);
+    ASSERT_EQ(0, backfill.PackEntry(&entry));
+    ASSERT_EQ(::fedb::api::MethodType::kDelete, entry.method_type());
+    ASSERT_EQ("addr0", entry.dimensions(0).key());
+}
+
+TEST_F(IndexBackfillTest, PutEntry) {
+    auto table = CreateTable(0);
+    ASSERT_TRUE(table->AddIndex(NewIndex()));
+    IndexBackfill backfill(table, NewIndex(), 2, 1);
+    ASSERT_TRUE(backfill.Init());
+    std::string row = EncodeRow(table, "card0", "mcc0", "addr0");
+    ::fedb::api::LogEntry entry;
+    ASSERT_EQ(0, backfill.PackRow(0, 1000, ::fedb::base::Slice(row), &entry));
+    ASSERT_EQ(0, IndexBackfill::PutEntry(table, entry, true));
+    ASSERT_EQ(1, IndexBackfill::PutEntry(table, entry, true));
+    entry.set_ts(1001);
+    ASSERT_EQ(0, IndexBackfill::PutEntry(table, entry, true));
+    entry.clear_dimensions();
+    ASSERT_EQ(-1, IndexBackfill::PutEntry(table, entry, false));
+}
+
+TEST_F(IndexBackfillTest, PutDeleteEntry) {
+    auto table = CreateTable(0);
+    ASSERT_TRUE(table->AddIndex(NewIndex()));
+    IndexBackfill backfill(table, NewIndex(), 2, 1);
+    ASSERT_TRUE(backfill.Init());
+    std::string row = EncodeRow(table, "card0", "mcc0", "addr0");
+    ::fedb::api::LogEntry entry;
+    ASSERT_EQ(0, backfill.PackRow(0, 1000, ::fedb::base::Slice(row), &entry));
+    ASSERT_EQ(0, IndexBackfill::PutEntry(table, entry, true));
+    ::fedb::api::LogEntry delete_entry;
+    delete_entry.set_method_type(::fedb::api::MethodType::kDelete);
+    ::fedb::api::Dimension* dim = delete_entry.add_dimensions();
+    dim->set_key("addr0");
+    dim->set_idx(2);
+    ASSERT_EQ(0, backfill.PackEntry(&delete_entry));
+    ASSERT_EQ(0, IndexBackfill::PutEntry(table, delete_entry, true));
+    // the row is gone from the new index and can be put again
+    ASSERT_EQ(1, IndexBackfill::PutEntry(table, delete_entry, true));
+    ASSERT_EQ(0, IndexBackfill::PutEntry(table, entry, true));
+}
+
+}  // namespace storage
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -583,6 +583,48 @@ uint64_t MemTable::GetRecordIdxByteSize() {
     return record_idx_byte_size;
 }
 
+void MemTable::GetMemoryUsage(::fedb::api::TableMemoryUsage* usage) {
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    MemoryUsage row_usage;
+    bool row_counted = false;
+    for (size_t i = 0; i < inner_indexs->size(); i++) {
+        std::string name;
+        for (const auto& index_def : inner_indexs->at(i)->GetIndex()) {
+            if (index_def && index_def->IsReady()) {
+                if (!name.empty()) {
+                    name.append(",");
+                }
+                name.append(index_def->GetName());
+            }
+        }
+        if (name.empty()) {
+            continue;
+        }
+        // the indexes share the rows, so they are counted under the first one
+        bool with_row = !row_counted;
+        row_counted = true;
+        MemoryUsage seg_usage;
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            segments_[i][j]->GetMemoryUsage(with_row, &seg_usage);
+        }
+        ::fedb::api::IndexMemoryUsage* index_usage = usage->add_index();
+        index_usage->set_name(name);
+        index_usage->set_key_entry_byte_size(seg_usage.key_entry);
+        index_usage->set_time_node_byte_size(seg_usage.time_node);
+        index_usage->set_pending_gc_byte_size(seg_usage.pending_gc);
+        if (with_row) {
+            row_usage = seg_usage;
+        }
+    }
+    // rows without a key of the first index are taken as the average size
+    uint64_t row_byte_size = row_usage.row;
+    uint64_t record_cnt = GetRecordCnt();
+    if (row_usage.row_cnt > 0 && record_cnt > row_usage.row_cnt) {
+        row_byte_size = static_cast<uint64_t>(static_cast<double>(row_usage.row) / row_usage.row_cnt * record_cnt);
+    }
+    usage->set_row_byte_size(row_byte_size);
+}
+
 uint64_t MemTable::GetRecordIdxCnt() {
     uint64_t record_idx_cnt = 0;
     auto inner_indexs = table_index_.GetAllInnerIndex();
@@ -835,6 +877,31 @@ TableIterator* MemTable::NewTraverseIterator(uint32_t index, uint32_t ts_index)
                 expire_time, expire_cnt, ts_index);
 }
 
+TableIterator* MemTable::NewSegmentTraverseIterator(uint32_t index, uint32_t seg_idx) {
+    std::shared_ptr<IndexDef> index_def = GetIndex(index);
+    if (!index_def || !index_def->IsReady() || seg_idx >= seg_cnt_) {
+        PDLOG(WARNING, "index %u seg_idx %u not found. tid %u pid %u", index, seg_idx, id_, pid_);
+        return NULL;
+    }
+    uint32_t ts_index = 0;
+    auto ts_col = index_def->GetTsColumn();
+    if (ts_col) {
+        ts_index = ts_col->GetTsIdx();
+    }
+    uint64_t expire_time = 0;
+    uint64_t expire_cnt = 0;
+    auto ttl = index_def->GetTTL();
+    if (enable_gc_.load(std::memory_order_relaxed)) {
+        expire_time = GetExpireTime(*ttl);
+        expire_cnt = ttl->lat_ttl;
+    }
+    uint32_t real_idx = index_def->GetInnerPos();
+    MemTableTraverseIterator* it = new MemTableTraverseIterator(segments_[real_idx] + seg_idx, 1, ttl->ttl_type,
+                                                                expire_time, expire_cnt, ts_index);
+    it->SetMaxTraverseCnt(0);
+    return it;
+}
+
 MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, ::fedb::storage::TTLType ttl_type,
                                          uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index)
     : segments_(segments),
@@ -968,7 +1035,8 @@ MemTableTraverseIterator::MemTableTraverseIterator(Segment** segments, uint32_t
       ts_idx_(0),
       expire_value_(expire_time, expire_cnt, ttl_type),
       ticket_(),
-      traverse_cnt_(0) {
+      traverse_cnt_(0),
+      max_traverse_cnt_(FLAGS_max_traverse_cnt) {
     uint32_t idx = 0;
     if (segments_[0]->GetTsIdx(ts_index, idx) == 0) {
         ts_idx_ = idx;
@@ -1034,7 +1102,7 @@ void MemTableTraverseIterator::NextPK() {
         it_->SeekToFirst();
         record_idx_ = 1;
         traverse_cnt_++;
-        if (traverse_cnt_ >= FLAGS_max_traverse_cnt) {
+        if (max_traverse_cnt_ > 0 && traverse_cnt_ >= max_traverse_cnt_) {
             break;
         }
     } while (it_ == NULL || !it_->Valid() || expire_value_.IsExpired(it_->GetKey(), record_idx_));
@@ -1153,7 +1221,7 @@ void MemTableTraverseIterator::SeekToFirst() {
             it_ = NULL;
             pk_it_->Next();
             ticket_.Pop();
-            if (traverse_cnt_ >= FLAGS_max_traverse_cnt) {
+            if (max_traverse_cnt_ > 0 && traverse_cnt_ >= max_traverse_cnt_) {
                 return;
             }
         }
@@ -132,6 +132,8 @@ class MemTableTraverseIterator : public TableIterator {
     uint64_t GetKey() const override;
     void SeekToFirst() override;
     uint64_t GetCount() const override;
+    // 0 means no limit
+    inline void SetMaxTraverseCnt(uint64_t cnt) { max_traverse_cnt_ = cnt; }
 
  private:
     void NextPK();
@@ -148,6 +150,7 @@ class MemTableTraverseIterator : public TableIterator {
     TTLSt expire_value_;
     Ticket ticket_;
     uint64_t traverse_cnt_;
+    uint64_t max_traverse_cnt_;
 };
 
 class MemTable : public Table {
@@ -193,6 +196,9 @@ class MemTable : public Table {
     TableIterator* NewTraverseIterator(uint32_t index,
                                        uint32_t ts_idx) override;
 
+    // traverse one segment of the index without the max_traverse_cnt limit
+    TableIterator* NewSegmentTraverseIterator(uint32_t index, uint32_t seg_idx);
+
     ::hybridse::vm::WindowIterator* NewWindowIterator(uint32_t index);
     ::hybridse::vm::WindowIterator* NewWindowIterator(uint32_t index,
                                                    uint32_t ts_idx);
@@ -210,6 +216,9 @@ class MemTable : public Table {
     uint64_t GetRecordIdxCnt();
     bool GetRecordIdxCnt(uint32_t idx, uint64_t** stat, uint32_t* size);
     uint64_t GetRecordIdxByteSize();
+
+    // measured bytes of each inner index and of the rows. it walks the table
+    void GetMemoryUsage(::fedb::api::TableMemoryUsage* usage);
     uint64_t GetRecordPkCnt();
 
     void SetCompressType(::fedb::api::CompressType compress_type);
@@ -22,6 +22,8 @@
 #endif
 #include <snappy.h>
 #include <unistd.h>
+#include <condition_variable>  // NOLINT
+#include <mutex>  // NOLINT
 #include <set>
 #include <utility>
 
@@ -64,7 +66,7 @@ const std::string MANIFEST = "MANIFEST";     // NOLINT
 MemTableSnapshot::MemTableSnapshot(uint32_t tid, uint32_t pid,
                                    LogParts* log_part,
                                    const std::string& db_root_path)
-    : Snapshot(tid, pid), log_part_(log_part), db_root_path_(db_root_path) {}
+    : Snapshot(tid, pid), log_part_(log_part), db_root_path_(db_root_path), load_pool_() {}
 
 bool MemTableSnapshot::Init() {
     snapshot_path_ = db_root_path_ + "/" + std::to_string(tid_) + "_" +
@@ -119,10 +121,31 @@ void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name,
 void MemTableSnapshot::RecoverSingleSnapshot(
     const std::string& path, std::shared_ptr<Table> table,
     std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
-    ::fedb::base::TaskPool load_pool_(FLAGS_load_table_thread_num,
-                                       FLAGS_load_table_batch);
+    std::shared_ptr<::fedb::base::TaskPool> load_pool = load_pool_;
+    if (!load_pool) {
+        load_pool = std::make_shared<::fedb::base::TaskPool>(FLAGS_load_table_thread_num, FLAGS_load_table_batch);
+    }
     std::atomic<uint64_t> succ_cnt, failed_cnt;
     succ_cnt = failed_cnt = 0;
+    // the pool may be shared, so wait for the batches of this file only
+    std::mutex pending_mu;
+    std::condition_variable pending_cv;
+    uint32_t pending = 0;
+    auto add_batch = [&](const std::vector<std::string*>& batch) {
+        {
+            std::lock_guard<std::mutex> lock(pending_mu);
+            pending++;
+        }
+        load_pool->AddTask([&, batch]() mutable {
+            std::string batch_path(path);
+            std::shared_ptr<Table> batch_table(table);
+            Put(batch_path, batch_table, batch, &succ_cnt, &failed_cnt);
+            std::lock_guard<std::mutex> lock(pending_mu);
+            if (--pending == 0) {
+                pending_cv.notify_all();
+            }
+        });
+    };
 
     do {
         if (table == NULL) {
@@ -170,19 +193,19 @@ void MemTableSnapshot::RecoverSingleSnapshot(
             std::string* sp = new std::string(record.data(), record.size());
             recordPtr.push_back(sp);
             if (recordPtr.size() >= FLAGS_load_table_batch) {
-                load_pool_.AddTask(boost::bind(&MemTableSnapshot::Put, this,
-                                               path, table, recordPtr,
-                                               &succ_cnt, &failed_cnt));
+                add_batch(recordPtr);
                 recordPtr.clear();
             }
         }
         if (recordPtr.size() > 0) {
-            load_pool_.AddTask(boost::bind(&MemTableSnapshot::Put, this, path,
-                                           table, recordPtr, &succ_cnt,
-                                           &failed_cnt));
+            add_batch(recordPtr);
         }
         // will close the fd atomic
         delete seq_file;
+        {
+            std::unique_lock<std::mutex> lock(pending_mu);
+            pending_cv.wait(lock, [&] { return pending == 0; });
+        }
         if (g_succ_cnt) {
             g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
         }
@@ -190,7 +213,6 @@ void MemTableSnapshot::RecoverSingleSnapshot(
             g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
         }
     } while (false);
-    load_pool_.Stop();
 }
 
 void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table,
@@ -34,6 +34,7 @@ using ::fedb::api::LogEntry;
 namespace fedb {
 namespace base {
 class Status;
+class TaskPool;
 }
 namespace storage {
 
@@ -120,6 +121,10 @@ class MemTableSnapshot : public Snapshot {
                          const std::set<uint32_t>& deleted_index,
                          std::string* buffer);
 
+    // decode the snapshot records with a pool shared by the tables of the
+    // tablet instead of starting threads for every snapshot file
+    void SetLoadPool(const std::shared_ptr<::fedb::base::TaskPool>& load_pool) { load_pool_ = load_pool; }
+
  private:
     // load single snapshot to table
     void RecoverSingleSnapshot(const std::string& path,
@@ -139,6 +144,7 @@ class MemTableSnapshot : public Snapshot {
     std::string log_path_;
     std::map<std::string, uint64_t> deleted_keys_;
     std::string db_root_path_;
+    std::shared_ptr<::fedb::base::TaskPool> load_pool_;
 };
 
 }  // namespace storage
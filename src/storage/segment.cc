@@ -21,7 +21,11 @@
 #include "base/strings.h"
 #include "base/glog_wapper.h"
 #include "common/timer.h"
+#include "config.h"  // NOLINT
 #include "storage/record.h"
+#ifdef TCMALLOC_ENABLE
+#include "gperftools/malloc_extension.h"
+#endif
 
 DECLARE_int32(gc_safe_offset);
 DECLARE_uint32(skiplist_max_height);
@@ -31,6 +35,16 @@ namespace fedb {
 namespace storage {
 
 static const SliceComparator scmp;
+
+// the bytes the allocator takes for a request of size
+static inline uint64_t GetAllocatedSize(uint64_t size) {
+#ifdef TCMALLOC_ENABLE
+    return MallocExtension::instance()->GetEstimatedAllocatedSize(size);
+#else
+    return size;
+#endif
+}
+
 Segment::Segment()
     : entries_(NULL),
       mu_(),
@@ -379,6 +393,7 @@ void Segment::GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt,
                               uint64_t& gc_record_byte_size) {
     ::fedb::base::Node<uint64_t, ::fedb::base::Node<Slice, void*>*>* node =
         NULL;
+    std::lock_guard<std::mutex> free_list_lock(free_list_mu_);
     {
         std::lock_guard<std::mutex> lock(gc_mu_);
         node = entry_free_list_->Split(version);
@@ -893,5 +908,78 @@ void MemTableIterator::SeekToLast() {
     it_->SeekToLast();
 }
 
+void Segment::GetEntryMemoryUsage(KeyEntry* entry, bool with_row, MemoryUsage* usage) {
+    // the entry and the head node of its ts skiplist
+    usage->key_entry += GetAllocatedSize(KEY_ENTRY_BYTE_SIZE) + GetAllocatedSize(DATA_NODE_SIZE) +
+                        GetAllocatedSize(key_entry_max_height_ * 8);
+    TimeEntries::Iterator* it = entry->entries.NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        usage->time_node += GetAllocatedSize(DATA_NODE_SIZE) + GetAllocatedSize(it->GetHeight() * 8);
+        if (with_row) {
+            DataBlock* block = it->GetValue();
+            usage->row += GetAllocatedSize(DATA_BLOCK_BYTE_SIZE) + GetAllocatedSize(block->size);
+            usage->row_cnt++;
+        }
+        it->Next();
+    }
+    delete it;
+}
+
+void Segment::GetMemoryUsage(bool with_row, MemoryUsage* usage) {
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        usage->key_entry += GetAllocatedSize(ENTRY_NODE_SIZE) + GetAllocatedSize(it->GetHeight() * 8) +
+                            GetAllocatedSize(it->GetKey().size());
+        std::vector<KeyEntry*> entries;
+        if (ts_cnt_ > 1) {
+            usage->key_entry += GetAllocatedSize(ts_cnt_ * KEY_ENTRY_PTR_SIZE);
+            KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
+            entries.assign(entry_arr, entry_arr + ts_cnt_);
+        } else {
+            entries.push_back((KeyEntry*)it->GetValue());  // NOLINT
+        }
+        {
+            // the gc skips the referenced entries
+            std::lock_guard<std::mutex> lock(mu_);
+            for (KeyEntry* entry : entries) {
+                entry->Ref();
+            }
+        }
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            // all ts of a pk point to the same row
+            GetEntryMemoryUsage(entries[i], with_row && i == 0, usage);
+            entries[i]->UnRef();
+        }
+        it->Next();
+    }
+    delete it;
+    MemoryUsage pending;
+    // the inserts under gc_mu_ are safe for the iterator, only the free of the
+    // list must wait
+    std::lock_guard<std::mutex> lock(free_list_mu_);
+    KeyEntryNodeList::Iterator* fit = entry_free_list_->NewIterator();
+    fit->SeekToFirst();
+    while (fit->Valid()) {
+        ::fedb::base::Node<Slice, void*>* entry_node = fit->GetValue();
+        pending.key_entry += GetAllocatedSize(DATA_NODE_SIZE) + GetAllocatedSize(fit->GetHeight() * 8) +
+                             GetAllocatedSize(ENTRY_NODE_SIZE) + GetAllocatedSize(entry_node->Height() * 8) +
+                             GetAllocatedSize(entry_node->GetKey().size());
+        if (ts_cnt_ > 1) {
+            pending.key_entry += GetAllocatedSize(ts_cnt_ * KEY_ENTRY_PTR_SIZE);
+            KeyEntry** entry_arr = (KeyEntry**)entry_node->GetValue();  // NOLINT
+            for (uint32_t i = 0; i < ts_cnt_; i++) {
+                GetEntryMemoryUsage(entry_arr[i], false, &pending);
+            }
+        } else {
+            GetEntryMemoryUsage((KeyEntry*)entry_node->GetValue(), false, &pending);  // NOLINT
+        }
+        fit->Next();
+    }
+    delete fit;
+    usage->pending_gc += pending.key_entry + pending.time_node;
+}
+
 }  // namespace storage
 }  // namespace fedb
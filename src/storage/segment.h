@@ -91,6 +91,20 @@ class MemTableIterator : public TableIterator {
     TimeEntries::Iterator* it_;
 };
 
+// bytes measured by walking a segment, rounded up to the size classes of
+// the allocator
+struct MemoryUsage {
+    // pk nodes, pk copies and key entries
+    uint64_t key_entry = 0;
+    // ts nodes
+    uint64_t time_node = 0;
+    // rows reached from the segment
+    uint64_t row = 0;
+    uint64_t row_cnt = 0;
+    // deleted pks waiting for the gc in the free list
+    uint64_t pending_gc = 0;
+};
+
 class KeyEntry {
  public:
     KeyEntry() : entries(12, 4, tcmp), refs_(0), count_(0) {}
@@ -244,7 +258,12 @@ class Segment {
                          uint64_t& gc_record_cnt,         // NOLINT
                          uint64_t& gc_record_byte_size);  // NOLINT
 
+    // walks the segment, so it takes time proportional to the records
+    void GetMemoryUsage(bool with_row, MemoryUsage* usage);
+
  private:
+    void GetEntryMemoryUsage(KeyEntry* entry, bool with_row, MemoryUsage* usage);
+
     void FreeList(::fedb::base::Node<uint64_t, DataBlock*>* node,
                   uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,  // NOLINT
                   uint64_t& gc_record_byte_size);                 // NOLINT
@@ -263,6 +282,9 @@ class Segment {
     // only Put need mutex
     std::mutex mu_;
     std::mutex gc_mu_;
+    // held while the entry free list is split and freed, so the memory usage
+    // can walk it without blocking the deletes on gc_mu_
+    std::mutex free_list_mu_;
     std::atomic<uint64_t> idx_cnt_;
     std::atomic<uint64_t> idx_byte_size_;
     std::atomic<uint64_t> pk_cnt_;
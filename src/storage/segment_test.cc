@@ -380,6 +380,30 @@ TEST_F(SegmentTest, TestStat) {
     ASSERT_EQ(0, (int64_t)segment.GetIdxCnt());
 }
 
+TEST_F(SegmentTest, GetMemoryUsage) {
+    Segment segment;
+    segment.Put("PK1", 9768, "test1", 5);
+    segment.Put("PK1", 9769, "test2", 5);
+    segment.Put("PK2", 9768, "test3", 5);
+    MemoryUsage usage;
+    segment.GetMemoryUsage(true, &usage);
+    ASSERT_EQ(3, (int64_t)usage.row_cnt);
+    ASSERT_GE(usage.row, 3 * (DATA_BLOCK_BYTE_SIZE + 5));
+    ASSERT_GE(usage.time_node, 3 * DATA_NODE_SIZE);
+    ASSERT_GT(usage.key_entry, 0u);
+    ASSERT_EQ(0, (int64_t)usage.pending_gc);
+    MemoryUsage no_row;
+    segment.GetMemoryUsage(false, &no_row);
+    ASSERT_EQ(0, (int64_t)no_row.row);
+    ASSERT_EQ(usage.key_entry, no_row.key_entry);
+    ASSERT_TRUE(segment.Delete("PK1"));
+    MemoryUsage deleted;
+    segment.GetMemoryUsage(true, &deleted);
+    ASSERT_EQ(1, (int64_t)deleted.row_cnt);
+    ASSERT_LT(deleted.key_entry, usage.key_entry);
+    ASSERT_GT(deleted.pending_gc, 0u);
+}
+
 TEST_F(SegmentTest, GetTsIdx) {
     std::vector<uint32_t> ts_idx_vec = {1, 3, 5};
     Segment segment(8, ts_idx_vec);
@@ -0,0 +1,404 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// microbenchmarks of the storage engine without a cluster around it. most
+// cases take the key cardinality and the value size as arguments, e.g.
+//   storage_benchmark --benchmark_filter=BM_MemTablePut/.*
+// the memory counters are taken from the record.h accounting of the table
+
+#include <gflags/gflags.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/slice.h"
+#include "benchmark/benchmark.h"
+#include "log/log_writer.h"
+#include "proto/tablet.pb.h"
+#include "storage/mem_table.h"
+#include "storage/mem_table_snapshot.h"
+#include "storage/record.h"
+#include "storage/segment.h"
+#include "storage/ticket.h"
+
+DECLARE_string(db_root_path);
+DECLARE_string(snapshot_compression);
+DECLARE_uint32(max_traverse_cnt);
+
+namespace fedb {
+namespace storage {
+
+static const uint64_t kBaseTime = 1600000000000;
+static const uint32_t kRowsPerKey = 10;
+static const uint32_t kRowsPerThread = 10000;
+static const ::fedb::base::DefaultComparator scmp;
+
+static std::vector<std::string> GenKeys(const std::string& prefix, uint32_t cnt) {
+    std::vector<std::string> keys;
+    keys.reserve(cnt);
+    for (uint32_t i = 0; i < cnt; i++) {
+        keys.push_back(prefix + std::to_string(i));
+    }
+    return keys;
+}
+
+// dim_cnt string index columns and ts_cnt bigint ts columns. every index
+// takes all ts columns
+static std::shared_ptr<MemTable> CreateTable(uint32_t tid, uint32_t dim_cnt, uint32_t ts_cnt,
+                                             ::fedb::api::TTLType ttl_type, uint64_t ttl) {
+    ::fedb::api::TableMeta table_meta;
+    table_meta.set_name("t" + std::to_string(tid));
+    table_meta.set_tid(tid);
+    table_meta.set_pid(0);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_ttl_type(ttl_type);
+    table_meta.set_ttl(ttl);
+    table_meta.set_mode(::fedb::api::TableMode::kTableLeader);
+    for (uint32_t i = 0; i < dim_cnt; i++) {
+        ::fedb::common::ColumnDesc* desc = table_meta.add_column_desc();
+        desc->set_name("k" + std::to_string(i));
+        desc->set_data_type(::fedb::type::kString);
+    }
+    for (uint32_t i = 0; i < ts_cnt; i++) {
+        ::fedb::common::ColumnDesc* desc = table_meta.add_column_desc();
+        desc->set_name("ts" + std::to_string(i));
+        desc->set_data_type(::fedb::type::kBigInt);
+        desc->set_is_ts_col(true);
+    }
+    for (uint32_t i = 0; i < dim_cnt; i++) {
+        ::fedb::common::ColumnKey* ck = table_meta.add_column_key();
+        ck->set_index_name("k" + std::to_string(i));
+        ck->add_col_name("k" + std::to_string(i));
+        for (uint32_t j = 0; j < ts_cnt; j++) {
+            ck->add_ts_name("ts" + std::to_string(j));
+        }
+    }
+    auto table = std::make_shared<MemTable>(table_meta);
+    table->Init();
+    return table;
+}
+
+// kRowsPerKey rows for each key on a single dimension table
+static std::shared_ptr<MemTable> CreateFilledTable(uint32_t key_cnt, uint32_t value_size) {
+    auto table = CreateTable(1, 1, 0, ::fedb::api::TTLType::kAbsoluteTime, 0);
+    std::vector<std::string> keys = GenKeys("key", key_cnt);
+    std::string value(value_size, 'v');
+    for (uint32_t i = 0; i < kRowsPerKey; i++) {
+        for (const auto& key : keys) {
+            table->Put(key, kBaseTime + i, value.c_str(), value.size());
+        }
+    }
+    return table;
+}
+
+static void SetMemCounters(benchmark::State& state, const std::shared_ptr<MemTable>& table) {
+    uint64_t cnt = table->GetRecordCnt();
+    if (cnt == 0) {
+        return;
+    }
+    state.counters["record_bytes_per_row"] = static_cast<double>(table->GetRecordByteSize()) / cnt;
+    state.counters["idx_bytes_per_row"] = static_cast<double>(table->GetRecordIdxByteSize()) / cnt;
+}
+
+static void KeyAndValueArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"keys", "value_size"});
+    for (int64_t key_cnt : {100, 10000}) {
+        for (int64_t value_size : {64, 1024}) {
+            b->Args({key_cnt, value_size});
+        }
+    }
+}
+
+static void BM_SegmentPut(benchmark::State& state) {
+    uint32_t thread_cnt = state.range(0);
+    std::vector<std::string> keys = GenKeys("key", state.range(1));
+    std::string value(state.range(2), 'v');
+    uint64_t idx_byte_size = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Segment* segment = new Segment();
+        state.ResumeTiming();
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < thread_cnt; t++) {
+            threads.emplace_back([&, t] {
+                for (uint32_t i = 0; i < kRowsPerThread; i++) {
+                    const std::string& key = keys[(t * kRowsPerThread + i) % keys.size()];
+                    segment->Put(Slice(key), kBaseTime + i, value.c_str(), value.size());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        state.PauseTiming();
+        idx_byte_size = segment->GetIdxByteSize();
+        segment->Release();
+        delete segment;
+        state.ResumeTiming();
+    }
+    uint64_t rows = static_cast<uint64_t>(thread_cnt) * kRowsPerThread;
+    state.SetItemsProcessed(state.iterations() * rows);
+    state.counters["record_bytes_per_row"] = GetRecordSize(value.size());
+    state.counters["idx_bytes_per_row"] = static_cast<double>(idx_byte_size) / rows;
+}
+BENCHMARK(BM_SegmentPut)
+    ->ArgNames({"threads", "keys", "value_size"})
+    ->Args({1, 100, 64})
+    ->Args({1, 10000, 64})
+    ->Args({1, 10000, 1024})
+    ->Args({4, 100, 64})
+    ->Args({4, 10000, 64})
+    ->Args({4, 10000, 1024})
+    ->Args({8, 10000, 64})
+    ->UseRealTime();
+
+static void BM_SegmentGet(benchmark::State& state) {
+    std::vector<std::string> keys = GenKeys("key", state.range(0));
+    std::string value(state.range(1), 'v');
+    Segment segment;
+    for (uint32_t i = 0; i < kRowsPerKey; i++) {
+        for (const auto& key : keys) {
+            segment.Put(Slice(key), kBaseTime + i, value.c_str(), value.size());
+        }
+    }
+    uint64_t cnt = 0;
+    for (auto _ : state) {
+        DataBlock* block = NULL;
+        const std::string& key = keys[cnt % keys.size()];
+        benchmark::DoNotOptimize(segment.Get(Slice(key), kBaseTime + cnt % kRowsPerKey, &block));
+        benchmark::DoNotOptimize(block);
+        cnt++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    segment.Release();
+}
+BENCHMARK(BM_SegmentGet)->Apply(KeyAndValueArgs);
+
+static void BM_MemTablePut(benchmark::State& state) {
+    uint32_t dim_cnt = state.range(0);
+    uint32_t ts_cnt = state.range(1);
+    uint32_t key_cnt = state.range(2);
+    std::string value(state.range(3), 'v');
+    auto table = CreateTable(1, dim_cnt, ts_cnt, ::fedb::api::TTLType::kAbsoluteTime, 0);
+    std::vector<::fedb::api::PutRequest> requests(key_cnt);
+    for (uint32_t i = 0; i < key_cnt; i++) {
+        for (uint32_t d = 0; d < dim_cnt; d++) {
+            ::fedb::api::Dimension* dim = requests[i].add_dimensions();
+            dim->set_idx(d);
+            dim->set_key("k" + std::to_string(d) + "_" + std::to_string(i));
+        }
+        for (uint32_t t = 0; t < ts_cnt; t++) {
+            requests[i].add_ts_dimensions()->set_idx(t);
+        }
+    }
+    uint64_t cnt = 0;
+    for (auto _ : state) {
+        ::fedb::api::PutRequest& request = requests[cnt % key_cnt];
+        uint64_t time = kBaseTime + cnt;
+        if (ts_cnt == 0) {
+            table->Put(time, value, request.dimensions());
+        } else {
+            for (auto& ts_dim : *request.mutable_ts_dimensions()) {
+                ts_dim.set_ts(time);
+            }
+            table->Put(request.dimensions(), request.ts_dimensions(), value);
+        }
+        cnt++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    SetMemCounters(state, table);
+}
+BENCHMARK(BM_MemTablePut)
+    ->ArgNames({"dims", "ts", "keys", "value_size"})
+    ->Args({1, 0, 10000, 64})
+    ->Args({1, 0, 10000, 1024})
+    ->Args({1, 1, 10000, 64})
+    ->Args({1, 2, 10000, 64})
+    ->Args({2, 1, 10000, 64})
+    ->Args({4, 1, 10000, 64})
+    ->Args({8, 0, 10000, 64})
+    ->Args({8, 1, 10000, 64})
+    ->Args({8, 2, 10000, 64})
+    ->Args({4, 1, 100, 64})
+    ->Args({4, 1, 100000, 64});
+
+static void BM_MemTableSeek(benchmark::State& state) {
+    uint32_t key_cnt = state.range(0);
+    auto table = CreateFilledTable(key_cnt, state.range(1));
+    std::vector<std::string> keys = GenKeys("key", key_cnt);
+    uint64_t cnt = 0;
+    for (auto _ : state) {
+        Ticket ticket;
+        TableIterator* it = table->NewIterator(0, keys[cnt % key_cnt], ticket);
+        it->Seek(kBaseTime + cnt % kRowsPerKey);
+        if (it->Valid()) {
+            benchmark::DoNotOptimize(it->GetValue());
+        }
+        delete it;
+        cnt++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    SetMemCounters(state, table);
+}
+BENCHMARK(BM_MemTableSeek)->Apply(KeyAndValueArgs);
+
+static void BM_MemTableWindowIterate(benchmark::State& state) {
+    auto table = CreateFilledTable(state.range(0), state.range(1));
+    uint64_t rows = 0;
+    for (auto _ : state) {
+        ::hybridse::vm::WindowIterator* it = table->NewWindowIterator(0);
+        it->SeekToFirst();
+        while (it->Valid()) {
+            std::unique_ptr<::hybridse::vm::RowIterator> wit = it->GetValue();
+            wit->SeekToFirst();
+            while (wit->Valid()) {
+                benchmark::DoNotOptimize(wit->GetValue());
+                wit->Next();
+                rows++;
+            }
+            it->Next();
+        }
+        delete it;
+    }
+    state.SetItemsProcessed(rows);
+    SetMemCounters(state, table);
+}
+BENCHMARK(BM_MemTableWindowIterate)->Apply(KeyAndValueArgs);
+
+static void BM_MemTableTraverse(benchmark::State& state) {
+    auto table = CreateFilledTable(state.range(0), state.range(1));
+    uint64_t rows = 0;
+    for (auto _ : state) {
+        TableIterator* it = table->NewTraverseIterator(0);
+        it->SeekToFirst();
+        while (it->Valid()) {
+            benchmark::DoNotOptimize(it->GetValue());
+            it->Next();
+            rows++;
+        }
+        delete it;
+    }
+    state.SetItemsProcessed(rows);
+    SetMemCounters(state, table);
+}
+BENCHMARK(BM_MemTableTraverse)->Apply(KeyAndValueArgs);
+
+// keeps the latest row of each key, so the gc drops all the others
+static void BM_MemTableGc(benchmark::State& state) {
+    std::vector<std::string> keys = GenKeys("key", state.range(0));
+    std::string value(state.range(1), 'v');
+    uint64_t gc_rows = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto table = CreateTable(1, 1, 0, ::fedb::api::TTLType::kLatestTime, 1);
+        for (uint32_t i = 0; i < kRowsPerKey; i++) {
+            for (const auto& key : keys) {
+                table->Put(key, kBaseTime + i, value.c_str(), value.size());
+            }
+        }
+        uint64_t before = table->GetRecordCnt();
+        state.ResumeTiming();
+        table->SchedGc();
+        state.PauseTiming();
+        gc_rows += before - table->GetRecordCnt();
+        table.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(gc_rows);
+}
+BENCHMARK(BM_MemTableGc)->Apply(KeyAndValueArgs);
+
+static bool WriteSnapshot(const std::string& path, uint32_t key_cnt, uint32_t value_size) {
+    FILE* fd_w = fopen(path.c_str(), "wb");
+    if (fd_w == NULL) {
+        return false;
+    }
+    ::fedb::log::WritableFile* wf = ::fedb::log::NewWritableFile(path, fd_w);
+    ::fedb::log::Writer writer(FLAGS_snapshot_compression, wf);
+    std::vector<std::string> keys = GenKeys("key", key_cnt);
+    ::fedb::api::LogEntry entry;
+    entry.set_value(std::string(value_size, 'v'));
+    ::fedb::api::Dimension* dim = entry.add_dimensions();
+    dim->set_idx(0);
+    std::string buf;
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < kRowsPerKey; i++) {
+        for (const auto& key : keys) {
+            entry.set_ts(kBaseTime + i);
+            entry.set_log_index(++offset);
+            dim->set_key(key);
+            entry.SerializeToString(&buf);
+            if (!writer.AddRecord(::fedb::base::Slice(buf)).ok()) {
+                delete wf;
+                return false;
+            }
+        }
+    }
+    writer.EndLog();
+    delete wf;
+    return true;
+}
+
+static void BM_SnapshotRecover(benchmark::State& state) {
+    uint32_t key_cnt = state.range(0);
+    uint32_t value_size = state.range(1);
+    uint32_t tid = 100;
+    uint32_t pid = state.range(0) + state.range(1);
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    MemTableSnapshot snapshot(tid, pid, log_part, FLAGS_db_root_path);
+    std::string snapshot_name = "storage_benchmark.sdb";
+    if (FLAGS_snapshot_compression != "off") {
+        snapshot_name.append(".");
+        snapshot_name.append(FLAGS_snapshot_compression);
+    }
+    std::string table_path = FLAGS_db_root_path + "/" + std::to_string(tid) + "_" + std::to_string(pid);
+    if (!snapshot.Init() || !WriteSnapshot(table_path + "/snapshot/" + snapshot_name, key_cnt, value_size)) {
+        state.SkipWithError("fail to write snapshot");
+        delete log_part;
+        return;
+    }
+    uint64_t expect_cnt = static_cast<uint64_t>(key_cnt) * kRowsPerKey;
+    std::shared_ptr<MemTable> table;
+    for (auto _ : state) {
+        state.PauseTiming();
+        table = CreateTable(tid, 1, 0, ::fedb::api::TTLType::kAbsoluteTime, 0);
+        state.ResumeTiming();
+        snapshot.RecoverFromSnapshot(snapshot_name, expect_cnt, table);
+    }
+    state.SetItemsProcessed(state.iterations() * expect_cnt);
+    SetMemCounters(state, table);
+    table.reset();
+    ::fedb::base::RemoveDirRecursive(table_path);
+    delete log_part;
+}
+BENCHMARK(BM_SnapshotRecover)->Apply(KeyAndValueArgs)->Unit(benchmark::kMillisecond);
+
+}  // namespace storage
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    // traverse the whole table rather than stop at the rpc limit
+    FLAGS_max_traverse_cnt = 0;
+    FLAGS_db_root_path = "/tmp/storage_benchmark";
+    ::benchmark::Initialize(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
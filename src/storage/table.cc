@@ -24,7 +24,7 @@
 namespace fedb {
 namespace storage {
 
-Table::Table() {}
+Table::Table() : put_cnt_(0), put_byte_size_(0), read_cnt_(0) {}
 
 Table::Table(const std::string &name,
              uint32_t id, uint32_t pid, uint64_t ttl, bool is_leader,
@@ -35,6 +35,9 @@ Table::Table(const std::string &name,
       : name_(name),
       id_(id),
       pid_(pid),
+      put_cnt_(0),
+      put_byte_size_(0),
+      read_cnt_(0),
       ttl_offset_(ttl_offset),
       is_leader_(is_leader),
       compress_type_(compress_type),
@@ -141,6 +141,20 @@ class Table {
         diskused_.store(size, std::memory_order_relaxed);
     }
 
+    // request counters reported to the nameserver to find hot partitions
+    inline void RecordPut(uint64_t byte_size) {
+        put_cnt_.fetch_add(1, std::memory_order_relaxed);
+        put_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    }
+
+    inline void RecordRead() { read_cnt_.fetch_add(1, std::memory_order_relaxed); }
+
+    inline uint64_t GetPutCnt() const { return put_cnt_.load(std::memory_order_relaxed); }
+
+    inline uint64_t GetPutByteSize() const { return put_byte_size_.load(std::memory_order_relaxed); }
+
+    inline uint64_t GetReadCnt() const { return read_cnt_.load(std::memory_order_relaxed); }
+
     inline void SetSchema(const std::string& schema) { schema_.assign(schema); }
 
     inline const std::string& GetSchema() { return schema_; }
@@ -222,6 +236,9 @@ class Table {
     uint32_t id_;
     uint32_t pid_;
     std::atomic<uint64_t> diskused_;
+    std::atomic<uint64_t> put_cnt_;
+    std::atomic<uint64_t> put_byte_size_;
+    std::atomic<uint64_t> read_cnt_;
     uint64_t ttl_offset_;
     bool is_leader_;
     std::atomic<uint32_t> table_status_;
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/admission_control.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "base/glog_wapper.h"
+
+namespace fedb {
+namespace tablet {
+
+static const char* CLASS_NAME[kRpcClassNum] = {"online", "write", "batch", "admin"};
+// the samples a window needs before the limit is updated
+static const uint64_t MIN_WINDOW_SAMPLES = 10;
+// the latency may grow to this times the no load one before the limit shrinks
+static const double LATENCY_TOLERANCE = 1.5;
+static const double LIMIT_SMOOTHING = 0.2;
+
+GradientLimiter::GradientLimiter(uint32_t min_limit, uint32_t max_limit, uint64_t window_us)
+    : min_limit_(std::max(min_limit, 1u)),
+      max_limit_(std::max(max_limit, std::max(min_limit, 1u))),
+      window_us_(window_us),
+      limit_(max_limit_),
+      window_start_(0),
+      sample_cnt_(0),
+      sample_sum_(0),
+      sample_min_(0),
+      no_load_latency_(0) {}
+
+uint32_t GradientLimiter::Update(int64_t latency_us, uint64_t now_us) {
+    latency_us = std::max(latency_us, static_cast<int64_t>(1));
+    if (sample_cnt_ == 0) {
+        window_start_ = now_us;
+        sample_min_ = latency_us;
+    }
+    sample_cnt_++;
+    sample_sum_ += latency_us;
+    sample_min_ = std::min(sample_min_, latency_us);
+    if (now_us < window_start_ + window_us_ || sample_cnt_ < MIN_WINDOW_SAMPLES) {
+        return GetLimit();
+    }
+    // the no load latency drifts up slowly, as the data and so the latency grow
+    if (no_load_latency_ == 0 || sample_min_ < no_load_latency_) {
+        no_load_latency_ = sample_min_;
+    } else {
+        no_load_latency_ = static_cast<int64_t>(no_load_latency_ * 0.95 + sample_min_ * 0.05);
+    }
+    double avg_latency = static_cast<double>(sample_sum_) / sample_cnt_;
+    double gradient = std::max(0.5, std::min(1.0, no_load_latency_ * LATENCY_TOLERANCE / avg_latency));
+    double new_limit = limit_ * gradient + sqrt(limit_);
+    limit_ = limit_ * (1 - LIMIT_SMOOTHING) + new_limit * LIMIT_SMOOTHING;
+    limit_ = std::max(static_cast<double>(min_limit_), std::min(static_cast<double>(max_limit_), limit_));
+    sample_cnt_ = 0;
+    sample_sum_ = 0;
+    return GetLimit();
+}
+
+const char* AdmissionController::GetClassName(RpcClass rpc_class) {
+    if (rpc_class < 0 || rpc_class >= kRpcClassNum) {
+        return "unknown";
+    }
+    return CLASS_NAME[rpc_class];
+}
+
+bool AdmissionController::ParseWeight(const std::string& weight, uint32_t weights[kRpcClassNum]) {
+    uint32_t parsed[kRpcClassNum];
+    std::fill(parsed, parsed + kRpcClassNum, 1);
+    std::stringstream ss(weight);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t pos = item.find(':');
+        if (pos == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, pos);
+        int idx = 0;
+        for (; idx < kRpcClassNum; idx++) {
+            if (name == CLASS_NAME[idx]) {
+                break;
+            }
+        }
+        if (idx == kRpcClassNum) {
+            return false;
+        }
+        try {
+            parsed[idx] = std::stoul(item.substr(pos + 1));
+        } catch (const std::exception& e) {
+            return false;
+        }
+        if (parsed[idx] == 0) {
+            return false;
+        }
+    }
+    std::copy(parsed, parsed + kRpcClassNum, weights);
+    return true;
+}
+
+AdmissionController::AdmissionController(const std::string& prefix, uint32_t max_concurrency,
+                                         const std::string& weight, uint32_t queue_size, uint32_t queue_timeout_ms)
+    : queue_size_(queue_size), queue_timeout_us_(queue_timeout_ms * 1000ul), classes_() {
+    uint32_t weights[kRpcClassNum];
+    std::fill(weights, weights + kRpcClassNum, 1);
+    if (!ParseWeight(weight, weights)) {
+        PDLOG(WARNING, "invalid rpc class weight %s, all classes get the same share", weight.c_str());
+    }
+    uint32_t total = 0;
+    for (int idx = 0; idx < kRpcClassNum; idx++) {
+        total += weights[idx];
+    }
+    for (int idx = 0; idx < kRpcClassNum; idx++) {
+        ClassState& state = classes_[idx];
+        uint32_t max_limit = std::max(1u, static_cast<uint32_t>(uint64_t(max_concurrency) * weights[idx] / total));
+        state.limiter.reset(new GradientLimiter(std::max(1u, max_limit / 8), max_limit, 100 * 1000));
+        std::string name = std::string(CLASS_NAME[idx]);
+        state.rejected.reset(new bvar::Adder<uint64_t>(prefix, name + "_rejected_count"));
+        state.limit_var.reset(new bvar::PassiveStatus<uint32_t>(prefix, name + "_limit", GetLimitVar, &state));
+        state.running_var.reset(new bvar::PassiveStatus<uint32_t>(prefix, name + "_running", GetRunningVar, &state));
+        PDLOG(INFO, "rpc class %s gets the concurrency limit %u", CLASS_NAME[idx], max_limit);
+    }
+}
+
+uint32_t AdmissionController::GetLimitVar(void* arg) {
+    ClassState* state = static_cast<ClassState*>(arg);
+    std::lock_guard<bthread::Mutex> lock(state->mu);
+    return state->limiter->GetLimit();
+}
+
+uint32_t AdmissionController::GetRunningVar(void* arg) {
+    ClassState* state = static_cast<ClassState*>(arg);
+    std::lock_guard<bthread::Mutex> lock(state->mu);
+    return state->running;
+}
+
+uint32_t AdmissionController::GetLimit(RpcClass rpc_class) { return GetLimitVar(&classes_[rpc_class]); }
+
+uint32_t AdmissionController::GetRunningCnt(RpcClass rpc_class) { return GetRunningVar(&classes_[rpc_class]); }
+
+bool AdmissionController::Acquire(RpcClass rpc_class) {
+    ClassState& state = classes_[rpc_class];
+    std::unique_lock<bthread::Mutex> lock(state.mu);
+    if (state.running < state.limiter->GetLimit()) {
+        state.running++;
+        return true;
+    }
+    if (state.waiting >= queue_size_ || queue_timeout_us_ == 0) {
+        *state.rejected << 1;
+        return false;
+    }
+    state.waiting++;
+    uint64_t deadline = ::baidu::common::timer::get_micros() + queue_timeout_us_;
+    while (state.running >= state.limiter->GetLimit()) {
+        uint64_t now = ::baidu::common::timer::get_micros();
+        if (now >= deadline) {
+            break;
+        }
+        state.cv.wait_for(lock, deadline - now);
+    }
+    state.waiting--;
+    if (state.running >= state.limiter->GetLimit()) {
+        *state.rejected << 1;
+        return false;
+    }
+    state.running++;
+    return true;
+}
+
+void AdmissionController::Release(RpcClass rpc_class, int64_t latency_us) {
+    ClassState& state = classes_[rpc_class];
+    std::lock_guard<bthread::Mutex> lock(state.mu);
+    if (state.running > 0) {
+        state.running--;
+    }
+    uint32_t limit = state.limiter->Update(latency_us, ::baidu::common::timer::get_micros());
+    if (state.waiting > 0 && state.running < limit) {
+        state.cv.notify_one();
+    }
+}
+
+}  // namespace tablet
+}  // namespace fedb
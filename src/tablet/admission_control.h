@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <bvar/bvar.h>
+#include <google/protobuf/stubs/callback.h>
+
+#include <memory>
+#include <string>
+
+#include "bthread/condition_variable.h"
+#include "bthread/mutex.h"
+#include "common/timer.h"
+
+namespace fedb {
+namespace tablet {
+
+enum RpcClass {
+    // request mode queries, procedures, get and scan
+    kOnlineRpc = 0,
+    kWriteRpc,
+    // batch mode queries, traverse and count
+    kBatchRpc,
+    // replication
+    kAdminRpc,
+    kRpcClassNum,
+};
+
+// concurrency limit that follows the latency gradient. every window the limit
+// is scaled by no_load_latency * tolerance / window_latency, so it shrinks
+// once requests queue up in the server and grows by sqrt(limit) while the
+// latency stays near the lowest one seen
+class GradientLimiter {
+ public:
+    GradientLimiter(uint32_t min_limit, uint32_t max_limit, uint64_t window_us);
+
+    // adds the latency of a finished request and returns the limit
+    uint32_t Update(int64_t latency_us, uint64_t now_us);
+
+    uint32_t GetLimit() const { return static_cast<uint32_t>(limit_); }
+    int64_t GetNoLoadLatency() const { return no_load_latency_; }
+
+ private:
+    uint32_t min_limit_;
+    uint32_t max_limit_;
+    uint64_t window_us_;
+    double limit_;
+    uint64_t window_start_;
+    uint64_t sample_cnt_;
+    int64_t sample_sum_;
+    int64_t sample_min_;
+    int64_t no_load_latency_;
+};
+
+// admission of the tablet rpcs by class. each class gets a share of
+// max_concurrency by its weight as the upper bound of its adaptive limit, and
+// its own wait queue, so a burst of batch queries does not hold up the online
+// requests and the writes. an rpc is rejected if the queue of its class is
+// full or it waits longer than queue_timeout_ms. the limits, the running rpcs
+// and the rejections of every class show on /vars
+class AdmissionController {
+ public:
+    // weight is like online:4,write:2,batch:1,admin:1, missing classes get 1
+    AdmissionController(const std::string& prefix, uint32_t max_concurrency, const std::string& weight,
+                        uint32_t queue_size, uint32_t queue_timeout_ms);
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    // waits in the queue of the class. it returns false if the rpc is rejected
+    bool Acquire(RpcClass rpc_class);
+
+    // latency_us is the time from Acquire to the response
+    void Release(RpcClass rpc_class, int64_t latency_us);
+
+    uint32_t GetLimit(RpcClass rpc_class);
+    uint32_t GetRunningCnt(RpcClass rpc_class);
+    uint64_t GetRejectedCnt(RpcClass rpc_class) { return classes_[rpc_class].rejected->get_value(); }
+
+    static const char* GetClassName(RpcClass rpc_class);
+    static bool ParseWeight(const std::string& weight, uint32_t weights[kRpcClassNum]);
+
+ private:
+    struct ClassState {
+        bthread::Mutex mu;
+        bthread::ConditionVariable cv;
+        uint32_t running = 0;
+        uint32_t waiting = 0;
+        std::unique_ptr<GradientLimiter> limiter;
+        std::unique_ptr<bvar::Adder<uint64_t>> rejected;
+        std::unique_ptr<bvar::PassiveStatus<uint32_t>> limit_var;
+        std::unique_ptr<bvar::PassiveStatus<uint32_t>> running_var;
+    };
+
+    static uint32_t GetLimitVar(void* arg);
+    static uint32_t GetRunningVar(void* arg);
+
+ private:
+    uint32_t queue_size_;
+    uint64_t queue_timeout_us_;
+    ClassState classes_[kRpcClassNum];
+};
+
+// releases the admission before handing the response to the wrapped closure
+class AdmissionClosure : public google::protobuf::Closure {
+ public:
+    AdmissionClosure(AdmissionController* controller, RpcClass rpc_class, google::protobuf::Closure* done)
+        : controller_(controller),
+          rpc_class_(rpc_class),
+          done_(done),
+          start_time_(::baidu::common::timer::get_micros()) {}
+
+    void Run() override {
+        controller_->Release(rpc_class_, ::baidu::common::timer::get_micros() - start_time_);
+        google::protobuf::Closure* done = done_;
+        delete this;
+        done->Run();
+    }
+
+ private:
+    AdmissionController* controller_;
+    RpcClass rpc_class_;
+    google::protobuf::Closure* done_;
+    uint64_t start_time_;
+};
+
+}  // namespace tablet
+}  // namespace fedb
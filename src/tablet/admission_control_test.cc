@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/admission_control.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace tablet {
+
+class AdmissionControlTest : public ::testing::Test {
+ public:
+    AdmissionControlTest() {}
+    ~AdmissionControlTest() {}
+};
+
+// a window of 1ms with 11 samples, the last one updates the limit
+static uint32_t RunWindow(GradientLimiter* limiter, int64_t latency_us, uint64_t* now_us) {
+    uint32_t limit = 0;
+    for (int i = 0; i <= 10; i++) {
+        limit = limiter->Update(latency_us, *now_us);
+        *now_us += 100;
+    }
+    return limit;
+}
+
+TEST_F(AdmissionControlTest, GradientLimiter) {
+    GradientLimiter limiter(2, 100, 1000);
+    ASSERT_EQ(100u, limiter.GetLimit());
+    uint64_t now_us = 1;
+    ASSERT_EQ(100u, RunWindow(&limiter, 100, &now_us));
+    ASSERT_EQ(100, limiter.GetNoLoadLatency());
+    // the limit shrinks while the latency is ten times the no load one
+    uint32_t last_limit = 100;
+    for (int i = 0; i < 5; i++) {
+        uint32_t limit = RunWindow(&limiter, 1000, &now_us);
+        ASSERT_LT(limit, last_limit);
+        last_limit = limit;
+    }
+    ASSERT_GE(last_limit, 2u);
+    // and grows back once it is low again
+    for (int i = 0; i < 50; i++) {
+        RunWindow(&limiter, 100, &now_us);
+    }
+    ASSERT_EQ(100u, limiter.GetLimit());
+}
+
+TEST_F(AdmissionControlTest, ParseWeight) {
+    uint32_t weights[kRpcClassNum] = {0};
+    ASSERT_TRUE(AdmissionController::ParseWeight("online:4,batch:2", weights));
+    ASSERT_EQ(4u, weights[kOnlineRpc]);
+    ASSERT_EQ(1u, weights[kWriteRpc]);
+    ASSERT_EQ(2u, weights[kBatchRpc]);
+    ASSERT_EQ(1u, weights[kAdminRpc]);
+    ASSERT_FALSE(AdmissionController::ParseWeight("query:1", weights));
+    ASSERT_FALSE(AdmissionController::ParseWeight("online:x", weights));
+    ASSERT_FALSE(AdmissionController::ParseWeight("online:0", weights));
+    ASSERT_EQ(4u, weights[kOnlineRpc]);
+}
+
+class CountClosure : public google::protobuf::Closure {
+ public:
+    CountClosure() : cnt_(0) {}
+    void Run() override { cnt_++; }
+    int cnt_;
+};
+
+TEST_F(AdmissionControlTest, Acquire) {
+    // online gets 4 of 8, the other classes 1 and 2
+    AdmissionController controller("admission_control_test", 8, "online:4,write:2,batch:1,admin:1", 1, 1);
+    ASSERT_EQ(4u, controller.GetLimit(kOnlineRpc));
+    ASSERT_EQ(1u, controller.GetLimit(kBatchRpc));
+    ASSERT_TRUE(controller.Acquire(kBatchRpc));
+    // the batch class is full, but the others are not held up
+    ASSERT_FALSE(controller.Acquire(kBatchRpc));
+    ASSERT_EQ(1u, controller.GetRejectedCnt(kBatchRpc));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(controller.Acquire(kOnlineRpc));
+    }
+    ASSERT_FALSE(controller.Acquire(kOnlineRpc));
+    ASSERT_TRUE(controller.Acquire(kWriteRpc));
+    CountClosure done;
+    google::protobuf::Closure* closure = new AdmissionClosure(&controller, kBatchRpc, &done);
+    closure->Run();
+    ASSERT_EQ(1, done.cnt_);
+    ASSERT_EQ(0u, controller.GetRunningCnt(kBatchRpc));
+    ASSERT_TRUE(controller.Acquire(kBatchRpc));
+    ASSERT_EQ(4u, controller.GetRunningCnt(kOnlineRpc));
+}
+
+}  // namespace tablet
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
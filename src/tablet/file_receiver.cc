@@ -17,13 +17,28 @@
 
 
 #include "tablet/file_receiver.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
 #include "base/strings.h"
+#include "log/crc32c.h"
 
 namespace fedb {
 namespace tablet {
 
+uint32_t BlockChecksum(const butil::IOBuf& data) {
+    uint32_t crc = 0;
+    for (size_t i = 0; i < data.backing_block_num(); i++) {
+        butil::StringPiece piece = data.backing_block(i);
+        crc = ::fedb::log::Extend(crc, piece.data(), piece.size());
+    }
+    return crc;
+}
+
 FileReceiver::FileReceiver(const std::string& file_name,
                            const std::string& dir_name, const std::string& path)
     : file_name_(file_name),
@@ -31,13 +46,16 @@ FileReceiver::FileReceiver(const std::string& file_name,
       path_(path),
       size_(0),
       block_id_(0),
-      file_(NULL) {}
+      pending_blocks_(),
+      file_(NULL),
+      mu_() {}
 
 FileReceiver::~FileReceiver() {
     if (file_) fclose(file_);
 }
 
 bool FileReceiver::Init() {
+    std::lock_guard<std::mutex> lock(mu_);
     if (file_) {
         fclose(file_);
         file_ = NULL;
@@ -56,13 +74,24 @@ bool FileReceiver::Init() {
         return false;
     }
     file_ = file;
+    size_ = 0;
     block_id_ = 0;
+    pending_blocks_.clear();
     return true;
 }
 
-uint64_t FileReceiver::GetBlockId() { return block_id_; }
+uint64_t FileReceiver::GetBlockId() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return block_id_;
+}
+
+bool FileReceiver::IsOpen() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return file_ != NULL;
+}
 
 int FileReceiver::WriteData(const std::string& data, uint64_t block_id) {
+    std::lock_guard<std::mutex> lock(mu_);
     if (file_ == NULL) {
         PDLOG(WARNING, "file is NULL");
         return -1;
@@ -88,7 +117,44 @@ int FileReceiver::WriteData(const std::string& data, uint64_t block_id) {
     return 0;
 }
 
+int FileReceiver::WriteBlock(butil::IOBuf* data, uint64_t block_id, uint64_t offset) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (file_ == NULL) {
+        PDLOG(WARNING, "file is NULL");
+        return -1;
+    }
+    if (block_id <= block_id_ || pending_blocks_.count(block_id) > 0) {
+        DEBUGLOG("block id %lu has been received", block_id);
+        return 0;
+    }
+    int fd = fileno(file_);
+    uint64_t written = 0;
+    while (!data->empty()) {
+        ssize_t r = data->pcut_into_file_descriptor(fd, offset + written);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            PDLOG(WARNING, "write error. name %s%s offset %lu error %s", path_.c_str(), file_name_.c_str(),
+                  offset + written, strerror(errno));
+            return -1;
+        }
+        written += r;
+    }
+    size_ += written;
+    pending_blocks_.insert(block_id);
+    while (!pending_blocks_.empty() && *pending_blocks_.begin() == block_id_ + 1) {
+        block_id_++;
+        pending_blocks_.erase(pending_blocks_.begin());
+    }
+    return 0;
+}
+
 void FileReceiver::SaveFile() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (file_) {
+        fflush(file_);
+    }
     std::string full_path = path_ + file_name_;
     std::string tmp_file_path = full_path + ".tmp";
     if (::fedb::base::IsExists(full_path)) {
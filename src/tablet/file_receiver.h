@@ -17,11 +17,18 @@
 
 #pragma once
 
+#include <mutex>  // NOLINT
+#include <set>
 #include <string>
 
+#include "butil/iobuf.h"
+
 namespace fedb {
 namespace tablet {
 
+// crc32c of a block, computed over the iobuf blocks without flattening them
+uint32_t BlockChecksum(const butil::IOBuf& data);
+
 class FileReceiver {
  public:
     FileReceiver(const std::string& file_name, const std::string& dir_name,
@@ -31,8 +38,13 @@ class FileReceiver {
     FileReceiver& operator=(const FileReceiver&) = delete;
     bool Init();
     int WriteData(const std::string& data, uint64_t block_id);
+    // write a block at offset, blocks of a pipelined sender may come out of order.
+    // data is cut into the file with pwritev, no copy is made
+    int WriteBlock(butil::IOBuf* data, uint64_t block_id, uint64_t offset);
     void SaveFile();
+    // all blocks up to the returned id have been written
     uint64_t GetBlockId();
+    bool IsOpen();
 
  private:
     std::string file_name_;
@@ -40,7 +52,10 @@ class FileReceiver {
     std::string path_;
     uint64_t size_;
     uint64_t block_id_;
+    // blocks written after a gap
+    std::set<uint64_t> pending_blocks_;
     FILE* file_;
+    std::mutex mu_;
 };
 
 }  // namespace tablet
@@ -16,6 +16,12 @@
 
 #include "tablet/file_sender.h"
 
+#include <brpc/callback.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <thread> // NOLINT
 #include <vector>
 #include "boost/algorithm/string/predicate.hpp"
@@ -23,16 +29,16 @@
 #include "base/glog_wapper.h"
 #include "common/timer.h"
 #include "gflags/gflags.h"
+#include "tablet/file_receiver.h"
 
 DECLARE_int32(send_file_max_try);
 DECLARE_uint32(stream_block_size);
 DECLARE_int32(stream_bandwidth_limit);
-DECLARE_uint32(stream_block_size);
-DECLARE_int32(stream_bandwidth_limit);
-DECLARE_int32(stream_close_wait_time_ms);
 DECLARE_int32(retry_send_file_wait_time_ms);
 DECLARE_int32(request_max_retry);
 DECLARE_int32(request_timeout_ms);
+DECLARE_uint32(send_file_window_size);
+DECLARE_uint32(send_dir_parallelism);
 
 namespace fedb {
 namespace tablet {
@@ -42,9 +48,9 @@ FileSender::FileSender(uint32_t tid, uint32_t pid,
     : tid_(tid),
       pid_(pid),
       endpoint_(endpoint),
-      cur_try_time_(0),
       max_try_time_(FLAGS_send_file_max_try),
-      limit_time_(0),
+      window_size_(std::max(FLAGS_send_file_window_size, 1u)),
+      limiter_(),
       channel_(NULL),
       stub_(NULL) {}
 
@@ -54,13 +60,10 @@ FileSender::~FileSender() {
 }
 
 bool FileSender::Init() {
-    // compute the used time(microseconds) that send a block by limit bandwidth.
-    // limit_time = (FLAGS_stream_block_size / FLAGS_stream_bandwidth_limit) *
-    // 1000 * 1000
-    if (FLAGS_stream_bandwidth_limit > 0) {
-        limit_time_ =
-            (FLAGS_stream_block_size * 1000000) / FLAGS_stream_bandwidth_limit;
-    }
+    // the bucket holds one window of blocks, so a burst never exceeds what is in flight
+    uint64_t rate = FLAGS_stream_bandwidth_limit > 0 ? FLAGS_stream_bandwidth_limit : 0;
+    limiter_.reset(new ::fedb::base::RateLimiter(
+        rate, static_cast<uint64_t>(FLAGS_stream_block_size) * window_size_));
     channel_ = new brpc::Channel();
     brpc::ChannelOptions options;
     options.timeout_ms = FLAGS_request_timeout_ms;
@@ -74,13 +77,9 @@ bool FileSender::Init() {
     return true;
 }
 
-int FileSender::WriteData(const std::string& file_name,
-                          const std::string& dir_name, const char* buffer,
-                          size_t len, uint64_t block_id) {
-    if (buffer == NULL) {
-        return -1;
-    }
-    uint64_t cur_time = ::baidu::common::timer::get_micros();
+int FileSender::OpenReceiver(const std::string& file_name,
+                             const std::string& dir_name, bool resume,
+                             uint64_t* block_id) {
     ::fedb::api::SendDataRequest request;
     request.set_tid(tid_);
     request.set_pid(pid_);
@@ -88,16 +87,11 @@ int FileSender::WriteData(const std::string& file_name,
     if (!dir_name.empty()) {
         request.set_dir_name(dir_name);
     }
-    request.set_block_id(block_id);
-    request.set_block_size(len);
+    request.set_block_id(0);
+    request.set_block_size(0);
+    request.set_resume(resume);
     brpc::Controller cntl;
-    if (block_id > 0) {
-        cntl.request_attachment().append(buffer, len);
-    }
-    if (len > 0 && len < FLAGS_stream_block_size) {
-        request.set_eof(true);
-    }
-    ::fedb::api::GeneralResponse response;
+    ::fedb::api::SendDataResponse response;
     stub_->SendData(&cntl, &request, &response, NULL);
     if (cntl.Failed()) {
         PDLOG(WARNING, "send data failed. tid %u pid %u file %s error msg %s",
@@ -108,12 +102,22 @@ int FileSender::WriteData(const std::string& file_name,
               tid_, pid_, file_name.c_str(), response.msg().c_str());
         return -1;
     }
-    uint64_t time_used = ::baidu::common::timer::get_micros() - cur_time;
-    if (limit_time_ > time_used && len > FLAGS_stream_block_size / 2) {
-        uint64_t sleep_time = limit_time_ - time_used;
-        DEBUGLOG("sleep %lu us, limit_time %lu time_used %lu", sleep_time,
-              limit_time_, time_used);
-        std::this_thread::sleep_for(std::chrono::microseconds(sleep_time));
+    *block_id = response.block_id();
+    return 0;
+}
+
+int FileSender::WaitBlock(BlockCall* call) {
+    brpc::Join(call->cntl.call_id());
+    if (call->cntl.Failed()) {
+        PDLOG(WARNING, "send data failed. tid %u pid %u file %s block %lu error msg %s",
+              tid_, pid_, call->request.file_name().c_str(), call->request.block_id(),
+              call->cntl.ErrorText().c_str());
+        return -1;
+    } else if (call->response.code() != 0) {
+        PDLOG(WARNING, "send data failed. tid %u pid %u file %s block %lu error msg %s",
+              tid_, pid_, call->request.file_name().c_str(), call->request.block_id(),
+              call->response.msg().c_str());
+        return -1;
     }
     return 0;
 }
@@ -138,17 +142,19 @@ int FileSender::SendFile(const std::string& file_name,
     }
     PDLOG(INFO, "send file %s to %s. size[%lu]", full_path.c_str(),
           endpoint_.c_str(), file_size);
-    int try_times = FLAGS_send_file_max_try;
+    int try_times = max_try_time_;
     do {
-        if (try_times < FLAGS_send_file_max_try) {
+        if (try_times < static_cast<int>(max_try_time_)) {
             std::this_thread::sleep_for(std::chrono::milliseconds(
-                (FLAGS_send_file_max_try - try_times) *
+                (max_try_time_ - try_times) *
                 FLAGS_retry_send_file_wait_time_ms));
             PDLOG(INFO, "retry to send file %s to %s. total size[%lu]",
                   full_path.c_str(), endpoint_.c_str(), file_size);
         }
+        // a retry keeps what the receiver got from the last try
+        bool resume = try_times < static_cast<int>(max_try_time_);
         try_times--;
-        if (SendFileInternal(file_name, dir_name, full_path, file_size) < 0) {
+        if (SendFileInternal(file_name, dir_name, full_path, file_size, resume) < 0) {
             continue;
         }
         if (CheckFile(file_name, dir_name, file_size) < 0) {
@@ -162,63 +168,110 @@ int FileSender::SendFile(const std::string& file_name,
 int FileSender::SendFileInternal(const std::string& file_name,
                                  const std::string& dir_name,
                                  const std::string& full_path,
-                                 uint64_t file_size) {
-    FILE* file = fopen(full_path.c_str(), "rb");
-    if (file == NULL) {
+                                 uint64_t file_size, bool resume) {
+    uint64_t block_id = 0;
+    if (OpenReceiver(file_name, dir_name, resume, &block_id) < 0) {
+        PDLOG(WARNING, "Init file receiver failed. tid[%u] pid[%u] file %s",
+              tid_, pid_, file_name.c_str());
+        return -1;
+    }
+    uint64_t block_size = FLAGS_stream_block_size;
+    // an empty file still sends one block to carry eof
+    uint64_t block_num = file_size == 0 ? 1 : (file_size + block_size - 1) / block_size;
+    if (block_id >= block_num) {
+        // the last block is the one that saves the file, always send it
+        block_id = block_num - 1;
+    }
+    int fd = open(full_path.c_str(), O_RDONLY);
+    if (fd < 0) {
         PDLOG(WARNING, "fail to open file %s", full_path.c_str());
         return -1;
     }
-    char buffer[FLAGS_stream_block_size];
-
-    uint64_t block_num = file_size / FLAGS_stream_block_size + 1;
+#ifndef __APPLE__
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    if (block_id > 0) {
+        PDLOG(INFO, "resume sending file %s from block %lu. total block num[%lu] tid[%u] pid[%u] endpoint[%s]",
+              file_name.c_str(), block_id + 1, block_num, tid_, pid_, endpoint_.c_str());
+    }
+    std::deque<std::unique_ptr<BlockCall>> calls;
     uint64_t report_block_num = block_num / 100;
     int ret = 0;
-    uint64_t block_count = 0;
-    do {
-        if (block_count == 0 &&
-            WriteData(file_name, dir_name, buffer, 0, block_count) < 0) {
-            PDLOG(WARNING, "Init file receiver failed. tid[%u] pid[%u] file %s",
-                  tid_, pid_, file_name.c_str());
-            ret = -1;
-            break;
-        }
-        block_count++;
-
-#ifdef __APPLE__
-        size_t len = fread(buffer, 1, FLAGS_stream_block_size, file);
-#else
-        size_t len = fread_unlocked(buffer, 1, FLAGS_stream_block_size, file);
-#endif
-        if (len < FLAGS_stream_block_size) {
-            if (feof(file)) {
-                if (len > 0) {
-                    ret = WriteData(file_name, dir_name, buffer, len,
-                                    block_count);
-                }
+    while (block_id < block_num) {
+        block_id++;
+        uint64_t offset = (block_id - 1) * block_size;
+        size_t len = std::min(block_size, file_size - offset);
+        // read the range into iobuf blocks which go to the socket as they are
+        butil::IOPortal data;
+        while (data.size() < len) {
+            ssize_t r = data.pappend_from_file_descriptor(fd, offset + data.size(), len - data.size());
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r <= 0) {
                 break;
             }
+        }
+        if (data.size() < len) {
             PDLOG(WARNING, "read file %s error. error message: %s",
                   file_name.c_str(), strerror(errno));
             ret = -1;
             break;
         }
-        if (WriteData(file_name, dir_name, buffer, len, block_count) < 0) {
-            PDLOG(WARNING, "data write failed. tid[%u] pid[%u] file %s", tid_,
-                  pid_, file_name.c_str());
-            ret = -1;
-            break;
+        bool eof = block_id == block_num;
+        if (eof) {
+            // the receiver saves the file on the last block, so every other
+            // block has to be acknowledged before it goes out
+            while (ret == 0 && !calls.empty()) {
+                ret = WaitBlock(calls.front().get());
+                calls.pop_front();
+            }
+            if (ret < 0) {
+                break;
+            }
+        }
+        limiter_->Acquire(len);
+        std::unique_ptr<BlockCall> call(new BlockCall());
+        ::fedb::api::SendDataRequest& request = call->request;
+        request.set_tid(tid_);
+        request.set_pid(pid_);
+        request.set_file_name(file_name);
+        if (!dir_name.empty()) {
+            request.set_dir_name(dir_name);
+        }
+        request.set_block_id(block_id);
+        request.set_block_size(len);
+        request.set_offset(offset);
+        request.set_checksum(BlockChecksum(data));
+        request.set_eof(eof);
+        call->cntl.request_attachment().append(data);
+        stub_->SendData(&call->cntl, &call->request, &call->response, brpc::DoNothing());
+        calls.push_back(std::move(call));
+        if (calls.size() >= window_size_) {
+            ret = WaitBlock(calls.front().get());
+            calls.pop_front();
+            if (ret < 0) {
+                PDLOG(WARNING, "data write failed. tid[%u] pid[%u] file %s", tid_,
+                      pid_, file_name.c_str());
+                break;
+            }
         }
-        if (report_block_num == 0 || block_count % report_block_num == 0) {
+        if (report_block_num == 0 || block_id % report_block_num == 0) {
             PDLOG(INFO,
                   "send block num[%lu] total block num[%lu]. tid[%u] pid[%u] "
                   "file[%s] endpoint[%s]",
-                  block_count, block_num, tid_, pid_, file_name.c_str(),
+                  block_id, block_num, tid_, pid_, file_name.c_str(),
                   endpoint_.c_str());
         }
-    } while (true);
-    fclose(file);
-    std::this_thread::sleep_for(
-        std::chrono::milliseconds(FLAGS_stream_close_wait_time_ms));
+    }
+    // never leave a call in flight, it refers to the controller here
+    while (!calls.empty()) {
+        if (WaitBlock(calls.front().get()) < 0) {
+            ret = -1;
+        }
+        calls.pop_front();
+    }
+    close(fd);
     return ret;
 }
 
@@ -255,13 +308,34 @@ int FileSender::SendDir(const std::string& dir_name,
                         const std::string& full_path) {
     std::vector<std::string> file_vec;
     ::fedb::base::GetFileName(full_path, file_vec);
-    for (const std::string& file : file_vec) {
-        if (SendFile(file.substr(file.find_last_of("/") + 1), dir_name, file) <
-            0) {
-            return -1;
+    if (file_vec.empty()) {
+        return 0;
+    }
+    std::atomic<uint32_t> next(0);
+    std::atomic<bool> failed(false);
+    auto send = [&]() {
+        while (!failed.load(std::memory_order_relaxed)) {
+            uint32_t idx = next.fetch_add(1, std::memory_order_relaxed);
+            if (idx >= file_vec.size()) {
+                break;
+            }
+            const std::string& file = file_vec[idx];
+            if (SendFile(file.substr(file.find_last_of("/") + 1), dir_name, file) < 0) {
+                failed.store(true, std::memory_order_relaxed);
+            }
         }
+    };
+    uint32_t parallelism = std::min(static_cast<uint32_t>(file_vec.size()),
+                                    std::max(FLAGS_send_dir_parallelism, 1u));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < parallelism; i++) {
+        threads.emplace_back(send);
     }
-    return 0;
+    send();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return failed.load(std::memory_order_relaxed) ? -1 : 0;
 }
 
 }  // namespace tablet
@@ -19,12 +19,17 @@
 
 #include <brpc/channel.h>
 #include <brpc/controller.h>
+#include <memory>
 #include <string>
+#include "base/rate_limiter.h"
 #include "proto/tablet.pb.h"
 
 namespace fedb {
 namespace tablet {
 
+// sends files block by block with a window of blocks in flight. the receiver
+// writes every block at its offset, so a retry resumes after the last block
+// it has acknowledged instead of starting over
 class FileSender {
  public:
     FileSender(uint32_t tid, uint32_t pid,
@@ -36,20 +41,32 @@ class FileSender {
     int SendFile(const std::string& file_name, const std::string& full_path);
     int SendFileInternal(const std::string& file_name,
                          const std::string& dir_name,
-                         const std::string& full_path, uint64_t file_size);
+                         const std::string& full_path, uint64_t file_size,
+                         bool resume);
+    // send the files of a directory in parallel
     int SendDir(const std::string& dir_name, const std::string& full_path);
-    int WriteData(const std::string& file_name, const std::string& dir_name,
-                  const char* buffer, size_t len, uint64_t block_id);
     int CheckFile(const std::string& file_name, const std::string& dir_name,
                   uint64_t file_size);
 
+ private:
+    struct BlockCall {
+        brpc::Controller cntl;
+        ::fedb::api::SendDataRequest request;
+        ::fedb::api::SendDataResponse response;
+    };
+
+    // open the receiver, block_id is the last block it already has
+    int OpenReceiver(const std::string& file_name, const std::string& dir_name,
+                     bool resume, uint64_t* block_id);
+    int WaitBlock(BlockCall* call);
+
  private:
     uint32_t tid_;
     uint32_t pid_;
     std::string endpoint_;
-    uint32_t cur_try_time_;
     uint32_t max_try_time_;
-    uint64_t limit_time_;
+    uint32_t window_size_;
+    std::unique_ptr<::fedb::base::RateLimiter> limiter_;
     brpc::Channel* channel_;
     ::fedb::api::TabletServer_Stub* stub_;
 };
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/load_scheduler.h"
+
+#include <utility>
+
+namespace fedb {
+namespace tablet {
+
+LoadScheduler::LoadScheduler(uint32_t concurrency)
+    : concurrency_(concurrency > 0 ? concurrency : 1), seq_(0), stop_(false), tasks_(), threads_(), mu_(), cv_() {}
+
+LoadScheduler::~LoadScheduler() { Stop(); }
+
+void LoadScheduler::Submit(const std::string& disk, bool is_leader, uint64_t size,
+                           const std::function<void()>& task) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (stop_) {
+        return;
+    }
+    auto it = tasks_.find(disk);
+    if (it == tasks_.end()) {
+        it = tasks_.emplace(disk, std::set<LoadTask>()).first;
+        // the workers of a disk are started with its first load
+        for (uint32_t idx = 0; idx < concurrency_; idx++) {
+            threads_.emplace_back(&LoadScheduler::Run, this, disk);
+        }
+    }
+    it->second.insert(LoadTask{is_leader, size, seq_++, task});
+    cv_.notify_all();
+}
+
+void LoadScheduler::Run(const std::string& disk) {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            auto& disk_tasks = tasks_[disk];
+            cv_.wait(lock, [&] { return stop_ || !disk_tasks.empty(); });
+            if (stop_) {
+                return;
+            }
+            task = std::move(disk_tasks.begin()->task);
+            disk_tasks.erase(disk_tasks.begin());
+        }
+        task();
+    }
+}
+
+void LoadScheduler::Stop() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+        tasks_.clear();
+        threads.swap(threads_);
+        cv_.notify_all();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+uint32_t LoadScheduler::GetWaitingCnt() {
+    std::lock_guard<std::mutex> lock(mu_);
+    uint32_t cnt = 0;
+    for (const auto& kv : tasks_) {
+        cnt += kv.second.size();
+    }
+    return cnt;
+}
+
+}  // namespace tablet
+}  // namespace fedb
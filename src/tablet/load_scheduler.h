@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace fedb {
+namespace tablet {
+
+// runs the table loads of a tablet. every disk runs at most concurrency loads
+// at a time, so one disk is not thrashed while another idles. the waiting
+// loads of a disk start with the leaders, then the smaller partitions, so the
+// tablet serves as much as possible early
+class LoadScheduler {
+ public:
+    explicit LoadScheduler(uint32_t concurrency);
+    ~LoadScheduler();
+    LoadScheduler(const LoadScheduler&) = delete;
+    LoadScheduler& operator=(const LoadScheduler&) = delete;
+
+    // size is the bytes the load reads from the disk
+    void Submit(const std::string& disk, bool is_leader, uint64_t size, const std::function<void()>& task);
+
+    // waits for the running loads and drops the waiting ones
+    void Stop();
+
+    uint32_t GetWaitingCnt();
+
+ private:
+    struct LoadTask {
+        bool is_leader;
+        uint64_t size;
+        uint64_t seq;
+        std::function<void()> task;
+
+        bool operator<(const LoadTask& other) const {
+            if (is_leader != other.is_leader) {
+                return is_leader;
+            }
+            if (size != other.size) {
+                return size < other.size;
+            }
+            return seq < other.seq;
+        }
+    };
+
+    void Run(const std::string& disk);
+
+ private:
+    uint32_t concurrency_;
+    uint64_t seq_;
+    bool stop_;
+    std::map<std::string, std::set<LoadTask>> tasks_;
+    std::vector<std::thread> threads_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+}  // namespace tablet
+}  // namespace fedb
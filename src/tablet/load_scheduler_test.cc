@@ -0,0 +1,104 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/load_scheduler.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/count_down_latch.h"
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace tablet {
+
+class LoadSchedulerTest : public ::testing::Test {
+ public:
+    LoadSchedulerTest() {}
+    ~LoadSchedulerTest() {}
+};
+
+TEST_F(LoadSchedulerTest, Order) {
+    LoadScheduler scheduler(1);
+    ::fedb::base::CountDownLatch started(1);
+    ::fedb::base::CountDownLatch block(1);
+    ::fedb::base::CountDownLatch done(6);
+    std::mutex mu;
+    std::vector<std::string> order;
+    auto add = [&](const std::string& name) {
+        std::lock_guard<std::mutex> lock(mu);
+        order.push_back(name);
+        done.CountDown();
+    };
+    // holds the only worker of the disk until all loads are queued
+    scheduler.Submit("/disk0", false, 1, [&] {
+        started.CountDown();
+        block.Wait();
+        add("first");
+    });
+    started.Wait();
+    scheduler.Submit("/disk0", false, 300, [&] { add("f300"); });
+    scheduler.Submit("/disk0", false, 100, [&] { add("f100"); });
+    scheduler.Submit("/disk0", true, 500, [&] { add("l500"); });
+    scheduler.Submit("/disk0", true, 200, [&] { add("l200"); });
+    scheduler.Submit("/disk0", false, 100, [&] { add("f100_2"); });
+    block.CountDown();
+    done.Wait();
+    std::vector<std::string> expect = {"first", "l200", "l500", "f100", "f100_2", "f300"};
+    ASSERT_EQ(expect, order);
+}
+
+TEST_F(LoadSchedulerTest, ConcurrencyPerDisk) {
+    LoadScheduler scheduler(2);
+    std::atomic<int> running[2];
+    std::atomic<int> max_running[2];
+    for (int idx = 0; idx < 2; idx++) {
+        running[idx] = 0;
+        max_running[idx] = 0;
+    }
+    ::fedb::base::CountDownLatch done(12);
+    for (int i = 0; i < 12; i++) {
+        int disk_idx = i % 2;
+        scheduler.Submit("/disk" + std::to_string(disk_idx), false, i, [&, disk_idx] {
+            int cur = ++running[disk_idx];
+            int max = max_running[disk_idx].load();
+            while (cur > max && !max_running[disk_idx].compare_exchange_weak(max, cur)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            running[disk_idx]--;
+            done.CountDown();
+        });
+    }
+    done.Wait();
+    // every disk runs two loads at most
+    for (int idx = 0; idx < 2; idx++) {
+        ASSERT_LE(max_running[idx].load(), 2);
+        ASSERT_GE(max_running[idx].load(), 1);
+    }
+    ASSERT_EQ(0u, scheduler.GetWaitingCnt());
+}
+
+}  // namespace tablet
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/procedure_result_cache.h"
+
+#include <iterator>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "base/hash.h"
+#include "codec/fe_row_codec.h"
+
+namespace fedb {
+namespace tablet {
+
+// the fixed cost of an entry besides its key and result
+static const uint64_t ENTRY_OVERHEAD = 128;
+
+// format a key column the same way SQLInsertRow packs a dimension
+static bool GetKeyColumn(::fedb::codec::RowView* row_view, const int8_t* row,
+                         const ::fedb::common::ColumnDesc& column, uint32_t idx, std::string* val) {
+    if (row_view->IsNULL(idx)) {
+        *val = hybridse::codec::NONETOKEN;
+        return true;
+    }
+    switch (column.data_type()) {
+        case ::fedb::type::kBool: {
+            bool v = false;
+            if (row_view->GetBool(idx, &v) != 0) return false;
+            *val = v ? "true" : "false";
+            return true;
+        }
+        case ::fedb::type::kSmallInt:
+        case ::fedb::type::kInt:
+        case ::fedb::type::kBigInt:
+        case ::fedb::type::kTimestamp: {
+            int64_t v = 0;
+            if (row_view->GetInteger(row, idx, column.data_type(), &v) != 0) return false;
+            *val = std::to_string(v);
+            return true;
+        }
+        case ::fedb::type::kDate: {
+            int32_t v = 0;
+            if (row_view->GetDate(idx, &v) != 0) return false;
+            *val = std::to_string(v);
+            return true;
+        }
+        case ::fedb::type::kString:
+        case ::fedb::type::kVarchar: {
+            char* ch = nullptr;
+            uint32_t length = 0;
+            if (row_view->GetString(idx, &ch, &length) != 0) return false;
+            if (length == 0) {
+                *val = hybridse::codec::EMPTY_STRING;
+            } else {
+                val->assign(ch, length);
+            }
+            return true;
+        }
+        default:
+            return row_view->GetStrValue(idx, val) == 0;
+    }
+}
+
+ProcedureResultCache::ProcedureResultCache(uint64_t max_bytes, uint32_t slot_num)
+    : max_bytes_(max_bytes),
+      slot_num_(slot_num == 0 ? 1 : slot_num),
+      mu_(),
+      procedure_cnt_(0),
+      options_(),
+      generations_(),
+      lru_(),
+      entries_(),
+      bytes_(0),
+      hit_cnt_(0),
+      miss_cnt_(0) {}
+
+std::string ProcedureResultCache::BuildTableKey(const std::string& db, const std::string& table) {
+    return db + "." + table;
+}
+
+uint32_t ProcedureResultCache::GetSlot(const std::string& key) const {
+    return static_cast<uint64_t>(::fedb::base::hash64(key)) % slot_num_;
+}
+
+std::vector<uint64_t>* ProcedureResultCache::GetGenerations(const std::string& db, const std::string& table) {
+    auto it = generations_.find(BuildTableKey(db, table));
+    if (it == generations_.end()) {
+        it = generations_.emplace(BuildTableKey(db, table), std::vector<uint64_t>(slot_num_ + 1, 0)).first;
+    }
+    return &(it->second);
+}
+
+void ProcedureResultCache::AddProcedure(const std::shared_ptr<ProcedureResultCacheOption>& option,
+                                        const std::string& sp_name) {
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    GetGenerations(option->db, option->main_table);
+    for (const auto& table : option->tables) {
+        GetGenerations(option->db, table);
+    }
+    auto& sp_map = options_[option->db];
+    if (sp_map.find(sp_name) == sp_map.end()) {
+        procedure_cnt_.fetch_add(1, std::memory_order_relaxed);
+    }
+    sp_map[sp_name] = option;
+}
+
+void ProcedureResultCache::DropProcedure(const std::string& db, const std::string& sp_name) {
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    auto it = options_.find(db);
+    if (it == options_.end()) {
+        return;
+    }
+    if (it->second.erase(sp_name) > 0) {
+        procedure_cnt_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    // results of the dropped procedure age out of the lru
+}
+
+std::shared_ptr<ProcedureResultCacheOption> ProcedureResultCache::GetOption(const std::string& db,
+                                                                            const std::string& sp_name) {
+    if (!Enabled()) {
+        return std::shared_ptr<ProcedureResultCacheOption>();
+    }
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    auto it = options_.find(db);
+    if (it == options_.end()) {
+        return std::shared_ptr<ProcedureResultCacheOption>();
+    }
+    auto iit = it->second.find(sp_name);
+    if (iit == it->second.end()) {
+        return std::shared_ptr<ProcedureResultCacheOption>();
+    }
+    return iit->second;
+}
+
+bool ProcedureResultCache::BuildKey(const ProcedureResultCacheOption& option, const std::string& sp_name,
+                                    const std::string& row, std::string* key) const {
+    if (row.empty()) {
+        return false;
+    }
+    key->clear();
+    key->reserve(option.db.size() + sp_name.size() + row.size() + 2);
+    key->append(option.db);
+    key->push_back('\0');
+    key->append(sp_name);
+    key->push_back('\0');
+    size_t row_offset = key->size();
+    key->append(row);
+    if (option.ts_idx < 0 || option.bucket_ms == 0) {
+        return true;
+    }
+    int8_t* buf = reinterpret_cast<int8_t*>(&((*key)[row_offset]));
+    ::fedb::codec::RowView row_view(*option.input_schema, buf, row.size());
+    if (row_view.IsNULL(option.ts_idx)) {
+        return true;
+    }
+    const auto& ts_column = option.input_schema->Get(option.ts_idx);
+    int64_t ts = 0;
+    if (row_view.GetInteger(buf, option.ts_idx, ts_column.data_type(), &ts) != 0) {
+        return false;
+    }
+    int64_t bucket = ts - ts % option.bucket_ms;
+    ::fedb::codec::RowBuilder builder(*option.input_schema);
+    uint8_t schema_version = ::fedb::codec::RowView::GetSchemaVersion(buf);
+    builder.SetSchemaVersion(schema_version);
+    if (!builder.SetBuffer(buf, row.size(), false)) {
+        return false;
+    }
+    if (ts_column.data_type() == ::fedb::type::kTimestamp) {
+        return builder.SetTimestamp(option.ts_idx, bucket);
+    } else if (ts_column.data_type() == ::fedb::type::kBigInt) {
+        return builder.SetInt64(option.ts_idx, bucket);
+    }
+    return false;
+}
+
+void ProcedureResultCache::GetDependency(const ProcedureResultCacheOption& option, const std::string& row,
+                                         std::vector<Dependency>* deps) {
+    std::vector<uint32_t> slots;
+    bool key_ok = !option.index_cols.empty();
+    if (key_ok) {
+        const int8_t* row_ptr = reinterpret_cast<const int8_t*>(row.data());
+        ::fedb::codec::RowView row_view(*option.input_schema, row_ptr, row.size());
+        for (const auto& cols : option.index_cols) {
+            std::string key;
+            for (uint32_t idx : cols) {
+                std::string val;
+                if (!GetKeyColumn(&row_view, row_ptr, option.input_schema->Get(idx), idx, &val)) {
+                    key_ok = false;
+                    break;
+                }
+                if (!key.empty()) {
+                    key.append("|");
+                }
+                key.append(val);
+            }
+            if (!key_ok) {
+                break;
+            }
+            slots.push_back(GetSlot(key));
+        }
+    }
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    auto gens = GetGenerations(option.db, option.main_table);
+    if (key_ok) {
+        for (uint32_t slot : slots) {
+            deps->push_back({gens, slot, (*gens)[slot]});
+        }
+    } else {
+        // the keys of the request are unknown, depend on the whole table
+        deps->push_back({gens, slot_num_, (*gens)[slot_num_]});
+    }
+    for (const auto& table : option.tables) {
+        gens = GetGenerations(option.db, table);
+        deps->push_back({gens, slot_num_, (*gens)[slot_num_]});
+    }
+}
+
+void ProcedureResultCache::EraseUnLock(std::list<Entry>::iterator it) {
+    bytes_ -= it->bytes;
+    entries_.erase(it->key);
+    lru_.erase(it);
+}
+
+bool ProcedureResultCache::Get(const std::string& key, uint64_t cur_time, ProcedureResult* result) {
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        miss_cnt_++;
+        return false;
+    }
+    bool valid = it->second->expire_time > cur_time;
+    for (const auto& dep : it->second->deps) {
+        if (!valid) {
+            break;
+        }
+        valid = (*dep.gens)[dep.slot] == dep.gen;
+    }
+    if (!valid) {
+        EraseUnLock(it->second);
+        miss_cnt_++;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    *result = it->second->result;
+    hit_cnt_++;
+    return true;
+}
+
+void ProcedureResultCache::Insert(const std::string& key, const ProcedureResult& result,
+                                  const std::vector<Dependency>& deps, uint64_t expire_time) {
+    uint64_t bytes = ENTRY_OVERHEAD + key.size() * 2 + result.buf.size() + result.schema.size() +
+                     deps.size() * sizeof(Dependency);
+    if (bytes > max_bytes_) {
+        return;
+    }
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    for (const auto& dep : deps) {
+        if ((*dep.gens)[dep.slot] != dep.gen) {
+            // a put landed while the query was running
+            return;
+        }
+    }
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        EraseUnLock(it->second);
+    }
+    lru_.push_front(Entry{key, result, deps, expire_time, bytes});
+    entries_.emplace(key, lru_.begin());
+    bytes_ += bytes;
+    while (bytes_ > max_bytes_ && !lru_.empty()) {
+        EraseUnLock(std::prev(lru_.end()));
+    }
+}
+
+void ProcedureResultCache::Invalidate(const std::string& db, const std::string& table,
+                                      const std::vector<std::string>& keys) {
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    auto it = generations_.find(BuildTableKey(db, table));
+    if (it == generations_.end()) {
+        return;
+    }
+    if (keys.empty()) {
+        for (auto& gen : it->second) {
+            gen++;
+        }
+        return;
+    }
+    it->second[slot_num_]++;
+    for (const auto& key : keys) {
+        it->second[GetSlot(key)]++;
+    }
+}
+
+uint64_t ProcedureResultCache::GetHitCnt() const {
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    return hit_cnt_;
+}
+
+uint64_t ProcedureResultCache::GetMissCnt() const {
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    return miss_cnt_;
+}
+
+uint64_t ProcedureResultCache::GetBytes() const {
+    std::lock_guard<::fedb::base::SpinMutex> lock(mu_);
+    return bytes_;
+}
+
+}  // namespace tablet
+}  // namespace fedb
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/spinlock.h"
+#include "butil/iobuf.h"
+#include "codec/codec.h"
+
+namespace fedb {
+namespace tablet {
+
+// how the results of one procedure are cached
+struct ProcedureResultCacheOption {
+    // requests whose ts falls in the same bucket share a result
+    uint32_t bucket_ms = 0;
+    std::string db;
+    std::string main_table;
+    // dependent tables besides the main table
+    std::vector<std::string> tables;
+    std::shared_ptr<::fedb::codec::Schema> input_schema;
+    // position of the ts column in the request row, -1 if there is none
+    int32_t ts_idx = -1;
+    // positions of the key columns of every index of the main table
+    std::vector<std::vector<uint32_t>> index_cols;
+};
+
+struct ProcedureResult {
+    butil::IOBuf buf;
+    std::string schema;
+    uint32_t byte_size = 0;
+};
+
+// row-level result cache of request mode procedures. a result depends on the
+// main table segments of the request keys and on every other dependent
+// table, and becomes invalid once a put lands on any of them. puts are
+// tracked by a generation per key hash slot, a result remembers the
+// generations it was computed against. puts to partitions on other tablets
+// are not seen here, so a result also expires after one bucket
+class ProcedureResultCache {
+ public:
+    struct Dependency {
+        const std::vector<uint64_t>* gens;
+        uint32_t slot;
+        uint64_t gen;
+    };
+
+    ProcedureResultCache(uint64_t max_bytes, uint32_t slot_num);
+    ~ProcedureResultCache() {}
+
+    void AddProcedure(const std::shared_ptr<ProcedureResultCacheOption>& option, const std::string& sp_name);
+    void DropProcedure(const std::string& db, const std::string& sp_name);
+    std::shared_ptr<ProcedureResultCacheOption> GetOption(const std::string& db, const std::string& sp_name);
+
+    inline bool Enabled() const { return procedure_cnt_.load(std::memory_order_relaxed) > 0; }
+
+    // the key is the request row with the ts rounded down to its bucket
+    bool BuildKey(const ProcedureResultCacheOption& option, const std::string& sp_name, const std::string& row,
+                  std::string* key) const;
+
+    // snapshot the generations a request row depends on, taken before the query runs
+    void GetDependency(const ProcedureResultCacheOption& option, const std::string& row,
+                       std::vector<Dependency>* deps);
+
+    bool Get(const std::string& key, uint64_t cur_time, ProcedureResult* result);
+    void Insert(const std::string& key, const ProcedureResult& result, const std::vector<Dependency>& deps,
+                uint64_t expire_time);
+
+    // a put with the given dimension keys landed on db.table, no keys
+    // invalidates every result depending on the table
+    void Invalidate(const std::string& db, const std::string& table, const std::vector<std::string>& keys);
+
+    uint64_t GetHitCnt() const;
+    uint64_t GetMissCnt() const;
+    uint64_t GetBytes() const;
+
+ private:
+    struct Entry {
+        std::string key;
+        ProcedureResult result;
+        std::vector<Dependency> deps;
+        uint64_t expire_time;
+        uint64_t bytes;
+    };
+
+    static std::string BuildTableKey(const std::string& db, const std::string& table);
+    std::vector<uint64_t>* GetGenerations(const std::string& db, const std::string& table);
+    uint32_t GetSlot(const std::string& key) const;
+    void EraseUnLock(std::list<Entry>::iterator it);
+
+ private:
+    uint64_t max_bytes_;
+    uint32_t slot_num_;
+    mutable ::fedb::base::SpinMutex mu_;
+    std::atomic<uint32_t> procedure_cnt_;
+    std::map<std::string, std::map<std::string, std::shared_ptr<ProcedureResultCacheOption>>> options_;
+    // db.table -> generation of every key slot, the last one is bumped by any put
+    std::map<std::string, std::vector<uint64_t>> generations_;
+    // front is the most recently used
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
+    uint64_t bytes_;
+    uint64_t hit_cnt_;
+    uint64_t miss_cnt_;
+};
+
+}  // namespace tablet
+}  // namespace fedb
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/procedure_result_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace tablet {
+
+class ProcedureResultCacheTest : public ::testing::Test {};
+
+static std::shared_ptr<ProcedureResultCacheOption> CreateOption() {
+    auto option = std::make_shared<ProcedureResultCacheOption>();
+    option->bucket_ms = 1000;
+    option->db = "db1";
+    option->main_table = "t1";
+    option->tables.push_back("t2");
+    option->input_schema = std::make_shared<::fedb::codec::Schema>();
+    auto col = option->input_schema->Add();
+    col->set_name("card");
+    col->set_data_type(::fedb::type::kString);
+    col = option->input_schema->Add();
+    col->set_name("ts");
+    col->set_data_type(::fedb::type::kTimestamp);
+    col = option->input_schema->Add();
+    col->set_name("amt");
+    col->set_data_type(::fedb::type::kBigInt);
+    option->ts_idx = 1;
+    option->index_cols.push_back({0});
+    return option;
+}
+
+static std::string EncodeRow(const ::fedb::codec::Schema& schema, const std::string& card, int64_t ts,
+                             int64_t amt) {
+    ::fedb::codec::RowBuilder builder(schema);
+    uint32_t size = builder.CalTotalLength(card.size());
+    std::string row;
+    row.resize(size);
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+    builder.AppendString(card.c_str(), card.size());
+    builder.AppendTimestamp(ts);
+    builder.AppendInt64(amt);
+    return row;
+}
+
+static ProcedureResult CreateResult(const std::string& value) {
+    ProcedureResult result;
+    result.buf.append(value);
+    result.schema = "schema";
+    result.byte_size = value.size();
+    return result;
+}
+
+TEST_F(ProcedureResultCacheTest, BuildKey) {
+    ProcedureResultCache cache(1024 * 1024, 16);
+    auto option = CreateOption();
+    std::string key1, key2, key3;
+    ASSERT_TRUE(cache.BuildKey(*option, "sp1", EncodeRow(*option->input_schema, "card0", 1100, 1), &key1));
+    ASSERT_TRUE(cache.BuildKey(*option, "sp1", EncodeRow(*option->input_schema, "card0", 1900, 1), &key2));
+    ASSERT_TRUE(cache.BuildKey(*option, "sp1", EncodeRow(*option->input_schema, "card0", 2100, 1), &key3));
+    // the same bucket shares a key
+    ASSERT_EQ(key1, key2);
+    ASSERT_NE(key1, key3);
+    ASSERT_TRUE(cache.BuildKey(*option, "sp2", EncodeRow(*option->input_schema, "card0", 1100, 1), &key2));
+    ASSERT_NE(key1, key2);
+    ASSERT_TRUE(cache.BuildKey(*option, "sp1", EncodeRow(*option->input_schema, "card0", 1100, 2), &key2));
+    ASSERT_NE(key1, key2);
+}
+
+TEST_F(ProcedureResultCacheTest, GetAndInvalidate) {
+    ProcedureResultCache cache(1024 * 1024, 16);
+    auto option = CreateOption();
+    ASSERT_FALSE(cache.Enabled());
+    cache.AddProcedure(option, "sp1");
+    ASSERT_TRUE(cache.Enabled());
+    ASSERT_EQ(option, cache.GetOption("db1", "sp1"));
+    ASSERT_FALSE(cache.GetOption("db1", "sp2"));
+
+    std::string row = EncodeRow(*option->input_schema, "card0", 1100, 1);
+    std::string key;
+    ASSERT_TRUE(cache.BuildKey(*option, "sp1", row, &key));
+    ProcedureResult result;
+    ASSERT_FALSE(cache.Get(key, 1100, &result));
+    std::vector<ProcedureResultCache::Dependency> deps;
+    cache.GetDependency(*option, row, &deps);
+    ASSERT_EQ(2u, deps.size());
+    cache.Insert(key, CreateResult("value1"), deps, 2000);
+    ASSERT_TRUE(cache.Get(key, 1500, &result));
+    ASSERT_EQ("value1", result.buf.to_string());
+    ASSERT_EQ("schema", result.schema);
+    // expired
+    ASSERT_FALSE(cache.Get(key, 2000, &result));
+
+    cache.Insert(key, CreateResult("value1"), deps, 2000);
+    // put to other keys of the main table, assume no slot collision with 16 slots
+    std::vector<std::string> keys;
+    for (int i = 1; i < 100 && keys.size() < 4; i++) {
+        std::vector<ProcedureResultCache::Dependency> other;
+        cache.GetDependency(*option, EncodeRow(*option->input_schema, "card" + std::to_string(i), 1100, 1), &other);
+        if (other[0].slot != deps[0].slot) {
+            keys.push_back("card" + std::to_string(i));
+        }
+    }
+    cache.Invalidate("db1", "t1", keys);
+    ASSERT_TRUE(cache.Get(key, 1500, &result));
+    cache.Invalidate("db1", "t3", {"card0"});
+    ASSERT_TRUE(cache.Get(key, 1500, &result));
+    cache.Invalidate("db1", "t1", {"card0"});
+    ASSERT_FALSE(cache.Get(key, 1500, &result));
+
+    // any put to a dependent table drops the result
+    deps.clear();
+    cache.GetDependency(*option, row, &deps);
+    cache.Insert(key, CreateResult("value1"), deps, 2000);
+    ASSERT_TRUE(cache.Get(key, 1500, &result));
+    cache.Invalidate("db1", "t2", {"other"});
+    ASSERT_FALSE(cache.Get(key, 1500, &result));
+
+    // a put lands while the query is running
+    deps.clear();
+    cache.GetDependency(*option, row, &deps);
+    cache.Invalidate("db1", "t1", {"card0"});
+    cache.Insert(key, CreateResult("value1"), deps, 2000);
+    ASSERT_FALSE(cache.Get(key, 1500, &result));
+
+    cache.DropProcedure("db1", "sp1");
+    ASSERT_FALSE(cache.Enabled());
+    ASSERT_FALSE(cache.GetOption("db1", "sp1"));
+}
+
+TEST_F(ProcedureResultCacheTest, Evict) {
+    auto option = CreateOption();
+    std::string row = EncodeRow(*option->input_schema, "card0", 1100, 1);
+    std::string value(1024, 'a');
+    ProcedureResultCache cache(4096, 16);
+    cache.AddProcedure(option, "sp1");
+    std::vector<ProcedureResultCache::Dependency> deps;
+    cache.GetDependency(*option, row, &deps);
+    for (int i = 0; i < 10; i++) {
+        cache.Insert("key" + std::to_string(i), CreateResult(value), deps, 2000);
+        ASSERT_LE(cache.GetBytes(), 4096u);
+    }
+    ProcedureResult result;
+    ASSERT_TRUE(cache.Get("key9", 1500, &result));
+    ASSERT_FALSE(cache.Get("key0", 1500, &result));
+    ASSERT_EQ(1u, cache.GetHitCnt());
+    ASSERT_EQ(1u, cache.GetMissCnt());
+}
+
+}  // namespace tablet
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/rpc_metric.h"
+
+#include <stdio.h>
+
+namespace fedb {
+namespace tablet {
+
+static const char* METHOD_NAME[kRpcMetricMethodNum] = {"put",   "get", "scan", "query", "sql_batch_request_query",
+                                                        "append_entries"};
+
+const char* RpcMetric::GetMethodName(RpcMetricMethod method) {
+    if (method < 0 || method >= kRpcMetricMethodNum) {
+        return "unknown";
+    }
+    return METHOD_NAME[method];
+}
+
+RpcMetric::RpcMetric(const std::string& prefix, bool enable_table)
+    : prefix_(prefix),
+      enable_table_(enable_table),
+      latency_(),
+      code_cache_(),
+      mu_(),
+      code_cnt_(),
+      tables_(),
+      table_latency_() {
+    for (int idx = 0; idx < kRpcMetricMethodNum; idx++) {
+        latency_[idx].reset(new bvar::LatencyRecorder(prefix_, METHOD_NAME[idx]));
+        for (int32_t code = 0; code < kCachedCodeNum; code++) {
+            code_cache_[idx][code].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+}
+
+bvar::Adder<uint64_t>* RpcMetric::GetCodeCnt(RpcMetricMethod method, int32_t code) {
+    bool cached = code >= 0 && code < kCachedCodeNum;
+    if (cached) {
+        bvar::Adder<uint64_t>* adder = code_cache_[method][code].load(std::memory_order_acquire);
+        if (adder != nullptr) {
+            return adder;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    auto key = std::make_pair(static_cast<int32_t>(method), code);
+    auto it = code_cnt_.find(key);
+    if (it == code_cnt_.end()) {
+        std::string name = std::string(METHOD_NAME[method]) + "_code_" + std::to_string(code) + "_count";
+        it = code_cnt_.emplace(key, std::unique_ptr<bvar::Adder<uint64_t>>(
+                                        new bvar::Adder<uint64_t>(prefix_, name))).first;
+    }
+    if (cached) {
+        code_cache_[method][code].store(it->second.get(), std::memory_order_release);
+    }
+    return it->second.get();
+}
+
+std::shared_ptr<bvar::LatencyRecorder> RpcMetric::GetTableLatency(RpcMetricMethod method, uint32_t tid,
+                                                                  uint32_t pid) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto key = std::make_tuple(static_cast<int32_t>(method), tid, pid);
+    auto it = table_latency_.find(key);
+    if (it == table_latency_.end()) {
+        // an rpc that returns after its partition is deleted
+        if (tables_.find(std::make_pair(tid, pid)) == tables_.end()) {
+            return std::shared_ptr<bvar::LatencyRecorder>();
+        }
+        std::string name = "tid_" + std::to_string(tid) + "_pid_" + std::to_string(pid);
+        auto recorder = std::make_shared<bvar::LatencyRecorder>(prefix_ + "_" + METHOD_NAME[method], name);
+        it = table_latency_.emplace(key, recorder).first;
+    }
+    return it->second;
+}
+
+void RpcMetric::Record(RpcMetricMethod method, int32_t code, int64_t latency_us) {
+    if (method < 0 || method >= kRpcMetricMethodNum) {
+        return;
+    }
+    *latency_[method] << latency_us;
+    *GetCodeCnt(method, code) << 1;
+}
+
+void RpcMetric::Record(RpcMetricMethod method, uint32_t tid, uint32_t pid, int32_t code, int64_t latency_us) {
+    Record(method, code, latency_us);
+    if (enable_table_ && method >= 0 && method < kRpcMetricMethodNum) {
+        std::shared_ptr<bvar::LatencyRecorder> recorder = GetTableLatency(method, tid, pid);
+        if (recorder) {
+            *recorder << latency_us;
+        }
+    }
+}
+
+void RpcMetric::AddTable(uint32_t tid, uint32_t pid) {
+    std::lock_guard<std::mutex> lock(mu_);
+    tables_.insert(std::make_pair(tid, pid));
+}
+
+void RpcMetric::DelTable(uint32_t tid, uint32_t pid) {
+    std::lock_guard<std::mutex> lock(mu_);
+    tables_.erase(std::make_pair(tid, pid));
+    for (int idx = 0; idx < kRpcMetricMethodNum; idx++) {
+        table_latency_.erase(std::make_tuple(idx, tid, pid));
+    }
+}
+
+static void AppendLatency(const std::string& name, bvar::LatencyRecorder* recorder, std::string* out) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%-48s %12ld %10ld %10ld %10ld %10ld %10ld %10ld\n", name.c_str(),
+             static_cast<int64_t>(recorder->count()), static_cast<int64_t>(recorder->qps()),
+             static_cast<int64_t>(recorder->latency()), static_cast<int64_t>(recorder->latency_percentile(0.5)),
+             static_cast<int64_t>(recorder->latency_percentile(0.99)),
+             static_cast<int64_t>(recorder->latency_percentile(0.999)),
+             static_cast<int64_t>(recorder->max_latency()));
+    out->append(buf);
+}
+
+void RpcMetric::Show(std::string* out) {
+    char buf[256];
+    out->append("<html><head><title>Rpc Stat</title></head><body><pre>");
+    snprintf(buf, sizeof(buf), "%-48s %12s %10s %10s %10s %10s %10s %10s\n", "name", "count", "qps", "avg(us)",
+             "p50(us)", "p99(us)", "p999(us)", "max(us)");
+    out->append(buf);
+    for (int idx = 0; idx < kRpcMetricMethodNum; idx++) {
+        AppendLatency(METHOD_NAME[idx], latency_[idx].get(), out);
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    for (const auto& kv : table_latency_) {
+        std::string name = std::string(METHOD_NAME[std::get<0>(kv.first)]) + " tid " +
+                           std::to_string(std::get<1>(kv.first)) + " pid " + std::to_string(std::get<2>(kv.first));
+        AppendLatency(name, kv.second.get(), out);
+    }
+    out->append("\n");
+    snprintf(buf, sizeof(buf), "%-48s %12s\n", "code", "count");
+    out->append(buf);
+    for (const auto& kv : code_cnt_) {
+        std::string name = std::string(METHOD_NAME[kv.first.first]) + " code " + std::to_string(kv.first.second);
+        snprintf(buf, sizeof(buf), "%-48s %12lu\n", name.c_str(), kv.second->get_value());
+        out->append(buf);
+    }
+    out->append("</pre></body></html>");
+}
+
+}  // namespace tablet
+}  // namespace fedb
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <bvar/bvar.h>
+#include <google/protobuf/stubs/callback.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "common/timer.h"
+
+namespace fedb {
+namespace tablet {
+
+enum RpcMetricMethod {
+    kPutMetric = 0,
+    kGetMetric,
+    kScanMetric,
+    kQueryMetric,
+    kSQLBatchRequestQueryMetric,
+    kAppendEntriesMetric,
+    kRpcMetricMethodNum,
+};
+
+// latency and qps of the rpcs, by method, by table partition and by result
+// code. every recorder is a bvar, so it shows on /vars of the builtin http port
+class RpcMetric {
+ public:
+    // table breakdown adds a recorder for every method and live partition served
+    RpcMetric(const std::string& prefix, bool enable_table);
+    RpcMetric(const RpcMetric&) = delete;
+    RpcMetric& operator=(const RpcMetric&) = delete;
+
+    void Record(RpcMetricMethod method, int32_t code, int64_t latency_us);
+
+    void Record(RpcMetricMethod method, uint32_t tid, uint32_t pid, int32_t code, int64_t latency_us);
+
+    // only the partitions added are recorded by table
+    void AddTable(uint32_t tid, uint32_t pid);
+
+    // drop the recorders of a deleted partition
+    void DelTable(uint32_t tid, uint32_t pid);
+
+    // html page with the percentiles of all recorders
+    void Show(std::string* out);
+
+    static const char* GetMethodName(RpcMetricMethod method);
+
+ private:
+    bvar::Adder<uint64_t>* GetCodeCnt(RpcMetricMethod method, int32_t code);
+    std::shared_ptr<bvar::LatencyRecorder> GetTableLatency(RpcMetricMethod method, uint32_t tid, uint32_t pid);
+
+ private:
+    // the adders of the codes below it are found without taking mu_
+    static constexpr int32_t kCachedCodeNum = 1024;
+
+    std::string prefix_;
+    bool enable_table_;
+    std::unique_ptr<bvar::LatencyRecorder> latency_[kRpcMetricMethodNum];
+    std::atomic<bvar::Adder<uint64_t>*> code_cache_[kRpcMetricMethodNum][kCachedCodeNum];
+    std::mutex mu_;
+    std::map<std::pair<int32_t, int32_t>, std::unique_ptr<bvar::Adder<uint64_t>>> code_cnt_;
+    std::set<std::pair<uint32_t, uint32_t>> tables_;
+    // recorders in use by an rpc outlive DelTable
+    std::map<std::tuple<int32_t, uint32_t, uint32_t>, std::shared_ptr<bvar::LatencyRecorder>> table_latency_;
+};
+
+// records the rpc before handing the response to the wrapped closure, so it
+// works whether the handler uses ClosureGuard or runs done by itself
+template <class Response>
+class RpcMetricClosure : public google::protobuf::Closure {
+ public:
+    RpcMetricClosure(RpcMetric* metric, RpcMetricMethod method, bool has_table, uint32_t tid, uint32_t pid,
+                     const Response* response, google::protobuf::Closure* done)
+        : metric_(metric),
+          method_(method),
+          has_table_(has_table),
+          tid_(tid),
+          pid_(pid),
+          response_(response),
+          done_(done),
+          start_time_(::baidu::common::timer::get_micros()) {}
+
+    void Run() override {
+        int64_t latency = ::baidu::common::timer::get_micros() - start_time_;
+        if (has_table_) {
+            metric_->Record(method_, tid_, pid_, response_->code(), latency);
+        } else {
+            metric_->Record(method_, response_->code(), latency);
+        }
+        google::protobuf::Closure* done = done_;
+        delete this;
+        done->Run();
+    }
+
+ private:
+    RpcMetric* metric_;
+    RpcMetricMethod method_;
+    bool has_table_;
+    uint32_t tid_;
+    uint32_t pid_;
+    const Response* response_;
+    google::protobuf::Closure* done_;
+    uint64_t start_time_;
+};
+
+template <class Response>
+google::protobuf::Closure* NewRpcMetricClosure(RpcMetric* metric, RpcMetricMethod method, const Response* response,
+                                               google::protobuf::Closure* done) {
+    return new RpcMetricClosure<Response>(metric, method, false, 0, 0, response, done);
+}
+
+template <class Response>
+google::protobuf::Closure* NewRpcMetricClosure(RpcMetric* metric, RpcMetricMethod method, uint32_t tid, uint32_t pid,
+                                               const Response* response, google::protobuf::Closure* done) {
+    return new RpcMetricClosure<Response>(metric, method, true, tid, pid, response, done);
+}
+
+}  // namespace tablet
+}  // namespace fedb
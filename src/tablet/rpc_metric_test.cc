@@ -0,0 +1,90 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/rpc_metric.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "proto/tablet.pb.h"
+
+namespace fedb {
+namespace tablet {
+
+class RpcMetricTest : public ::testing::Test {
+ public:
+    RpcMetricTest() {}
+    ~RpcMetricTest() {}
+};
+
+class CountClosure : public google::protobuf::Closure {
+ public:
+    CountClosure() : cnt_(0) {}
+    void Run() override { cnt_++; }
+    int cnt_;
+};
+
+TEST_F(RpcMetricTest, Record) {
+    RpcMetric metric("rpc_metric_test", true);
+    metric.AddTable(1, 2);
+    ::fedb::api::PutResponse response;
+    response.set_code(0);
+    CountClosure done;
+    google::protobuf::Closure* closure = NewRpcMetricClosure(&metric, kPutMetric, 1, 2, &response, &done);
+    closure->Run();
+    ASSERT_EQ(1, done.cnt_);
+    metric.Record(kGetMetric, 307, 100);
+    std::string stat;
+    metric.Show(&stat);
+    ASSERT_NE(std::string::npos, stat.find("put tid 1 pid 2"));
+    ASSERT_NE(std::string::npos, stat.find("put code 0"));
+    ASSERT_NE(std::string::npos, stat.find("get code 307"));
+    metric.DelTable(1, 2);
+    stat.clear();
+    metric.Show(&stat);
+    ASSERT_EQ(std::string::npos, stat.find("put tid 1 pid 2"));
+    // an rpc returning after the drop does not add the recorder back
+    metric.Record(kPutMetric, 1, 2, 0, 100);
+    stat.clear();
+    metric.Show(&stat);
+    ASSERT_EQ(std::string::npos, stat.find("put tid 1 pid 2"));
+}
+
+TEST_F(RpcMetricTest, UnknownTable) {
+    RpcMetric metric("rpc_metric_unknown_test", true);
+    metric.Record(kGetMetric, 3, 4, 0, 100);
+    std::string stat;
+    metric.Show(&stat);
+    ASSERT_EQ(std::string::npos, stat.find("get tid 3 pid 4"));
+    ASSERT_NE(std::string::npos, stat.find("get code 0"));
+}
+
+TEST_F(RpcMetricTest, DisableTable) {
+    RpcMetric metric("rpc_metric_disable_test", false);
+    metric.Record(kScanMetric, 1, 2, 0, 100);
+    std::string stat;
+    metric.Show(&stat);
+    ASSERT_EQ(std::string::npos, stat.find("scan tid 1 pid 2"));
+    ASSERT_NE(std::string::npos, stat.find("scan code 0"));
+}
+
+}  // namespace tablet
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/sql_plan_cache.h"
+
+#include <mutex>  // NOLINT
+
+#include "base/hash.h"
+
+namespace fedb {
+namespace tablet {
+
+SQLPlanCache::SQLPlanCache(uint32_t shard_num, uint32_t capacity) : shard_capacity_(1), shards_() {
+    if (shard_num == 0) {
+        shard_num = 1;
+    }
+    if (capacity > shard_num) {
+        shard_capacity_ = capacity / shard_num;
+    }
+    for (uint32_t idx = 0; idx < shard_num; idx++) {
+        shards_.emplace_back(new Shard());
+    }
+}
+
+std::string SQLPlanCache::BuildKey(const std::string& db, const std::string& option, const std::string& sql) {
+    std::string key;
+    key.reserve(db.size() + option.size() + sql.size() + 2);
+    key.append(db);
+    key.push_back('\0');
+    key.append(option);
+    key.push_back('\0');
+    key.append(sql);
+    return key;
+}
+
+SQLPlanCache::Shard& SQLPlanCache::GetShard(const std::string& key) {
+    uint64_t hash = static_cast<uint64_t>(::fedb::base::hash64(key));
+    return *shards_[hash % shards_.size()];
+}
+
+std::shared_ptr<hybridse::vm::CompileInfo> SQLPlanCache::Get(const std::string& db, const std::string& option,
+                                                             const std::string& sql, uint64_t version) {
+    std::string key = BuildKey(db, option, sql);
+    Shard& shard = GetShard(key);
+    std::lock_guard<::fedb::base::SpinMutex> lock(shard.mu);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        shard.miss_cnt++;
+        return std::shared_ptr<hybridse::vm::CompileInfo>();
+    }
+    if (it->second->version != version) {
+        // compiled against an old catalog
+        shard.lru.erase(it->second);
+        shard.entries.erase(it);
+        shard.miss_cnt++;
+        return std::shared_ptr<hybridse::vm::CompileInfo>();
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    shard.hit_cnt++;
+    return it->second->info;
+}
+
+void SQLPlanCache::Insert(const std::string& db, const std::string& option, const std::string& sql,
+                          uint64_t version, const std::shared_ptr<hybridse::vm::CompileInfo>& info) {
+    if (!info) {
+        return;
+    }
+    std::string key = BuildKey(db, option, sql);
+    Shard& shard = GetShard(key);
+    std::lock_guard<::fedb::base::SpinMutex> lock(shard.mu);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        it->second->version = version;
+        it->second->info = info;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    shard.lru.push_front(Entry{key, db, version, info});
+    shard.entries.emplace(key, shard.lru.begin());
+    while (shard.lru.size() > shard_capacity_) {
+        shard.entries.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+    }
+}
+
+void SQLPlanCache::Erase(const std::string& db, const std::string& option, const std::string& sql) {
+    std::string key = BuildKey(db, option, sql);
+    Shard& shard = GetShard(key);
+    std::lock_guard<::fedb::base::SpinMutex> lock(shard.mu);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        shard.lru.erase(it->second);
+        shard.entries.erase(it);
+    }
+}
+
+void SQLPlanCache::Invalidate(const std::string& db) {
+    for (auto& shard : shards_) {
+        std::lock_guard<::fedb::base::SpinMutex> lock(shard->mu);
+        auto it = shard->lru.begin();
+        while (it != shard->lru.end()) {
+            if (it->db == db) {
+                shard->entries.erase(it->key);
+                it = shard->lru.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void SQLPlanCache::Clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<::fedb::base::SpinMutex> lock(shard->mu);
+        shard->entries.clear();
+        shard->lru.clear();
+    }
+}
+
+uint64_t SQLPlanCache::GetHitCnt() const {
+    uint64_t cnt = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<::fedb::base::SpinMutex> lock(shard->mu);
+        cnt += shard->hit_cnt;
+    }
+    return cnt;
+}
+
+uint64_t SQLPlanCache::GetMissCnt() const {
+    uint64_t cnt = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<::fedb::base::SpinMutex> lock(shard->mu);
+        cnt += shard->miss_cnt;
+    }
+    return cnt;
+}
+
+uint64_t SQLPlanCache::GetSize() const {
+    uint64_t size = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<::fedb::base::SpinMutex> lock(shard->mu);
+        size += shard->lru.size();
+    }
+    return size;
+}
+
+}  // namespace tablet
+}  // namespace fedb
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/spinlock.h"
+#include "vm/engine.h"
+
+namespace fedb {
+namespace tablet {
+
+// cache of compiled sql plans in front of the engine. entries are keyed by
+// db, compile options and sql text, and tagged with the catalog version they
+// were compiled against, so a plan compiled before a ddl is never reused.
+// the key space is split into shards with a small lru each, which keeps the
+// critical section of a lookup to one hash probe and one list splice
+class SQLPlanCache {
+ public:
+    SQLPlanCache(uint32_t shard_num, uint32_t capacity);
+    ~SQLPlanCache() {}
+
+    std::shared_ptr<hybridse::vm::CompileInfo> Get(const std::string& db, const std::string& option,
+                                                   const std::string& sql, uint64_t version);
+
+    void Insert(const std::string& db, const std::string& option, const std::string& sql, uint64_t version,
+                const std::shared_ptr<hybridse::vm::CompileInfo>& info);
+
+    void Erase(const std::string& db, const std::string& option, const std::string& sql);
+
+    // drop all plans of db, used when a table of db is created or dropped locally
+    void Invalidate(const std::string& db);
+
+    void Clear();
+
+    uint64_t GetHitCnt() const;
+    uint64_t GetMissCnt() const;
+    uint64_t GetSize() const;
+
+ private:
+    struct Entry {
+        std::string key;
+        std::string db;
+        uint64_t version;
+        std::shared_ptr<hybridse::vm::CompileInfo> info;
+    };
+
+    struct Shard {
+        Shard() : mu(), lru(), entries(), hit_cnt(0), miss_cnt(0) {}
+        mutable ::fedb::base::SpinMutex mu;
+        // front is the most recently used
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+        uint64_t hit_cnt;
+        uint64_t miss_cnt;
+    };
+
+    static std::string BuildKey(const std::string& db, const std::string& option, const std::string& sql);
+    Shard& GetShard(const std::string& key);
+
+ private:
+    uint32_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace tablet
+}  // namespace fedb
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/sql_plan_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace fedb {
+namespace tablet {
+
+class SQLPlanCacheTest : public ::testing::Test {};
+
+TEST_F(SQLPlanCacheTest, GetAndInsert) {
+    SQLPlanCache cache(4, 16);
+    auto info = std::make_shared<hybridse::vm::SQLCompileInfo>();
+    ASSERT_FALSE(cache.Get("db1", "request", "select c1 from t1;", 1));
+    cache.Insert("db1", "request", "select c1 from t1;", 1, info);
+    ASSERT_EQ(info, cache.Get("db1", "request", "select c1 from t1;", 1));
+    // option and db are part of the key
+    ASSERT_FALSE(cache.Get("db1", "batch", "select c1 from t1;", 1));
+    ASSERT_FALSE(cache.Get("db2", "request", "select c1 from t1;", 1));
+    ASSERT_EQ(1u, cache.GetHitCnt());
+    ASSERT_EQ(3u, cache.GetMissCnt());
+    // catalog version changed
+    ASSERT_FALSE(cache.Get("db1", "request", "select c1 from t1;", 2));
+    ASSERT_EQ(0u, cache.GetSize());
+    cache.Insert("db1", "request", "select c1 from t1;", 2, info);
+    cache.Erase("db1", "request", "select c1 from t1;");
+    ASSERT_FALSE(cache.Get("db1", "request", "select c1 from t1;", 2));
+}
+
+TEST_F(SQLPlanCacheTest, Evict) {
+    SQLPlanCache cache(1, 2);
+    auto info = std::make_shared<hybridse::vm::SQLCompileInfo>();
+    cache.Insert("db1", "request", "sql1", 1, info);
+    cache.Insert("db1", "request", "sql2", 1, info);
+    ASSERT_TRUE(cache.Get("db1", "request", "sql1", 1));
+    cache.Insert("db1", "request", "sql3", 1, info);
+    ASSERT_EQ(2u, cache.GetSize());
+    // sql2 is the least recently used
+    ASSERT_FALSE(cache.Get("db1", "request", "sql2", 1));
+    ASSERT_TRUE(cache.Get("db1", "request", "sql1", 1));
+    ASSERT_TRUE(cache.Get("db1", "request", "sql3", 1));
+}
+
+TEST_F(SQLPlanCacheTest, Invalidate) {
+    SQLPlanCache cache(4, 64);
+    auto info = std::make_shared<hybridse::vm::SQLCompileInfo>();
+    for (int i = 0; i < 10; i++) {
+        cache.Insert("db1", "request", "sql" + std::to_string(i), 1, info);
+        cache.Insert("db2", "request", "sql" + std::to_string(i), 1, info);
+    }
+    ASSERT_EQ(20u, cache.GetSize());
+    cache.Invalidate("db1");
+    ASSERT_EQ(10u, cache.GetSize());
+    ASSERT_FALSE(cache.Get("db1", "request", "sql1", 1));
+    ASSERT_TRUE(cache.Get("db2", "request", "sql1", 1));
+    cache.Clear();
+    ASSERT_EQ(0u, cache.GetSize());
+}
+
+}  // namespace tablet
+}  // namespace fedb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -22,12 +22,17 @@
 #include <google/protobuf/text_format.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef DISALLOW_COPY_AND_ASSIGN
 #undef DISALLOW_COPY_AND_ASSIGN
 #endif
 #include <snappy.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <sstream>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -40,16 +45,23 @@
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
 #include "base/hash.h"
+#include "base/query_profiler.h"
 #include "base/status.h"
 #include "base/strings.h"
+#include "base/taskpool.hpp"
 #include "brpc/controller.h"
+#include "bthread/bthread.h"
 #include "butil/iobuf.h"
+#include "catalog/table_change.h"
+#include "client/tablet_client.h"
 #include "codec/codec.h"
 #include "glog/logging.h"
+#include "log/crc32c.h"
 #include "storage/binlog.h"
 #include "storage/segment.h"
 #include "tablet/file_sender.h"
 #include "common/timer.h"
+#include "codec/sql_rpc_column_codec.h"
 #include "codec/sql_rpc_row_codec.h"
 #include "codec/row_codec.h"
 
@@ -64,6 +76,12 @@ DECLARE_int32(gc_pool_size);
 DECLARE_int32(statdb_ttl);
 DECLARE_uint32(scan_max_bytes_size);
 DECLARE_uint32(scan_reserve_size);
+DECLARE_uint32(batch_query_parallelism);
+DECLARE_uint32(batch_query_parallel_threshold);
+DECLARE_uint32(sql_plan_cache_shard_num);
+DECLARE_uint32(sql_plan_cache_capacity);
+DECLARE_uint32(procedure_result_cache_max_mb);
+DECLARE_uint32(procedure_result_cache_slot_num);
 DECLARE_double(mem_release_rate);
 DECLARE_string(db_root_path);
 DECLARE_bool(binlog_notify_on_put);
@@ -76,9 +94,14 @@ DECLARE_bool(recycle_bin_enabled);
 DECLARE_uint32(recycle_ttl);
 DECLARE_string(recycle_bin_root_path);
 DECLARE_int32(make_snapshot_threshold_offset);
+DECLARE_uint32(load_table_thread_num);
+DECLARE_uint32(load_table_batch);
+DECLARE_uint32(load_table_concurrency_per_disk);
 DECLARE_uint32(get_table_diskused_interval);
 DECLARE_uint32(task_check_interval);
 DECLARE_uint32(load_index_max_wait_time);
+DECLARE_uint32(index_backfill_thread_num);
+DECLARE_uint32(index_backfill_batch_size);
 DECLARE_bool(use_name);
 DECLARE_bool(enable_distsql);
 DECLARE_string(snapshot_compression);
@@ -100,6 +123,12 @@ DECLARE_uint32(snapshot_ttl_time);
 DECLARE_uint32(snapshot_ttl_check_interval);
 DECLARE_uint32(put_slow_log_threshold);
 DECLARE_uint32(query_slow_log_threshold);
+DECLARE_bool(enable_table_rpc_metric);
+DECLARE_bool(enable_admission_control);
+DECLARE_uint32(admission_max_concurrency);
+DECLARE_string(admission_class_weight);
+DECLARE_uint32(admission_queue_size);
+DECLARE_uint32(admission_queue_timeout_ms);
 DECLARE_int32(snapshot_pool_size);
 
 namespace fedb {
@@ -107,6 +136,171 @@ namespace tablet {
 
 static const std::string SERVER_CONCURRENCY_KEY = "server";  // NOLINT
 static const uint32_t SEED = 0xe17a1465;
+// compile options a cached plan depends on besides db and sql
+static const char SQL_PLAN_BATCH[] = "batch";
+static const char SQL_PLAN_REQUEST[] = "request";
+static const char SQL_PLAN_BATCH_REQUEST[] = "batch_request";
+static const char SQL_PLAN_SP_REQUEST[] = "sp_request";
+static const char SQL_PLAN_SP_BATCH_REQUEST[] = "sp_batch_request";
+
+static uint64_t HashRpcRow(const ::hybridse::codec::Row& row) {
+    uint64_t hash = SEED;
+    for (int i = 0; i < row.GetRowPtrCnt(); i++) {
+        uint64_t slice_hash = ::fedb::base::MurmurHash64A(row.buf(i), row.size(i), SEED);
+        hash ^= slice_hash + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+static bool IsSameRpcRow(const ::hybridse::codec::Row& lhs, const ::hybridse::codec::Row& rhs) {
+    if (lhs.GetRowPtrCnt() != rhs.GetRowPtrCnt()) {
+        return false;
+    }
+    for (int i = 0; i < lhs.GetRowPtrCnt(); i++) {
+        if (lhs.size(i) != rhs.size(i)) {
+            return false;
+        }
+        if (lhs.size(i) > 0 && memcmp(lhs.buf(i), rhs.buf(i), lhs.size(i)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// encodes the output of a batch request column by column. a common column
+// holds the value of the first row only. with a common slice the common
+// columns are in slice 0 and the others in slice 1 of every row
+static bool EncodeBatchColumns(const ::hybridse::vm::Schema& schema, const std::vector<bool>& is_common,
+                               bool has_common_slice, const std::vector<::hybridse::codec::Row>& output_rows,
+                               const std::vector<size_t>& row_pos,
+                               ::fedb::api::SQLBatchRequestQueryResponse* response, butil::IOBuf* buf) {
+    ::hybridse::codec::Schema common_schema;
+    ::hybridse::codec::Schema non_common_schema;
+    std::vector<uint32_t> slice_col_idx(schema.size());
+    for (int i = 0; i < schema.size(); i++) {
+        if (has_common_slice && is_common[i]) {
+            slice_col_idx[i] = common_schema.size();
+            *common_schema.Add() = schema.Get(i);
+        } else {
+            slice_col_idx[i] = non_common_schema.size();
+            *non_common_schema.Add() = schema.Get(i);
+        }
+    }
+    int slice_num = has_common_slice ? 2 : 1;
+    std::vector<const int8_t*> common_rows;
+    std::vector<const int8_t*> rows;
+    rows.reserve(row_pos.size());
+    for (size_t pos : row_pos) {
+        if (output_rows[pos].GetRowPtrCnt() != slice_num) {
+            LOG(WARNING) << "illegal row ptrs: expect " << slice_num;
+            return false;
+        }
+        rows.push_back(output_rows[pos].buf(slice_num - 1));
+    }
+    if (!row_pos.empty()) {
+        common_rows.push_back(output_rows[row_pos[0]].buf(0));
+    }
+    for (int i = 0; i < schema.size(); i++) {
+        size_t size = 0;
+        bool ok = false;
+        if (has_common_slice && is_common[i]) {
+            ok = codec::EncodeRpcColumn(common_schema, slice_col_idx[i], common_rows, buf, &size);
+        } else {
+            ok = codec::EncodeRpcColumn(non_common_schema, slice_col_idx[i], is_common[i] ? common_rows : rows,
+                                        buf, &size);
+        }
+        if (!ok) {
+            return false;
+        }
+        response->add_column_sizes(size);
+    }
+    response->set_columnar(true);
+    return true;
+}
+
+static uint64_t GetPlanCacheHitCnt(void* arg) {
+    return reinterpret_cast<SQLPlanCache*>(arg)->GetHitCnt();
+}
+
+static uint64_t GetPlanCacheMissCnt(void* arg) {
+    return reinterpret_cast<SQLPlanCache*>(arg)->GetMissCnt();
+}
+
+static uint64_t GetResultCacheHitCnt(void* arg) {
+    return reinterpret_cast<ProcedureResultCache*>(arg)->GetHitCnt();
+}
+
+static uint64_t GetResultCacheMissCnt(void* arg) {
+    return reinterpret_cast<ProcedureResultCache*>(arg)->GetMissCnt();
+}
+
+static uint64_t GetResultCacheBytes(void* arg) {
+    return reinterpret_cast<ProcedureResultCache*>(arg)->GetBytes();
+}
+
+static void* RunBatchQueryTask(void* args) {
+    auto task = reinterpret_cast<std::function<void()>*>(args);
+    (*task)();
+    return NULL;
+}
+
+// run fn for every key of a batch query. keys are split into groups by
+// stride and each group runs on its own bthread, so lookups falling in
+// different segments proceed in parallel
+static void ForEachBatchKey(uint32_t key_cnt,
+                            const std::function<void(uint32_t)>& fn) {
+    uint32_t parallelism = std::min(FLAGS_batch_query_parallelism, key_cnt);
+    if (parallelism <= 1 || key_cnt < FLAGS_batch_query_parallel_threshold) {
+        for (uint32_t idx = 0; idx < key_cnt; idx++) {
+            fn(idx);
+        }
+        return;
+    }
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(parallelism);
+    for (uint32_t group = 0; group < parallelism; group++) {
+        tasks.emplace_back([group, parallelism, key_cnt, &fn]() {
+            for (uint32_t idx = group; idx < key_cnt; idx += parallelism) {
+                fn(idx);
+            }
+        });
+    }
+    std::vector<bthread_t> bthreads(parallelism);
+    std::vector<bool> started(parallelism, false);
+    for (uint32_t group = 1; group < parallelism; group++) {
+        if (bthread_start_background(&bthreads[group], NULL, RunBatchQueryTask,
+                                     &tasks[group]) == 0) {
+            started[group] = true;
+        } else {
+            PDLOG(WARNING, "fail to start bthread for batch query, run it inline");
+            tasks[group]();
+        }
+    }
+    tasks[0]();
+    for (uint32_t group = 1; group < parallelism; group++) {
+        if (started[group]) {
+            bthread_join(bthreads[group], NULL);
+        }
+    }
+}
+
+static int32_t ConvertQueryCode(int32_t code) {
+    switch (code) {
+        case 0:
+            return ::fedb::base::ReturnCode::kOk;
+        case 1:
+            return ::fedb::base::ReturnCode::kKeyNotFound;
+        case -1:
+        case -2:
+            return ::fedb::base::ReturnCode::kInvalidParameter;
+        case -3:
+            return ::fedb::base::ReturnCode::kReacheTheScanMaxBytesSize;
+        case -4:
+            return ::fedb::base::ReturnCode::kEncodeError;
+        default:
+            return code;
+    }
+}
 
 TabletImpl::TabletImpl()
     : tables_(),
@@ -119,6 +313,8 @@ TabletImpl::TabletImpl()
       task_pool_(FLAGS_task_pool_size),
       io_pool_(FLAGS_io_pool_size),
       snapshot_pool_(FLAGS_snapshot_pool_size),
+      load_scheduler_(FLAGS_load_table_concurrency_per_disk),
+      load_pool_(std::make_shared<::fedb::base::TaskPool>(FLAGS_load_table_thread_num, FLAGS_load_table_batch)),
       server_(NULL),
       mode_root_paths_(),
       mode_recycle_root_paths_(),
@@ -129,8 +325,18 @@ TabletImpl::TabletImpl()
       zk_path_(),
       endpoint_(),
       sp_cache_(std::shared_ptr<SpCache>(new SpCache())),
-      notify_path_() {
-}
+      plan_cache_(std::make_shared<SQLPlanCache>(FLAGS_sql_plan_cache_shard_num, FLAGS_sql_plan_cache_capacity)),
+      plan_cache_hit_(),
+      plan_cache_miss_(),
+      result_cache_(std::make_shared<ProcedureResultCache>(
+          static_cast<uint64_t>(FLAGS_procedure_result_cache_max_mb) * 1024 * 1024,
+          FLAGS_procedure_result_cache_slot_num)),
+      result_cache_hit_(),
+      result_cache_miss_(),
+      result_cache_bytes_(),
+      notify_path_(),
+      rpc_metric_(),
+      admission_() {}
 
 TabletImpl::~TabletImpl() {
     task_pool_.Stop(true);
@@ -138,6 +344,8 @@ TabletImpl::~TabletImpl() {
     gc_pool_.Stop(true);
     io_pool_.Stop(true);
     snapshot_pool_.Stop(true);
+    load_scheduler_.Stop();
+    load_pool_->Stop();
     delete zk_client_;
 }
 
@@ -153,6 +361,24 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
     engine_ = std::unique_ptr<::hybridse::vm::Engine>(new ::hybridse::vm::Engine(catalog_, options));
     catalog_->SetLocalTablet(std::shared_ptr<::hybridse::vm::Tablet>(
         new ::hybridse::vm::LocalTablet(engine_.get(), sp_cache_)));
+    // several tablets may share a process, so the bvar names carry the endpoint
+    std::string metric_prefix = "fedb_tablet_" + endpoint;
+    plan_cache_hit_.reset(new bvar::PassiveStatus<uint64_t>(metric_prefix, "sql_plan_cache_hit",
+                                                            GetPlanCacheHitCnt, plan_cache_.get()));
+    plan_cache_miss_.reset(new bvar::PassiveStatus<uint64_t>(metric_prefix, "sql_plan_cache_miss",
+                                                             GetPlanCacheMissCnt, plan_cache_.get()));
+    result_cache_hit_.reset(new bvar::PassiveStatus<uint64_t>(metric_prefix, "procedure_result_cache_hit",
+                                                              GetResultCacheHitCnt, result_cache_.get()));
+    result_cache_miss_.reset(new bvar::PassiveStatus<uint64_t>(metric_prefix, "procedure_result_cache_miss",
+                                                               GetResultCacheMissCnt, result_cache_.get()));
+    result_cache_bytes_.reset(new bvar::PassiveStatus<uint64_t>(metric_prefix, "procedure_result_cache_bytes",
+                                                                GetResultCacheBytes, result_cache_.get()));
+    rpc_metric_.reset(new RpcMetric(metric_prefix, FLAGS_enable_table_rpc_metric));
+    if (FLAGS_enable_admission_control) {
+        admission_.reset(new AdmissionController(metric_prefix + "_admission", FLAGS_admission_max_concurrency,
+                                                 FLAGS_admission_class_weight, FLAGS_admission_queue_size,
+                                                 FLAGS_admission_queue_timeout_ms));
+    }
     std::set<std::string> snapshot_compression_set{"off", "zlib", "snappy"};
     if (snapshot_compression_set.find(FLAGS_snapshot_compression) == snapshot_compression_set.end()) {
         LOG(WARNING) << "wrong snapshot_compression: " << FLAGS_snapshot_compression;
@@ -488,6 +714,10 @@ int32_t TabletImpl::GetIndex(const ::fedb::api::GetRequest* request,
 void TabletImpl::Get(RpcController* controller,
                      const ::fedb::api::GetRequest* request,
                      ::fedb::api::GetResponse* response, Closure* done) {
+    done = NewTableRpcMetricClosure(kGetMetric, request, response, done);
+    if (!Admit(kOnlineRpc, response, &done)) {
+        return;
+    }
     brpc::ClosureGuard done_guard(done);
     uint64_t start_time = ::baidu::common::timer::get_micros();
     uint32_t tid = request->tid();
@@ -518,6 +748,14 @@ void TabletImpl::Get(RpcController* controller,
             response->set_msg("table is loading");
             return;
         }
+        table->RecordRead();
+        std::string msg;
+        int32_t offset_code = CheckReadOffset(table, request->min_log_offset(), &msg);
+        if (offset_code != ::fedb::base::ReturnCode::kOk) {
+            response->set_code(offset_code);
+            response->set_msg(msg);
+            return;
+        }
         uint32_t index = 0;
         int ts_index = -1;
         if (request->has_ts_name() && request->ts_name().size() > 0) {
@@ -607,12 +845,16 @@ void TabletImpl::Get(RpcController* controller,
 void TabletImpl::Put(RpcController* controller,
                      const ::fedb::api::PutRequest* request,
                      ::fedb::api::PutResponse* response, Closure* done) {
+    done = NewRpcMetricClosure(rpc_metric_.get(), kPutMetric, request->tid(), request->pid(), response, done);
     if (follower_.load(std::memory_order_relaxed)) {
         response->set_code(::fedb::base::ReturnCode::kIsFollowerCluster);
         response->set_msg("is follower cluster");
         done->Run();
         return;
     }
+    if (!Admit(kWriteRpc, response, &done)) {
+        return;
+    }
     uint64_t start_time = ::baidu::common::timer::get_micros();
     std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
     if (!table) {
@@ -693,7 +935,19 @@ void TabletImpl::Put(RpcController* controller,
         done->Run();
         return;
     }
+    table->RecordPut(request->value().size());
     response->set_code(::fedb::base::ReturnCode::kOk);
+    if (result_cache_->Enabled()) {
+        std::vector<std::string> keys;
+        if (request->dimensions_size() > 0) {
+            for (const auto& dimension : request->dimensions()) {
+                keys.push_back(dimension.key());
+            }
+        } else {
+            keys.push_back(request->pk());
+        }
+        result_cache_->Invalidate(table->GetDB(), table->GetName(), keys);
+    }
     std::shared_ptr<LogReplicator> replicator;
     do {
         replicator = GetReplicator(request->tid(), request->pid());
@@ -717,6 +971,7 @@ void TabletImpl::Put(RpcController* controller,
                     request->ts_dimensions());
         }
         replicator->AppendEntry(entry);
+        response->set_log_offset(entry.log_index());
     } while (false);
     uint64_t end_time = ::baidu::common::timer::get_micros();
     if (start_time + FLAGS_put_slow_log_threshold < end_time) {
@@ -1274,6 +1529,10 @@ int32_t TabletImpl::CountIndex(uint64_t expire_time, uint64_t expire_cnt,
 void TabletImpl::Scan(RpcController* controller,
                       const ::fedb::api::ScanRequest* request,
                       ::fedb::api::ScanResponse* response, Closure* done) {
+    done = NewTableRpcMetricClosure(kScanMetric, request, response, done);
+    if (!Admit(kOnlineRpc, response, &done)) {
+        return;
+    }
     brpc::ClosureGuard done_guard(done);
     uint64_t start_time = ::baidu::common::timer::get_micros();
     if (request->st() < request->et()) {
@@ -1309,6 +1568,14 @@ void TabletImpl::Scan(RpcController* controller,
             response->set_msg("table is loading");
             return;
         }
+        table->RecordRead();
+        std::string msg;
+        int32_t offset_code = CheckReadOffset(table, request->min_log_offset(), &msg);
+        if (offset_code != ::fedb::base::ReturnCode::kOk) {
+            response->set_code(offset_code);
+            response->set_msg(msg);
+            return;
+        }
         uint32_t index = 0;
         int ts_index = -1;
         if (request->has_ts_name() && !request->ts_name().empty()) {
@@ -1408,9 +1675,249 @@ void TabletImpl::Scan(RpcController* controller,
     }
 }
 
+int32_t TabletImpl::CheckReadOffset(const std::shared_ptr<Table>& table,
+                                    uint64_t min_log_offset, std::string* msg) {
+    if (min_log_offset == 0 || table->IsLeader()) {
+        return ::fedb::base::ReturnCode::kOk;
+    }
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(table->GetId(), table->GetPid());
+    if (!replicator) {
+        PDLOG(WARNING, "fail to find table tid %u pid %u log replicator", table->GetId(), table->GetPid());
+        *msg = "replicator is not exist";
+        return ::fedb::base::ReturnCode::kReplicatorIsNotExist;
+    }
+    uint64_t offset = replicator->GetOffset();
+    if (offset < min_log_offset) {
+        DLOG(INFO) << "replica of tid " << table->GetId() << " pid " << table->GetPid() << " offset " << offset
+                   << " is behind " << min_log_offset;
+        *msg = "replica offset is behind";
+        return ::fedb::base::ReturnCode::kReplicaOffsetBehind;
+    }
+    return ::fedb::base::ReturnCode::kOk;
+}
+
+int32_t TabletImpl::GetBatchQueryIndex(uint32_t tid, uint32_t pid,
+                                       const std::string& idx_name,
+                                       const std::string& ts_name,
+                                       std::shared_ptr<Table>* table,
+                                       uint32_t* index, int* ts_index,
+                                       ::fedb::storage::TTLSt* expired_value,
+                                       std::string* msg) {
+    *table = GetTable(tid, pid);
+    if (!(*table)) {
+        PDLOG(WARNING, "table is not exist. tid %u, pid %u", tid, pid);
+        *msg = "table is not exist";
+        return ::fedb::base::ReturnCode::kTableIsNotExist;
+    }
+    if ((*table)->GetTableStat() == ::fedb::storage::kLoading) {
+        PDLOG(WARNING, "table is loading. tid %u, pid %u", tid, pid);
+        *msg = "table is loading";
+        return ::fedb::base::ReturnCode::kTableIsLoading;
+    }
+    *ts_index = -1;
+    if (!ts_name.empty()) {
+        auto iter = (*table)->GetTSMapping().find(ts_name);
+        if (iter == (*table)->GetTSMapping().end()) {
+            PDLOG(WARNING, "ts name %s not found in table tid %u, pid %u",
+                  ts_name.c_str(), tid, pid);
+            *msg = "ts name not found";
+            return ::fedb::base::ReturnCode::kTsNameNotFound;
+        }
+        *ts_index = iter->second;
+    }
+    std::string index_name = idx_name;
+    if (index_name.empty()) {
+        index_name = (*table)->GetPkIndex()->GetName();
+    }
+    std::shared_ptr<IndexDef> index_def;
+    if (*ts_index >= 0) {
+        index_def = (*table)->GetIndex(index_name, *ts_index);
+    } else {
+        index_def = (*table)->GetIndex(index_name);
+    }
+    if (!index_def || !index_def->IsReady()) {
+        PDLOG(WARNING, "idx name %s not found in table tid %u, pid %u", index_name.c_str(), tid, pid);
+        *msg = "idx name not found";
+        return ::fedb::base::ReturnCode::kIdxNameNotFound;
+    }
+    *index = index_def->GetId();
+    *expired_value = *(index_def->GetTTL());
+    expired_value->abs_ttl = (*table)->GetExpireTime(*expired_value);
+    return ::fedb::base::ReturnCode::kOk;
+}
+
+void TabletImpl::BatchGet(RpcController* controller,
+                          const ::fedb::api::BatchGetRequest* request,
+                          ::fedb::api::BatchGetResponse* response,
+                          Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::shared_ptr<Table> table;
+    uint32_t index = 0;
+    int ts_index = -1;
+    ::fedb::storage::TTLSt expired_value;
+    std::string msg;
+    int32_t code = GetBatchQueryIndex(request->tid(), request->pid(), request->idx_name(), request->ts_name(),
+                                      &table, &index, &ts_index, &expired_value, &msg);
+    if (code == ::fedb::base::ReturnCode::kOk) {
+        code = CheckReadOffset(table, request->min_log_offset(), &msg);
+    }
+    if (code != ::fedb::base::ReturnCode::kOk) {
+        response->set_code(code);
+        response->set_msg(msg);
+        return;
+    }
+    // all keys share the same get condition
+    ::fedb::api::GetRequest get_request;
+    get_request.set_tid(request->tid());
+    get_request.set_pid(request->pid());
+    get_request.set_ts(request->ts());
+    get_request.set_type(request->type());
+    get_request.set_et(request->et());
+    get_request.set_et_type(request->et_type());
+    get_request.mutable_projection()->CopyFrom(request->projection());
+    const ::fedb::api::TableMeta& table_meta = table->GetTableMeta();
+    const std::map<int32_t, std::shared_ptr<Schema>> vers_schema = table->GetAllVersionSchema();
+    uint32_t key_cnt = request->keys_size();
+    std::vector<std::string> values(key_cnt);
+    std::vector<uint64_t> ts_vec(key_cnt, 0);
+    std::vector<int32_t> codes(key_cnt, ::fedb::base::ReturnCode::kOk);
+    ForEachBatchKey(key_cnt, [&](uint32_t idx) {
+        table->RecordRead();
+        std::vector<QueryIt> query_its(1);
+        GetIterator(table, request->keys(idx), index, ts_index, &query_its[0].it, &query_its[0].ticket);
+        if (!query_its[0].it) {
+            codes[idx] = ::fedb::base::ReturnCode::kTsNameNotFound;
+            return;
+        }
+        query_its[0].table = table;
+        CombineIterator combine_it(std::move(query_its), get_request.ts(), get_request.type(), expired_value);
+        combine_it.SeekToFirst();
+        codes[idx] = ConvertQueryCode(
+            GetIndex(&get_request, table_meta, vers_schema, &combine_it, &values[idx], &ts_vec[idx]));
+    });
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    butil::IOBuf& buf = cntl->response_attachment();
+    for (uint32_t idx = 0; idx < key_cnt; idx++) {
+        response->add_key_codes(codes[idx]);
+        response->add_ts(ts_vec[idx]);
+        response->add_buf_offsets(buf.size());
+        if (codes[idx] == ::fedb::base::ReturnCode::kOk) {
+            buf.append(values[idx]);
+        }
+    }
+    response->set_buf_size(buf.size());
+    response->set_code(::fedb::base::ReturnCode::kOk);
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_query_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[batchget]. key cnt %u index_name %s time %lu. tid %u, pid %u", key_cnt,
+              request->idx_name().c_str(), end_time - start_time, request->tid(), request->pid());
+    }
+}
+
+void TabletImpl::BatchScan(RpcController* controller,
+                           const ::fedb::api::BatchScanRequest* request,
+                           ::fedb::api::BatchScanResponse* response,
+                           Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    if (request->st() < request->et()) {
+        response->set_code(::fedb::base::ReturnCode::kStLessThanEt);
+        response->set_msg("starttime less than endtime");
+        return;
+    }
+    std::shared_ptr<Table> table;
+    uint32_t index = 0;
+    int ts_index = -1;
+    ::fedb::storage::TTLSt expired_value;
+    std::string msg;
+    int32_t code = GetBatchQueryIndex(request->tid(), request->pid(), request->idx_name(), request->ts_name(),
+                                      &table, &index, &ts_index, &expired_value, &msg);
+    if (code == ::fedb::base::ReturnCode::kOk) {
+        code = CheckReadOffset(table, request->min_log_offset(), &msg);
+    }
+    if (code != ::fedb::base::ReturnCode::kOk) {
+        response->set_code(code);
+        response->set_msg(msg);
+        return;
+    }
+    // all keys share the same scan condition
+    ::fedb::api::ScanRequest scan_request;
+    scan_request.set_tid(request->tid());
+    scan_request.set_pid(request->pid());
+    scan_request.set_st(request->st());
+    scan_request.set_et(request->et());
+    scan_request.set_st_type(request->st_type());
+    scan_request.set_et_type(request->et_type());
+    scan_request.set_limit(request->limit());
+    scan_request.set_atleast(request->atleast());
+    scan_request.set_enable_remove_duplicated_record(request->enable_remove_duplicated_record());
+    scan_request.mutable_projection()->CopyFrom(request->projection());
+    const ::fedb::api::TableMeta& table_meta = table->GetTableMeta();
+    const std::map<int32_t, std::shared_ptr<Schema>> vers_schema = table->GetAllVersionSchema();
+    uint32_t key_cnt = request->keys_size();
+    std::vector<butil::IOBuf> bufs(key_cnt);
+    std::vector<uint32_t> counts(key_cnt, 0);
+    std::vector<int32_t> codes(key_cnt, ::fedb::base::ReturnCode::kOk);
+    // all keys share one scan_max_bytes_size budget, the keys scanned after it
+    // is used up are skipped
+    std::atomic<uint64_t> scanned_bytes(0);
+    ForEachBatchKey(key_cnt, [&](uint32_t idx) {
+        if (scanned_bytes.load(std::memory_order_relaxed) > FLAGS_scan_max_bytes_size) {
+            codes[idx] = ::fedb::base::ReturnCode::kReacheTheScanMaxBytesSize;
+            return;
+        }
+        table->RecordRead();
+        std::vector<QueryIt> query_its(1);
+        GetIterator(table, request->keys(idx), index, ts_index, &query_its[0].it, &query_its[0].ticket);
+        if (!query_its[0].it) {
+            codes[idx] = ::fedb::base::ReturnCode::kTsNameNotFound;
+            return;
+        }
+        query_its[0].table = table;
+        CombineIterator combine_it(std::move(query_its), scan_request.st(), scan_request.st_type(), expired_value);
+        codes[idx] = ConvertQueryCode(
+            ScanIndex(&scan_request, table_meta, vers_schema, &combine_it, &bufs[idx], &counts[idx]));
+        scanned_bytes.fetch_add(bufs[idx].size(), std::memory_order_relaxed);
+    });
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    butil::IOBuf& buf = cntl->response_attachment();
+    // the response holds the keys before the one that overflows the budget,
+    // that key and all keys after it get kReacheTheScanMaxBytesSize
+    bool truncated = false;
+    for (uint32_t idx = 0; idx < key_cnt; idx++) {
+        if (!truncated && (codes[idx] == ::fedb::base::ReturnCode::kReacheTheScanMaxBytesSize ||
+                           (codes[idx] == ::fedb::base::ReturnCode::kOk &&
+                            buf.size() + bufs[idx].size() > FLAGS_scan_max_bytes_size))) {
+            truncated = true;
+        }
+        if (truncated) {
+            codes[idx] = ::fedb::base::ReturnCode::kReacheTheScanMaxBytesSize;
+        }
+        response->add_key_codes(codes[idx]);
+        response->add_buf_offsets(buf.size());
+        if (codes[idx] == ::fedb::base::ReturnCode::kOk) {
+            response->add_counts(counts[idx]);
+            buf.append(bufs[idx]);
+        } else {
+            response->add_counts(0);
+        }
+    }
+    response->set_buf_size(buf.size());
+    response->set_code(::fedb::base::ReturnCode::kOk);
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_query_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[batchscan]. key cnt %u index_name %s time %lu. tid %u, pid %u", key_cnt,
+              request->idx_name().c_str(), end_time - start_time, request->tid(), request->pid());
+    }
+}
+
 void TabletImpl::Count(RpcController* controller,
                        const ::fedb::api::CountRequest* request,
                        ::fedb::api::CountResponse* response, Closure* done) {
+    if (!Admit(kBatchRpc, response, &done)) {
+        return;
+    }
     brpc::ClosureGuard done_guard(done);
     std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
     if (!table) {
@@ -1427,6 +1934,7 @@ void TabletImpl::Count(RpcController* controller,
         response->set_msg("table is loading");
         return;
     }
+    table->RecordRead();
     uint32_t index = 0;
     int ts_index = -1;
     if (request->has_ts_name() && request->ts_name().size() > 0) {
@@ -1531,6 +2039,9 @@ void TabletImpl::Traverse(RpcController* controller,
                           const ::fedb::api::TraverseRequest* request,
                           ::fedb::api::TraverseResponse* response,
                           Closure* done) {
+    if (!Admit(kBatchRpc, response, &done)) {
+        return;
+    }
     brpc::ClosureGuard done_guard(done);
     std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
     if (!table) {
@@ -1547,6 +2058,7 @@ void TabletImpl::Traverse(RpcController* controller,
         response->set_msg("table is loading");
         return;
     }
+    table->RecordRead();
     uint32_t index = 0;
     int ts_index = -1;
     std::string index_name;
@@ -1741,6 +2253,10 @@ void TabletImpl::Delete(RpcController* controller,
         response->set_msg("ok");
         DEBUGLOG("delete ok. tid %u, pid %u, key %s", request->tid(),
                 request->pid(), request->key().c_str());
+        if (result_cache_->Enabled()) {
+            // the rows are gone from every index, not only the keyed one
+            result_cache_->Invalidate(table->GetDB(), table->GetName(), std::vector<std::string>());
+        }
     } else {
         response->set_code(::fedb::base::ReturnCode::kDeleteFailed);
         response->set_msg("delete failed");
@@ -1774,10 +2290,23 @@ void TabletImpl::Query(RpcController* ctrl,
                        const fedb::api::QueryRequest* request,
                        fedb::api::QueryResponse* response, Closure* done) {
     DLOG(INFO) << "handle query request begin!";
+    done = NewRpcMetricClosure(rpc_metric_.get(), kQueryMetric, response, done);
+    if (!Admit(request->is_batch() ? kBatchRpc : kOnlineRpc, response, &done)) {
+        return;
+    }
     brpc::ClosureGuard done_guard(done);
     brpc::Controller* cntl = static_cast<brpc::Controller*>(ctrl);
     butil::IOBuf& buf = cntl->response_attachment();
-    ProcessQuery(ctrl, request, response, &buf);
+    if (!request->is_profile()) {
+        ProcessQuery(ctrl, request, response, &buf);
+        return;
+    }
+    ::fedb::base::QueryProfiler profiler;
+    {
+        ::fedb::base::QueryProfiler::Scope scope(&profiler);
+        ProcessQuery(ctrl, request, response, &buf);
+    }
+    FillQueryProfile(profiler, response->mutable_profile());
 }
 
 void TabletImpl::ProcessQuery(RpcController* ctrl,
@@ -1791,8 +2320,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl,
             session.EnableDebug();
         }
         {
-            bool ok =
-                engine_->Get(request->sql(), request->db(), session, status);
+            bool ok = CompileSQL(request->db(), request->sql(), SQL_PLAN_BATCH, session, status);
             if (!ok) {
                 response->set_msg(status.msg);
                 response->set_code(::fedb::base::kSQLCompileError);
@@ -1801,7 +2329,11 @@ void TabletImpl::ProcessQuery(RpcController* ctrl,
             }
         }
 
-        auto table = session.Run();
+        std::shared_ptr<::hybridse::vm::TableHandler> table;
+        {
+            ::fedb::base::QueryProfiler::Stage stage("run");
+            table = session.Run();
+        }
         if (!table) {
             DLOG(WARNING) << "fail to run sql " << request->sql();
             response->set_code(::fedb::base::kSQLRunError);
@@ -1816,6 +2348,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl,
             response->set_code(::fedb::base::kOk);
             return;
         }
+        ::fedb::base::QueryProfiler::Stage stage("encode");
         iter->SeekToFirst();
         uint32_t byte_size = 0;
         uint32_t count = 0;
@@ -1833,6 +2366,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl,
             iter->Next();
             buf->append(reinterpret_cast<void*>(row.buf()), row.size());
             count += 1;
+            stage.SetRowCnt(count);
         }
         response->set_schema(session.GetEncodedSchema());
         response->set_byte_size(byte_size);
@@ -1851,8 +2385,9 @@ void TabletImpl::ProcessQuery(RpcController* ctrl,
             const std::string& sp_name = request->sp_name();
             std::shared_ptr<hybridse::vm::CompileInfo> request_compile_info;
             {
+                ::fedb::base::QueryProfiler::Stage stage("get_procedure");
                 hybridse::base::Status status;
-                request_compile_info = sp_cache_->GetRequestInfo(db_name, sp_name, status);
+                request_compile_info = GetProcedureInfo(db_name, sp_name, false, status);
                 if (!status.isOK()) {
                     response->set_code(::fedb::base::ReturnCode::kProcedureNotFound);
                     response->set_msg(status.msg);
@@ -1862,9 +2397,17 @@ void TabletImpl::ProcessQuery(RpcController* ctrl,
             }
             session.SetCompileInfo(request_compile_info);
             session.SetSpName(sp_name);
-            RunRequestQuery(ctrl, *request, session, *response, *buf);
+            std::shared_ptr<ProcedureResultCacheOption> cache_option;
+            if (!request->has_task_id() && !request->is_debug() && request->row_slices() == 1) {
+                cache_option = result_cache_->GetOption(db_name, sp_name);
+            }
+            if (!cache_option) {
+                RunRequestQuery(ctrl, *request, session, *response, *buf);
+            } else {
+                RunCachedRequestQuery(ctrl, *request, *cache_option, session, *response, *buf);
+            }
         } else {
-            bool ok = engine_->Get(request->sql(), request->db(), session, status);
+            bool ok = CompileSQL(request->db(), request->sql(), SQL_PLAN_REQUEST, session, status);
             if (!ok || session.GetCompileInfo() == nullptr) {
                 response->set_msg(status.msg);
                 response->set_code(::fedb::base::kSQLCompileError);
@@ -1896,10 +2439,35 @@ void TabletImpl::SubQuery(RpcController* ctrl,
 void TabletImpl::SQLBatchRequestQuery(RpcController* ctrl, const fedb::api::SQLBatchRequestQueryRequest* request,
                                       fedb::api::SQLBatchRequestQueryResponse* response, Closure* done) {
     DLOG(INFO) << "handle query batch request begin!";
+    done = NewRpcMetricClosure(rpc_metric_.get(), kSQLBatchRequestQueryMetric, response, done);
+    if (!Admit(kOnlineRpc, response, &done)) {
+        return;
+    }
     brpc::ClosureGuard done_guard(done);
     brpc::Controller* cntl = static_cast<brpc::Controller*>(ctrl);
     butil::IOBuf& buf = cntl->response_attachment();
-    return ProcessBatchRequestQuery(ctrl, request, response, buf);
+    if (!request->is_profile()) {
+        ProcessBatchRequestQuery(ctrl, request, response, buf);
+        return;
+    }
+    ::fedb::base::QueryProfiler profiler;
+    {
+        ::fedb::base::QueryProfiler::Scope scope(&profiler);
+        ProcessBatchRequestQuery(ctrl, request, response, buf);
+    }
+    FillQueryProfile(profiler, response->mutable_profile());
+}
+
+void TabletImpl::FillQueryProfile(const ::fedb::base::QueryProfiler& profiler, ::fedb::api::QueryProfile* profile) {
+    profile->set_endpoint(endpoint_);
+    profile->set_total_time_us(profiler.GetTotalTime());
+    for (const auto& stage : profiler.GetStages()) {
+        ::fedb::api::QueryProfileStage* profile_stage = profile->add_stage();
+        profile_stage->set_name(stage.name);
+        profile_stage->set_time_us(stage.time_us);
+        profile_stage->set_row_cnt(stage.row_cnt);
+        profile_stage->set_cnt(stage.cnt);
+    }
 }
 void TabletImpl::ProcessBatchRequestQuery(
     RpcController* ctrl, const fedb::api::SQLBatchRequestQueryRequest* request,
@@ -1914,9 +2482,10 @@ void TabletImpl::ProcessBatchRequestQuery(
     if (is_procedure) {
         std::shared_ptr<hybridse::vm::CompileInfo> request_compile_info;
         {
+            ::fedb::base::QueryProfiler::Stage stage("get_procedure");
             hybridse::base::Status status;
-            request_compile_info = sp_cache_->GetBatchRequestInfo(
-                request->db(), request->sp_name(), status);
+            request_compile_info = GetProcedureInfo(
+                request->db(), request->sp_name(), true, status);
             if (!status.isOK()) {
                 response->set_code(
                     ::fedb::base::ReturnCode::kProcedureNotFound);
@@ -1929,11 +2498,13 @@ void TabletImpl::ProcessBatchRequestQuery(
         }
     } else {
         size_t common_column_num = request->common_column_indices().size();
+        std::string option = SQL_PLAN_BATCH_REQUEST;
         for (size_t i = 0; i < common_column_num; ++i) {
             auto col_idx = request->common_column_indices().Get(i);
             session.AddCommonColumnIdx(col_idx);
+            option.append(",").append(std::to_string(col_idx));
         }
-        bool ok = engine_->Get(request->sql(), request->db(), session, status);
+        bool ok = CompileSQL(request->db(), request->sql(), option, session, status);
         if (!ok || session.GetCompileInfo() == nullptr) {
             response->set_msg(status.msg);
             response->set_code(::fedb::base::kSQLCompileError);
@@ -1966,50 +2537,72 @@ void TabletImpl::ProcessBatchRequestQuery(
         return;
     }
 
-    auto& io_buf = static_cast<brpc::Controller*>(ctrl)->request_attachment();
-    size_t buf_offset = 0;
-    std::vector<::hybridse::codec::Row> input_rows(input_row_num);
+    // rows are cut off the front of a shallow copy of the attachment
+    std::unique_ptr<::fedb::base::QueryProfiler::Stage> decode_stage(
+        new ::fedb::base::QueryProfiler::Stage("decode"));
+    decode_stage->SetRowCnt(input_row_num);
+    butil::IOBuf io_buf = static_cast<brpc::Controller*>(ctrl)->request_attachment();
+    ::hybridse::codec::Row common_row;
+    size_t row_size_idx = 0;
     if (has_common_and_uncommon_row) {
-        size_t common_size = request->row_sizes().Get(0);
-        ::hybridse::codec::Row common_row;
-        if (!codec::DecodeRpcRow(io_buf, buf_offset, common_size,
-                                 request->common_slices(), &common_row)) {
+        size_t common_size = request->row_sizes().Get(row_size_idx++);
+        if (!codec::CutRpcRow(&io_buf, common_size,
+                              request->common_slices(), &common_row)) {
             response->set_msg("decode input common row failed");
             response->set_code(::fedb::base::kSQLRunError);
             return;
         }
-        buf_offset += common_size;
-        for (size_t i = 0; i < input_row_num; ++i) {
-            ::hybridse::codec::Row non_common_row;
-            size_t non_common_size = request->row_sizes().Get(i + 1);
-            if (!codec::DecodeRpcRow(io_buf, buf_offset, non_common_size,
-                                     request->non_common_slices(), &non_common_row)) {
-                response->set_msg("decode input non common row failed");
-                response->set_code(::fedb::base::kSQLRunError);
-                return;
-            }
-            buf_offset += non_common_size;
-            input_rows[i] = ::hybridse::codec::Row(
-                1, common_row, 1, non_common_row);
+    }
+    // request rows with the same bytes produce the same output, so the session
+    // only runs the distinct ones. row_pos maps a request row to its distinct row.
+    // rows that only share the window key still run one by one, the window
+    // lookups happen inside the engine, which evaluates every request row alone
+    std::vector<::hybridse::codec::Row> input_rows;
+    std::vector<::hybridse::codec::Row> non_common_rows;
+    std::vector<size_t> row_pos(input_row_num);
+    std::unordered_map<uint64_t, std::vector<size_t>> row_hash_map;
+    input_rows.reserve(input_row_num);
+    for (size_t i = 0; i < input_row_num; ++i) {
+        ::hybridse::codec::Row non_common_row;
+        size_t non_common_size = request->row_sizes().Get(row_size_idx++);
+        if (!codec::CutRpcRow(&io_buf, non_common_size,
+                              request->non_common_slices(), &non_common_row)) {
+            response->set_msg("decode input non common row failed");
+            response->set_code(::fedb::base::kSQLRunError);
+            return;
         }
-    } else {
-        for (size_t i = 0; i < input_row_num; ++i) {
-            size_t non_common_size = request->row_sizes().Get(i);
-            if (!codec::DecodeRpcRow(io_buf, buf_offset, non_common_size,
-                                     request->non_common_slices(), &input_rows[i])) {
-                response->set_msg("decode input non common row failed");
-                response->set_code(::fedb::base::kSQLRunError);
-                return;
+        auto& same_hash_rows = row_hash_map[HashRpcRow(non_common_row)];
+        bool found = false;
+        for (size_t pos : same_hash_rows) {
+            if (IsSameRpcRow(non_common_rows[pos], non_common_row)) {
+                row_pos[i] = pos;
+                found = true;
+                break;
             }
-            buf_offset += non_common_size;
         }
+        if (found) {
+            continue;
+        }
+        row_pos[i] = input_rows.size();
+        same_hash_rows.push_back(input_rows.size());
+        if (has_common_and_uncommon_row) {
+            input_rows.emplace_back(1, common_row, 1, non_common_row);
+        } else {
+            input_rows.push_back(non_common_row);
+        }
+        non_common_rows.push_back(std::move(non_common_row));
     }
+    decode_stage.reset();
     std::vector<::hybridse::codec::Row> output_rows;
     int32_t run_ret = 0;
-    if (request->has_task_id()) {
-        session.Run(request->task_id(), input_rows, output_rows);
-    } else {
-        session.Run(input_rows, output_rows);
+    {
+        ::fedb::base::QueryProfiler::Stage stage("run");
+        stage.SetRowCnt(input_rows.size());
+        if (request->has_task_id()) {
+            session.Run(request->task_id(), input_rows, output_rows);
+        } else {
+            session.Run(input_rows, output_rows);
+        }
     }
     if (run_ret != 0) {
         response->set_msg(status.msg);
@@ -2019,6 +2612,8 @@ void TabletImpl::ProcessBatchRequestQuery(
     }
 
     // fill output data
+    ::fedb::base::QueryProfiler::Stage encode_stage("encode");
+    encode_stage.SetRowCnt(row_pos.size());
     size_t output_col_num = session.GetSchema().size();
     auto& output_common_indices =
         batch_request_info.output_common_column_indices;
@@ -2026,40 +2621,62 @@ void TabletImpl::ProcessBatchRequestQuery(
         !request->has_task_id() && !output_common_indices.empty() &&
         output_common_indices.size() < output_col_num;
 
-    if (has_common_and_uncomon_slice && !output_rows.empty()) {
-        const auto& first_row = output_rows[0];
-        if (first_row.GetRowPtrCnt() != 2) {
-            response->set_msg("illegal row ptrs: expect 2");
+    if (output_rows.size() != input_rows.size()) {
+        response->set_msg("output row count mismatch");
+        response->set_code(::fedb::base::kSQLRunError);
+        LOG(WARNING) << "output row count " << output_rows.size() << " mismatch with input " << input_rows.size();
+        return;
+    }
+    if (request->columnar_result()) {
+        std::vector<bool> is_common(output_col_num, false);
+        for (size_t idx : output_common_indices) {
+            if (idx < output_col_num) {
+                is_common[idx] = true;
+            }
+        }
+        if (!EncodeBatchColumns(session.GetSchema(), is_common, has_common_and_uncomon_slice, output_rows, row_pos,
+                                response, &buf)) {
+            response->set_msg("encode output columns failed");
             response->set_code(::fedb::base::kSQLRunError);
-            LOG(WARNING) << "illegal row ptrs: expect 2";
             return;
         }
-        buf.append(first_row.buf(0), first_row.size(0));
-        response->add_row_sizes(first_row.size(0));
-        response->set_common_slices(1);
     } else {
-        response->set_common_slices(0);
-    }
-    response->set_non_common_slices(1);
-    for (auto& output_row : output_rows) {
-        if (has_common_and_uncomon_slice) {
-            if (output_row.GetRowPtrCnt() != 2) {
+        if (has_common_and_uncomon_slice && !output_rows.empty()) {
+            const auto& first_row = output_rows[0];
+            if (first_row.GetRowPtrCnt() != 2) {
                 response->set_msg("illegal row ptrs: expect 2");
                 response->set_code(::fedb::base::kSQLRunError);
                 LOG(WARNING) << "illegal row ptrs: expect 2";
                 return;
             }
-            buf.append(output_row.buf(1), output_row.size(1));
-            response->add_row_sizes(output_row.size(1));
+            buf.append(first_row.buf(0), first_row.size(0));
+            response->add_row_sizes(first_row.size(0));
+            response->set_common_slices(1);
         } else {
-            if (output_row.GetRowPtrCnt() != 1) {
-                response->set_msg("illegal row ptrs: expect 1");
-                response->set_code(::fedb::base::kSQLRunError);
-                LOG(WARNING) << "illegal row ptrs: expect 1";
-                return;
+            response->set_common_slices(0);
+        }
+        response->set_non_common_slices(1);
+        for (size_t pos : row_pos) {
+            const auto& output_row = output_rows[pos];
+            if (has_common_and_uncomon_slice) {
+                if (output_row.GetRowPtrCnt() != 2) {
+                    response->set_msg("illegal row ptrs: expect 2");
+                    response->set_code(::fedb::base::kSQLRunError);
+                    LOG(WARNING) << "illegal row ptrs: expect 2";
+                    return;
+                }
+                buf.append(output_row.buf(1), output_row.size(1));
+                response->add_row_sizes(output_row.size(1));
+            } else {
+                if (output_row.GetRowPtrCnt() != 1) {
+                    response->set_msg("illegal row ptrs: expect 1");
+                    response->set_code(::fedb::base::kSQLRunError);
+                    LOG(WARNING) << "illegal row ptrs: expect 1";
+                    return;
+                }
+                buf.append(output_row.buf(0), output_row.size(0));
+                response->add_row_sizes(output_row.size(0));
             }
-            buf.append(output_row.buf(0), output_row.size(0));
-            response->add_row_sizes(output_row.size(0));
         }
     }
 
@@ -2068,10 +2685,10 @@ void TabletImpl::ProcessBatchRequestQuery(
         response->add_common_column_indices(idx);
     }
     response->set_schema(session.GetEncodedSchema());
-    response->set_count(output_rows.size());
+    response->set_count(row_pos.size());
     response->set_code(::fedb::base::kOk);
     DLOG(INFO) << "handle batch request sql " << request->sql()
-               << " with record cnt " << output_rows.size()
+               << " with record cnt " << row_pos.size() << " distinct cnt " << output_rows.size()
                << " with schema size " << session.GetSchema().size();
 }
 void TabletImpl::SubBatchRequestQuery(RpcController* ctrl, const fedb::api::SQLBatchRequestQueryRequest* request,
@@ -2330,6 +2947,11 @@ void TabletImpl::AppendEntries(
     RpcController* controller,
     const ::fedb::api::AppendEntriesRequest* request,
     ::fedb::api::AppendEntriesResponse* response, Closure* done) {
+    done = NewRpcMetricClosure(rpc_metric_.get(), kAppendEntriesMetric, request->tid(), request->pid(), response,
+                               done);
+    if (!Admit(kAdminRpc, response, &done)) {
+        return;
+    }
     brpc::ClosureGuard done_guard(done);
     std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
     if (!table) {
@@ -2369,6 +2991,25 @@ void TabletImpl::AppendEntries(
         response->set_code(::fedb::base::ReturnCode::kOk);
         response->set_msg("ok");
     }
+    if (result_cache_->Enabled() && request->entries_size() > 0) {
+        // procedures are routed to followers too, so replicated rows drop the
+        // cached results the same way a local put or delete does
+        std::vector<std::string> keys;
+        for (const auto& entry : request->entries()) {
+            if (entry.has_method_type() && entry.method_type() == ::fedb::api::MethodType::kDelete) {
+                keys.clear();
+                break;
+            }
+            if (entry.dimensions_size() > 0) {
+                for (const auto& dimension : entry.dimensions()) {
+                    keys.push_back(dimension.key());
+                }
+            } else {
+                keys.push_back(entry.pk());
+            }
+        }
+        result_cache_->Invalidate(table->GetDB(), table->GetName(), keys);
+    }
 }
 
 void TabletImpl::GetTableSchema(
@@ -2483,7 +3124,8 @@ void TabletImpl::GetTableStatus(
     const ::fedb::api::GetTableStatusRequest* request,
     ::fedb::api::GetTableStatusResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
-    std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+    std::vector<std::pair<std::shared_ptr<Table>, ::fedb::api::TableStatus*>> memory_tables;
+    std::unique_lock<SpinMutex> spin_lock(spin_mutex_);
     for (auto it = tables_.begin(); it != tables_.end(); ++it) {
         if (request->has_tid() && request->tid() != it->first) {
             continue;
@@ -2510,6 +3152,9 @@ void TabletImpl::GetTableStatus(
             ttl_desc->set_ttl_type(ttl.GetTabletTTLType());
             status->set_ttl_type(ttl.GetTabletTTLType());
             status->set_diskused(table->GetDiskused());
+            status->set_put_cnt(table->GetPutCnt());
+            status->set_put_byte_size(table->GetPutByteSize());
+            status->set_read_cnt(table->GetReadCnt());
             if (status->ttl_type() == ::fedb::api::TTLType::kLatestTime) {
                 status->set_ttl(table->GetTTL().lat_ttl);
             } else {
@@ -2557,11 +3202,66 @@ void TabletImpl::GetTableStatus(
             if (request->has_need_schema() && request->need_schema()) {
                 status->set_schema(table->GetSchema());
             }
+            if (request->need_memory_usage()) {
+                memory_tables.push_back(std::make_pair(table, status));
+            }
         }
     }
+    spin_lock.unlock();
+    if (request->need_memory_usage()) {
+        GetTableMemoryUsage(memory_tables);
+        GetProcessMemoryUsage(response->mutable_process_memory_usage());
+    }
     response->set_code(::fedb::base::ReturnCode::kOk);
 }
 
+void TabletImpl::GetTableMemoryUsage(
+    const std::vector<std::pair<std::shared_ptr<Table>, ::fedb::api::TableStatus*>>& tables) {
+    for (const auto& kv : tables) {
+        const std::shared_ptr<Table>& table = kv.first;
+        ::fedb::api::TableMemoryUsage* usage = kv.second->mutable_memory_usage();
+        if (MemTable* mem_table = dynamic_cast<MemTable*>(table.get())) {
+            mem_table->GetMemoryUsage(usage);
+        }
+        std::shared_ptr<LogReplicator> replicator = GetReplicator(table->GetId(), table->GetPid());
+        if (replicator) {
+            uint64_t buffer_byte_size = 0;
+            uint64_t cache_byte_size = 0;
+            replicator->GetMemoryUsage(&buffer_byte_size, &cache_byte_size);
+            usage->set_binlog_buffer_byte_size(buffer_byte_size);
+            usage->set_replication_cache_byte_size(cache_byte_size);
+        }
+    }
+}
+
+void TabletImpl::GetProcessMemoryUsage(::fedb::api::ProcessMemoryUsage* usage) {
+#ifdef TCMALLOC_ENABLE
+    MallocExtension* tcmalloc = MallocExtension::instance();
+    size_t value = 0;
+    if (tcmalloc->GetNumericProperty("generic.current_allocated_bytes", &value)) {
+        usage->set_allocated_byte_size(value);
+    }
+    if (tcmalloc->GetNumericProperty("generic.heap_size", &value)) {
+        usage->set_heap_byte_size(value);
+    }
+    if (tcmalloc->GetNumericProperty("tcmalloc.pageheap_free_bytes", &value)) {
+        usage->set_pageheap_free_byte_size(value);
+    }
+    if (tcmalloc->GetNumericProperty("tcmalloc.pageheap_unmapped_bytes", &value)) {
+        usage->set_unmapped_byte_size(value);
+    }
+    uint64_t cache_free = 0;
+    for (const char* property : {"tcmalloc.central_cache_free_bytes", "tcmalloc.transfer_cache_free_bytes",
+                                 "tcmalloc.thread_cache_free_bytes"}) {
+        if (tcmalloc->GetNumericProperty(property, &value)) {
+            cache_free += value;
+        }
+    }
+    usage->set_cache_free_byte_size(cache_free);
+#endif
+    usage->set_procedure_cnt(sp_cache_->GetProcedureCnt());
+}
+
 void TabletImpl::SetExpire(RpcController* controller,
                            const ::fedb::api::SetExpireRequest* request,
                            ::fedb::api::GeneralResponse* response,
@@ -2673,19 +3373,63 @@ void TabletImpl::MakeSnapshotInternal(
     PDLOG(INFO, "MakeSnapshotInternal finish, tid[%u] pid[%u]", tid, pid);
 }
 
-void TabletImpl::MakeSnapshot(RpcController* controller,
-                              const ::fedb::api::GeneralRequest* request,
-                              ::fedb::api::GeneralResponse* response,
-                              Closure* done) {
-    brpc::ClosureGuard done_guard(done);
-    std::shared_ptr<::fedb::api::TaskInfo> task_ptr;
-    if (request->has_task_info() && request->task_info().IsInitialized()) {
-        if (AddOPTask(request->task_info(),
-                      ::fedb::api::TaskType::kMakeSnapshot, task_ptr) < 0) {
-            response->set_code(-1);
-            response->set_msg("add task failed");
-            return;
-        }
+void TabletImpl::MakeSnapshotOnShutdown() {
+    // the server does not serve any more. leave zk before the snapshots are
+    // written, so that the nameserver moves the leaders of this tablet away
+    keep_alive_pool_.Stop(true);
+    if (zk_client_ != NULL) {
+        zk_client_->CloseZK();
+        PDLOG(INFO, "close zk session before making snapshot on shutdown");
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> partitions;
+    {
+        std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+        for (const auto& kv : tables_) {
+            for (const auto& table_kv : kv.second) {
+                if (table_kv.second->GetTableStat() == ::fedb::storage::kNormal) {
+                    partitions.emplace_back(kv.first, table_kv.first);
+                }
+            }
+        }
+    }
+    PDLOG(INFO, "make snapshot of %lu partitions on shutdown", partitions.size());
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    ::fedb::base::CountDownLatch latch(partitions.size());
+    for (const auto& partition : partitions) {
+        snapshot_pool_.AddTask(boost::bind(&TabletImpl::MakeSnapshotOnShutdownInternal, this, partition.first,
+                                           partition.second, &latch));
+    }
+    latch.Wait();
+    PDLOG(INFO, "make snapshot on shutdown done. time %lu ms",
+          (::baidu::common::timer::get_micros() - start_time) / 1000);
+}
+
+void TabletImpl::MakeSnapshotOnShutdownInternal(uint32_t tid, uint32_t pid, ::fedb::base::CountDownLatch* latch) {
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(tid, pid);
+    std::shared_ptr<Snapshot> snapshot = GetSnapshot(tid, pid);
+    if (replicator && snapshot) {
+        replicator->SyncToDisk();
+        uint64_t end_offset = replicator->GetOffset();
+        if (end_offset > snapshot->GetOffset()) {
+            MakeSnapshotInternal(tid, pid, end_offset, std::shared_ptr<::fedb::api::TaskInfo>());
+        }
+    }
+    latch->CountDown();
+}
+
+void TabletImpl::MakeSnapshot(RpcController* controller,
+                              const ::fedb::api::GeneralRequest* request,
+                              ::fedb::api::GeneralResponse* response,
+                              Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    std::shared_ptr<::fedb::api::TaskInfo> task_ptr;
+    if (request->has_task_info() && request->task_info().IsInitialized()) {
+        if (AddOPTask(request->task_info(),
+                      ::fedb::api::TaskType::kMakeSnapshot, task_ptr) < 0) {
+            response->set_code(-1);
+            response->set_msg("add task failed");
+            return;
+        }
     }
     uint32_t tid = request->tid();
     uint32_t pid = request->pid();
@@ -2776,7 +3520,7 @@ void TabletImpl::SchedMakeSnapshot() {
 
 void TabletImpl::SendData(RpcController* controller,
                           const ::fedb::api::SendDataRequest* request,
-                          ::fedb::api::GeneralResponse* response,
+                          ::fedb::api::SendDataResponse* response,
                           Closure* done) {
     brpc::ClosureGuard done_guard(done);
     brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
@@ -2810,6 +3554,15 @@ void TabletImpl::SendData(RpcController* controller,
                 response->set_msg("table already exists");
                 return;
             }
+            if (request->resume() && iter != file_receiver_map_.end() && iter->second->IsOpen()) {
+                // continue after the blocks received by the last try
+                response->set_block_id(iter->second->GetBlockId());
+                response->set_code(::fedb::base::ReturnCode::kOk);
+                response->set_msg("ok");
+                PDLOG(INFO, "file receiver resume. tid %u, pid %u, file_name %s, block_id %lu",
+                      tid, pid, request->file_name().c_str(), response->block_id());
+                return;
+            }
             if (iter == file_receiver_map_.end()) {
                 std::string path = db_root_path + "/" + std::to_string(tid) +
                                    "_" + std::to_string(pid) + "/";
@@ -2858,6 +3611,41 @@ void TabletImpl::SendData(RpcController* controller,
         response->set_msg("cannot find receiver");
         return;
     }
+    if (request->has_offset() && request->block_id() > 0) {
+        butil::IOBuf& data = cntl->request_attachment();
+        if (data.size() != request->block_size() ||
+            (request->has_checksum() && BlockChecksum(data) != request->checksum())) {
+            PDLOG(WARNING, "receive data error. tid %u, pid %u, file_name %s, block_id %lu", tid, pid,
+                  request->file_name().c_str(), request->block_id());
+            response->set_code(::fedb::base::ReturnCode::kReceiveDataError);
+            response->set_msg("receive data error");
+            return;
+        }
+        if (receiver->WriteBlock(&data, request->block_id(), request->offset()) < 0) {
+            PDLOG(WARNING, "receiver write data failed. tid %u, pid %u, file_name %s", tid, pid,
+                  request->file_name().c_str());
+            response->set_code(::fedb::base::ReturnCode::kWriteDataFailed);
+            response->set_msg("write data failed");
+            return;
+        }
+        response->set_block_id(receiver->GetBlockId());
+        if (request->eof()) {
+            // the sender drains its window before the last block
+            if (response->block_id() != request->block_id()) {
+                PDLOG(WARNING, "file is incomplete. tid %u, pid %u, file_name %s, block_id %lu eof block_id %lu",
+                      tid, pid, request->file_name().c_str(), response->block_id(), request->block_id());
+                response->set_code(::fedb::base::ReturnCode::kBlockIdMismatch);
+                response->set_msg("block_id mismatch");
+                return;
+            }
+            receiver->SaveFile();
+            std::lock_guard<std::mutex> lock(mu_);
+            file_receiver_map_.erase(combine_key);
+        }
+        response->set_msg("ok");
+        response->set_code(::fedb::base::ReturnCode::kOk);
+        return;
+    }
     if (receiver->GetBlockId() == request->block_id()) {
         response->set_msg("ok");
         response->set_code(::fedb::base::ReturnCode::kOk);
@@ -2874,7 +3662,8 @@ void TabletImpl::SendData(RpcController* controller,
         return;
     }
     std::string data = cntl->request_attachment().to_string();
-    if (data.length() != request->block_size()) {
+    if (data.length() != request->block_size() ||
+        (request->has_checksum() && ::fedb::log::Value(data.c_str(), data.length()) != request->checksum())) {
         PDLOG(WARNING,
               "receive data error. tid %u, pid %u, file_name %s, expected "
               "length %u real length %u",
@@ -3259,8 +4048,10 @@ void TabletImpl::LoadTable(RpcController* controller,
                 "idx_cnt %u schema_size %u ttl %llu",
                 tid, pid, name.c_str(), seg_cnt, table_meta.dimensions_size(),
                 table_meta.schema().size(), ttl);
-        task_pool_.AddTask(boost::bind(&TabletImpl::LoadTableInternal, this,
-                    tid, pid, task_ptr));
+        uint64_t load_size = 0;
+        ::fedb::base::GetDirSizeRecur(db_path, load_size);
+        load_scheduler_.Submit(root_path, table_meta.mode() == ::fedb::api::TableMode::kTableLeader, load_size,
+                               boost::bind(&TabletImpl::LoadTableInternal, this, tid, pid, task_ptr));
         response->set_code(::fedb::base::ReturnCode::kOk);
         response->set_msg("ok");
         return;
@@ -3368,6 +4159,7 @@ int32_t TabletImpl::DeleteTableInternal(
             std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
             engine_->ClearCacheLocked(table->GetTableMeta().db());
             tables_[tid].erase(pid);
+            rpc_metric_->DelTable(tid, pid);
             replicators_[tid].erase(pid);
             snapshots_[tid].erase(pid);
             if (tables_[tid].empty()) {
@@ -3386,6 +4178,7 @@ int32_t TabletImpl::DeleteTableInternal(
         }
         if (!table->GetDB().empty()) {
             catalog_->DeleteTable(table->GetDB(), table->GetName(), pid);
+            plan_cache_->Invalidate(table->GetDB());
         }
         code = 0;
     } while (0);
@@ -3980,10 +4773,11 @@ int TabletImpl::CreateTableInternal(const ::fedb::api::TableMeta* table_meta,
         table_meta->mode() == ::fedb::api::TableMode::kTableLeader) {
         replicator->SetLeaderTerm(table_meta->term());
     }
-    ::fedb::storage::Snapshot* snapshot_ptr =
+    ::fedb::storage::MemTableSnapshot* snapshot_ptr =
         new ::fedb::storage::MemTableSnapshot(
             table_meta->tid(), table_meta->pid(), replicator->GetLogPart(),
             db_root_path);
+    snapshot_ptr->SetLoadPool(load_pool_);
 
     if (!snapshot_ptr->Init()) {
         PDLOG(WARNING, "fail to init snapshot for tid %u, pid %u",
@@ -3993,6 +4787,7 @@ int TabletImpl::CreateTableInternal(const ::fedb::api::TableMeta* table_meta,
     }
     std::shared_ptr<Snapshot> snapshot(snapshot_ptr);
     tables_[table_meta->tid()].insert(std::make_pair(table_meta->pid(), table));
+    rpc_metric_->AddTable(table_meta->tid(), table_meta->pid());
     snapshots_[table_meta->tid()].insert(
         std::make_pair(table_meta->pid(), snapshot));
     replicators_[table_meta->tid()].insert(
@@ -4000,6 +4795,7 @@ int TabletImpl::CreateTableInternal(const ::fedb::api::TableMeta* table_meta,
     if (!table_meta->db().empty()) {
         bool ok = catalog_->AddTable(*table_meta, table);
         engine_->ClearCacheLocked(table_meta->db());
+        plan_cache_->Invalidate(table_meta->db());
         if (ok) {
             LOG(INFO) << "add table " << table_meta->name()
                 << " to catalog with db " << table_meta->db();
@@ -4175,6 +4971,16 @@ int TabletImpl::GetTaskStatus(std::shared_ptr<::fedb::api::TaskInfo>& task_ptr,
     return 0;
 }
 
+void TabletImpl::SetTaskProgress(
+    std::shared_ptr<::fedb::api::TaskInfo>& task_ptr,
+    const std::string& progress) {
+    if (!task_ptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    task_ptr->set_progress(progress);
+}
+
 int TabletImpl::AddOPTask(const ::fedb::api::TaskInfo& task_info,
                           ::fedb::api::TaskType task_type,
                           std::shared_ptr<::fedb::api::TaskInfo>& task_ptr) {
@@ -4353,6 +5159,84 @@ void TabletImpl::ShowMemPool(RpcController* controller,
 #endif
 }
 
+void TabletImpl::ShowRpcMetric(RpcController* controller, const ::fedb::api::HttpRequest* request,
+                               ::fedb::api::HttpResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    std::string stat;
+    rpc_metric_->Show(&stat);
+    cntl->response_attachment().append(stat);
+}
+
+// table and index names are user input
+static std::string EscapeHtml(const std::string& str) {
+    std::string result;
+    result.reserve(str.size());
+    for (char c : str) {
+        switch (c) {
+            case '&':
+                result.append("&amp;");
+                break;
+            case '<':
+                result.append("&lt;");
+                break;
+            case '>':
+                result.append("&gt;");
+                break;
+            case '"':
+                result.append("&quot;");
+                break;
+            case '\'':
+                result.append("&#39;");
+                break;
+            default:
+                result.push_back(c);
+        }
+    }
+    return result;
+}
+
+void TabletImpl::ShowMemoryUsage(RpcController* controller, const ::fedb::api::HttpRequest* request,
+                                 ::fedb::api::HttpResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    ::fedb::api::GetTableStatusRequest status_request;
+    status_request.set_need_memory_usage(true);
+    ::fedb::api::GetTableStatusResponse status_response;
+    GetTableStatus(NULL, &status_request, &status_response, NULL);
+    const ::fedb::api::ProcessMemoryUsage& process = status_response.process_memory_usage();
+    std::ostringstream oss;
+    oss << "<html><head><title>Memory Usage</title></head><body><pre>";
+    oss << "allocated: " << process.allocated_byte_size() << "\n";
+    oss << "heap: " << process.heap_byte_size() << "\n";
+    oss << "pageheap free: " << process.pageheap_free_byte_size() << "\n";
+    oss << "cache free: " << process.cache_free_byte_size() << "\n";
+    oss << "unmapped: " << process.unmapped_byte_size() << "\n";
+    oss << "procedure cnt: " << process.procedure_cnt() << "\n";
+    oss << "</pre><table border=\"1\"><tr><th>tid</th><th>pid</th><th>name</th><th>index</th>"
+        << "<th>key entry</th><th>time node</th><th>pending gc</th><th>row</th>"
+        << "<th>binlog buffer</th><th>replication cache</th></tr>";
+    for (const auto& status : status_response.all_table_status()) {
+        const ::fedb::api::TableMemoryUsage& usage = status.memory_usage();
+        for (int i = 0; i < usage.index_size(); i++) {
+            const ::fedb::api::IndexMemoryUsage& index = usage.index(i);
+            oss << "<tr><td>" << status.tid() << "</td><td>" << status.pid() << "</td><td>"
+                << EscapeHtml(status.name()) << "</td><td>" << EscapeHtml(index.name()) << "</td><td>"
+                << index.key_entry_byte_size() << "</td><td>" << index.time_node_byte_size() << "</td><td>"
+                << index.pending_gc_byte_size() << "</td>";
+            if (i == 0) {
+                oss << "<td>" << usage.row_byte_size() << "</td><td>" << usage.binlog_buffer_byte_size()
+                    << "</td><td>" << usage.replication_cache_byte_size() << "</td>";
+            } else {
+                oss << "<td></td><td></td><td></td>";
+            }
+            oss << "</tr>";
+        }
+    }
+    oss << "</table></body></html>";
+    cntl->response_attachment().append(oss.str());
+}
+
 void TabletImpl::CheckZkClient() {
     if (!zk_client_->IsConnected()) {
         PDLOG(WARNING, "reconnect zk");
@@ -4369,6 +5253,43 @@ void TabletImpl::CheckZkClient() {
                                boost::bind(&TabletImpl::CheckZkClient, this));
 }
 
+bool TabletImpl::RefreshChangedTables(uint64_t version) {
+    uint64_t cur_version = catalog_->GetVersion();
+    if (cur_version == 0 || version <= cur_version) {
+        return false;
+    }
+    std::string value;
+    if (!zk_client_->GetNodeValue(zk_path_ + "/table/change_log", value)) {
+        return false;
+    }
+    std::set<uint32_t> tids;
+    if (!::fedb::catalog::GetChangedTables(value, cur_version, version, &tids)) {
+        DLOG(INFO) << "reload all tables. version " << cur_version << " -> " << version;
+        return false;
+    }
+    std::string db_table_data_path = zk_path_ + "/table/db_table_data";
+    std::vector<::fedb::nameserver::TableInfo> table_info_vec;
+    for (uint32_t tid : tids) {
+        std::string node = db_table_data_path + "/" + std::to_string(tid);
+        if (zk_client_->IsExistNode(node) != 0) {
+            // the table is dropped
+            continue;
+        }
+        if (!zk_client_->GetNodeValue(node, value)) {
+            LOG(WARNING) << "fail to get table data. node: " << node;
+            return false;
+        }
+        ::fedb::nameserver::TableInfo table_info;
+        if (!table_info.ParseFromString(value)) {
+            LOG(WARNING) << "fail to parse table proto. node: " << node;
+            return false;
+        }
+        table_info_vec.push_back(std::move(table_info));
+    }
+    catalog_->RefreshTables(table_info_vec, tids, version);
+    return true;
+}
+
 void TabletImpl::RefreshTableInfo() {
     std::string db_table_notify_path = zk_path_ + "/table/notify";
     std::string value;
@@ -4382,6 +5303,9 @@ void TabletImpl::RefreshTableInfo() {
     } catch (const std::exception& e) {
         LOG(WARNING) << "value is not integer";
     }
+    if (RefreshChangedTables(version)) {
+        return;
+    }
     std::string db_table_data_path = zk_path_ + "/table/db_table_data";
     std::vector<std::string> table_datas;
     if (zk_client_->IsExistNode(db_table_data_path) == 0) {
@@ -4437,6 +5361,7 @@ void TabletImpl::RefreshTableInfo() {
             LOG(WARNING) << "fail to parse procedure proto. node: " << node << " value: "<< value;
             continue;
         }
+        AddProcedureResultCache(sp_info_pb);
         // conver to ProcedureInfoImpl
         auto sp_info = fedb::catalog::SchemaAdapter::ConvertProcedureInfo(sp_info_pb);
         if (!sp_info) {
@@ -5236,6 +6161,424 @@ void TabletImpl::ExtractIndexDataInternal(
     SetTaskStatus(task, ::fedb::api::TaskStatus::kDone);
 }
 
+void TabletImpl::BackfillIndexData(
+    RpcController* controller,
+    const ::fedb::api::BackfillIndexDataRequest* request,
+    ::fedb::api::GeneralResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    std::shared_ptr<::fedb::api::TaskInfo> task_ptr;
+    if (request->has_task_info() && request->task_info().IsInitialized()) {
+        if (AddOPTask(request->task_info(),
+                      ::fedb::api::TaskType::kBackfillIndexData,
+                      task_ptr) < 0) {
+            response->set_code(-1);
+            response->set_msg("add task failed");
+            return;
+        }
+    }
+    do {
+        uint32_t tid = request->tid();
+        uint32_t pid = request->pid();
+        std::shared_ptr<Table> table = GetTable(tid, pid);
+        if (!table) {
+            PDLOG(WARNING, "table is not exist. tid %u pid %u", tid, pid);
+            response->set_code(::fedb::base::ReturnCode::kTableIsNotExist);
+            response->set_msg("table is not exist");
+            break;
+        }
+        if (table->GetTableStat() != ::fedb::storage::kNormal) {
+            PDLOG(WARNING,
+                  "table state is %d, cannot backfill index data. tid %u, "
+                  "pid %u",
+                  table->GetTableStat(), tid, pid);
+            response->set_code(
+                ::fedb::base::ReturnCode::kTableStatusIsNotKnormal);
+            response->set_msg("table status is not kNormal");
+            break;
+        }
+        std::shared_ptr<MemTable> mem_table =
+            std::dynamic_pointer_cast<MemTable>(table);
+        if (!mem_table) {
+            PDLOG(WARNING, "table is not memtable. tid %u, pid %u", tid, pid);
+            response->set_code(::fedb::base::ReturnCode::kTableTypeMismatch);
+            response->set_msg("table is not memtable");
+            break;
+        }
+        auto backfill = std::make_shared<::fedb::storage::IndexBackfill>(
+            mem_table, request->column_key(), request->idx(),
+            request->partition_num());
+        if (!backfill->Init()) {
+            PDLOG(WARNING, "init index backfill failed. tid %u pid %u", tid,
+                  pid);
+            response->set_code(::fedb::base::ReturnCode::kAddIndexFailed);
+            response->set_msg("init index backfill failed");
+            break;
+        }
+        std::map<uint32_t, std::string> pid_endpoint_map;
+        for (const auto& pair : request->pairs()) {
+            pid_endpoint_map.insert(
+                std::make_pair(pair.pid(), pair.endpoint()));
+        }
+        task_pool_.AddTask(boost::bind(&TabletImpl::BackfillIndexDataInternal,
+                                       this, mem_table, backfill,
+                                       pid_endpoint_map, task_ptr));
+        response->set_code(::fedb::base::ReturnCode::kOk);
+        response->set_msg("ok");
+        PDLOG(INFO, "backfill index %s. tid[%u] pid[%u]",
+              request->column_key().index_name().c_str(), tid, pid);
+        return;
+    } while (0);
+    SetTaskStatus(task_ptr, ::fedb::api::TaskStatus::kFailed);
+}
+
+void TabletImpl::BackfillIndexDataInternal(
+    std::shared_ptr<::fedb::storage::MemTable> table,
+    std::shared_ptr<::fedb::storage::IndexBackfill> backfill,
+    const std::map<uint32_t, std::string>& pid_endpoint_map,
+    std::shared_ptr<::fedb::api::TaskInfo> task) {
+    uint32_t tid = table->GetId();
+    uint32_t pid = table->GetPid();
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(tid, pid);
+    if (!replicator) {
+        PDLOG(WARNING, "replicator is not exist. tid %u pid %u", tid, pid);
+        SetTaskStatus(task, ::fedb::api::TaskStatus::kFailed);
+        return;
+    }
+    std::map<uint32_t, std::shared_ptr<::fedb::client::TabletClient>> clients;
+    for (const auto& kv : pid_endpoint_map) {
+        std::string real_endpoint = kv.second;
+        if (FLAGS_use_name) {
+            auto tmp_map = std::atomic_load_explicit(&real_ep_map_,
+                    std::memory_order_acquire);
+            auto iter = tmp_map->find(kv.second);
+            if (iter == tmp_map->end()) {
+                PDLOG(WARNING, "name %s not found in real_ep_map."
+                        "tid[%u] pid[%u]", kv.second.c_str(), tid, pid);
+                SetTaskStatus(task, ::fedb::api::TaskStatus::kFailed);
+                return;
+            }
+            real_endpoint = iter->second;
+        }
+        auto client = std::make_shared<::fedb::client::TabletClient>(
+            kv.second, real_endpoint);
+        if (client->Init() < 0) {
+            PDLOG(WARNING, "init client failed. endpoint[%s] tid[%u] pid[%u]",
+                  kv.second.c_str(), tid, pid);
+            SetTaskStatus(task, ::fedb::api::TaskStatus::kFailed);
+            return;
+        }
+        clients.insert(std::make_pair(kv.first, client));
+    }
+    // rows put from now on are caught up from the binlog
+    uint64_t start_offset = replicator->GetOffset();
+    std::vector<std::pair<uint32_t, uint32_t>> segments;
+    for (uint32_t idx : backfill->GetScanIndex()) {
+        for (uint32_t seg_idx = 0; seg_idx < table->GetSegCnt(); seg_idx++) {
+            segments.push_back(std::make_pair(idx, seg_idx));
+        }
+    }
+    std::atomic<uint32_t> next_segment(0);
+    std::atomic<uint32_t> done_segment(0);
+    std::atomic<uint64_t> scan_cnt(0);
+    std::atomic<uint64_t> local_cnt(0);
+    std::atomic<uint64_t> remote_cnt(0);
+    std::atomic<bool> failed(false);
+    auto progress = [&]() {
+        return "segment " + std::to_string(done_segment.load()) + "/" +
+               std::to_string(segments.size()) + " scanned " +
+               std::to_string(scan_cnt.load()) + " local " +
+               std::to_string(local_cnt.load()) + " remote " +
+               std::to_string(remote_cnt.load());
+    };
+    auto flush = [&](uint32_t index_pid,
+                     ::fedb::api::PutIndexDataRequest* request) {
+        if (request->entries_size() == 0) {
+            return true;
+        }
+        auto it = clients.find(index_pid);
+        if (it == clients.end()) {
+            PDLOG(WARNING, "leader of pid %u is unknown. tid %u pid %u",
+                  index_pid, tid, pid);
+            return false;
+        }
+        request->set_tid(tid);
+        request->set_pid(index_pid);
+        if (!SendIndexEntries(it->second, request, task)) {
+            return false;
+        }
+        remote_cnt.fetch_add(request->entries_size(),
+                             std::memory_order_relaxed);
+        request->clear_entries();
+        return true;
+    };
+    auto scan = [&]() {
+        std::map<uint32_t, ::fedb::api::PutIndexDataRequest> requests;
+        ::fedb::api::LogEntry entry;
+        while (!failed.load(std::memory_order_relaxed)) {
+            uint32_t pos = next_segment.fetch_add(1);
+            if (pos >= segments.size()) {
+                break;
+            }
+            uint32_t scan_idx = segments[pos].first;
+            std::unique_ptr<::fedb::storage::TableIterator> it(
+                table->NewSegmentTraverseIterator(scan_idx,
+                                                  segments[pos].second));
+            if (!it) {
+                failed.store(true, std::memory_order_relaxed);
+                break;
+            }
+            it->SeekToFirst();
+            while (it->Valid()) {
+                scan_cnt.fetch_add(1, std::memory_order_relaxed);
+                int index_pid = backfill->PackRow(scan_idx, it->GetKey(),
+                                                  it->GetValue(), &entry);
+                // puts of clients that know the new index already write it
+                // while the scan runs, so the scanned rows may be there
+                if (index_pid == static_cast<int>(pid)) {
+                    int ret = ::fedb::storage::IndexBackfill::PutEntry(
+                        table, entry, true);
+                    if (ret < 0) {
+                        PDLOG(WARNING, "put index entry failed. tid %u pid %u",
+                              tid, pid);
+                        failed.store(true, std::memory_order_relaxed);
+                        break;
+                    } else if (ret == 0) {
+                        replicator->AppendEntry(entry);
+                        local_cnt.fetch_add(1, std::memory_order_relaxed);
+                    }
+                } else if (index_pid >= 0) {
+                    auto& request = requests[index_pid];
+                    request.set_check_exist(true);
+                    request.add_entries()->Swap(&entry);
+                    if (request.entries_size() >=
+                            static_cast<int>(FLAGS_index_backfill_batch_size) &&
+                        !flush(index_pid, &request)) {
+                        failed.store(true, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+                it->Next();
+            }
+            done_segment.fetch_add(1);
+            SetTaskProgress(task, progress());
+        }
+        for (auto& kv : requests) {
+            if (!failed.load(std::memory_order_relaxed) &&
+                !flush(kv.first, &kv.second)) {
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+    uint32_t thread_num = std::max(1u, std::min(FLAGS_index_backfill_thread_num,
+                                                 (uint32_t)segments.size()));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < thread_num; i++) {
+        threads.emplace_back(scan);
+    }
+    scan();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (failed.load()) {
+        PDLOG(WARNING, "backfill index from memory failed. tid %u pid %u %s",
+              tid, pid, progress().c_str());
+        SetTaskStatus(task, ::fedb::api::TaskStatus::kFailed);
+        return;
+    }
+    PDLOG(INFO, "backfill index from memory done. tid %u pid %u %s", tid, pid,
+          progress().c_str());
+    // catch up the rows put while traversing
+    uint64_t end_offset = replicator->GetOffset();
+    replicator->SyncToDisk();
+    ::fedb::log::LogReader log_reader(replicator->GetLogPart(),
+                                      replicator->GetLogPath(), false);
+    log_reader.SetOffset(start_offset);
+    uint64_t cur_offset = start_offset;
+    uint64_t catchup_cnt = 0;
+    uint64_t last_time = ::baidu::common::timer::get_micros() / 1000;
+    int last_log_index = log_reader.GetLogIndex();
+    std::map<uint32_t, ::fedb::api::PutIndexDataRequest> requests;
+    std::string buffer;
+    ::fedb::api::LogEntry entry;
+    while (cur_offset < end_offset) {
+        buffer.clear();
+        ::fedb::base::Slice record;
+        ::fedb::base::Status status =
+            log_reader.ReadNextRecord(&record, &buffer);
+        if (status.IsWaitRecord()) {
+            int end_log_index = log_reader.GetEndLogIndex();
+            int cur_log_index = log_reader.GetLogIndex();
+            if (end_log_index >= 0 && end_log_index > cur_log_index) {
+                log_reader.RollRLogFile();
+                continue;
+            }
+            // the tail is not flushed yet
+            uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+            if (last_time + FLAGS_load_index_max_wait_time < cur_time) {
+                PDLOG(WARNING, "wait binlog too long. tid %u pid %u offset %lu",
+                      tid, pid, cur_offset);
+                failed.store(true);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        if (status.IsEof()) {
+            if (log_reader.GetLogIndex() != last_log_index) {
+                last_log_index = log_reader.GetLogIndex();
+                continue;
+            }
+            break;
+        }
+        if (!status.ok()) {
+            continue;
+        }
+        if (!entry.ParseFromString(std::string(record.data(), record.size()))) {
+            continue;
+        }
+        if (entry.log_index() <= cur_offset) {
+            continue;
+        }
+        cur_offset = entry.log_index();
+        int index_pid = backfill->PackEntry(&entry);
+        if (index_pid == static_cast<int>(pid)) {
+            int ret = ::fedb::storage::IndexBackfill::PutEntry(table, entry,
+                                                                true);
+            if (ret < 0) {
+                failed.store(true);
+                break;
+            } else if (ret == 0) {
+                replicator->AppendEntry(entry);
+            }
+        } else if (index_pid >= 0) {
+            auto& request = requests[index_pid];
+            request.set_check_exist(true);
+            request.add_entries()->Swap(&entry);
+            if (request.entries_size() >=
+                    static_cast<int>(FLAGS_index_backfill_batch_size) &&
+                !flush(index_pid, &request)) {
+                failed.store(true);
+                break;
+            }
+        }
+        if (++catchup_cnt % 10000 == 0) {
+            SetTaskProgress(task, progress() + " binlog " +
+                                      std::to_string(cur_offset) + "/" +
+                                      std::to_string(end_offset));
+        }
+    }
+    for (auto& kv : requests) {
+        if (!failed.load() && !flush(kv.first, &kv.second)) {
+            failed.store(true);
+        }
+    }
+    SetTaskProgress(task, progress() + " binlog " + std::to_string(cur_offset) +
+                              "/" + std::to_string(end_offset));
+    if (failed.load()) {
+        PDLOG(WARNING, "catch up index from binlog failed. tid %u pid %u",
+              tid, pid);
+        SetTaskStatus(task, ::fedb::api::TaskStatus::kFailed);
+        return;
+    }
+    PDLOG(INFO, "backfill index success. tid %u pid %u %s binlog %lu-%lu",
+          tid, pid, progress().c_str(), start_offset, end_offset);
+    SetTaskStatus(task, ::fedb::api::TaskStatus::kDone);
+}
+
+bool TabletImpl::SendIndexEntries(
+    const std::shared_ptr<::fedb::client::TabletClient>& client,
+    ::fedb::api::PutIndexDataRequest* request,
+    std::shared_ptr<::fedb::api::TaskInfo> task) {
+    uint64_t start_time = ::baidu::common::timer::get_micros() / 1000;
+    while (true) {
+        ::fedb::api::GeneralResponse response;
+        bool ok = client->PutIndexData(*request, &response);
+        if (ok && response.code() == ::fedb::base::ReturnCode::kOk) {
+            return true;
+        }
+        if (ok && response.code() != ::fedb::base::ReturnCode::kIndexNotReady) {
+            PDLOG(WARNING, "put index data to %s failed. code %d msg %s",
+                  client->GetEndpoint().c_str(), response.code(),
+                  response.msg().c_str());
+            return false;
+        }
+        ::fedb::api::TaskStatus status = ::fedb::api::TaskStatus::kFailed;
+        if (GetTaskStatus(task, &status) == 0 &&
+            status != ::fedb::api::TaskStatus::kDoing) {
+            return false;
+        }
+        uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+        if (start_time + FLAGS_load_index_max_wait_time < cur_time) {
+            PDLOG(WARNING, "wait index on %s too long",
+                  client->GetEndpoint().c_str());
+            return false;
+        }
+        // a timed out request may have been applied
+        request->set_check_exist(true);
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(FLAGS_task_check_interval));
+    }
+}
+
+void TabletImpl::PutIndexData(RpcController* controller,
+                              const ::fedb::api::PutIndexDataRequest* request,
+                              ::fedb::api::GeneralResponse* response,
+                              Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    uint32_t tid = request->tid();
+    uint32_t pid = request->pid();
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    if (!table) {
+        PDLOG(WARNING, "table is not exist. tid %u, pid %u", tid, pid);
+        response->set_code(::fedb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table is not exist");
+        return;
+    }
+    if (!table->IsLeader()) {
+        response->set_code(::fedb::base::ReturnCode::kTableIsFollower);
+        response->set_msg("table is follower");
+        return;
+    }
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(tid, pid);
+    if (!replicator) {
+        PDLOG(WARNING, "replicator is not exist. tid %u pid %u", tid, pid);
+        response->set_code(::fedb::base::ReturnCode::kReplicatorIsNotExist);
+        response->set_msg("replicator is not exist");
+        return;
+    }
+    for (const auto& entry : request->entries()) {
+        if (entry.dimensions_size() == 0) {
+            response->set_code(
+                ::fedb::base::ReturnCode::kInvalidDimensionParameter);
+            response->set_msg("invalid dimension parameter");
+            return;
+        }
+        auto index_def = table->GetIndex(entry.dimensions(0).idx());
+        if (!index_def || !index_def->IsReady()) {
+            // the add index task of this partition has not run yet
+            response->set_code(::fedb::base::ReturnCode::kIndexNotReady);
+            response->set_msg("index is not ready");
+            return;
+        }
+    }
+    for (const auto& entry : request->entries()) {
+        int ret = ::fedb::storage::IndexBackfill::PutEntry(
+            table, entry, request->check_exist());
+        if (ret < 0) {
+            PDLOG(WARNING, "put index entry failed. tid %u pid %u", tid, pid);
+            response->set_code(::fedb::base::ReturnCode::kPutFailed);
+            response->set_msg("put failed");
+            return;
+        }
+        if (ret == 0) {
+            ::fedb::api::LogEntry cur_entry(entry);
+            replicator->AppendEntry(cur_entry);
+        }
+    }
+    response->set_code(::fedb::base::ReturnCode::kOk);
+    response->set_msg("ok");
+}
+
 void TabletImpl::AddIndex(RpcController* controller,
                           const ::fedb::api::AddIndexRequest* request,
                           ::fedb::api::GeneralResponse* response,
@@ -5424,6 +6767,9 @@ void TabletImpl::CreateProcedure(RpcController* controller,
 
     sp_cache_->InsertSQLProcedureCacheEntry(db_name, sp_name, sp_info_impl, session.GetCompileInfo(),
                                             batch_session.GetCompileInfo());
+    plan_cache_->Erase(db_name, SQL_PLAN_SP_REQUEST, sp_name);
+    plan_cache_->Erase(db_name, SQL_PLAN_SP_BATCH_REQUEST, sp_name);
+    AddProcedureResultCache(sp_info);
 
     response->set_code(::fedb::base::ReturnCode::kOk);
     response->set_msg("ok");
@@ -5438,6 +6784,9 @@ void TabletImpl::DropProcedure(RpcController* controller,
     const std::string& db_name = request->db_name();
     const std::string& sp_name = request->sp_name();
     sp_cache_->DropSQLProcedureCacheEntry(db_name, sp_name);
+    plan_cache_->Erase(db_name, SQL_PLAN_SP_REQUEST, sp_name);
+    plan_cache_->Erase(db_name, SQL_PLAN_SP_BATCH_REQUEST, sp_name);
+    result_cache_->DropProcedure(db_name, sp_name);
     if (!catalog_->DropProcedure(db_name, sp_name)) {
         LOG(WARNING) << "drop procedure" << db_name << "." << sp_name << " in catalog failed";
     }
@@ -5447,6 +6796,49 @@ void TabletImpl::DropProcedure(RpcController* controller,
         db_name.c_str(), sp_name.c_str());
 }
 
+bool TabletImpl::CompileSQL(const std::string& db, const std::string& sql,
+                            const std::string& option,
+                            ::hybridse::vm::RunSession& session,
+                            ::hybridse::base::Status& status) {
+    ::fedb::base::QueryProfiler::Stage stage("compile");
+    if (session.IsDebug()) {
+        // debug mode prints the plan while compiling
+        return engine_->Get(sql, db, session, status);
+    }
+    // a plan compiled concurrently with a ddl is tagged with the old version
+    uint64_t version = catalog_->GetVersion();
+    auto compile_info = plan_cache_->Get(db, option, sql, version);
+    if (compile_info) {
+        session.SetCompileInfo(compile_info);
+        return true;
+    }
+    if (!engine_->Get(sql, db, session, status)) {
+        return false;
+    }
+    plan_cache_->Insert(db, option, sql, version, session.GetCompileInfo());
+    return true;
+}
+
+std::shared_ptr<hybridse::vm::CompileInfo> TabletImpl::GetProcedureInfo(
+    const std::string& db, const std::string& sp_name, bool is_batch_request,
+    hybridse::base::Status& status) {
+    const char* option = is_batch_request ? SQL_PLAN_SP_BATCH_REQUEST : SQL_PLAN_SP_REQUEST;
+    uint64_t version = catalog_->GetVersion();
+    auto compile_info = plan_cache_->Get(db, option, sp_name, version);
+    if (compile_info) {
+        return compile_info;
+    }
+    if (is_batch_request) {
+        compile_info = sp_cache_->GetBatchRequestInfo(db, sp_name, status);
+    } else {
+        compile_info = sp_cache_->GetRequestInfo(db, sp_name, status);
+    }
+    if (status.isOK()) {
+        plan_cache_->Insert(db, option, sp_name, version, compile_info);
+    }
+    return compile_info;
+}
+
 void TabletImpl::RunRequestQuery(RpcController* ctrl,
                                  const fedb::api::QueryRequest& request,
                                  ::hybridse::vm::RequestRunSession& session,
@@ -5458,17 +6850,25 @@ void TabletImpl::RunRequestQuery(RpcController* ctrl,
     ::hybridse::codec::Row row;
     auto& request_buf = static_cast<brpc::Controller*>(ctrl)->request_attachment();
     size_t input_slices = request.row_slices();
-    if (!codec::DecodeRpcRow(request_buf, 0, request.row_size(), input_slices, &row)) {
-        response.set_code(::fedb::base::kSQLRunError);
-        response.set_msg("fail to decode input row");
-        return;
+    {
+        ::fedb::base::QueryProfiler::Stage stage("decode");
+        stage.SetRowCnt(1);
+        if (!codec::DecodeRpcRow(request_buf, 0, request.row_size(), input_slices, &row)) {
+            response.set_code(::fedb::base::kSQLRunError);
+            response.set_msg("fail to decode input row");
+            return;
+        }
     }
     ::hybridse::codec::Row output;
     int32_t ret = 0;
-    if (request.has_task_id()) {
-        ret = session.Run(request.task_id(), row, &output);
-    } else {
-        ret = session.Run(row, &output);
+    {
+        ::fedb::base::QueryProfiler::Stage stage("run");
+        stage.SetRowCnt(1);
+        if (request.has_task_id()) {
+            ret = session.Run(request.task_id(), row, &output);
+        } else {
+            ret = session.Run(row, &output);
+        }
     }
     if (ret != 0) {
         response.set_code(::fedb::base::kSQLRunError);
@@ -5479,6 +6879,8 @@ void TabletImpl::RunRequestQuery(RpcController* ctrl,
         response.set_msg("do not support multiple output row slices");
         return;
     }
+    ::fedb::base::QueryProfiler::Stage encode_stage("encode");
+    encode_stage.SetRowCnt(1);
     size_t buf_total_size;
     if (!codec::EncodeRpcRow(output, &buf, &buf_total_size)) {
         response.set_code(::fedb::base::kSQLRunError);
@@ -5494,6 +6896,50 @@ void TabletImpl::RunRequestQuery(RpcController* ctrl,
     response.set_code(::fedb::base::kOk);
 }
 
+void TabletImpl::RunCachedRequestQuery(RpcController* ctrl, const fedb::api::QueryRequest& request,
+                                       const ProcedureResultCacheOption& option,
+                                       ::hybridse::vm::RequestRunSession& session,
+                                       fedb::api::QueryResponse& response, butil::IOBuf& buf) {
+    auto& request_buf = static_cast<brpc::Controller*>(ctrl)->request_attachment();
+    std::string row;
+    std::string key;
+    if (request.row_size() > request_buf.size() ||
+        request_buf.copy_to(&row, request.row_size(), 0) != request.row_size() ||
+        !result_cache_->BuildKey(option, request.sp_name(), row, &key)) {
+        RunRequestQuery(ctrl, request, session, response, buf);
+        return;
+    }
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    ProcedureResult result;
+    bool hit = false;
+    {
+        ::fedb::base::QueryProfiler::Stage stage("result_cache");
+        hit = result_cache_->Get(key, cur_time, &result);
+        stage.SetRowCnt(hit ? 1 : 0);
+    }
+    if (hit) {
+        buf.append(result.buf);
+        response.set_schema(result.schema);
+        response.set_byte_size(result.byte_size);
+        response.set_count(1);
+        response.set_row_slices(1);
+        response.set_code(::fedb::base::kOk);
+        return;
+    }
+    // take the generations before running, a put in between drops the result
+    std::vector<ProcedureResultCache::Dependency> deps;
+    result_cache_->GetDependency(option, row, &deps);
+    size_t start = buf.size();
+    RunRequestQuery(ctrl, request, session, response, buf);
+    if (response.code() != ::fedb::base::kOk) {
+        return;
+    }
+    buf.append_to(&result.buf, buf.size() - start, start);
+    result.schema = response.schema();
+    result.byte_size = response.byte_size();
+    result_cache_->Insert(key, result, deps, cur_time + option.bucket_ms);
+}
+
 void TabletImpl::CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureInfo> sp_info) {
     const std::string& db_name = sp_info->GetDbName();
     const std::string& sp_name = sp_info->GetSpName();
@@ -5521,8 +6967,76 @@ void TabletImpl::CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureI
     }
     sp_cache_->InsertSQLProcedureCacheEntry(db_name, sp_name, sp_info, session.GetCompileInfo(),
                                             batch_session.GetCompileInfo());
+    plan_cache_->Erase(db_name, SQL_PLAN_SP_REQUEST, sp_name);
+    plan_cache_->Erase(db_name, SQL_PLAN_SP_BATCH_REQUEST, sp_name);
     LOG(INFO) << "refresh procedure success! sp_name: " << sp_name << ", db: " << db_name << ", sql: " << sql;
 }
 
+void TabletImpl::AddProcedureResultCache(const ::fedb::api::ProcedureInfo& sp_info) {
+    if (sp_info.result_cache_bucket_ms() == 0) {
+        result_cache_->DropProcedure(sp_info.db_name(), sp_info.sp_name());
+        return;
+    }
+    std::shared_ptr<Table> main_table;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (const auto& kv : tables_) {
+            for (const auto& pkv : kv.second) {
+                if (pkv.second->GetDB() == sp_info.db_name() && pkv.second->GetName() == sp_info.main_table()) {
+                    main_table = pkv.second;
+                    break;
+                }
+            }
+            if (main_table) break;
+        }
+    }
+    if (!main_table) {
+        DLOG(INFO) << "main table " << sp_info.main_table() << " has no partition here, skip result cache of "
+                   << sp_info.sp_name();
+        return;
+    }
+    auto option = std::make_shared<ProcedureResultCacheOption>();
+    option->bucket_ms = sp_info.result_cache_bucket_ms();
+    option->db = sp_info.db_name();
+    option->main_table = sp_info.main_table();
+    for (const auto& table : sp_info.tables()) {
+        if (table != sp_info.main_table()) {
+            option->tables.push_back(table);
+        }
+    }
+    option->input_schema = std::make_shared<::fedb::codec::Schema>(sp_info.input_schema());
+    std::map<std::string, uint32_t> col_map;
+    for (int idx = 0; idx < sp_info.input_schema_size(); idx++) {
+        col_map.emplace(sp_info.input_schema(idx).name(), idx);
+    }
+    for (const auto& column_key : main_table->GetTableMeta().column_key()) {
+        if (column_key.flag() != 0) {
+            continue;
+        }
+        if (option->ts_idx < 0 && column_key.ts_name_size() > 0) {
+            auto it = col_map.find(column_key.ts_name(0));
+            if (it != col_map.end()) {
+                option->ts_idx = it->second;
+            }
+        }
+        std::vector<uint32_t> cols;
+        for (const auto& name : column_key.col_name()) {
+            auto it = col_map.find(name);
+            if (it == col_map.end()) {
+                // the request can not tell the keys of this index
+                cols.clear();
+                break;
+            }
+            cols.push_back(it->second);
+        }
+        if (!cols.empty()) {
+            option->index_cols.push_back(cols);
+        }
+    }
+    result_cache_->AddProcedure(option, sp_info.sp_name());
+    LOG(INFO) << "enable result cache of procedure " << sp_info.sp_name() << " in db " << sp_info.db_name()
+              << " with bucket " << option->bucket_ms << "ms";
+}
+
 }  // namespace tablet
 }  // namespace fedb
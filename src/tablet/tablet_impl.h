@@ -19,6 +19,7 @@
 #define SRC_TABLET_TABLET_IMPL_H_
 
 #include <brpc/server.h>
+#include <bvar/bvar.h>
 #include <utility>
 #include <list>
 #include <map>
@@ -28,15 +29,23 @@
 #include <string>
 #include <vector>
 
+#include "base/count_down_latch.h"
+#include "base/query_profiler.h"
 #include "base/set.h"
 #include "base/spinlock.h"
 #include "catalog/tablet_catalog.h"
 #include "proto/tablet.pb.h"
 #include "replica/log_replicator.h"
+#include "storage/index_backfill.h"
 #include "storage/mem_table.h"
 #include "storage/mem_table_snapshot.h"
+#include "tablet/admission_control.h"
 #include "tablet/combine_iterator.h"
 #include "tablet/file_receiver.h"
+#include "tablet/load_scheduler.h"
+#include "tablet/procedure_result_cache.h"
+#include "tablet/rpc_metric.h"
+#include "tablet/sql_plan_cache.h"
 #include "common/thread_pool.h"
 #include "vm/engine.h"
 #include "zk/zk_client.h"
@@ -102,6 +111,14 @@ class SpCache : public hybridse::vm::CompileInfoCache {
         auto sp_it = sp_map_of_db.find(sp_name);
         return sp_it != sp_map_of_db.end();
     }
+    uint32_t GetProcedureCnt() {
+        std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+        uint32_t cnt = 0;
+        for (const auto& kv : db_sp_map_) {
+            cnt += kv.second.size();
+        }
+        return cnt;
+    }
     std::shared_ptr<hybridse::vm::CompileInfo> GetRequestInfo(const std::string& db, const std::string& sp_name,
                                                            hybridse::base::Status& status) override {  // NOLINT
         std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
@@ -164,6 +181,11 @@ class TabletImpl : public ::fedb::api::TabletServer {
 
     bool RegisterZK();
 
+    // snapshots every partition at its latest offset once the server stops
+    // serving, so the next start loads the snapshot and replays no binlog.
+    // the zk session is closed first so the nameserver fails over at once
+    void MakeSnapshotOnShutdown();
+
     void Put(RpcController* controller, const ::fedb::api::PutRequest* request,
              ::fedb::api::PutResponse* response, Closure* done);
 
@@ -174,6 +196,14 @@ class TabletImpl : public ::fedb::api::TabletServer {
               const ::fedb::api::ScanRequest* request,
               ::fedb::api::ScanResponse* response, Closure* done);
 
+    void BatchGet(RpcController* controller,
+                  const ::fedb::api::BatchGetRequest* request,
+                  ::fedb::api::BatchGetResponse* response, Closure* done);
+
+    void BatchScan(RpcController* controller,
+                   const ::fedb::api::BatchScanRequest* request,
+                   ::fedb::api::BatchScanResponse* response, Closure* done);
+
     void Delete(RpcController* controller,
                 const ::fedb::api::DeleteRequest* request,
                 ::fedb::api::GeneralResponse* response, Closure* done);
@@ -250,7 +280,7 @@ class TabletImpl : public ::fedb::api::TabletServer {
 
     void SendData(RpcController* controller,
                   const ::fedb::api::SendDataRequest* request,
-                  ::fedb::api::GeneralResponse* response, Closure* done);
+                  ::fedb::api::SendDataResponse* response, Closure* done);
 
     void GetTaskStatus(RpcController* controller,
                        const ::fedb::api::TaskStatusRequest* request,
@@ -282,6 +312,12 @@ class TabletImpl : public ::fedb::api::TabletServer {
                      const ::fedb::api::HttpRequest* request,
                      ::fedb::api::HttpResponse* response, Closure* done);
 
+    void ShowRpcMetric(RpcController* controller, const ::fedb::api::HttpRequest* request,
+                       ::fedb::api::HttpResponse* response, Closure* done);
+
+    void ShowMemoryUsage(RpcController* controller, const ::fedb::api::HttpRequest* request,
+                         ::fedb::api::HttpResponse* response, Closure* done);
+
     void GetAllSnapshotOffset(
         RpcController* controller, const ::fedb::api::EmptyRequest* request,
         ::fedb::api::TableSnapshotOffsetResponse* response, Closure* done);
@@ -343,6 +379,16 @@ class TabletImpl : public ::fedb::api::TabletServer {
                           ::fedb::api::GeneralResponse* response,
                           Closure* done);
 
+    void BackfillIndexData(RpcController* controller,
+                           const ::fedb::api::BackfillIndexDataRequest* request,
+                           ::fedb::api::GeneralResponse* response,
+                           Closure* done);
+
+    void PutIndexData(RpcController* controller,
+                      const ::fedb::api::PutIndexDataRequest* request,
+                      ::fedb::api::GeneralResponse* response,
+                      Closure* done);
+
     void AddIndex(RpcController* controller,
                   const ::fedb::api::AddIndexRequest* request,
                   ::fedb::api::GeneralResponse* response, Closure* done);
@@ -426,6 +472,30 @@ class TabletImpl : public ::fedb::api::TabletServer {
                                                        uint32_t pid);
     std::shared_ptr<Snapshot> GetSnapshot(uint32_t tid, uint32_t pid);
 
+    // compile sql with the plan cache in front of the engine
+    bool CompileSQL(const std::string& db, const std::string& sql,
+                    const std::string& option,
+                    ::hybridse::vm::RunSession& session,  // NOLINT
+                    ::hybridse::base::Status& status);    // NOLINT
+
+    // look up the compiled plan of a procedure, SpCache owns it
+    std::shared_ptr<hybridse::vm::CompileInfo> GetProcedureInfo(
+        const std::string& db, const std::string& sp_name, bool is_batch_request,
+        hybridse::base::Status& status);  // NOLINT
+
+    // a follower serves reads only after it has applied min_log_offset
+    int32_t CheckReadOffset(const std::shared_ptr<Table>& table,
+                            uint64_t min_log_offset, std::string* msg);
+
+    // resolve table and index shared by all keys of a batch query
+    int32_t GetBatchQueryIndex(uint32_t tid, uint32_t pid,
+                               const std::string& idx_name,
+                               const std::string& ts_name,
+                               std::shared_ptr<Table>* table, uint32_t* index,
+                               int* ts_index,
+                               ::fedb::storage::TTLSt* expired_value,
+                               std::string* msg);
+
     std::shared_ptr<Snapshot> GetSnapshotUnLock(uint32_t tid, uint32_t pid);
 
     void GcTable(uint32_t tid, uint32_t pid, bool execute_once);
@@ -441,6 +511,9 @@ class TabletImpl : public ::fedb::api::TabletServer {
     void MakeSnapshotInternal(uint32_t tid, uint32_t pid, uint64_t end_offset,
                               std::shared_ptr<::fedb::api::TaskInfo> task);
 
+    // flushes the binlog and snapshots the partition up to it, then counts down latch
+    void MakeSnapshotOnShutdownInternal(uint32_t tid, uint32_t pid, ::fedb::base::CountDownLatch* latch);
+
     void SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
                               uint32_t pid, uint32_t remote_tid,
                               std::shared_ptr<::fedb::api::TaskInfo> task);
@@ -467,14 +540,36 @@ class TabletImpl : public ::fedb::api::TabletServer {
         ::fedb::common::ColumnKey& column_key, uint32_t idx,  // NOLINT
         uint32_t partition_num, std::shared_ptr<::fedb::api::TaskInfo> task);
 
+    void BackfillIndexDataInternal(
+        std::shared_ptr<::fedb::storage::MemTable> table,
+        std::shared_ptr<::fedb::storage::IndexBackfill> backfill,
+        const std::map<uint32_t, std::string>& pid_endpoint_map,
+        std::shared_ptr<::fedb::api::TaskInfo> task);
+
+    // sends a batch of index entries to the leader of their partition. retries
+    // until the index is added there or load_index_max_wait_time passes
+    bool SendIndexEntries(const std::shared_ptr<::fedb::client::TabletClient>& client,
+                          ::fedb::api::PutIndexDataRequest* request,
+                          std::shared_ptr<::fedb::api::TaskInfo> task);
+
     void SchedMakeSnapshot();
 
     void GetDiskused();
 
+    void GetProcessMemoryUsage(::fedb::api::ProcessMemoryUsage* usage);
+
+    // walks the tables out of spin_mutex_ as it takes a while
+    void GetTableMemoryUsage(
+        const std::vector<std::pair<std::shared_ptr<Table>, ::fedb::api::TableStatus*>>& tables);
+
     void CheckZkClient();
 
     void RefreshTableInfo();
 
+    // applies the tables changed up to version from the change log. returns
+    // false if the whole catalog must be reloaded
+    bool RefreshChangedTables(uint64_t version);
+
     int32_t DeleteTableInternal(
         uint32_t tid, uint32_t pid,
         std::shared_ptr<::fedb::api::TaskInfo> task_ptr);
@@ -503,6 +598,10 @@ class TabletImpl : public ::fedb::api::TabletServer {
         std::shared_ptr<::fedb::api::TaskInfo>& task_ptr,  // NOLINT
         ::fedb::api::TaskStatus* status);
 
+    void SetTaskProgress(
+        std::shared_ptr<::fedb::api::TaskInfo>& task_ptr,  // NOLINT
+        const std::string& progress);
+
     std::shared_ptr<::fedb::api::TaskInfo> FindTask(
         uint64_t op_id, ::fedb::api::TaskType task_type);
 
@@ -564,8 +663,48 @@ class TabletImpl : public ::fedb::api::TabletServer {
         ::hybridse::vm::RequestRunSession& session, // NOLINT 
         fedb::api::QueryResponse& response, butil::IOBuf& buf); // NOLINT
 
+    // serve a procedure request from the result cache, run and fill it on a miss
+    void RunCachedRequestQuery(RpcController* controller,
+        const fedb::api::QueryRequest& request,
+        const ProcedureResultCacheOption& option,
+        ::hybridse::vm::RequestRunSession& session, // NOLINT
+        fedb::api::QueryResponse& response, butil::IOBuf& buf); // NOLINT
+
     void CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureInfo> sp_info);
 
+    // enable the result cache of a procedure if its main table has a partition here
+    void AddProcedureResultCache(const ::fedb::api::ProcedureInfo& sp_info);
+
+    void FillQueryProfile(const ::fedb::base::QueryProfiler& profiler, ::fedb::api::QueryProfile* profile);
+
+    // a request on a pid group spans several partitions and counts for the method only
+    template <class Request, class Response>
+    Closure* NewTableRpcMetricClosure(RpcMetricMethod method, const Request* request, const Response* response,
+                                      Closure* done) {
+        if (request->pid_group_size() > 0) {
+            return NewRpcMetricClosure(rpc_metric_.get(), method, response, done);
+        }
+        return NewRpcMetricClosure(rpc_metric_.get(), method, request->tid(), request->pid(), response, done);
+    }
+
+    // done is run and false returned if the rpc is rejected, otherwise done
+    // releases the admission. the sub queries are not limited, they are part
+    // of a query admitted on another tablet
+    template <class Response>
+    bool Admit(RpcClass rpc_class, Response* response, Closure** done) {
+        if (!admission_) {
+            return true;
+        }
+        if (!admission_->Acquire(rpc_class)) {
+            response->set_code(::fedb::base::ReturnCode::kServerOverloaded);
+            response->set_msg(std::string("too many ") + AdmissionController::GetClassName(rpc_class) + " rpcs");
+            (*done)->Run();
+            return false;
+        }
+        *done = new AdmissionClosure(admission_.get(), rpc_class, *done);
+        return true;
+    }
+
     Tables tables_;
     std::mutex mu_;
     SpinMutex spin_mutex_;
@@ -577,6 +716,9 @@ class TabletImpl : public ::fedb::api::TabletServer {
     ThreadPool task_pool_;
     ThreadPool io_pool_;
     ThreadPool snapshot_pool_;
+    LoadScheduler load_scheduler_;
+    // decodes the snapshot records of all the loading tables
+    std::shared_ptr<::fedb::base::TaskPool> load_pool_;
     std::map<uint64_t, std::list<std::shared_ptr<::fedb::api::TaskInfo>>>
         task_map_;
     std::set<std::string> sync_snapshot_set_;
@@ -595,7 +737,17 @@ class TabletImpl : public ::fedb::api::TabletServer {
     std::string zk_path_;
     std::string endpoint_;
     std::shared_ptr<SpCache> sp_cache_;
+    std::shared_ptr<SQLPlanCache> plan_cache_;
+    std::unique_ptr<bvar::PassiveStatus<uint64_t>> plan_cache_hit_;
+    std::unique_ptr<bvar::PassiveStatus<uint64_t>> plan_cache_miss_;
+    std::shared_ptr<ProcedureResultCache> result_cache_;
+    std::unique_ptr<bvar::PassiveStatus<uint64_t>> result_cache_hit_;
+    std::unique_ptr<bvar::PassiveStatus<uint64_t>> result_cache_miss_;
+    std::unique_ptr<bvar::PassiveStatus<uint64_t>> result_cache_bytes_;
     std::string notify_path_;
+    std::unique_ptr<RpcMetric> rpc_metric_;
+    // null if admission control is disabled
+    std::unique_ptr<AdmissionController> admission_;
     std::string sp_root_path_;
 };
 
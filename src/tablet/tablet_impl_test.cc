@@ -30,6 +30,7 @@
 #include "base/kv_iterator.h"
 #include "base/strings.h"
 #include "boost/lexical_cast.hpp"
+#include "brpc/controller.h"
 #include "codec/codec.h"
 #include "codec/flat_array.h"
 #include "codec/schema_codec.h"
@@ -53,6 +54,7 @@ DECLARE_string(db_root_path);
 DECLARE_string(recycle_bin_root_path);
 DECLARE_string(endpoint);
 DECLARE_uint32(recycle_ttl);
+DECLARE_uint32(scan_max_bytes_size);
 
 namespace fedb {
 namespace tablet {
@@ -1874,6 +1876,122 @@ TEST_F(TabletImplTest, Scan_with_limit) {
     ASSERT_EQ(2, (signed)srp.count());
 }
 
+TEST_F(TabletImplTest, BatchGetAndScan) {
+    TabletImpl tablet;
+    uint32_t id = counter++;
+    tablet.Init("");
+    ::fedb::api::CreateTableRequest request;
+    ::fedb::api::TableMeta* table_meta = request.mutable_table_meta();
+    table_meta->set_name("t0");
+    table_meta->set_tid(id);
+    table_meta->set_pid(1);
+    table_meta->set_ttl(0);
+    table_meta->set_wal(true);
+    ::fedb::api::CreateTableResponse response;
+    MockClosure closure;
+    tablet.CreateTable(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+    // key0 has one record, key1 has two records, key2 has none
+    for (uint32_t i = 0; i < 3; i++) {
+        ::fedb::api::PutRequest prequest;
+        prequest.set_pk(i == 0 ? "key0" : "key1");
+        prequest.set_time(9527 + i);
+        prequest.set_value("value" + std::to_string(i));
+        prequest.set_tid(id);
+        prequest.set_pid(1);
+        ::fedb::api::PutResponse presponse;
+        tablet.Put(NULL, &prequest, &presponse, &closure);
+        ASSERT_EQ(0, presponse.code());
+    }
+    {
+        ::fedb::api::BatchGetRequest gr;
+        gr.set_tid(id);
+        gr.set_pid(1);
+        gr.add_keys("key0");
+        gr.add_keys("key2");
+        gr.add_keys("key1");
+        ::fedb::api::BatchGetResponse grp;
+        brpc::Controller cntl;
+        tablet.BatchGet(&cntl, &gr, &grp, &closure);
+        ASSERT_EQ(0, grp.code());
+        ASSERT_EQ(3, grp.key_codes_size());
+        ASSERT_EQ(0, grp.key_codes(0));
+        ASSERT_EQ(::fedb::base::ReturnCode::kKeyNotFound, grp.key_codes(1));
+        ASSERT_EQ(0, grp.key_codes(2));
+        ASSERT_EQ(9527, (int64_t)grp.ts(0));
+        ASSERT_EQ(9529, (int64_t)grp.ts(2));
+        ASSERT_EQ(grp.buf_size(), cntl.response_attachment().size());
+        std::string value;
+        cntl.response_attachment().copy_to(&value, grp.buf_offsets(1) - grp.buf_offsets(0), grp.buf_offsets(0));
+        ASSERT_EQ("value0", value);
+        value.clear();
+        cntl.response_attachment().copy_to(&value, grp.buf_size() - grp.buf_offsets(2), grp.buf_offsets(2));
+        ASSERT_EQ("value2", value);
+    }
+    {
+        ::fedb::api::BatchScanRequest sr;
+        sr.set_tid(id);
+        sr.set_pid(1);
+        sr.add_keys("key1");
+        sr.add_keys("key2");
+        sr.add_keys("key0");
+        sr.set_st(9530);
+        sr.set_et(9526);
+        ::fedb::api::BatchScanResponse srp;
+        brpc::Controller cntl;
+        tablet.BatchScan(&cntl, &sr, &srp, &closure);
+        ASSERT_EQ(0, srp.code());
+        ASSERT_EQ(3, srp.counts_size());
+        ASSERT_EQ(2, (signed)srp.counts(0));
+        ASSERT_EQ(0, (signed)srp.counts(1));
+        ASSERT_EQ(1, (signed)srp.counts(2));
+        ASSERT_EQ(srp.buf_offsets(1), srp.buf_offsets(2));
+        ASSERT_EQ(srp.buf_size(), cntl.response_attachment().size());
+    }
+    {
+        // key1 uses up the byte budget, key0 and the keys after it are truncated
+        ::fedb::api::BatchScanRequest sr;
+        sr.set_tid(id);
+        sr.set_pid(1);
+        sr.add_keys("key1");
+        sr.set_st(9530);
+        sr.set_et(9526);
+        ::fedb::api::BatchScanResponse srp;
+        brpc::Controller cntl;
+        tablet.BatchScan(&cntl, &sr, &srp, &closure);
+        ASSERT_EQ(0, srp.code());
+        uint32_t old_max_bytes_size = FLAGS_scan_max_bytes_size;
+        FLAGS_scan_max_bytes_size = srp.buf_size() + 1;
+        sr.add_keys("key2");
+        sr.add_keys("key0");
+        sr.add_keys("key2");
+        ::fedb::api::BatchScanResponse truncated_srp;
+        brpc::Controller truncated_cntl;
+        tablet.BatchScan(&truncated_cntl, &sr, &truncated_srp, &closure);
+        FLAGS_scan_max_bytes_size = old_max_bytes_size;
+        ASSERT_EQ(0, truncated_srp.code());
+        ASSERT_EQ(4, truncated_srp.key_codes_size());
+        ASSERT_EQ(0, truncated_srp.key_codes(0));
+        ASSERT_EQ(::fedb::base::ReturnCode::kKeyNotFound, truncated_srp.key_codes(1));
+        ASSERT_EQ(::fedb::base::ReturnCode::kReacheTheScanMaxBytesSize, truncated_srp.key_codes(2));
+        ASSERT_EQ(::fedb::base::ReturnCode::kReacheTheScanMaxBytesSize, truncated_srp.key_codes(3));
+        ASSERT_EQ(2, (signed)truncated_srp.counts(0));
+        ASSERT_EQ(0, (signed)truncated_srp.counts(2));
+        ASSERT_EQ(srp.buf_size(), truncated_srp.buf_size());
+        ASSERT_EQ(truncated_srp.buf_size(), truncated_cntl.response_attachment().size());
+    }
+    {
+        ::fedb::api::BatchScanRequest sr;
+        sr.set_tid(id + 1000);
+        sr.set_pid(1);
+        sr.add_keys("key1");
+        ::fedb::api::BatchScanResponse srp;
+        brpc::Controller cntl;
+        tablet.BatchScan(&cntl, &sr, &srp, &closure);
+        ASSERT_EQ(::fedb::base::ReturnCode::kTableIsNotExist, srp.code());
+    }
+}
+
 TEST_F(TabletImplTest, Scan) {
     TabletImpl tablet;
     uint32_t id = counter++;
@@ -2430,6 +2548,88 @@ TEST_F(TabletImplTest, LoadWithDeletedKey) {
     }
 }
 
+TEST_F(TabletImplTest, LoadAfterSnapshotOnShutdown) {
+    uint32_t id = counter++;
+    MockClosure closure;
+    {
+        TabletImpl tablet;
+        tablet.Init("");
+        ::fedb::api::CreateTableRequest request;
+        ::fedb::api::TableMeta* table_meta = request.mutable_table_meta();
+        table_meta->set_name("t0");
+        table_meta->set_tid(id);
+        table_meta->set_pid(1);
+        table_meta->set_ttl(0);
+        table_meta->set_seg_cnt(8);
+        table_meta->set_term(1024);
+        ::fedb::common::ColumnDesc* column_desc = table_meta->add_column_desc();
+        column_desc->set_name("card");
+        column_desc->set_type("string");
+        column_desc->set_add_ts_idx(true);
+        table_meta->set_mode(::fedb::api::TableMode::kTableLeader);
+        ::fedb::api::CreateTableResponse response;
+        tablet.CreateTable(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+        for (int i = 0; i < 5; i++) {
+            ::fedb::api::PutRequest request;
+            request.set_time(1100);
+            request.set_value("test");
+            request.set_tid(id);
+            request.set_pid(1);
+            ::fedb::api::Dimension* dim = request.add_dimensions();
+            dim->set_idx(0);
+            dim->set_key("card" + std::to_string(i));
+            ::fedb::api::PutResponse response;
+            tablet.Put(NULL, &request, &response, &closure);
+            ASSERT_EQ(0, response.code());
+        }
+        tablet.MakeSnapshotOnShutdown();
+    }
+    // the restart can only recover the rows from the snapshot
+    ::fedb::base::RemoveDirRecursive(FLAGS_db_root_path + "/" + std::to_string(id) + "_1/binlog");
+    {
+        TabletImpl tablet;
+        tablet.Init("");
+        ::fedb::api::LoadTableRequest request;
+        ::fedb::api::TableMeta* table_meta = request.mutable_table_meta();
+        table_meta->set_name("t0");
+        table_meta->set_tid(id);
+        table_meta->set_pid(1);
+        table_meta->set_ttl(0);
+        table_meta->set_mode(::fedb::api::TableMode::kTableLeader);
+        ::fedb::api::GeneralResponse response;
+        tablet.LoadTable(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+        sleep(1);
+        for (int i = 0; i < 5; i++) {
+            ::fedb::api::ScanRequest sr;
+            sr.set_tid(id);
+            sr.set_pid(1);
+            sr.set_pk("card" + std::to_string(i));
+            sr.set_idx_name("card");
+            sr.set_st(1200);
+            sr.set_et(1000);
+            ::fedb::api::ScanResponse srp;
+            tablet.Scan(NULL, &sr, &srp, &closure);
+            ASSERT_EQ(0, srp.code());
+            ASSERT_EQ(1, (signed)srp.count());
+        }
+        ::fedb::api::GetTableStatusRequest gr;
+        ::fedb::api::GetTableStatusResponse gres;
+        tablet.GetTableStatus(NULL, &gr, &gres, &closure);
+        ASSERT_EQ(0, gres.code());
+        bool checked = false;
+        for (int32_t i = 0; i < gres.all_table_status_size(); i++) {
+            const ::fedb::api::TableStatus& ts = gres.all_table_status(i);
+            if (ts.tid() == id) {
+                ASSERT_EQ(5u, ts.offset());
+                checked = true;
+            }
+        }
+        ASSERT_TRUE(checked);
+    }
+}
+
 TEST_F(TabletImplTest, Load_with_incomplete_binlog) {
     int old_offset = FLAGS_make_snapshot_threshold_offset;
     int old_interval = FLAGS_binlog_delete_interval;
@@ -2740,6 +2940,62 @@ TEST_F(TabletImplTest, DropTableFollower) {
     ASSERT_EQ(0, response.code());
 }
 
+TEST_F(TabletImplTest, FollowerReadWithMinOffset) {
+    TabletImpl tablet;
+    tablet.Init("");
+    MockClosure closure;
+    uint32_t id = counter++;
+    ::fedb::api::CreateTableRequest request;
+    ::fedb::api::TableMeta* table_meta = request.mutable_table_meta();
+    table_meta->set_name("t0");
+    table_meta->set_tid(id);
+    table_meta->set_pid(1);
+    table_meta->set_ttl(0);
+    ::fedb::api::CreateTableResponse response;
+    tablet.CreateTable(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+    for (uint64_t i = 1; i <= 2; i++) {
+        ::fedb::api::PutRequest prequest;
+        prequest.set_pk("test1");
+        prequest.set_time(9527 + i);
+        prequest.set_value("test0");
+        prequest.set_tid(id);
+        prequest.set_pid(1);
+        ::fedb::api::PutResponse presponse;
+        tablet.Put(NULL, &prequest, &presponse, &closure);
+        ASSERT_EQ(0, presponse.code());
+        ASSERT_EQ(i, presponse.log_offset());
+    }
+    // the leader ignores min_log_offset
+    ::fedb::api::ScanRequest sr;
+    sr.set_tid(id);
+    sr.set_pid(1);
+    sr.set_pk("test1");
+    sr.set_st(0);
+    sr.set_et(0);
+    sr.set_min_log_offset(100);
+    ::fedb::api::ScanResponse srp;
+    tablet.Scan(NULL, &sr, &srp, &closure);
+    ASSERT_EQ(0, srp.code());
+    ASSERT_EQ(2u, srp.count());
+
+    uint32_t follower_id = counter++;
+    table_meta->set_tid(follower_id);
+    table_meta->set_mode(::fedb::api::TableMode::kTableFollower);
+    tablet.CreateTable(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+    sr.set_tid(follower_id);
+    sr.set_min_log_offset(1);
+    srp.Clear();
+    tablet.Scan(NULL, &sr, &srp, &closure);
+    ASSERT_EQ(::fedb::base::ReturnCode::kReplicaOffsetBehind, srp.code());
+    sr.clear_min_log_offset();
+    srp.Clear();
+    tablet.Scan(NULL, &sr, &srp, &closure);
+    ASSERT_EQ(0, srp.code());
+    ASSERT_EQ(0u, srp.count());
+}
+
 TEST_F(TabletImplTest, TestGetType) {
     TabletImpl tablet;
     uint32_t id = counter++;